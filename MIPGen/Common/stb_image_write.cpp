@@ -148,8 +148,13 @@ LICENSE
 
 */
 
+#include "ParallelDeflate.h"
+
+#define STBIW_ZLIB_COMPRESS ParallelDeflate::Compress
 #define STB_IMAGE_WRITE_IMPLEMENTATION
+#ifdef _MSC_VER
 #define __STDC_LIB_EXT1__
+#endif
 #include "stb_image_write.h"
 
 /*
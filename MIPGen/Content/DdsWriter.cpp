@@ -0,0 +1,175 @@
+//--------------------------------------------------------------------------------------
+// Copyright (c) XU, Tianchen. All rights reserved.
+//--------------------------------------------------------------------------------------
+
+#include <algorithm>
+#include <fstream>
+#include "DdsWriter.h"
+
+using namespace std;
+
+namespace DdsWriter
+{
+	static const uint32_t Magic = 0x20534444;	// "DDS "
+	static const uint32_t FourCCDX10 = 'D' | ('X' << 8) | ('1' << 16) | ('0' << 24);
+
+	// DDS_HEADER flags and caps
+	static const uint32_t FlagCaps = 0x1;
+	static const uint32_t FlagHeight = 0x2;
+	static const uint32_t FlagWidth = 0x4;
+	static const uint32_t FlagPitch = 0x8;
+	static const uint32_t FlagPixelFormat = 0x1000;
+	static const uint32_t FlagMipMapCount = 0x20000;
+	static const uint32_t FlagLinearSize = 0x80000;
+	static const uint32_t PixelFormatFourCC = 0x4;
+	static const uint32_t CapsComplex = 0x8;
+	static const uint32_t CapsTexture = 0x1000;
+	static const uint32_t CapsMipMap = 0x400000;
+	static const uint32_t Caps2CubeMapAllFaces = 0xfe00;
+
+	// DDS_HEADER_DXT10
+	static const uint32_t ResourceDimensionTexture2D = 3;
+	static const uint32_t MiscFlagTextureCube = 0x4;
+
+	struct DdsPixelFormat
+	{
+		uint32_t Size;
+		uint32_t Flags;
+		uint32_t FourCC;
+		uint32_t RGBBitCount;
+		uint32_t RBitMask;
+		uint32_t GBitMask;
+		uint32_t BBitMask;
+		uint32_t ABitMask;
+	};
+
+	struct DdsHeader
+	{
+		uint32_t Size;
+		uint32_t Flags;
+		uint32_t Height;
+		uint32_t Width;
+		uint32_t PitchOrLinearSize;
+		uint32_t Depth;
+		uint32_t MipMapCount;
+		uint32_t Reserved1[11];
+		DdsPixelFormat PixelFormat;
+		uint32_t Caps;
+		uint32_t Caps2;
+		uint32_t Caps3;
+		uint32_t Caps4;
+		uint32_t Reserved2;
+	};
+
+	struct DdsHeaderDX10
+	{
+		uint32_t DxgiFormat;
+		uint32_t ResourceDimension;
+		uint32_t MiscFlag;
+		uint32_t ArraySize;
+		uint32_t MiscFlags2;
+	};
+
+	static_assert(sizeof(DdsPixelFormat) == 32 && sizeof(DdsHeader) == 124 && sizeof(DdsHeaderDX10) == 20,
+		"DDS headers are packed 32-bit fields");
+
+	// Bytes per 4x4 block of the BC formats, 0 for the others
+	static uint32_t GetBlockBytes(uint32_t format)
+	{
+		if ((format >= 70 && format <= 72) || (format >= 79 && format <= 81)) return 8;	// BC1, BC4
+		if ((format >= 73 && format <= 78) || (format >= 82 && format <= 84) ||
+			(format >= 94 && format <= 99)) return 16;	// BC2, BC3, BC5, BC6H, BC7
+
+		return 0;
+	}
+
+	// Bits per texel of the uncompressed formats, from the ranges of DXGI_FORMAT; 0 for the
+	// formats not taken: sub-byte, packed 4:2:2 and the video ones
+	static uint32_t GetBitsPerTexel(uint32_t format)
+	{
+		if (format >= 1 && format <= 4) return 128;		// R32G32B32A32
+		if (format >= 5 && format <= 8) return 96;		// R32G32B32
+		if (format >= 9 && format <= 22) return 64;		// R16G16B16A16, R32G32, R32G8X24
+		if (format >= 23 && format <= 47) return 32;	// R10G10B10A2 to R24G8
+		if (format >= 48 && format <= 59) return 16;	// R8G8, R16
+		if (format >= 60 && format <= 65) return 8;		// R8, A8
+		if (format == 67 || (format >= 87 && format <= 93)) return 32;	// R9G9B9E5, B8G8R8A8
+		if (format == 85 || format == 86 || format == 115) return 16;	// B5G6R5, B5G5R5A1, B4G4R4A4
+
+		return 0;
+	}
+
+	bool GetSurfaceInfo(uint32_t format, uint32_t width, uint32_t height, uint32_t& rowBytes, uint32_t& numRows)
+	{
+		const auto blockBytes = GetBlockBytes(format);
+		if (blockBytes)
+		{
+			rowBytes = blockBytes * ((width + 3) / 4);
+			numRows = (height + 3) / 4;
+
+			return true;
+		}
+
+		const auto bitsPerTexel = GetBitsPerTexel(format);
+		rowBytes = bitsPerTexel / 8 * width;
+		numRows = height;
+
+		return bitsPerTexel > 0;
+	}
+
+	bool Write(const char* fileName, uint32_t format, uint32_t width, uint32_t height, uint32_t mipLevels,
+		uint32_t arraySize, const Subresource* pSubresources, bool isCubeMap, AlphaMode alphaMode)
+	{
+		uint32_t rowBytes, numRows;
+		if (!fileName || !pSubresources || !width || !height || !mipLevels || !arraySize ||
+			(isCubeMap && arraySize % 6) || !GetSurfaceInfo(format, width, height, rowBytes, numRows))
+			return false;
+
+		ofstream file(fileName, ios::out | ios::binary);
+		if (!file) return false;
+
+		const auto isCompressed = GetBlockBytes(format) > 0;
+		DdsHeader header = {};
+		header.Size = sizeof(DdsHeader);
+		header.Flags = FlagCaps | FlagHeight | FlagWidth | FlagPixelFormat |
+			(isCompressed ? FlagLinearSize : FlagPitch) | (mipLevels > 1 ? FlagMipMapCount : 0);
+		header.Height = height;
+		header.Width = width;
+		header.PitchOrLinearSize = isCompressed ? rowBytes * numRows : rowBytes;
+		header.Depth = 1;
+		header.MipMapCount = mipLevels;
+		header.PixelFormat.Size = sizeof(DdsPixelFormat);
+		header.PixelFormat.Flags = PixelFormatFourCC;
+		header.PixelFormat.FourCC = FourCCDX10;
+		header.Caps = CapsTexture | (mipLevels > 1 || arraySize > 1 ? CapsComplex : 0) | (mipLevels > 1 ? CapsMipMap : 0);
+		header.Caps2 = isCubeMap ? Caps2CubeMapAllFaces : 0;
+
+		DdsHeaderDX10 headerDX10 = {};
+		headerDX10.DxgiFormat = format;
+		headerDX10.ResourceDimension = ResourceDimensionTexture2D;
+		headerDX10.MiscFlag = isCubeMap ? MiscFlagTextureCube : 0;
+		headerDX10.ArraySize = isCubeMap ? arraySize / 6 : arraySize;
+		headerDX10.MiscFlags2 = alphaMode;
+
+		file.write(reinterpret_cast<const char*>(&Magic), sizeof(Magic));
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		file.write(reinterpret_cast<const char*>(&headerDX10), sizeof(headerDX10));
+
+		// Subresources in index order, each level of a slice with its rows tightly packed
+		for (auto i = 0u; i < mipLevels * arraySize; ++i)
+		{
+			const auto level = i % mipLevels;
+			GetSurfaceInfo(format, (max)(width >> level, 1u), (max)(height >> level, 1u), rowBytes, numRows);
+
+			const auto& subresource = pSubresources[i];
+			const auto pData = static_cast<const char*>(subresource.pData);
+			if (!pData) return false;
+			if (subresource.RowPitch == rowBytes) file.write(pData, static_cast<streamsize>(rowBytes) * numRows);
+			else for (auto y = 0u; y < numRows; ++y)
+				file.write(&pData[static_cast<size_t>(subresource.RowPitch) * y], rowBytes);
+		}
+		file.close();
+
+		return !file.fail();
+	}
+}
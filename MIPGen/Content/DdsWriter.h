@@ -0,0 +1,45 @@
+//--------------------------------------------------------------------------------------
+// Copyright (c) XU, Tianchen. All rights reserved.
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <cstdint>
+
+//--------------------------------------------------------------------------------------
+// DDS writer, the counterpart of XUSG::DDS::Loader: a 2D texture, texture array or cube
+// map with its MIP chain, in one file with the DX10 header extension, so that any DXGI
+// format round-trips. The subresources are written in the order of D3D12 subresource
+// indices (every level of array slice 0, then of slice 1, ...), which is that of DDS,
+// each one with its rows tightly packed.
+//--------------------------------------------------------------------------------------
+namespace DdsWriter
+{
+	// As DDS::AlphaMode of XUSGTextureLoader.h, the miscFlags2 of the DX10 header
+	enum AlphaMode : uint8_t
+	{
+		ALPHA_MODE_UNKNOWN,
+		ALPHA_MODE_STRAIGHT,
+		ALPHA_MODE_PREMULTIPLIED,
+		ALPHA_MODE_OPAQUE,
+		ALPHA_MODE_CUSTOM
+	};
+
+	// A subresource in memory: rows (of blocks for BC formats) rowPitch bytes apart, as
+	// a CPU level or a GPU read-back placed with D3D12_PLACED_SUBRESOURCE_FOOTPRINT
+	struct Subresource
+	{
+		const void* pData;
+		uint32_t RowPitch;
+	};
+
+	// format is a DXGI_FORMAT, which XUSG::Format shares the values of: the uncompressed
+	// formats of whole bytes per texel, and BC1 to BC7. For cube maps, arraySize counts the
+	// faces, a multiple of 6. pSubresources holds mipLevels * arraySize subresources.
+	bool Write(const char* fileName, uint32_t format, uint32_t width, uint32_t height, uint32_t mipLevels,
+		uint32_t arraySize, const Subresource* pSubresources, bool isCubeMap = false,
+		AlphaMode alphaMode = ALPHA_MODE_UNKNOWN);
+
+	// Bytes per row and rows of a level, in blocks for BC formats; false for the formats not taken
+	bool GetSurfaceInfo(uint32_t format, uint32_t width, uint32_t height, uint32_t& rowBytes, uint32_t& numRows);
+}
@@ -0,0 +1,282 @@
+//--------------------------------------------------------------------------------------
+// Copyright (c) XU, Tianchen. All rights reserved.
+//--------------------------------------------------------------------------------------
+
+#include <algorithm>
+#include <memory>
+
+// A private instance of the JPEG decoder of stb_image, for its internals, most of which
+// go unused here
+#if defined(_MSC_VER)
+#pragma warning(push)
+#pragma warning(disable: 4100 4505)
+#elif defined(__GNUC__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-function"
+#pragma GCC diagnostic ignored "-Wunused-parameter"
+#endif
+#define STB_IMAGE_STATIC
+#define STBI_ONLY_JPEG
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+#if defined(_MSC_VER)
+#pragma warning(pop)
+#elif defined(__GNUC__)
+#pragma GCC diagnostic pop
+#endif
+
+#include "JpegDecoder.h"
+
+using namespace std;
+
+namespace JpegDecoder
+{
+	// Image being decoded by the thread, and the reduction of its blocks, for the IDCT kernel
+	static thread_local const stbi__jpeg* g_pJpeg = nullptr;
+	static thread_local uint32_t g_scaleShift = 0;
+
+	static inline uint8_t ClampToByte(int value)
+	{
+		return static_cast<uint8_t>(value < 0 ? 0 : (value > 0xff ? 0xff : value));
+	}
+
+	//--------------------------------------------------------------------------------------
+	// Reduced IDCTs, the scaled IDCTs of libjpeg: the N-point IDCT of the NxN dequantized
+	// coefficients in the low-frequency corner of a block, the others dropped, scaled by
+	// sqrt(N / 8) per dimension to keep the DC level. The outputs sample the truncated
+	// spectrum: they are close to the means of the 8 / N x 8 / N pixels they stand for, and
+	// equal to them only for 1x1, the DC alone. 2x2 and 1x1 reduce to sums of the coefficients.
+	//--------------------------------------------------------------------------------------
+	static void Idct4x4(uint8_t* pDst, uint32_t dstStride, const short coeffs[64])
+	{
+		// sqrt(1 / 8), which is also cos(pi / 4) / 2, and cos(pi / 8) / 2 and cos(3 pi / 8) / 2
+		static const auto c0 = 0.353553391f;
+		static const auto c1 = 0.461939766f;
+		static const auto c3 = 0.191341716f;
+
+		// Columns, then rows, the outputs biased by 128 and rounded (the negative ones clamp to 0
+		// whichever way they round)
+		float values[4][4];
+		for (auto u = 0u; u < 4; ++u)
+		{
+			const auto pCol = &coeffs[u];
+			const auto e0 = c0 * (pCol[0] + pCol[16]);
+			const auto e1 = c0 * (pCol[0] - pCol[16]);
+			const auto o0 = c1 * pCol[8] + c3 * pCol[24];
+			const auto o1 = c3 * pCol[8] - c1 * pCol[24];
+			values[0][u] = e0 + o0;
+			values[1][u] = e1 + o1;
+			values[2][u] = e1 - o1;
+			values[3][u] = e0 - o0;
+		}
+
+		for (auto y = 0u; y < 4; ++y, pDst += dstStride)
+		{
+			const auto pRow = values[y];
+			const auto e0 = c0 * (pRow[0] + pRow[2]) + 128.5f;
+			const auto e1 = c0 * (pRow[0] - pRow[2]) + 128.5f;
+			const auto o0 = c1 * pRow[1] + c3 * pRow[3];
+			const auto o1 = c3 * pRow[1] - c1 * pRow[3];
+			pDst[0] = ClampToByte(static_cast<int>(e0 + o0));
+			pDst[1] = ClampToByte(static_cast<int>(e1 + o1));
+			pDst[2] = ClampToByte(static_cast<int>(e1 - o1));
+			pDst[3] = ClampToByte(static_cast<int>(e0 - o0));
+		}
+	}
+
+	static void Idct2x2(uint8_t* pDst, uint32_t dstStride, const short coeffs[64])
+	{
+		// The 2-point IDCT in both dimensions: (F00 +- F01 +- F10 +- F11) / 8, biased by 128 and rounded
+		const auto s0 = coeffs[0] + coeffs[8] + (128 << 3) + 4;
+		const auto s1 = coeffs[0] - coeffs[8] + (128 << 3) + 4;
+		const auto d0 = coeffs[1] + coeffs[9];
+		const auto d1 = coeffs[1] - coeffs[9];
+		pDst[0] = ClampToByte((s0 + d0) >> 3);
+		pDst[1] = ClampToByte((s0 - d0) >> 3);
+		pDst[dstStride] = ClampToByte((s1 + d1) >> 3);
+		pDst[dstStride + 1] = ClampToByte((s1 - d1) >> 3);
+	}
+
+	static void Idct1x1(uint8_t* pDst, uint32_t, const short coeffs[64])
+	{
+		*pDst = ClampToByte((coeffs[0] + (128 << 3) + 4) >> 3);
+	}
+
+	//--------------------------------------------------------------------------------------
+	// The idct_block_kernel of stb_image, writing the reduced blocks tightly packed within
+	// the plane of their component: the block of the full-size plane at (x, y) lands at
+	// (x, y) >> scaleShift of a plane with a pitch of w2 >> scaleShift. The blocks never
+	// overlap, and the planes are read after all of them are written.
+	//--------------------------------------------------------------------------------------
+	static void IdctBlockReduced(stbi_uc* out, int out_stride, short data[64])
+	{
+		const auto& jpeg = *g_pJpeg;
+		for (auto i = 0; i < jpeg.s->img_n; ++i)
+		{
+			const auto& comp = jpeg.img_comp[i];
+			const auto offset = out - comp.data;
+			if (offset < 0 || offset >= static_cast<ptrdiff_t>(comp.w2) * comp.h2) continue;
+
+			const auto x = static_cast<uint32_t>(offset % out_stride) >> g_scaleShift;
+			const auto y = static_cast<uint32_t>(offset / out_stride) >> g_scaleShift;
+			const auto pitch = static_cast<uint32_t>(out_stride) >> g_scaleShift;
+			const auto pDst = &comp.data[static_cast<size_t>(pitch) * y + x];
+			switch (g_scaleShift)
+			{
+			case 1:
+				Idct4x4(pDst, pitch, data);
+				break;
+			case 2:
+				Idct2x2(pDst, pitch, data);
+				break;
+			default:
+				Idct1x1(pDst, pitch, data);
+			}
+
+			return;
+		}
+	}
+
+	//--------------------------------------------------------------------------------------
+	// Decoding, then upsampling and color conversion at the reduced size, following
+	// load_jpeg_image() of stb_image
+	//--------------------------------------------------------------------------------------
+	static uint8_t* Decode(stbi__jpeg& jpeg, uint32_t scaleShift, int* pWidth, int* pHeight, int* pChannels, int reqChannels)
+	{
+		jpeg.s->img_n = 0;	// Makes stbi__cleanup_jpeg() safe
+		if (scaleShift > 0) jpeg.idct_block_kernel = IdctBlockReduced;
+		g_pJpeg = &jpeg;
+		g_scaleShift = scaleShift;
+		const auto isDecoded = stbi__decode_jpeg_image(&jpeg) != 0;
+		g_pJpeg = nullptr;
+
+		const auto numComps = jpeg.s->img_n;
+		if (!isDecoded || (numComps != 1 && numComps != 3))
+		{
+			stbi__cleanup_jpeg(&jpeg);
+
+			return nullptr;
+		}
+
+		const auto numChannels = reqChannels ? reqChannels : numComps;
+		const auto isRGB = numComps == 3 && (jpeg.rgb == 3 || (jpeg.app14_color_transform == 0 && !jpeg.jfif));
+		const auto numDecodeComps = numComps == 3 && numChannels < 3 && !isRGB ? 1 : numComps;
+		const auto width = (max)(jpeg.s->img_x >> scaleShift, 1u);
+		const auto height = (max)(jpeg.s->img_y >> scaleShift, 1u);
+
+		stbi__resample resamples[3];
+		uint32_t compHeights[3], compPitches[3];
+		for (auto k = 0; k < numDecodeComps; ++k)
+		{
+			auto& comp = jpeg.img_comp[k];
+			auto& r = resamples[k];
+
+			// Line buffer for upsampling off the edges by up to 4, freed by stbi__cleanup_jpeg()
+			comp.linebuf = static_cast<stbi_uc*>(stbi__malloc(width + 3));
+			if (!comp.linebuf)
+			{
+				stbi__cleanup_jpeg(&jpeg);
+
+				return nullptr;
+			}
+
+			r.hs = jpeg.img_h_max / comp.h;
+			r.vs = jpeg.img_v_max / comp.v;
+			r.ystep = r.vs >> 1;
+			r.w_lores = (width + r.hs - 1) / r.hs;
+			r.ypos = 0;
+			r.line0 = r.line1 = comp.data;
+			if (r.hs == 1 && r.vs == 1) r.resample = resample_row_1;
+			else if (r.hs == 1 && r.vs == 2) r.resample = stbi__resample_row_v_2;
+			else if (r.hs == 2 && r.vs == 1) r.resample = stbi__resample_row_h_2;
+			else if (r.hs == 2 && r.vs == 2) r.resample = jpeg.resample_row_hv_2_kernel;
+			else r.resample = stbi__resample_row_generic;
+
+			compHeights[k] = (height * comp.v + jpeg.img_v_max - 1) / jpeg.img_v_max;
+			compPitches[k] = comp.w2 >> scaleShift;
+		}
+
+		// A byte to spare, for the fourth one the scalar YCbCr_to_RGB_kernel writes past the last pixel
+		const auto pOutput = static_cast<uint8_t*>(stbi__malloc_mad3(numChannels, width, height, 1));
+		if (!pOutput)
+		{
+			stbi__cleanup_jpeg(&jpeg);
+
+			return nullptr;
+		}
+
+		for (auto j = 0u; j < height; ++j)
+		{
+			const stbi_uc* rows[3] = {};
+			for (auto k = 0; k < numDecodeComps; ++k)
+			{
+				auto& r = resamples[k];
+				const auto isBottom = r.ystep >= (r.vs >> 1);
+				rows[k] = r.resample(jpeg.img_comp[k].linebuf, isBottom ? r.line1 : r.line0,
+					isBottom ? r.line0 : r.line1, r.w_lores, r.hs);
+				if (++r.ystep >= r.vs)
+				{
+					r.ystep = 0;
+					r.line0 = r.line1;
+					if (static_cast<uint32_t>(++r.ypos) < compHeights[k]) r.line1 += compPitches[k];
+				}
+			}
+
+			auto pOut = &pOutput[static_cast<size_t>(numChannels) * width * j];
+			const auto pY = rows[0];
+			if (numChannels >= 3)
+			{
+				if (numComps == 1) for (auto i = 0u; i < width; ++i, pOut += numChannels)
+				{
+					pOut[0] = pOut[1] = pOut[2] = pY[i];
+					if (numChannels == 4) pOut[3] = 0xff;
+				}
+				else if (isRGB) for (auto i = 0u; i < width; ++i, pOut += numChannels)
+				{
+					pOut[0] = pY[i];
+					pOut[1] = rows[1][i];
+					pOut[2] = rows[2][i];
+					if (numChannels == 4) pOut[3] = 0xff;
+				}
+				else jpeg.YCbCr_to_RGB_kernel(pOut, pY, rows[1], rows[2], width, numChannels);
+			}
+			else for (auto i = 0u; i < width; ++i)
+			{
+				*pOut++ = isRGB ? stbi__compute_y(pY[i], rows[1][i], rows[2][i]) : pY[i];
+				if (numChannels == 2) *pOut++ = 0xff;
+			}
+		}
+		stbi__cleanup_jpeg(&jpeg);
+
+		*pWidth = static_cast<int>(width);
+		*pHeight = static_cast<int>(height);
+		if (pChannels) *pChannels = numComps;
+
+		return pOutput;
+	}
+
+	uint8_t* Load(const char* fileName, uint32_t scaleShift, int* pWidth, int* pHeight, int* pChannels, int reqChannels)
+	{
+		if (!fileName || !pWidth || !pHeight || scaleShift > MaxScaleShift || reqChannels < 0 || reqChannels > 4)
+			return nullptr;
+
+		const auto pFile = stbi__fopen(fileName, "rb");
+		if (!pFile) return nullptr;
+
+		stbi__context context;
+		stbi__start_file(&context, pFile);
+
+		uint8_t* pImageData = nullptr;
+		if (stbi__jpeg_test(&context))
+		{
+			// Zero-initialized, as stbi__jpeg_load() does
+			const auto pJpeg = make_unique<stbi__jpeg>();
+			pJpeg->s = &context;
+			stbi__setup_jpeg(pJpeg.get());
+			pImageData = Decode(*pJpeg, scaleShift, pWidth, pHeight, pChannels, reqChannels);
+		}
+		fclose(pFile);
+
+		return pImageData;
+	}
+}
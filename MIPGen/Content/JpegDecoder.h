@@ -0,0 +1,27 @@
+//--------------------------------------------------------------------------------------
+// Copyright (c) XU, Tianchen. All rights reserved.
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <cstdint>
+
+//--------------------------------------------------------------------------------------
+// JPEG decoder at 1/2, 1/4 or 1/8 of the size, for the callers needing only the lower
+// levels: the entropy-coded data is decoded by a private instance of stb_image, and each
+// 8x8 block of coefficients is turned into 4x4, 2x2 or 1x1 pixels by an IDCT of its
+// low-frequency corner alone, so that the image never exists at full resolution. The
+// chroma is then upsampled and converted at the reduced size, as stb_image does.
+// It takes the grayscale and 3-component files; CMYK and YCCK ones are left to stb_image.
+//--------------------------------------------------------------------------------------
+namespace JpegDecoder
+{
+	static const uint32_t MaxScaleShift = 3;	// 8x8 blocks down to 1x1
+
+	// As stbi_load() of the file reduced by 2^scaleShift, the size of that MIP level of the
+	// full image, (max)(size >> scaleShift, 1): *pChannels is that of the file, and the result
+	// has reqChannels (0 for that of the file) channels, allocated with malloc() so that
+	// stbi_image_free() releases it. Returns nullptr for files other than JPEG, for those it
+	// does not take, and on any error.
+	uint8_t* Load(const char* fileName, uint32_t scaleShift, int* pWidth, int* pHeight, int* pChannels, int reqChannels);
+}
@@ -3,6 +3,7 @@
 //--------------------------------------------------------------------------------------
 
 #include "MipGenerator.h"
+#include "DdsWriter.h"
 
 #define _ENABLE_STB_IMAGE_LOADER_ONLY_
 #include "Advanced/XUSGTextureLoader.h"
@@ -105,6 +106,45 @@ void MipGenerator::Visualize(CommandList* pCommandList, RenderTarget* pRenderTar
 		m_samplerTable, 0, m_pipelines[BLIT_2D_GRAPHICS]);
 }
 
+bool MipGenerator::ReadBack(CommandList* pCommandList, ResourceState dstState)
+{
+	// A buffer per level, so that each one starts at offset 0, with the row pitch returned
+	const auto numMips = GetMipLevelCount();
+	m_readBuffers.resize(numMips);
+	m_rowPitches.resize(numMips);
+	for (auto i = 0u; i < numMips; ++i)
+	{
+		if (!m_readBuffers[i]) m_readBuffers[i] = Buffer::MakeUnique();
+		XUSG_N_RETURN(m_mipmaps->ReadBack(pCommandList, m_readBuffers[i].get(), &m_rowPitches[i],
+			1, i, 0, dstState), false);
+	}
+
+	return true;
+}
+
+bool MipGenerator::SaveDDS(const char* fileName)
+{
+	const auto numMips = static_cast<uint32_t>(m_readBuffers.size());
+	if (!numMips) return false;
+
+	vector<DdsWriter::Subresource> subresources(numMips);
+	auto numMapped = 0u;
+	for (; numMapped < numMips; ++numMapped)
+	{
+		auto& subresource = subresources[numMapped];
+		subresource.pData = m_readBuffers[numMapped]->Map(nullptr);
+		subresource.RowPitch = m_rowPitches[numMapped];
+		if (!subresource.pData) break;
+	}
+
+	// Straight from the pitched rows of the buffers
+	const auto result = numMapped == numMips && DdsWriter::Write(fileName, static_cast<uint32_t>(m_mipmaps->GetFormat()),
+		m_imageSize.x, m_imageSize.y, numMips, 1, subresources.data());
+	for (auto i = 0u; i < numMapped; ++i) m_readBuffers[i]->Unmap();
+
+	return result;
+}
+
 uint32_t MipGenerator::GetMipLevelCount() const
 {
 	return m_mipmaps->GetNumMips();
@@ -27,6 +27,11 @@ public:
 	void Process(XUSG::CommandList* pCommandList, XUSG::ResourceState dstState, PipelineType pipelineType);
 	void Visualize(XUSG::CommandList* pCommandList, XUSG::RenderTarget* pRenderTarget, uint32_t mipLevel);
 
+	// Copies every level into a read-back buffer of its own; once the command list has
+	// executed, SaveDDS() writes them into one DDS file with the whole chain.
+	bool ReadBack(XUSG::CommandList* pCommandList, XUSG::ResourceState dstState);
+	bool SaveDDS(const char* fileName);
+
 	uint32_t GetMipLevelCount() const;
 	void GetImageSize(uint32_t& width, uint32_t& height) const;
 
@@ -78,6 +83,9 @@ protected:
 	XUSG::TypedBuffer::uptr				m_counter;
 	XUSG::RenderTarget::uptr			m_mipmaps;
 
+	std::vector<XUSG::Buffer::uptr>		m_readBuffers;
+	std::vector<uint32_t>				m_rowPitches;
+
 	DirectX::XMUINT2					m_imageSize;
 
 	XUSG::ResourceBarrier				m_barriers[2];
@@ -0,0 +1,1737 @@
+//--------------------------------------------------------------------------------------
+// Copyright (c) XU, Tianchen. All rights reserved.
+//--------------------------------------------------------------------------------------
+
+#include <cassert>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <string>
+#include "MipGeneratorCPU.h"
+#include "PngDecoder.h"
+#include "JpegDecoder.h"
+#include "DdsWriter.h"
+#include "dxgiformat.h"
+#include "stb_image.h"
+#include "stb_image_write.h"
+
+#define DIV_UP(x, n)	(((x) + (n) - 1) / (n))
+#define ALIGN_UP(x, n)	(DIV_UP(x, n) * (n))
+
+using namespace std;
+using namespace MipKernels;
+
+static const uint32_t g_dataAlignment = 64;	// Cache-line aligned rows
+static const uint32_t g_offsets2x2[][2] = { { 0, 0 }, { 1, 0 }, { 0, 1 }, { 1, 1 } };
+
+// SWAR 2x2 box average of packed R8G8B8A8 texels, (a + b + c + d + 2) / 4 per byte:
+// the even and the odd bytes are summed in 16-bit lanes, where 4 * 255 + 2 fits.
+static inline uint32_t AveragePacked(uint32_t a, uint32_t b, uint32_t c, uint32_t d)
+{
+	const auto mask = 0x00ff00ffu;
+	const auto bias = 0x00020002u;
+	const auto even = (a & mask) + (b & mask) + (c & mask) + (d & mask) + bias;
+	const auto odd = ((a >> 8) & mask) + ((b >> 8) & mask) + ((c >> 8) & mask) + ((d >> 8) & mask) + bias;
+
+	return ((even >> 2) & mask) | ((odd << 6) & ~mask);
+}
+
+// Channel c of a texel as a float, with the color of R8G8B8A8_UNORM_SRGB in linear light
+static inline float LoadChannel(const uint8_t* pTexel, uint8_t c, bool isSRGB)
+{
+	return isSRGB && c < 3 ? SRGB8ToLinear(pTexel[c]) : UNORM8ToFloat(pTexel[c]);
+}
+
+static inline void StoreTexel(uint8_t* pTexel, const float* pVal, bool isSRGB)
+{
+	for (uint8_t c = 0; c < 4; ++c)
+		pTexel[c] = isSRGB && c < 3 ? LinearToSRGB8(pVal[c]) : FloatToUNORM8(pVal[c]);
+}
+
+
+MipGeneratorCPU::MipGeneratorCPU() :
+	m_layout(ROW_MAJOR),
+	m_format(R8G8B8A8_UNORM),
+	m_texelSize(sizeof(uint32_t)),
+	m_numChannels(4),
+	m_filter(BILINEAR),
+	m_isSRGB(false),
+	m_isPremultiplied(false),
+	m_normalMap(COLOR_MAP),
+	m_normalFlags(0),
+	m_alphaTestRef(0.0f),
+	m_kernels(MipKernels::GetKernels())
+{
+}
+
+MipGeneratorCPU::~MipGeneratorCPU()
+{
+}
+
+bool MipGeneratorCPU::Init(const char* fileName, uint32_t numThreads, StorageLayout layout, TexelFormat hdrFormat)
+{
+	// Load input image, following LoadImageInfoFromFile() for the channel count
+	int width, height, channels;
+	if (!stbi_info(fileName, &width, &height, &channels)) return false;
+	const auto reqChannels = channels != 3 ? channels : 4;
+
+	if (stbi_is_hdr(fileName))
+	{
+		const auto pImageData = stbi_loadf(fileName, &width, &height, &channels, reqChannels);
+		if (!pImageData) return false;
+
+		const auto result = InitHDR(pImageData, width, height, reqChannels, hdrFormat, numThreads, layout);
+		stbi_image_free(pImageData);
+
+		return result;
+	}
+
+	if (stbi_is_16_bit(fileName))
+	{
+		auto pImageData = PngDecoder::Load16(fileName, &width, &height, &channels, reqChannels);
+		if (!pImageData) pImageData = stbi_load_16(fileName, &width, &height, &channels, reqChannels);
+		if (!pImageData) return false;
+
+		const auto result = InitUNORM16(pImageData, width, height, reqChannels, numThreads, layout);
+		stbi_image_free(pImageData);
+
+		return result;
+	}
+
+	// PNG files through PngDecoder, the others and those it leaves through stb_image
+	auto pImageData = PngDecoder::Load(fileName, &width, &height, &channels, reqChannels);
+	if (!pImageData) pImageData = stbi_load(fileName, &width, &height, &channels, reqChannels);
+	if (!pImageData) return false;
+
+	const auto result = Init(pImageData, width, height, reqChannels, numThreads, layout);
+	stbi_image_free(pImageData);
+
+	return result;
+}
+
+bool MipGeneratorCPU::InitFromLevel(const char* fileName, uint32_t& baseLevel, uint32_t numThreads, StorageLayout layout)
+{
+	int width, height, channels;
+	if (!stbi_info(fileName, &width, &height, &channels)) return false;
+	const auto reqChannels = channels != 3 ? channels : 4;
+
+	baseLevel = (min)(baseLevel, JpegDecoder::MaxScaleShift);
+	if (baseLevel > 0)
+	{
+		const auto pImageData = JpegDecoder::Load(fileName, baseLevel, &width, &height, &channels, reqChannels);
+		if (pImageData)
+		{
+			const auto result = Init(pImageData, width, height, reqChannels, numThreads, layout);
+			stbi_image_free(pImageData);
+
+			return result;
+		}
+	}
+
+	baseLevel = 0;
+
+	return Init(fileName, numThreads, layout);
+}
+
+bool MipGeneratorCPU::Init(const void* pData, uint32_t width, uint32_t height, uint8_t channels,
+	uint32_t numThreads, StorageLayout layout)
+{
+	if (!pData || !width || !height || !channels || channels > 4) return false;
+
+	initLevels(width, height, numThreads, layout, R8G8B8A8_UNORM);
+
+	// Copy the source into level 0 with the default SRV component mapping,
+	// as the blit in MipGenerator::Init() does for R8 and R8G8 sources.
+	const auto& mip = m_mips[0];
+	const auto pSrc = static_cast<const uint8_t*>(pData);
+	const auto pDst = getMipData(0);
+	m_scheduler->ParallelFor(height, [&](uint32_t y)
+	{
+		const auto pSrcRow = &pSrc[static_cast<size_t>(channels) * width * y];
+		if (channels == 4 && m_layout == ROW_MAJOR)
+			memcpy(getTexel(pDst, mip, 0, y), pSrcRow, sizeof(uint32_t) * width);
+		else for (auto x = 0u; x < width; ++x)
+		{
+			const uint8_t defaults[] = { 0, 0, 0, 0xff };
+			const auto pTexel = getTexel(pDst, mip, x, y);
+			for (uint8_t c = 0; c < 4; ++c)
+				pTexel[c] = c < channels ? pSrcRow[channels * x + c] : defaults[c];
+		}
+	});
+
+	return true;
+}
+
+bool MipGeneratorCPU::InitHDR(const float* pData, uint32_t width, uint32_t height, uint8_t channels,
+	TexelFormat format, uint32_t numThreads, StorageLayout layout)
+{
+	if (!pData || !width || !height || !channels || channels > 4) return false;
+
+	initLevels(width, height, numThreads, layout, format);
+
+	// Expand each row with the default SRV component mapping, convert it, and copy it into
+	// level 0, texel by texel if tiled
+	const auto& mip = m_mips[0];
+	const auto pDst = getMipData(0);
+	m_scheduler->ParallelFor(height, [&](uint32_t y)
+	{
+		thread_local vector<float> values;
+		thread_local vector<uint8_t> texels;
+		values.resize(4 * width);
+		texels.resize(m_texelSize * width);
+
+		const float defaults[] = { 0.0f, 0.0f, 0.0f, 1.0f };
+		const auto pSrcRow = &pData[static_cast<size_t>(channels) * width * y];
+		for (auto x = 0u; x < width; ++x)
+			for (uint8_t c = 0; c < 4; ++c)
+				values[4 * x + c] = c < channels ? pSrcRow[channels * x + c] : defaults[c];
+
+		const auto pRow = m_layout == ROW_MAJOR ? getTexel(pDst, mip, 0, y) : texels.data();
+		if (m_format == R16G16B16A16_FLOAT) m_kernels.FloatToHalf(reinterpret_cast<uint16_t*>(pRow), values.data(), 4 * width);
+		else if (m_format == R32G32B32A32_FLOAT) memcpy(pRow, values.data(), sizeof(float) * 4 * width);
+		else if (m_format == R16G16B16A16_UNORM) for (auto i = 0u; i < 4 * width; ++i)
+		{
+			const auto val = (min)((max)(values[i], 0.0f), 1.0f);
+			reinterpret_cast<uint16_t*>(pRow)[i] = static_cast<uint16_t>(val * 65535 + 0.5f);
+		}
+		else for (auto i = 0u; i < 4 * width; ++i) pRow[i] = FloatToUNORM8(values[i]);
+
+		if (m_layout == MORTON_TILED)
+			for (auto x = 0u; x < width; ++x)
+				memcpy(getTexel(pDst, mip, x, y), &texels[m_texelSize * x], m_texelSize);
+	});
+
+	return true;
+}
+
+bool MipGeneratorCPU::InitUNORM16(const uint16_t* pData, uint32_t width, uint32_t height, uint8_t channels,
+	uint32_t numThreads, StorageLayout layout)
+{
+	if (!pData || !width || !height || !channels || channels > 4) return false;
+
+	initLevels(width, height, numThreads, layout, R16G16B16A16_UNORM);
+
+	// As Init() with 8-bit channels
+	const auto& mip = m_mips[0];
+	const auto pDst = getMipData(0);
+	m_scheduler->ParallelFor(height, [&](uint32_t y)
+	{
+		const auto pSrcRow = &pData[static_cast<size_t>(channels) * width * y];
+		if (channels == 4 && m_layout == ROW_MAJOR)
+			memcpy(getTexel(pDst, mip, 0, y), pSrcRow, m_texelSize * width);
+		else for (auto x = 0u; x < width; ++x)
+		{
+			const uint16_t defaults[] = { 0, 0, 0, 0xffff };
+			uint16_t texel[4];
+			for (uint8_t c = 0; c < 4; ++c) texel[c] = c < channels ? pSrcRow[channels * x + c] : defaults[c];
+			memcpy(getTexel(pDst, mip, x, y), texel, sizeof(texel));
+		}
+	});
+
+	return true;
+}
+
+bool MipGeneratorCPU::InitNative(const void* pData, uint32_t width, uint32_t height, TexelFormat format,
+	uint32_t numThreads, StorageLayout layout)
+{
+	if (!pData || !width || !height) return false;
+
+	initLevels(width, height, numThreads, layout, format);
+
+	// Rows copied as they are, texel by texel if tiled
+	const auto& mip = m_mips[0];
+	const auto pSrc = static_cast<const uint8_t*>(pData);
+	const auto pDst = getMipData(0);
+	m_scheduler->ParallelFor(height, [&](uint32_t y)
+	{
+		const auto pSrcRow = &pSrc[static_cast<size_t>(m_texelSize) * width * y];
+		if (m_layout == ROW_MAJOR) memcpy(getTexel(pDst, mip, 0, y), pSrcRow, m_texelSize * width);
+		else for (auto x = 0u; x < width; ++x)
+			memcpy(getTexel(pDst, mip, x, y), &pSrcRow[m_texelSize * x], m_texelSize);
+	});
+
+	return true;
+}
+
+bool MipGeneratorCPU::InitNative(const char* fileName, uint32_t numThreads, StorageLayout layout)
+{
+	int width, height, channels;
+	if (!stbi_info(fileName, &width, &height, &channels)) return false;
+	const auto is16Bit = stbi_is_16_bit(fileName) != 0;
+	if (channels > 3 || (channels == 3 && is16Bit) || stbi_is_hdr(fileName)) return Init(fileName, numThreads, layout);
+
+	auto pImageData = is16Bit ? static_cast<void*>(PngDecoder::Load16(fileName, &width, &height, &channels, 0)) :
+		static_cast<void*>(PngDecoder::Load(fileName, &width, &height, &channels, 0));
+	if (!pImageData) pImageData = is16Bit ? static_cast<void*>(stbi_load_16(fileName, &width, &height, &channels, 0)) :
+		static_cast<void*>(stbi_load(fileName, &width, &height, &channels, 0));
+	if (!pImageData) return false;
+
+	const TexelFormat formats[][3] = { { R8_UNORM, R8G8_UNORM, R8G8B8_UNORM }, { R16_UNORM, R16G16_UNORM } };
+	const auto format = formats[is16Bit][channels - 1];
+	const auto result = InitNative(pImageData, width, height, format, numThreads, layout);
+	stbi_image_free(pImageData);
+
+	return result;
+}
+
+void MipGeneratorCPU::Process(PipelineType pipelineType, ReductionMode reductionMode)
+{
+	// Levels of the other formats are blitted only, the single pass taking the tiles of COMPUTE
+	if (m_format != R8G8B8A8_UNORM && pipelineType == SINGLE_PASS) pipelineType = COMPUTE;
+
+	switch (pipelineType)
+	{
+	case COMPUTE:
+		generateMipsCompute();
+		break;
+	case SINGLE_PASS:
+		// PACKED reduces level by level with the 2x2 kernels of the other pipelines, so it takes
+		// every option; the carries fall back to it where they would differ from them:
+		// - FUSED_INTEGER with sRGB, its integer sums being of the encoded bytes, not linear light;
+		// - any normal map, each level being renormalized before it is reduced further;
+		// - premultiplied alpha without sRGB, the carries averaging colors unweighted where the
+		//   kernels weight them by alpha (with sRGB, the sRGB kernels take precedence, and the
+		//   float carry in linear light matches them).
+		if ((reductionMode == FUSED_INTEGER && m_isSRGB) || m_normalMap != COLOR_MAP ||
+			(m_isPremultiplied && !m_isSRGB))
+			reductionMode = PACKED;
+		generateMipsSinglePass(reductionMode);
+		break;
+	default:
+		generateMipsGraphics();
+	}
+
+	if (m_alphaTestRef > 0.0f && m_format == R8G8B8A8_UNORM) preserveAlphaCoverage();
+}
+
+void MipGeneratorCPU::SetFilter(FilterType filter)
+{
+	// The taps and the tile dependencies follow the filter
+	m_filter = filter;
+	buildFilterTaps();
+	buildBlitGraph();
+}
+
+void MipGeneratorCPU::SetSRGB(bool isSRGB)
+{
+	m_isSRGB = isSRGB;
+}
+
+void MipGeneratorCPU::SetPremultipliedAlpha(bool isPremultiplied)
+{
+	m_isPremultiplied = isPremultiplied;
+}
+
+void MipGeneratorCPU::SetNormalMap(NormalMapMode mode, bool foldRoughness)
+{
+	m_normalMap = mode;
+	m_normalFlags = 0;
+	if (mode == NORMAL_MAP_XY) m_normalFlags |= NORMAL_XY;
+	if (foldRoughness) m_normalFlags |= NORMAL_ROUGHNESS;
+}
+
+void MipGeneratorCPU::SetAlphaTestRef(float alphaRef)
+{
+	m_alphaTestRef = (min)((max)(alphaRef, 0.0f), 1.0f);
+}
+
+uint32_t MipGeneratorCPU::GetMipLevelCount() const
+{
+	return static_cast<uint32_t>(m_mips.size());
+}
+
+uint32_t MipGeneratorCPU::GetThreadCount() const
+{
+	return m_scheduler ? m_scheduler->GetThreadCount() : 0;
+}
+
+void MipGeneratorCPU::GetImageSize(uint32_t& width, uint32_t& height) const
+{
+	GetMipSize(0, width, height);
+}
+
+void MipGeneratorCPU::GetMipSize(uint32_t mipLevel, uint32_t& width, uint32_t& height) const
+{
+	assert(mipLevel < GetMipLevelCount());
+	width = m_mips[mipLevel].Width;
+	height = m_mips[mipLevel].Height;
+}
+
+MipGeneratorCPU::StorageLayout MipGeneratorCPU::GetStorageLayout() const
+{
+	return m_layout;
+}
+
+MipGeneratorCPU::TexelFormat MipGeneratorCPU::GetTexelFormat() const
+{
+	return m_format;
+}
+
+MipGeneratorCPU::FilterType MipGeneratorCPU::GetFilter() const
+{
+	return m_filter;
+}
+
+bool MipGeneratorCPU::IsSRGB() const
+{
+	return m_isSRGB;
+}
+
+bool MipGeneratorCPU::IsPremultipliedAlpha() const
+{
+	return m_isPremultiplied;
+}
+
+MipGeneratorCPU::NormalMapMode MipGeneratorCPU::GetNormalMap() const
+{
+	return m_normalMap;
+}
+
+float MipGeneratorCPU::GetAlphaTestRef() const
+{
+	return m_alphaTestRef;
+}
+
+MipKernels::Isa MipGeneratorCPU::GetKernelIsa() const
+{
+	return m_kernels.SelectedIsa;
+}
+
+bool MipGeneratorCPU::BuildFilterTaps(FilterType filter, uint32_t dstSize, uint32_t srcSize, FilterTaps& taps)
+{
+	static const struct
+	{
+		FilterFunc Func;
+		float Radius;
+	} filters[] =
+	{
+		{ TentFilter, 1.0f },
+		{ MitchellFilter, 2.0f },
+		{ Lanczos3Filter, 3.0f },
+		{ KaiserFilter, 3.0f }
+	};
+
+	if (filter <= BOX) return false;
+
+	const auto& polyphase = filters[filter - TENT];
+	MipKernels::BuildFilterTaps(taps, dstSize, srcSize, polyphase.Func, polyphase.Radius);
+
+	return true;
+}
+
+const uint8_t* MipGeneratorCPU::GetMipData(uint32_t mipLevel, uint32_t* pRowPitch) const
+{
+	assert(mipLevel < GetMipLevelCount());
+	if (pRowPitch) *pRowPitch = m_mips[mipLevel].RowPitch;
+
+	return const_cast<MipGeneratorCPU*>(this)->getMipData(mipLevel);
+}
+
+void MipGeneratorCPU::ReadMipData(uint32_t mipLevel, void* pDst, uint32_t rowPitch) const
+{
+	// Row-major copy, de-tiled if needed
+	const auto& mip = m_mips[mipLevel];
+	const auto pSrc = const_cast<MipGeneratorCPU*>(this)->getMipData(mipLevel);
+	for (auto y = 0u; y < mip.Height; ++y)
+	{
+		const auto pDstRow = &static_cast<uint8_t*>(pDst)[static_cast<size_t>(rowPitch) * y];
+		if (m_layout == ROW_MAJOR) memcpy(pDstRow, getTexel(pSrc, mip, 0, y), m_texelSize * mip.Width);
+		else for (auto x = 0u; x < mip.Width; ++x)
+			memcpy(&pDstRow[m_texelSize * x], getTexel(pSrc, mip, x, y), m_texelSize);
+	}
+}
+
+uint32_t MipGeneratorCPU::SaveMipLevels(const char* fileName) const
+{
+	const auto isFloat = m_format == R16G16B16A16_FLOAT || m_format == R32G32B32A32_FLOAT;
+	if (!fileName || m_mips.empty() || (!isFloat && m_texelSize != m_numChannels)) return 0;
+
+	const string name(fileName);
+	const auto dot = name.find_last_of('.');
+	const auto hasExtension = dot != string::npos && name.find_first_of("/\\", dot) == string::npos;
+	const auto stem = hasExtension ? name.substr(0, dot) : name;
+
+	// One task per level, level 0 taking most of the time
+	atomic<uint32_t> numSaved(0);
+	m_scheduler->ParallelFor(GetMipLevelCount(), [&](uint32_t i)
+	{
+		const auto& mip = m_mips[i];
+		const auto levelName = stem + "_" + to_string(i) + (isFloat ? ".hdr" : ".png");
+		const auto w = static_cast<int>(mip.Width);
+		const auto h = static_cast<int>(mip.Height);
+		const auto numTexels = static_cast<size_t>(mip.Width) * mip.Height;
+
+		auto isSaved = false;
+		if (isFloat)
+		{
+			// Radiance HDR takes tightly packed floats
+			vector<float> values(4 * numTexels);
+			if (m_format == R32G32B32A32_FLOAT) ReadMipData(i, values.data(), m_texelSize * mip.Width);
+			else
+			{
+				vector<uint16_t> halves(4 * numTexels);
+				ReadMipData(i, halves.data(), m_texelSize * mip.Width);
+				m_kernels.HalfToFloat(values.data(), halves.data(), static_cast<uint32_t>(halves.size()));
+			}
+			isSaved = stbi_write_hdr(levelName.c_str(), w, h, 4, values.data()) != 0;
+		}
+		else if (m_layout == ROW_MAJOR)
+		{
+			uint32_t rowPitch;
+			const auto pData = GetMipData(i, &rowPitch);
+			isSaved = stbi_write_png(levelName.c_str(), w, h, m_numChannels, pData, rowPitch) != 0;
+		}
+		else
+		{
+			// Tiled levels are untiled first
+			vector<uint8_t> texels(m_texelSize * numTexels);
+			ReadMipData(i, texels.data(), m_texelSize * mip.Width);
+			isSaved = stbi_write_png(levelName.c_str(), w, h, m_numChannels, texels.data(), m_texelSize * mip.Width) != 0;
+		}
+
+		if (isSaved) ++numSaved;
+	});
+
+	return numSaved;
+}
+
+bool MipGeneratorCPU::SaveDDS(const char* fileName) const
+{
+	// DXGI_FORMAT of each TexelFormat
+	static const DXGI_FORMAT dxgiFormats[] =
+	{
+		DXGI_FORMAT_R8G8B8A8_UNORM,
+		DXGI_FORMAT_R16G16B16A16_UNORM,
+		DXGI_FORMAT_R16G16B16A16_FLOAT,
+		DXGI_FORMAT_R32G32B32A32_FLOAT,
+		DXGI_FORMAT_R8_UNORM,
+		DXGI_FORMAT_R8G8_UNORM,
+		DXGI_FORMAT_R16_UNORM,
+		DXGI_FORMAT_R16G16_UNORM,
+		DXGI_FORMAT_R8G8B8A8_UNORM	// Expanded from R8G8B8_UNORM
+	};
+	if (!fileName || m_mips.empty()) return false;
+
+	const auto isRGB = m_format == R8G8B8_UNORM;
+	const auto format = m_format == R8G8B8A8_UNORM && m_isSRGB ? DXGI_FORMAT_R8G8B8A8_UNORM_SRGB : dxgiFormats[m_format];
+	const auto numMips = GetMipLevelCount();
+	vector<DdsWriter::Subresource> subresources(numMips);
+	vector<uint8_t> texels;
+	if (m_layout == ROW_MAJOR && !isRGB)
+	{
+		// Straight from the pitched rows
+		for (auto i = 0u; i < numMips; ++i)
+			subresources[i].pData = GetMipData(i, &subresources[i].RowPitch);
+	}
+	else
+	{
+		// Tiled levels are untiled, and R8G8B8 ones expanded to R8G8B8A8, into one chain
+		const auto texelSize = isRGB ? static_cast<uint32_t>(sizeof(uint32_t)) : m_texelSize;
+		vector<size_t> offsets(numMips + 1);
+		for (auto i = 0u; i < numMips; ++i)
+		{
+			subresources[i].RowPitch = texelSize * m_mips[i].Width;
+			offsets[i + 1] = offsets[i] + static_cast<size_t>(subresources[i].RowPitch) * m_mips[i].Height;
+		}
+		texels.resize(offsets[numMips]);
+		for (auto i = 0u; i < numMips; ++i) subresources[i].pData = &texels[offsets[i]];
+
+		m_scheduler->ParallelFor(numMips, [&](uint32_t i)
+		{
+			const auto& mip = m_mips[i];
+			const auto pDst = &texels[offsets[i]];
+			ReadMipData(i, pDst, subresources[i].RowPitch);
+
+			// In place within each row, from the last texel
+			if (isRGB) for (auto y = 0u; y < mip.Height; ++y)
+			{
+				const auto pRow = &pDst[static_cast<size_t>(subresources[i].RowPitch) * y];
+				for (auto x = mip.Width; x-- > 0;)
+				{
+					const uint8_t rgb[] = { pRow[3 * x], pRow[3 * x + 1], pRow[3 * x + 2] };
+					memcpy(&pRow[4 * x], rgb, sizeof(rgb));
+					pRow[4 * x + 3] = 0xff;
+				}
+			}
+		});
+	}
+
+	return DdsWriter::Write(fileName, format, m_mips[0].Width, m_mips[0].Height, numMips, 1, subresources.data(),
+		false, isRGB ? DdsWriter::ALPHA_MODE_OPAQUE : DdsWriter::ALPHA_MODE_UNKNOWN);
+}
+
+void MipGeneratorCPU::initLevels(uint32_t width, uint32_t height, uint32_t numThreads, StorageLayout layout, TexelFormat format)
+{
+	if (!m_scheduler || (numThreads && numThreads != m_scheduler->GetThreadCount()))
+		m_scheduler = make_unique<TaskScheduler>(numThreads);
+	m_layout = layout;
+	m_format = format;
+	m_numChannels = format == R8_UNORM || format == R16_UNORM ? 1 :
+		(format == R8G8_UNORM || format == R16G16_UNORM ? 2 : (format == R8G8B8_UNORM ? 3 : 4));
+	m_texelSize = m_numChannels * (format == R32G32B32A32_FLOAT ? sizeof(float) :
+		(format == R8G8B8A8_UNORM || format == R8_UNORM || format == R8G8_UNORM ||
+		format == R8G8B8_UNORM ? sizeof(uint8_t) : sizeof(uint16_t)));
+	allocateMips(width, height);
+	buildFilterTaps();
+	buildBlitGraph();
+}
+
+void MipGeneratorCPU::allocateMips(uint32_t width, uint32_t height)
+{
+	// Full chain, as RenderTarget::Create() with 0 MIP levels
+	auto numMips = 1u;
+	for (auto size = (max)(width, height); size > 1; size >>= 1) ++numMips;
+
+	m_mips.resize(numMips);
+	size_t offset = 0;
+	for (auto i = 0u; i < numMips; ++i)
+	{
+		auto& mip = m_mips[i];
+		mip.Width = (max)(width >> i, 1u);
+		mip.Height = (max)(height >> i, 1u);
+		mip.Offset = offset;
+		if (m_layout == MORTON_TILED)
+		{
+			mip.RowPitch = m_texelSize * StorageTileSize * StorageTileSize * DIV_UP(mip.Width, StorageTileSize);
+			offset += static_cast<size_t>(mip.RowPitch) * DIV_UP(mip.Height, StorageTileSize);
+		}
+		else
+		{
+			mip.RowPitch = ALIGN_UP(m_texelSize * mip.Width, g_dataAlignment);
+			offset += static_cast<size_t>(mip.RowPitch) * mip.Height;
+		}
+	}
+
+	m_storage.resize(offset + g_dataAlignment);
+}
+
+void MipGeneratorCPU::buildFilterTaps()
+{
+	const auto numMips = GetMipLevelCount();
+	m_filterLevels.clear();
+	if (m_filter <= BOX) return;
+
+	m_filterLevels.resize(numMips);
+	for (auto i = 1u; i < numMips; ++i)
+	{
+		const auto& src = m_mips[i - 1];
+		const auto& dst = m_mips[i];
+		BuildFilterTaps(m_filter, dst.Width, src.Width, m_filterLevels[i].X);
+		BuildFilterTaps(m_filter, dst.Height, src.Height, m_filterLevels[i].Y);
+	}
+}
+
+void MipGeneratorCPU::buildBlitGraph()
+{
+	// Tiles of every level, each depending on the tiles of the parent level under its footprint.
+	// The footprints of BILINEAR and BOX are merged, those of a polyphase filter are its taps.
+	const auto numMips = GetMipLevelCount();
+	m_blitTileOffsets.assign(numMips + 1, 0);
+	for (auto i = 1u; i < numMips; ++i)
+	{
+		const auto& mip = m_mips[i];
+		m_blitTileOffsets[i + 1] = m_blitTileOffsets[i] + DIV_UP(mip.Width, BlitTileSize) * DIV_UP(mip.Height, BlitTileSize);
+	}
+
+	const auto numTasks = m_blitTileOffsets[numMips];
+	m_blitGraph.NumDependencies.assign(numTasks, 0);
+	m_blitGraph.Successors.assign(numTasks, vector<uint32_t>());
+	for (auto i = 2u; i < numMips; ++i)
+	{
+		const auto& src = m_mips[i - 1];
+		const auto& dst = m_mips[i];
+		const auto srcTileCountX = DIV_UP(src.Width, BlitTileSize);
+		const auto tileCountX = DIV_UP(dst.Width, BlitTileSize);
+		const auto tileCountY = DIV_UP(dst.Height, BlitTileSize);
+		for (auto ty = 0u; ty < tileCountY; ++ty)
+		{
+			uint32_t sy0, sy1, unused;
+			SampleCoord(BlitTileSize * ty, dst.Height, src.Height, sy0, unused);
+			SampleCoord((min)(BlitTileSize * (ty + 1), dst.Height) - 1, dst.Height, src.Height, unused, sy1);
+			sy0 = (min)(sy0, 2 * BlitTileSize * ty);
+			sy1 = (max)(sy1, (min)(2 * (min)(BlitTileSize * (ty + 1), dst.Height), src.Height - 1));
+			if (!m_filterLevels.empty())
+			{
+				const auto& taps = m_filterLevels[i].Y;
+				sy0 = taps.First[BlitTileSize * ty];
+				sy1 = taps.First[(min)(BlitTileSize * (ty + 1), dst.Height) - 1] + taps.NumTaps - 1;
+			}
+			for (auto tx = 0u; tx < tileCountX; ++tx)
+			{
+				uint32_t sx0, sx1;
+				SampleCoord(BlitTileSize * tx, dst.Width, src.Width, sx0, unused);
+				SampleCoord((min)(BlitTileSize * (tx + 1), dst.Width) - 1, dst.Width, src.Width, unused, sx1);
+				sx0 = (min)(sx0, 2 * BlitTileSize * tx);
+				sx1 = (max)(sx1, (min)(2 * (min)(BlitTileSize * (tx + 1), dst.Width), src.Width - 1));
+				if (!m_filterLevels.empty())
+				{
+					const auto& taps = m_filterLevels[i].X;
+					sx0 = taps.First[BlitTileSize * tx];
+					sx1 = taps.First[(min)(BlitTileSize * (tx + 1), dst.Width) - 1] + taps.NumTaps - 1;
+				}
+
+				const auto task = m_blitTileOffsets[i] + tileCountX * ty + tx;
+				for (auto y = sy0 / BlitTileSize; y <= sy1 / BlitTileSize; ++y)
+					for (auto x = sx0 / BlitTileSize; x <= sx1 / BlitTileSize; ++x)
+					{
+						m_blitGraph.Successors[m_blitTileOffsets[i - 1] + srcTileCountX * y + x].push_back(task);
+						++m_blitGraph.NumDependencies[task];
+					}
+			}
+		}
+	}
+}
+
+void MipGeneratorCPU::generateMipsGraphics()
+{
+	// One blit per level, rows (or rows of tiles) spread over the threads. The polyphase
+	// filters take bands of rows, so that the horizontal pass is shared by their rows.
+	const auto numMips = GetMipLevelCount();
+	const auto rowsPerTask = m_filter > BOX ? BlitTileSize : (m_layout == MORTON_TILED ? StorageTileSize : 1);
+	for (auto i = 1u; i < numMips; ++i)
+	{
+		const auto& mip = m_mips[i];
+		m_scheduler->ParallelFor(DIV_UP(mip.Height, rowsPerTask), [this, i, &mip, rowsPerTask](uint32_t t)
+		{
+			const auto y = rowsPerTask * t;
+			blit2D(i, 0, y, mip.Width, (min)(y + rowsPerTask, mip.Height));
+		});
+	}
+}
+
+void MipGeneratorCPU::generateMipsCompute()
+{
+	// 2D tiles of all levels at once, each one starting as soon as the tiles under its
+	// footprint are finished, with no barrier between levels
+	m_scheduler->Run(m_blitGraph, [this](uint32_t task)
+	{
+		const auto level = static_cast<uint32_t>(upper_bound(m_blitTileOffsets.cbegin(),
+			m_blitTileOffsets.cend(), task) - m_blitTileOffsets.cbegin()) - 1;
+		const auto& mip = m_mips[level];
+		const auto tileCountX = DIV_UP(mip.Width, BlitTileSize);
+		const auto t = task - m_blitTileOffsets[level];
+		const auto x = BlitTileSize * (t % tileCountX);
+		const auto y = BlitTileSize * (t / tileCountX);
+		blit2D(level, x, y, (min)(x + BlitTileSize, mip.Width), (min)(y + BlitTileSize, mip.Height));
+	});
+}
+
+void MipGeneratorCPU::generateMipsSinglePass(ReductionMode reductionMode)
+{
+	const auto numMips = GetMipLevelCount();
+	if (numMips < 2) return;
+
+	// Tier t of groups reduces level TierLevels * t, as long as levels remain. Instead of the
+	// one counter of the shader, every group of an upper tier counts its child groups.
+	const auto childSpan = 2 * GroupSize;
+	m_groupTiers.clear();
+	for (auto level = 0u; level + 1 < numMips; level += TierLevels)
+	{
+		const auto& mip = m_mips[level + 1];
+		GroupTier groups;
+		groups.GroupCountX = DIV_UP(mip.Width, GroupSize);
+		groups.GroupCountY = DIV_UP(mip.Height, GroupSize);
+		const auto numGroups = groups.GroupCountX * groups.GroupCountY;
+		if (!m_groupTiers.empty())
+		{
+			const auto& children = m_groupTiers.back();
+			groups.Counters.reset(new atomic<uint32_t>[numGroups]);
+			for (auto i = 0u; i < numGroups; ++i)
+			{
+				const auto x = childSpan * (i % groups.GroupCountX);
+				const auto y = childSpan * (i / groups.GroupCountX);
+				groups.Counters[i] = (min)(children.GroupCountX - x, childSpan) * (min)(children.GroupCountY - y, childSpan);
+			}
+		}
+		if (reductionMode == FUSED_INTEGER) groups.Sums.resize(4 * numGroups);
+		m_groupTiers.push_back(move(groups));
+	}
+
+	// For each group, 32x32 => 1x1; no barrier between levels, the slowest
+	// group under a group of the next tier goes on with it.
+	const auto process = reductionMode == FUSED_INTEGER ? &MipGeneratorCPU::perGroupProcessFused :
+		(reductionMode == PACKED ? &MipGeneratorCPU::perGroupProcessPacked : &MipGeneratorCPU::perGroupProcess);
+	const auto& groups = m_groupTiers[0];
+	m_scheduler->ParallelFor(groups.GroupCountX * groups.GroupCountY, [this, process, childSpan, &groups](uint32_t i)
+	{
+		auto gidX = i % groups.GroupCountX;
+		auto gidY = i / groups.GroupCountX;
+		auto level = (this->*process)(0, gidX, gidY);
+
+		for (auto tier = 1u; tier < m_groupTiers.size(); ++tier)
+		{
+			gidX /= childSpan;
+			gidY /= childSpan;
+			if (!isSlowestGroup(tier, gidX, gidY)) break;
+			level = (this->*process)(level, gidX, gidY);
+		}
+	});
+}
+
+void MipGeneratorCPU::preserveAlphaCoverage()
+{
+	// The test passes the 8-bit alphas from ref on. The scale, in 16.16 fixed point and
+	// rounded, keeps the alphas in order, so that the texels passing after it are those from
+	// a threshold t on, where a * scale reaches the bound: the coverage of each scale is a
+	// suffix sum of the histogram, and the level is read once more only to be scaled.
+	const auto ref = (max)(static_cast<uint32_t>(ceilf(m_alphaTestRef * 255)), 1u);
+	const auto bound = (ref << 16) - 0x8000;
+
+	uint64_t hist[256];
+	alphaHistogram(0, hist);
+	uint64_t numPassed = 0;
+	for (auto a = ref; a < 256; ++a) numPassed += hist[a];
+	const auto& baseMip = m_mips[0];
+	const auto coverage = static_cast<double>(numPassed) / (static_cast<double>(baseMip.Width) * baseMip.Height);
+
+	const auto numMips = GetMipLevelCount();
+	for (auto i = 1u; i < numMips; ++i)
+	{
+		const auto& mip = m_mips[i];
+		const auto target = coverage * mip.Width * mip.Height;
+		alphaHistogram(i, hist);
+
+		// Thresholds from 256 (none passes) down, the closest to ref among the best
+		auto bestThreshold = ref;
+		auto bestScale = 0u;
+		auto bestError = HUGE_VAL;
+		uint64_t suffix = 0;
+		for (auto t = 256u; t > 0; --t)
+		{
+			if (t < 256) suffix += hist[t];
+			const auto scale = DIV_UP(bound, t);
+			if (t != ref && (scale >= 1u << 24 || (t - 1) * scale >= bound)) continue;
+
+			const auto error = fabs(static_cast<double>(suffix) - target);
+			const auto distance = (max)(t, ref) - (min)(t, ref);
+			const auto bestDistance = (max)(bestThreshold, ref) - (min)(bestThreshold, ref);
+			if (error < bestError || (error == bestError && distance < bestDistance))
+			{
+				bestThreshold = t;
+				bestScale = scale;
+				bestError = error;
+			}
+		}
+
+		if (bestThreshold != ref)
+			forEachSpan(i, [this, bestScale](uint8_t* pTexels, uint32_t count)
+			{
+				m_kernels.ScaleAlphaRGBA8(pTexels, count, bestScale);
+			});
+	}
+}
+
+void MipGeneratorCPU::blit2D(uint32_t level, uint32_t x0, uint32_t y0, uint32_t x1, uint32_t y1)
+{
+	if (m_format != R8G8B8A8_UNORM)
+	{
+		formatBlit2D(level, x0, y0, x1, y1);
+
+		return;
+	}
+
+	if (m_filter > BOX && m_normalMap == COLOR_MAP)
+	{
+		filterBlit2D(level, x0, y0, x1, y1);
+
+		return;
+	}
+
+	// Bilinear sampling with clamp at the destination texel centers, as Blit2D() does
+	const auto& src = m_mips[level - 1];
+	const auto& dst = m_mips[level];
+	const auto pSrc = getMipData(level - 1);
+	const auto pDst = getMipData(level);
+	const auto downSampleQuads = m_isSRGB ? m_kernels.DownSampleQuadsSRGBA8 :
+		(m_isPremultiplied ? m_kernels.DownSampleQuadsPremulRGBA8 : m_kernels.DownSampleQuadsRGBA8);
+	const auto downSampleRow = m_isSRGB ? m_kernels.DownSampleSRGBA8 :
+		(m_isPremultiplied ? m_kernels.DownSamplePremulRGBA8 : m_kernels.DownSampleRGBA8);
+
+	// Exact 2x2 footprints, where the bilinear sample is the box average
+	if (src.Width == 2 * dst.Width && src.Height == 2 * dst.Height)
+	{
+		if (m_layout == MORTON_TILED)
+		{
+			// Quadrant q of a destination tile is the whole of one source tile, whose
+			// 2x2 footprints are consecutive. The rectangle is tile aligned.
+			const auto quadSize = StorageTileSize / 2;
+			const auto quadTexels = quadSize * quadSize;
+			for (auto ty = y0 / StorageTileSize; ty < DIV_UP(y1, StorageTileSize); ++ty)
+				for (auto tx = x0 / StorageTileSize; tx < DIV_UP(x1, StorageTileSize); ++tx)
+				{
+					const auto pDstTile = getTexel(pDst, dst, StorageTileSize * tx, StorageTileSize * ty);
+					for (auto q = 0u; q < 4; ++q)
+					{
+						const auto sx = StorageTileSize * (2 * tx + (q & 1));
+						const auto sy = StorageTileSize * (2 * ty + (q >> 1));
+						if (sx >= src.Width || sy >= src.Height) continue;
+
+						const auto pDstQuad = &pDstTile[sizeof(uint32_t) * quadTexels * q];
+						const auto pSrcTile = getTexel(pSrc, src, sx, sy);
+						if (m_normalMap != COLOR_MAP)
+							m_kernels.DownSampleQuadsNormalsRGBA8(pDstQuad, pSrcTile, quadTexels, m_normalFlags);
+						else downSampleQuads(pDstQuad, pSrcTile, quadTexels);
+					}
+				}
+		}
+		else for (auto y = y0; y < y1; ++y)
+		{
+			const auto pRow0 = getTexel(pSrc, src, 2 * x0, 2 * y);
+			const auto pRow1 = &pRow0[src.RowPitch];
+			if (m_normalMap != COLOR_MAP)
+				m_kernels.DownSampleNormalsRGBA8(getTexel(pDst, dst, x0, y), pRow0, pRow1, x1 - x0, m_normalFlags);
+			else downSampleRow(getTexel(pDst, dst, x0, y), pRow0, pRow1, x1 - x0);
+		}
+
+		return;
+	}
+
+	if (m_normalMap != COLOR_MAP)
+	{
+		normalBlit2D(level, x0, y0, x1, y1);
+
+		return;
+	}
+
+	if (m_filter == BOX)
+	{
+		boxBlit2D(level, x0, y0, x1, y1);
+
+		return;
+	}
+
+	const auto blitRow = m_isSRGB ? BlitRowSRGBA8 : (m_isPremultiplied ? BlitRowPremulRGBA8 : BlitRowRGBA8);
+	const auto blendTexels = m_isSRGB ? BlendTexelsSRGBA8 : (m_isPremultiplied ? BlendTexelsPremulRGBA8 : BlendTexelsRGBA8);
+	for (auto y = y0; y < y1; ++y)
+	{
+		uint32_t sy0, sy1;
+		const auto wy = SampleCoord(y, dst.Height, src.Height, sy0, sy1);
+		if (m_layout == ROW_MAJOR)
+			blitRow(getTexel(pDst, dst, x0, y), getTexel(pSrc, src, 0, sy0), getTexel(pSrc, src, 0, sy1),
+				wy, x0, x1, src.Width, dst.Width);
+		else for (auto x = x0; x < x1; ++x)
+		{
+			uint32_t sx0, sx1;
+			const auto wx = SampleCoord(x, dst.Width, src.Width, sx0, sx1);
+			blendTexels(getTexel(pDst, dst, x, y), getTexel(pSrc, src, sx0, sy0), getTexel(pSrc, src, sx1, sy0),
+				getTexel(pSrc, src, sx0, sy1), getTexel(pSrc, src, sx1, sy1), wx, wy);
+		}
+	}
+}
+
+void MipGeneratorCPU::boxBlit2D(uint32_t level, uint32_t x0, uint32_t y0, uint32_t x1, uint32_t y1)
+{
+	// Box of any size in one pass: the footprint of texel (x, y) starts at (2x, 2y), with 2 taps
+	// along an even size and 3 polyphase ones along an odd size, so that no texel is dropped.
+	const auto& src = m_mips[level - 1];
+	const auto& dst = m_mips[level];
+	const auto pSrc = getMipData(level - 1);
+	const auto pDst = getMipData(level);
+	const auto boxRow = m_isSRGB ? BoxRowSRGBA8 : (m_isPremultiplied ? BoxRowPremulRGBA8 : m_kernels.BoxRowRGBA8);
+
+	// Tiled levels are gathered into rows of the footprint span, and scattered back through
+	// a fourth row; the scratch of each worker is reused across tiles
+	thread_local vector<uint8_t> rows;
+	const auto sx0 = 2 * x0;
+	const auto spanWidth = (min)(2 * x1 + 1, src.Width) - sx0;
+	const auto rowPitch = sizeof(uint32_t) * (2 * (x1 - x0) + 1);
+	if (m_layout == MORTON_TILED) rows.resize(rowPitch * 4);
+
+	for (auto y = y0; y < y1; ++y)
+	{
+		float weights[3];
+		const uint8_t* ppRows[3];
+		const auto numRows = GetBoxTaps(y, src.Height, weights);
+		for (auto r = 0u; r < numRows; ++r)
+		{
+			const auto sy = 2 * y + r;
+			if (m_layout == ROW_MAJOR) ppRows[r] = getTexel(pSrc, src, sx0, sy);
+			else
+			{
+				const auto pRow = &rows[rowPitch * r];
+				for (auto x = 0u; x < spanWidth; ++x)
+					memcpy(&pRow[sizeof(uint32_t) * x], getTexel(pSrc, src, sx0 + x, sy), sizeof(uint32_t));
+				ppRows[r] = pRow;
+			}
+		}
+
+		if (m_layout == ROW_MAJOR)
+			boxRow(getTexel(pDst, dst, x0, y), ppRows, weights, numRows, x0, x1, src.Width);
+		else
+		{
+			const auto pDstRow = &rows[rowPitch * 3];
+			boxRow(pDstRow, ppRows, weights, numRows, x0, x1, src.Width);
+			for (auto x = x0; x < x1; ++x)
+				memcpy(getTexel(pDst, dst, x, y), &pDstRow[sizeof(uint32_t) * (x - x0)], sizeof(uint32_t));
+		}
+	}
+}
+
+void MipGeneratorCPU::filterBlit2D(uint32_t level, uint32_t x0, uint32_t y0, uint32_t x1, uint32_t y1)
+{
+	// Separable polyphase filtering, in strips of BlitTileSize columns: the source rows
+	// under a strip are filtered horizontally into floats, kept in cache for the vertical
+	// pass. Tiled levels are gathered into rows, and scattered back.
+	const auto& src = m_mips[level - 1];
+	const auto& dst = m_mips[level];
+	const auto pSrc = getMipData(level - 1);
+	const auto pDst = getMipData(level);
+	const auto& tapsX = m_filterLevels[level].X;
+	const auto& tapsY = m_filterLevels[level].Y;
+	const auto filterRow = m_isSRGB ? FilterRowSRGBA8 : m_kernels.FilterRowRGBA8;
+	const auto filterColumns = m_isSRGB ? FilterColumnsSRGBA8 : m_kernels.FilterColumnsRGBA8;
+
+	// Scratch of each worker, reused across tiles
+	thread_local vector<float> rows;
+	thread_local vector<uint8_t> texels;
+
+	const auto sy0 = tapsY.First[y0];
+	const auto sy1 = tapsY.First[y1 - 1] + tapsY.NumTaps;
+	for (auto stripX = x0; stripX < x1; stripX += BlitTileSize)
+	{
+		const auto count = (min)(stripX + BlitTileSize, x1) - stripX;
+		const auto sx0 = tapsX.First[stripX];
+		const auto sx1 = tapsX.First[stripX + count - 1] + tapsX.NumTaps;
+		const auto rowSize = 4 * count;
+		rows.resize(static_cast<size_t>(rowSize) * (sy1 - sy0));
+		if (m_layout == MORTON_TILED) texels.resize(sizeof(uint32_t) * (max)(sx1 - sx0, count));
+
+		for (auto sy = sy0; sy < sy1; ++sy)
+		{
+			const uint8_t* pSrcRow;
+			if (m_layout == ROW_MAJOR) pSrcRow = getTexel(pSrc, src, sx0, sy);
+			else
+			{
+				for (auto x = sx0; x < sx1; ++x)
+					memcpy(&texels[sizeof(uint32_t) * (x - sx0)], getTexel(pSrc, src, x, sy), sizeof(uint32_t));
+				pSrcRow = texels.data();
+			}
+			filterRow(&rows[rowSize * (sy - sy0)], pSrcRow, sx0, &tapsX.First[stripX],
+				&tapsX.Weights[tapsX.NumTaps * stripX], tapsX.NumTaps, count);
+		}
+
+		for (auto y = y0; y < y1; ++y)
+		{
+			const float* ppRows[MaxFilterTaps];
+			for (auto t = 0u; t < tapsY.NumTaps; ++t) ppRows[t] = &rows[rowSize * (tapsY.First[y] + t - sy0)];
+			const auto pWeights = &tapsY.Weights[tapsY.NumTaps * y];
+
+			if (m_layout == ROW_MAJOR) filterColumns(getTexel(pDst, dst, stripX, y), ppRows, pWeights, tapsY.NumTaps, count);
+			else
+			{
+				filterColumns(texels.data(), ppRows, pWeights, tapsY.NumTaps, count);
+				for (auto x = 0u; x < count; ++x)
+					memcpy(getTexel(pDst, dst, stripX + x, y), &texels[sizeof(uint32_t) * x], sizeof(uint32_t));
+			}
+		}
+	}
+}
+
+void MipGeneratorCPU::normalBlit2D(uint32_t level, uint32_t x0, uint32_t y0, uint32_t x1, uint32_t y1)
+{
+	// Footprints other than 2x2, texel by texel in any layout: the bilinear taps, or the box
+	// ones for the other filters
+	const auto& src = m_mips[level - 1];
+	const auto& dst = m_mips[level];
+	const auto pSrc = getMipData(level - 1);
+	const auto pDst = getMipData(level);
+	const auto getTaps = [this](uint32_t i, uint32_t dstSize, uint32_t srcSize, uint32_t* pFirst, float* pWeights)
+	{
+		if (m_filter != BILINEAR)
+		{
+			pFirst[0] = 2 * i;
+			const auto numTaps = GetBoxTaps(i, srcSize, pWeights);
+			for (auto t = 1u; t < numTaps; ++t) pFirst[t] = 2 * i + t;
+
+			return numTaps;
+		}
+
+		const auto weight = SampleCoord(i, dstSize, srcSize, pFirst[0], pFirst[1]);
+		pWeights[0] = 1.0f - weight;
+		pWeights[1] = weight;
+
+		return 2u;
+	};
+
+	for (auto y = y0; y < y1; ++y)
+	{
+		uint32_t rows[3];
+		float rowWeights[3];
+		const auto numRows = getTaps(y, dst.Height, src.Height, rows, rowWeights);
+		for (auto x = x0; x < x1; ++x)
+		{
+			uint32_t columns[3];
+			float columnWeights[3];
+			const auto numColumns = getTaps(x, dst.Width, src.Width, columns, columnWeights);
+
+			const uint8_t* ppTexels[9];
+			float weights[9];
+			auto numTexels = 0u;
+			for (auto r = 0u; r < numRows; ++r)
+				for (auto c = 0u; c < numColumns; ++c, ++numTexels)
+				{
+					ppTexels[numTexels] = getTexel(pSrc, src, columns[c], rows[r]);
+					weights[numTexels] = rowWeights[r] * columnWeights[c];
+				}
+
+			FilterNormalRGBA8(getTexel(pDst, dst, x, y), ppTexels, weights, numTexels, m_normalFlags);
+		}
+	}
+}
+
+void MipGeneratorCPU::formatBlit2D(uint32_t level, uint32_t x0, uint32_t y0, uint32_t x1, uint32_t y1)
+{
+	// Levels of formats other than R8G8B8A8_UNORM: of 1 or 2 channels, or of 16 or 32 bits
+	// per channel
+	const auto& src = m_mips[level - 1];
+	const auto& dst = m_mips[level];
+	const auto pSrc = getMipData(level - 1);
+	const auto pDst = getMipData(level);
+	const auto numChannels = m_numChannels;
+	const auto isHalf = m_format == R16G16B16A16_FLOAT;
+	const auto isFloat = m_format == R32G32B32A32_FLOAT;
+	const auto isUNORM8 = m_texelSize == numChannels;
+
+	// Exact 2x2 footprints of BILINEAR and BOX, in the same tiling as blit2D()
+	if (m_filter <= BOX && src.Width == 2 * dst.Width && src.Height == 2 * dst.Height)
+	{
+		// Kernels specialized for the formats of 1 to 3 channels
+		DownSampleRowFunc downSampleRow = nullptr;
+		DownSampleQuadsFunc downSampleQuads = nullptr;
+		switch (m_format)
+		{
+		case R8_UNORM:
+			downSampleRow = m_kernels.DownSampleR8;
+			downSampleQuads = m_kernels.DownSampleQuadsR8;
+			break;
+		case R8G8_UNORM:
+			downSampleRow = m_kernels.DownSampleRG8;
+			downSampleQuads = m_kernels.DownSampleQuadsRG8;
+			break;
+		case R8G8B8_UNORM:
+			downSampleRow = m_kernels.DownSampleRGB8;
+			downSampleQuads = m_kernels.DownSampleQuadsRGB8;
+			break;
+		case R16_UNORM:
+			downSampleRow = m_kernels.DownSampleR16;
+			downSampleQuads = m_kernels.DownSampleQuadsR16;
+			break;
+		case R16G16_UNORM:
+			downSampleRow = m_kernels.DownSampleRG16;
+			downSampleQuads = m_kernels.DownSampleQuadsRG16;
+			break;
+		default:
+			break;
+		}
+
+		const auto reduceQuads = [&](uint8_t* pDstQuads, const uint8_t* pSrcQuads, uint32_t dstCount)
+		{
+			if (downSampleQuads) downSampleQuads(pDstQuads, pSrcQuads, dstCount);
+			else if (isHalf) m_kernels.DownSampleQuadsRGBA16F(reinterpret_cast<uint16_t*>(pDstQuads),
+				reinterpret_cast<const uint16_t*>(pSrcQuads), dstCount);
+			else if (isFloat) m_kernels.DownSampleQuadsRGBA32F(reinterpret_cast<float*>(pDstQuads),
+				reinterpret_cast<const float*>(pSrcQuads), dstCount);
+			else m_kernels.DownSampleQuadsRGBA16(reinterpret_cast<uint16_t*>(pDstQuads),
+				reinterpret_cast<const uint16_t*>(pSrcQuads), dstCount);
+		};
+
+		if (m_layout == MORTON_TILED)
+		{
+			const auto quadSize = StorageTileSize / 2;
+			const auto quadTexels = quadSize * quadSize;
+			for (auto ty = y0 / StorageTileSize; ty < DIV_UP(y1, StorageTileSize); ++ty)
+				for (auto tx = x0 / StorageTileSize; tx < DIV_UP(x1, StorageTileSize); ++tx)
+				{
+					const auto pDstTile = getTexel(pDst, dst, StorageTileSize * tx, StorageTileSize * ty);
+					for (auto q = 0u; q < 4; ++q)
+					{
+						const auto sx = StorageTileSize * (2 * tx + (q & 1));
+						const auto sy = StorageTileSize * (2 * ty + (q >> 1));
+						if (sx < src.Width && sy < src.Height)
+							reduceQuads(&pDstTile[m_texelSize * quadTexels * q], getTexel(pSrc, src, sx, sy), quadTexels);
+					}
+				}
+		}
+		else for (auto y = y0; y < y1; ++y)
+		{
+			const auto pRow0 = getTexel(pSrc, src, 2 * x0, 2 * y);
+			const auto pRow1 = &pRow0[src.RowPitch];
+			const auto pDstRow = getTexel(pDst, dst, x0, y);
+			if (downSampleRow) downSampleRow(pDstRow, pRow0, pRow1, x1 - x0);
+			else if (isHalf) m_kernels.DownSampleRGBA16F(reinterpret_cast<uint16_t*>(pDstRow),
+				reinterpret_cast<const uint16_t*>(pRow0), reinterpret_cast<const uint16_t*>(pRow1), x1 - x0);
+			else if (isFloat) m_kernels.DownSampleRGBA32F(reinterpret_cast<float*>(pDstRow),
+				reinterpret_cast<const float*>(pRow0), reinterpret_cast<const float*>(pRow1), x1 - x0);
+			else m_kernels.DownSampleRGBA16(reinterpret_cast<uint16_t*>(pDstRow),
+				reinterpret_cast<const uint16_t*>(pRow0), reinterpret_cast<const uint16_t*>(pRow1), x1 - x0);
+		}
+
+		return;
+	}
+
+	// Other footprints, separable in strips of BlitTileSize columns as filterBlit2D(), with the
+	// taps of any filter: the bilinear ones, the box ones, or the polyphase ones
+	const auto getTaps = [this](uint32_t i, uint32_t dstSize, uint32_t srcSize, const FilterTaps* pTaps,
+		uint32_t& first, float* pWeights)
+	{
+		if (pTaps)
+		{
+			first = pTaps->First[i];
+			memcpy(pWeights, &pTaps->Weights[pTaps->NumTaps * i], sizeof(float) * pTaps->NumTaps);
+
+			return pTaps->NumTaps;
+		}
+
+		if (m_filter == BOX)
+		{
+			first = 2 * i;
+
+			return GetBoxTaps(i, srcSize, pWeights);
+		}
+
+		uint32_t i1;
+		const auto weight = SampleCoord(i, dstSize, srcSize, first, i1);
+		assert(i1 == first || i1 == first + 1);
+		pWeights[0] = i1 > first ? 1.0f - weight : 1.0f;
+		pWeights[1] = weight;
+
+		return i1 - first + 1;
+	};
+
+	assert(y1 - y0 <= BlitTileSize);
+	const auto pTapsX = m_filterLevels.empty() ? nullptr : &m_filterLevels[level].X;
+	const auto pTapsY = m_filterLevels.empty() ? nullptr : &m_filterLevels[level].Y;
+	uint32_t firstX[BlitTileSize], numTapsX[BlitTileSize];
+	uint32_t firstY[BlitTileSize], numTapsY[BlitTileSize];
+	float weightsX[BlitTileSize * MaxFilterTaps], weightsY[BlitTileSize * MaxFilterTaps];
+
+	auto sy0 = UINT32_MAX, sy1 = 0u;
+	for (auto y = y0; y < y1; ++y)
+	{
+		const auto j = y - y0;
+		numTapsY[j] = getTaps(y, dst.Height, src.Height, pTapsY, firstY[j], &weightsY[MaxFilterTaps * j]);
+		sy0 = (min)(sy0, firstY[j]);
+		sy1 = (max)(sy1, firstY[j] + numTapsY[j]);
+	}
+
+	// Scratch of each worker, reused across tiles
+	thread_local vector<float> rows;
+	thread_local vector<float> values;
+	thread_local vector<uint8_t> texels;
+
+	for (auto stripX = x0; stripX < x1; stripX += BlitTileSize)
+	{
+		const auto count = (min)(stripX + BlitTileSize, x1) - stripX;
+		auto sx0 = UINT32_MAX, sx1 = 0u;
+		for (auto i = 0u; i < count; ++i)
+		{
+			numTapsX[i] = getTaps(stripX + i, dst.Width, src.Width, pTapsX, firstX[i], &weightsX[MaxFilterTaps * i]);
+			sx0 = (min)(sx0, firstX[i]);
+			sx1 = (max)(sx1, firstX[i] + numTapsX[i]);
+		}
+
+		const auto rowSize = numChannels * count;
+		rows.resize(static_cast<size_t>(rowSize) * (sy1 - sy0));
+		values.resize(numChannels * (max)(sx1 - sx0, count));
+		texels.resize(m_texelSize * (max)(sx1 - sx0, count));
+
+		// Horizontal pass over the source rows under the strip, converted to float (in [0, 255]
+		// or [0, 65535] for the UNORM formats)
+		for (auto sy = sy0; sy < sy1; ++sy)
+		{
+			const uint8_t* pSrcRow;
+			if (m_layout == ROW_MAJOR) pSrcRow = getTexel(pSrc, src, sx0, sy);
+			else
+			{
+				for (auto x = sx0; x < sx1; ++x)
+					memcpy(&texels[m_texelSize * (x - sx0)], getTexel(pSrc, src, x, sy), m_texelSize);
+				pSrcRow = texels.data();
+			}
+
+			auto pSpan = reinterpret_cast<const float*>(pSrcRow);
+			if (!isFloat)
+			{
+				const auto spanSize = numChannels * (sx1 - sx0);
+				const auto pVals16 = reinterpret_cast<const uint16_t*>(pSrcRow);
+				if (isHalf) m_kernels.HalfToFloat(values.data(), pVals16, spanSize);
+				else if (isUNORM8) for (auto i = 0u; i < spanSize; ++i) values[i] = pSrcRow[i];
+				else for (auto i = 0u; i < spanSize; ++i) values[i] = pVals16[i];
+				pSpan = values.data();
+			}
+
+			const auto pRow = &rows[rowSize * (sy - sy0)];
+			for (auto i = 0u; i < count; ++i)
+			{
+				float sum[4] = {};
+				const auto pTexels = &pSpan[numChannels * (firstX[i] - sx0)];
+				for (auto t = 0u; t < numTapsX[i]; ++t)
+					for (uint8_t c = 0; c < numChannels; ++c)
+						sum[c] = sum[c] + weightsX[MaxFilterTaps * i + t] * pTexels[numChannels * t + c];
+				memcpy(&pRow[numChannels * i], sum, sizeof(float) * numChannels);
+			}
+		}
+
+		// Vertical pass, converted back into the destination
+		for (auto y = y0; y < y1; ++y)
+		{
+			const auto j = y - y0;
+			for (auto i = 0u; i < rowSize; ++i)
+			{
+				auto sum = 0.0f;
+				for (auto t = 0u; t < numTapsY[j]; ++t)
+					sum = sum + weightsY[MaxFilterTaps * j + t] * rows[rowSize * (firstY[j] + t - sy0) + i];
+				values[i] = (max)(sum, 0.0f);
+			}
+
+			const auto pDstRow = m_layout == ROW_MAJOR ? getTexel(pDst, dst, stripX, y) : texels.data();
+			if (isHalf) m_kernels.FloatToHalf(reinterpret_cast<uint16_t*>(pDstRow), values.data(), rowSize);
+			else if (isFloat) memcpy(pDstRow, values.data(), sizeof(float) * rowSize);
+			else if (isUNORM8) for (auto i = 0u; i < rowSize; ++i)
+				pDstRow[i] = static_cast<uint8_t>((min)(values[i], 255.0f) + 0.5f);
+			else for (auto i = 0u; i < rowSize; ++i)
+				reinterpret_cast<uint16_t*>(pDstRow)[i] = static_cast<uint16_t>((min)(values[i], 65535.0f) + 0.5f);
+
+			if (m_layout == MORTON_TILED)
+				for (auto i = 0u; i < count; ++i)
+					memcpy(getTexel(pDst, dst, stripX + i, y), &texels[m_texelSize * i], m_texelSize);
+		}
+	}
+}
+
+uint32_t MipGeneratorCPU::perGroupProcess(uint32_t level, uint32_t gidX, uint32_t gidY)
+{
+	// CPU counterpart of main() and PerGroupProcess() in CSGenerateMips.hlsl: the first
+	// level is reduced from the stored texels (out-of-bound reads return 0 as UAV loads do),
+	// the remaining ones from the unquantized values kept in the group tile, which are in
+	// linear light for sRGB as the typed UAV loads of CSGenerateMips.hlsl would return.
+	float groupVals[GroupSize][GroupSize][4];
+	const auto numMips = GetMipLevelCount();
+
+	// Down-sample texture
+	{
+		const auto& src = m_mips[level];
+		const auto& dst = m_mips[++level];
+		const auto pSrc = getMipData(level - 1);
+		const auto pDst = getMipData(level);
+
+		for (auto y = 0u; y < GroupSize; ++y)
+		{
+			const auto dy = GroupSize * gidY + y;
+			for (auto x = 0u; x < GroupSize; ++x)
+			{
+				const auto dx = GroupSize * gidX + x;
+				auto& val = groupVals[y][x];
+				float sum[4] = {};
+				for (const auto& offset : g_offsets2x2)
+				{
+					const auto sx = dx * 2 + offset[0];
+					const auto sy = dy * 2 + offset[1];
+					if (sx < src.Width && sy < src.Height)
+					{
+						const auto pTexel = getTexel(pSrc, src, sx, sy);
+						for (uint8_t c = 0; c < 4; ++c) sum[c] += LoadChannel(pTexel, c, m_isSRGB);
+					}
+				}
+
+				for (uint8_t c = 0; c < 4; ++c) val[c] = sum[c] / 4.0f;
+
+				if (dx < dst.Width && dy < dst.Height) StoreTexel(getTexel(pDst, dst, dx, dy), val, m_isSRGB);
+			}
+		}
+	}
+
+	// For a group, 32x32 => 1x1
+	for (auto fillSize = GroupSize >> 1; fillSize > 0; fillSize >>= 1)
+	{
+		if (level + 1 >= numMips) break;
+
+		const auto& dst = m_mips[++level];
+		const auto pDst = getMipData(level);
+
+		// In place is safe, since the 2x2 footprint of (x, y) never precedes (x, y)
+		for (auto y = 0u; y < fillSize; ++y)
+		{
+			const auto dy = fillSize * gidY + y;
+			for (auto x = 0u; x < fillSize; ++x)
+			{
+				const auto dx = fillSize * gidX + x;
+				float sum[4] = {};
+				for (const auto& offset : g_offsets2x2)
+				{
+					const auto& groupVal = groupVals[y * 2 + offset[1]][x * 2 + offset[0]];
+					for (uint8_t c = 0; c < 4; ++c) sum[c] += groupVal[c];
+				}
+
+				auto& val = groupVals[y][x];
+				for (uint8_t c = 0; c < 4; ++c) val[c] = sum[c] / 4.0f;
+
+				if (dx < dst.Width && dy < dst.Height) StoreTexel(getTexel(pDst, dst, dx, dy), val, m_isSRGB);
+			}
+		}
+	}
+
+	return level;
+}
+
+uint32_t MipGeneratorCPU::perGroupProcessPacked(uint32_t level, uint32_t gidX, uint32_t gidY)
+{
+	// Same flow as perGroupProcess(), with the group tile kept as packed texels in Z-order,
+	// like the threads of CSGenerateMips.hlsl (gTid = MortonDecode(GIdx)). Every 2x2
+	// footprint is then 4 consecutive texels, reduced by the quad kernel, with no float
+	// but for the linear light of sRGB.
+	const auto groupTexels = GroupSize * GroupSize;
+	uint32_t groupVals[2][groupTexels];
+	auto pVals = groupVals[0];
+	const auto numMips = GetMipLevelCount();
+	const auto downSampleColorQuads = m_isSRGB ? m_kernels.DownSampleQuadsSRGBA8 :
+		(m_isPremultiplied ? m_kernels.DownSampleQuadsPremulRGBA8 : m_kernels.DownSampleQuadsRGBA8);
+	const auto downSampleColorRow = m_isSRGB ? m_kernels.DownSampleSRGBA8 :
+		(m_isPremultiplied ? m_kernels.DownSamplePremulRGBA8 : m_kernels.DownSampleRGBA8);
+	const auto downSampleQuads = [&](uint8_t* pDst, const uint8_t* pSrc, uint32_t dstCount)
+	{
+		if (m_normalMap != COLOR_MAP) m_kernels.DownSampleQuadsNormalsRGBA8(pDst, pSrc, dstCount, m_normalFlags);
+		else downSampleColorQuads(pDst, pSrc, dstCount);
+	};
+	const auto downSampleRow = [&](uint8_t* pDst, const uint8_t* pRow0, const uint8_t* pRow1, uint32_t dstWidth)
+	{
+		if (m_normalMap != COLOR_MAP) m_kernels.DownSampleNormalsRGBA8(pDst, pRow0, pRow1, dstWidth, m_normalFlags);
+		else downSampleColorRow(pDst, pRow0, pRow1, dstWidth);
+	};
+
+	// Down-sample texture
+	{
+		const auto& src = m_mips[level];
+		const auto& dst = m_mips[++level];
+		const auto pSrc = getMipData(level - 1);
+		const auto pDst = getMipData(level);
+		const auto x0 = GroupSize * gidX;
+		const auto y0 = GroupSize * gidY;
+
+		if (2 * (x0 + GroupSize) <= src.Width && 2 * (y0 + GroupSize) <= src.Height)
+		{
+			if (m_layout == MORTON_TILED)
+			{
+				// The group is a destination tile, and its quadrant q is the source tile q
+				const auto quadTexels = groupTexels / 4;
+				for (auto q = 0u; q < 4; ++q)
+					downSampleQuads(reinterpret_cast<uint8_t*>(&pVals[quadTexels * q]),
+						getTexel(pSrc, src, 2 * x0 + GroupSize * (q & 1), 2 * y0 + GroupSize * (q >> 1)), quadTexels);
+				storeGroupVals(level, gidX, gidY, GroupSize, pVals);
+			}
+			else for (auto y = 0u; y < GroupSize; ++y)
+			{
+				// Rows straight to the destination, then gathered into the group tile
+				const auto pRow0 = getTexel(pSrc, src, 2 * x0, 2 * (y0 + y));
+				const auto pDstRow = getTexel(pDst, dst, x0, y0 + y);
+				downSampleRow(pDstRow, pRow0, &pRow0[src.RowPitch], GroupSize);
+				for (auto x = 0u; x < GroupSize; ++x)
+					memcpy(&pVals[m_kernels.MortonEncode(x, y)], &pDstRow[sizeof(uint32_t) * x], sizeof(uint32_t));
+			}
+		}
+		else
+		{
+			// Partial group, out-of-bound reads return 0
+			for (auto i = 0u; i < groupTexels; ++i)
+			{
+				uint32_t x, y;
+				m_kernels.MortonDecode(i, x, y);
+
+				uint32_t texels[4] = {};
+				for (uint8_t j = 0; j < 4; ++j)
+				{
+					const auto sx = 2 * (x0 + x) + g_offsets2x2[j][0];
+					const auto sy = 2 * (y0 + y) + g_offsets2x2[j][1];
+					if (sx < src.Width && sy < src.Height)
+						memcpy(&texels[j], getTexel(pSrc, src, sx, sy), sizeof(uint32_t));
+				}
+
+				if (m_isSRGB || m_isPremultiplied || m_normalMap != COLOR_MAP)
+					downSampleQuads(reinterpret_cast<uint8_t*>(&pVals[i]), reinterpret_cast<const uint8_t*>(texels), 1);
+				else pVals[i] = AveragePacked(texels[0], texels[1], texels[2], texels[3]);
+			}
+
+			storeGroupVals(level, gidX, gidY, GroupSize, pVals);
+		}
+	}
+
+	// For a group, 32x32 => 1x1
+	for (auto fillSize = GroupSize >> 1; fillSize > 0; fillSize >>= 1)
+	{
+		if (level + 1 >= numMips) break;
+
+		// Ping-pong between the 2 group tiles
+		const auto pSrcVals = pVals;
+		pVals = groupVals[pSrcVals == groupVals[0] ? 1 : 0];
+		downSampleQuads(reinterpret_cast<uint8_t*>(pVals), reinterpret_cast<const uint8_t*>(pSrcVals), fillSize * fillSize);
+		storeGroupVals(++level, gidX, gidY, fillSize, pVals);
+	}
+
+	return level;
+}
+
+uint32_t MipGeneratorCPU::perGroupProcessFused(uint32_t level, uint32_t gidX, uint32_t gidY)
+{
+	if (level > 0) return perGroupProcessFusedTier(level, gidX, gidY);
+
+	// Sums of the base texels under every texel of the group, in Z-order: in 16-bit lanes
+	// up to 16x16 footprints (256 * 255 at most), then in 32-bit ones. Every level is
+	// rounded once from its sums, with no quantization in between.
+	const auto groupTexels = GroupSize * GroupSize;
+	uint16_t groupSums[2][4 * groupTexels];
+	uint32_t groupVals[groupTexels];
+	auto pSums = groupSums[0];
+	const auto numMips = GetMipLevelCount();
+	++level;
+
+	// 2x2 sums of the base level
+	{
+		const auto& src = m_mips[0];
+		const auto& dst = m_mips[1];
+		const auto pSrc = getMipData(0);
+		const auto pDst = getMipData(1);
+		const auto x0 = GroupSize * gidX;
+		const auto y0 = GroupSize * gidY;
+
+		if (2 * (x0 + GroupSize) <= src.Width && 2 * (y0 + GroupSize) <= src.Height)
+		{
+			if (m_layout == MORTON_TILED)
+			{
+				const auto quadTexels = groupTexels / 4;
+				for (auto q = 0u; q < 4; ++q)
+					m_kernels.SumQuadsRGBA8(&pSums[4 * quadTexels * q],
+						getTexel(pSrc, src, 2 * x0 + GroupSize * (q & 1), 2 * y0 + GroupSize * (q >> 1)), quadTexels);
+				m_kernels.RoundSums16(reinterpret_cast<uint8_t*>(groupVals), pSums, groupTexels, 2);
+				storeGroupVals(1, gidX, gidY, GroupSize, groupVals);
+			}
+			else for (auto y = 0u; y < GroupSize; ++y)
+			{
+				uint16_t rowSums[4 * GroupSize];
+				const auto pRow0 = getTexel(pSrc, src, 2 * x0, 2 * (y0 + y));
+				m_kernels.SumRowRGBA8(rowSums, pRow0, &pRow0[src.RowPitch], GroupSize);
+				m_kernels.RoundSums16(getTexel(pDst, dst, x0, y0 + y), rowSums, GroupSize, 2);
+				for (auto x = 0u; x < GroupSize; ++x)
+					memcpy(&pSums[4 * m_kernels.MortonEncode(x, y)], &rowSums[4 * x], sizeof(uint16_t[4]));
+			}
+		}
+		else
+		{
+			// Partial group, out-of-bound reads return 0
+			for (auto i = 0u; i < groupTexels; ++i)
+			{
+				uint32_t x, y;
+				m_kernels.MortonDecode(i, x, y);
+
+				const auto pSum = &pSums[4 * i];
+				for (uint8_t c = 0; c < 4; ++c) pSum[c] = 0;
+				for (const auto& offset : g_offsets2x2)
+				{
+					const auto sx = 2 * (x0 + x) + offset[0];
+					const auto sy = 2 * (y0 + y) + offset[1];
+					if (sx < src.Width && sy < src.Height)
+					{
+						const auto pTexel = getTexel(pSrc, src, sx, sy);
+						for (uint8_t c = 0; c < 4; ++c) pSum[c] += pTexel[c];
+					}
+				}
+			}
+
+			m_kernels.RoundSums16(reinterpret_cast<uint8_t*>(groupVals), pSums, groupTexels, 2);
+			storeGroupVals(1, gidX, gidY, GroupSize, groupVals);
+		}
+	}
+
+	// 4x4 to 16x16 sums in 16-bit lanes
+	auto fillSize = GroupSize >> 1;
+	for (; level < 4 && level + 1 < numMips; fillSize >>= 1)
+	{
+		const auto pSrcSums = pSums;
+		pSums = groupSums[pSrcSums == groupSums[0] ? 1 : 0];
+		m_kernels.SumQuads16(pSums, pSrcSums, fillSize * fillSize);
+		m_kernels.RoundSums16(reinterpret_cast<uint8_t*>(groupVals), pSums, fillSize * fillSize, 2 * ++level);
+		storeGroupVals(level, gidX, gidY, fillSize, groupVals);
+	}
+
+	// 32x32 and 64x64 sums in 32-bit lanes, reduced in place
+	uint32_t sums32[4 * 4 * 4];
+	if (level + 1 < numMips)
+		for (auto i = 0u; i < 4 * 4 * fillSize * fillSize; ++i) sums32[i] = pSums[i];
+
+	for (; fillSize > 0 && level + 1 < numMips; fillSize >>= 1)
+	{
+		const auto shift = 2 * ++level;
+		const auto pVals = reinterpret_cast<uint8_t*>(groupVals);
+		for (auto i = 0u; i < 4 * fillSize * fillSize; ++i)
+		{
+			const auto j = (i & ~3u) * 4 + (i & 3);
+			sums32[i] = sums32[j] + sums32[j + 4] + sums32[j + 8] + sums32[j + 12];
+			pVals[i] = static_cast<uint8_t>((sums32[i] + (1u << (shift - 1))) >> shift);
+		}
+		storeGroupVals(level, gidX, gidY, fillSize, groupVals);
+	}
+
+	// The group is down to 1x1, keep its sums for the next tier
+	if (level + 1 < numMips)
+	{
+		auto& groups = m_groupTiers[0];
+		copy(sums32, sums32 + 4, &groups.Sums[4 * (groups.GroupCountX * gidY + gidX)]);
+	}
+
+	return level;
+}
+
+uint32_t MipGeneratorCPU::perGroupProcessFusedTier(uint32_t level, uint32_t gidX, uint32_t gidY)
+{
+	// A group of an upper tier, from the sums of its child groups as if it read them from
+	// the last level (0 out of bounds). Sums of up to the whole base need 64 bits.
+	const auto tier = level / TierLevels;
+	const auto& children = m_groupTiers[tier - 1];
+	const auto& src = m_mips[level];
+	const auto numMips = GetMipLevelCount();
+
+	// Scratch of each worker, reused across groups
+	thread_local vector<uint64_t> sums;
+	sums.assign(4 * GroupSize * GroupSize, 0);
+
+	const auto storeSums = [this, gidX, gidY](uint32_t mipLevel, uint32_t fillSize)
+	{
+		const auto& dst = m_mips[mipLevel];
+		const auto pDst = getMipData(mipLevel);
+		const auto shift = 2 * mipLevel;
+		for (auto y = 0u; y < fillSize && fillSize * gidY + y < dst.Height; ++y)
+			for (auto x = 0u; x < fillSize && fillSize * gidX + x < dst.Width; ++x)
+			{
+				const auto pTexel = getTexel(pDst, dst, fillSize * gidX + x, fillSize * gidY + y);
+				for (uint8_t c = 0; c < 4; ++c)
+					pTexel[c] = static_cast<uint8_t>((sums[4 * (fillSize * y + x) + c] + (1ull << (shift - 1))) >> shift);
+			}
+	};
+
+	// 2x2 sums of the child sums
+	for (auto y = 0u; y < GroupSize; ++y)
+		for (auto x = 0u; x < GroupSize; ++x)
+		{
+			const auto pSum = &sums[4 * (GroupSize * y + x)];
+			for (const auto& offset : g_offsets2x2)
+			{
+				const auto sx = 2 * (GroupSize * gidX + x) + offset[0];
+				const auto sy = 2 * (GroupSize * gidY + y) + offset[1];
+				if (sx < src.Width && sy < src.Height)
+					for (uint8_t c = 0; c < 4; ++c) pSum[c] += children.Sums[4 * (children.GroupCountX * sy + sx) + c];
+			}
+		}
+	storeSums(++level, GroupSize);
+
+	// For a group, 32x32 => 1x1, rows in place
+	for (auto fillSize = GroupSize >> 1; fillSize > 0 && level + 1 < numMips; fillSize >>= 1)
+	{
+		for (auto y = 0u; y < fillSize; ++y)
+			for (auto x = 0u; x < fillSize; ++x)
+				for (uint8_t c = 0; c < 4; ++c)
+				{
+					const auto j = 4 * (2 * fillSize * 2 * y + 2 * x) + c;
+					sums[4 * (fillSize * y + x) + c] = sums[j] + sums[j + 4] + sums[j + 8 * fillSize] + sums[j + 8 * fillSize + 4];
+				}
+		storeSums(++level, fillSize);
+	}
+
+	// The group is down to 1x1, keep its sums for the next tier
+	if (level + 1 < numMips)
+	{
+		auto& groups = m_groupTiers[tier];
+		copy(sums.cbegin(), sums.cbegin() + 4, &groups.Sums[4 * (groups.GroupCountX * gidY + gidX)]);
+	}
+
+	return level;
+}
+
+void MipGeneratorCPU::storeGroupVals(uint32_t level, uint32_t gidX, uint32_t gidY, uint32_t fillSize, const uint32_t* pVals)
+{
+	const auto& dst = m_mips[level];
+	const auto pDst = getMipData(level);
+	const auto x0 = fillSize * gidX;
+	const auto y0 = fillSize * gidY;
+
+	// An aligned square of a power-of-2 size within a tile is a contiguous range of it
+	if (m_layout == MORTON_TILED && x0 + fillSize <= dst.Width && y0 + fillSize <= dst.Height)
+		memcpy(getTexel(pDst, dst, x0, y0), pVals, sizeof(uint32_t) * fillSize * fillSize);
+	else for (auto i = 0u; i < fillSize * fillSize; ++i)
+	{
+		uint32_t x, y;
+		m_kernels.MortonDecode(i, x, y);
+		if (x0 + x < dst.Width && y0 + y < dst.Height)
+			memcpy(getTexel(pDst, dst, x0 + x, y0 + y), &pVals[i], sizeof(uint32_t));
+	}
+}
+
+bool MipGeneratorCPU::isSlowestGroup(uint32_t tier, uint32_t gidX, uint32_t gidY)
+{
+	// Groups beyond the last parent only cover texels out of bounds of the next tier
+	const auto& groups = m_groupTiers[tier];
+	if (gidX >= groups.GroupCountX || gidY >= groups.GroupCountY) return false;
+
+	// Acquire-release, so that the slowest child sees the texels of all the others
+	return groups.Counters[groups.GroupCountX * gidY + gidX].fetch_sub(1, memory_order_acq_rel) == 1;
+}
+
+void MipGeneratorCPU::forEachSpan(uint32_t level, const function<void(uint8_t*, uint32_t)>& func)
+{
+	// Contiguous texels of a level in parallel: rows, or rows of tiles, where a whole tile
+	// is one span and the texels of the partial tiles at the edges go one by one
+	const auto& mip = m_mips[level];
+	const auto pData = getMipData(level);
+	if (m_layout == MORTON_TILED)
+	{
+		m_scheduler->ParallelFor(DIV_UP(mip.Height, StorageTileSize), [&](uint32_t t)
+		{
+			const auto y0 = StorageTileSize * t;
+			const auto y1 = (min)(y0 + StorageTileSize, mip.Height);
+			for (auto x0 = 0u; x0 < mip.Width; x0 += StorageTileSize)
+			{
+				const auto x1 = (min)(x0 + StorageTileSize, mip.Width);
+				if (x1 - x0 == StorageTileSize && y1 - y0 == StorageTileSize)
+					func(getTexel(pData, mip, x0, y0), StorageTileSize * StorageTileSize);
+				else for (auto y = y0; y < y1; ++y)
+					for (auto x = x0; x < x1; ++x) func(getTexel(pData, mip, x, y), 1);
+			}
+		});
+	}
+	else m_scheduler->ParallelFor(mip.Height, [&](uint32_t y) { func(getTexel(pData, mip, 0, y), mip.Width); });
+}
+
+void MipGeneratorCPU::alphaHistogram(uint32_t level, uint64_t* pHist)
+{
+	// The 4 interleaved histograms of each thread, summed at the end
+	const auto numThreads = GetThreadCount();
+	vector<uint32_t> histograms(4 * 256 * numThreads);
+	forEachSpan(level, [this, &histograms](uint8_t* pTexels, uint32_t count)
+	{
+		HistogramAlphaRGBA8(&histograms[4 * 256 * m_scheduler->GetThreadIndex()], pTexels, count);
+	});
+
+	for (auto a = 0u; a < 256; ++a)
+	{
+		pHist[a] = 0;
+		for (auto i = 0u; i < 4 * numThreads; ++i) pHist[a] += histograms[256 * i + a];
+	}
+}
+
+uint8_t* MipGeneratorCPU::getMipData(uint32_t mipLevel)
+{
+	const auto base = ALIGN_UP(reinterpret_cast<uintptr_t>(m_storage.data()), g_dataAlignment);
+
+	return reinterpret_cast<uint8_t*>(base) + m_mips[mipLevel].Offset;
+}
+
+uint8_t* MipGeneratorCPU::getTexel(uint8_t* pMipData, const MipLevel& mip, uint32_t x, uint32_t y) const
+{
+	if (m_layout == MORTON_TILED)
+	{
+		const auto tileBytes = m_texelSize * StorageTileSize * StorageTileSize;
+		const auto tileOffset = static_cast<size_t>(mip.RowPitch) * (y / StorageTileSize) + tileBytes * (x / StorageTileSize);
+
+		return &pMipData[tileOffset + m_texelSize * m_kernels.MortonEncode(x % StorageTileSize, y % StorageTileSize)];
+	}
+
+	return &pMipData[static_cast<size_t>(mip.RowPitch) * y + m_texelSize * x];
+}
@@ -0,0 +1,257 @@
+//--------------------------------------------------------------------------------------
+// Copyright (c) XU, Tianchen. All rights reserved.
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <functional>
+#include "MipKernels.h"
+#include "TaskScheduler.h"
+
+//--------------------------------------------------------------------------------------
+// Headless MIP-map generator, producing the same chain as MipGenerator::Process()
+// without a D3D12 device. Every level is stored as R8G8B8A8_UNORM, or in a format of 16 or
+// 32 bits per channel for 16-bit and HDR sources, or of 1 to 3 channels for native sources.
+//--------------------------------------------------------------------------------------
+class MipGeneratorCPU
+{
+public:
+	enum PipelineType
+	{
+		GRAPHICS,		// Level by level, bilinear blits over rows
+		COMPUTE,		// Level by level, bilinear blits over 2D tiles
+		SINGLE_PASS,	// Depth first, 32x32 tiles reduced to 1x1 in cache
+
+		NUM_PIPE_TYPE
+	};
+
+	enum StorageLayout : uint8_t
+	{
+		ROW_MAJOR,		// Pitched rows
+		MORTON_TILED	// Rows of 32x32 tiles (4 KB of R8G8B8A8), texels in Z-order within a tile
+	};
+
+	enum ReductionMode : uint8_t
+	{
+		FLOAT_CARRY,	// Unquantized values carried through a group, as CSGenerateMips.hlsl
+		PACKED,			// R8G8B8A8_UNORM kept packed through a group, rounded at each level
+		FUSED_INTEGER	// Exact integer sums of the base texels, each level rounded once from them
+	};
+
+	enum FilterType : uint8_t
+	{
+		BILINEAR,		// One bilinear sample per texel, as Blit2D(); drops texels of odd sizes
+		BOX,			// Exact box over the footprint, with 3 polyphase taps along odd sizes
+		TENT,			// Separable polyphase filters, stretched over the footprint and run
+		MITCHELL,		// in horizontal then vertical passes over cache-sized tiles
+		LANCZOS3,
+		KAISER
+	};
+
+	enum NormalMapMode : uint8_t
+	{
+		COLOR_MAP,
+		NORMAL_MAP_XYZ,	// Tangent-space normals in RGB as (n + 1) / 2, alpha spare, from 4 channels
+		NORMAL_MAP_XY	// X and Y in RG, Z reconstructed, blue spare, from 2 channels as BC5
+	};
+
+	enum TexelFormat : uint8_t
+	{
+		R8G8B8A8_UNORM,
+		R16G16B16A16_UNORM,
+		R16G16B16A16_FLOAT,	// Half of the memory and bandwidth of R32G32B32A32_FLOAT
+		R32G32B32A32_FLOAT,
+		R8_UNORM,			// Masks, heights and roughness, a quarter of R8G8B8A8_UNORM
+		R8G8_UNORM,			// BC5-style normals
+		R16_UNORM,
+		R16G16_UNORM,
+		R8G8B8_UNORM		// Opaque photographs, 3 bytes per texel; no DXGI counterpart
+	};
+
+	MipGeneratorCPU();
+	virtual ~MipGeneratorCPU();
+
+	// Radiance HDR files are loaded as floats into levels of hdrFormat, 16-bit PNG, PSD and PNM
+	// files as R16G16B16A16_UNORM, the others as R8G8B8A8_UNORM
+	bool Init(const char* fileName, uint32_t numThreads = 0, StorageLayout layout = ROW_MAJOR,
+		TexelFormat hdrFormat = R16G16B16A16_FLOAT);
+	bool Init(const void* pData, uint32_t width, uint32_t height, uint8_t channels,
+		uint32_t numThreads = 0, StorageLayout layout = ROW_MAJOR);
+
+	// For the callers needing only the levels from baseLevel down, e.g. thumbnails: the file is
+	// loaded straight at that level, so that level 0 of the generator is level baseLevel of the
+	// full image. JPEG files are decoded at 1/2, 1/4 or 1/8 of the size (baseLevel is capped at 3),
+	// the others loaded in full as Init() does; baseLevel returns the level actually loaded.
+	// A JPEG level seeded so is not level baseLevel of Process() on the full image: it comes from
+	// a truncated-spectrum IDCT instead of a chain of 2x2 reductions, and differs slightly, as do
+	// the levels generated from it.
+	bool InitFromLevel(const char* fileName, uint32_t& baseLevel, uint32_t numThreads = 0,
+		StorageLayout layout = ROW_MAJOR);
+
+	// Levels in formats other than R8G8B8A8_UNORM are linear, and filtered as such by GRAPHICS and
+	// COMPUTE with any filter, negative lobes clamped at 0. SINGLE_PASS takes the tiles of
+	// COMPUTE, and the color space, alpha and normal-map modes are ignored.
+	bool InitHDR(const float* pData, uint32_t width, uint32_t height, uint8_t channels,
+		TexelFormat format = R16G16B16A16_FLOAT, uint32_t numThreads = 0, StorageLayout layout = ROW_MAJOR);
+	bool InitUNORM16(const uint16_t* pData, uint32_t width, uint32_t height, uint8_t channels,
+		uint32_t numThreads = 0, StorageLayout layout = ROW_MAJOR);
+
+	// Levels in the format of the source, tightly packed texels of that format, instead of
+	// the expansion to 4 channels: R8, R8G8 and R8G8B8 levels take a quarter, a half and 3/4
+	// of the memory and bandwidth. The same as InitHDR() for the color space, alpha and
+	// normal-map modes. From a file, images of 1 and 2 channels, and 8-bit ones of 3, are
+	// kept as such, the others loaded as Init() does.
+	bool InitNative(const void* pData, uint32_t width, uint32_t height, TexelFormat format,
+		uint32_t numThreads = 0, StorageLayout layout = ROW_MAJOR);
+	bool InitNative(const char* fileName, uint32_t numThreads = 0, StorageLayout layout = ROW_MAJOR);
+
+	// The reduction mode applies to SINGLE_PASS, the filter to the blits of GRAPHICS and COMPUTE
+	void Process(PipelineType pipelineType, ReductionMode reductionMode = FLOAT_CARRY);
+	void SetFilter(FilterType filter);
+
+	// Treats the levels as R8G8B8A8_UNORM_SRGB: every pipeline filters in linear light, as
+	// sampling and typed UAVs of that format do. FUSED_INTEGER, whose sums are of the encoded
+	// values, turns into PACKED.
+	void SetSRGB(bool isSRGB);
+
+	// Filters R8G8B8A8_UNORM as premultiplied alpha, storing straight alpha: the colors are
+	// weighted by alpha on the first read of each footprint, and divided by the filtered
+	// alpha on store, within the same pass. Applies to the 2x2 reductions, the bilinear
+	// and box blits; sRGB levels and the polyphase filters keep straight alpha. FLOAT_CARRY
+	// and FUSED_INTEGER turn into PACKED.
+	void SetPremultipliedAlpha(bool isPremultiplied);
+
+	// Normal maps are decoded, averaged over the footprints and renormalized in the pass of
+	// each level, the spare channel optionally holding a roughness folded Toksvig-style with
+	// the spread of the normals (see MipKernels::NormalMapFlag). Polyphase filters take the
+	// box footprints, the color space and the alpha mode are ignored, and FLOAT_CARRY and
+	// FUSED_INTEGER turn into PACKED.
+	void SetNormalMap(NormalMapMode mode, bool foldRoughness = false);
+
+	// For alpha-tested cutouts: after each Process(), the alpha of every level is scaled so
+	// that the fraction of texels passing the test alpha >= alphaRef matches level 0, found
+	// from one histogram pass per level. 0 turns it off.
+	void SetAlphaTestRef(float alphaRef);
+
+	uint32_t GetMipLevelCount() const;
+	uint32_t GetThreadCount() const;
+	void GetImageSize(uint32_t& width, uint32_t& height) const;
+	void GetMipSize(uint32_t mipLevel, uint32_t& width, uint32_t& height) const;
+
+	StorageLayout GetStorageLayout() const;
+	TexelFormat GetTexelFormat() const;
+	FilterType GetFilter() const;
+	bool IsSRGB() const;
+	bool IsPremultipliedAlpha() const;
+	NormalMapMode GetNormalMap() const;
+	float GetAlphaTestRef() const;
+	MipKernels::Isa GetKernelIsa() const;
+
+	// With MORTON_TILED, the row pitch is the size of a row of tiles
+	const uint8_t* GetMipData(uint32_t mipLevel, uint32_t* pRowPitch = nullptr) const;
+	void ReadMipData(uint32_t mipLevel, void* pDst, uint32_t rowPitch) const;
+
+	// Writes every level as fileName with _<level> before the extension, the levels encoded
+	// in parallel: PNG for the 8-bit formats, straight from the pitched rows of ROW_MAJOR,
+	// and Radiance HDR for the float ones. 16-bit UNORM levels are not written. Returns the
+	// number of levels written.
+	uint32_t SaveMipLevels(const char* fileName) const;
+
+	// Writes the whole chain into one DDS file with the DX10 header, in the DXGI format of the
+	// levels (R8G8B8A8_UNORM_SRGB if sRGB), for runtimes to load pre-baked with DDS::Loader.
+	// R8G8B8 levels are expanded to opaque R8G8B8A8_UNORM, having no DXGI counterpart.
+	bool SaveDDS(const char* fileName) const;
+
+	// Levels per tier of the single pass: a 2x2 down-sample, then 32x32 => 1x1. One tier
+	// of groups alone covers up to 4096x4096, as CSGenerateMips.hlsl does.
+	static const uint32_t TierLevels = 6;
+
+	// Taps of a polyphase filter along a dimension; false for BILINEAR and BOX
+	static bool BuildFilterTaps(FilterType filter, uint32_t dstSize, uint32_t srcSize, MipKernels::FilterTaps& taps);
+
+protected:
+	struct MipLevel
+	{
+		uint32_t Width;
+		uint32_t Height;
+		uint32_t RowPitch;
+		size_t Offset;
+	};
+
+	// Groups of a tier of the single pass. A group of tier t > 0 reduces the level
+	// written by its (2 * GroupSize)^2 child groups of tier t - 1, once all of them
+	// have finished, so that no group waits and no level needs a barrier.
+	struct GroupTier
+	{
+		uint32_t GroupCountX;
+		uint32_t GroupCountY;
+		std::unique_ptr<std::atomic<uint32_t>[]> Counters;	// Child groups yet to finish
+		std::vector<uint64_t> Sums;	// FUSED_INTEGER only, base sums of each group as 1x1
+	};
+
+	// Polyphase taps of a level from its parent
+	struct FilterLevel
+	{
+		MipKernels::FilterTaps X;
+		MipKernels::FilterTaps Y;
+	};
+
+	static const uint32_t GroupSize = 32;
+	static const uint32_t BlitTileSize = 64;
+	static const uint32_t StorageTileSize = 32;
+
+	void initLevels(uint32_t width, uint32_t height, uint32_t numThreads, StorageLayout layout, TexelFormat format);
+	void allocateMips(uint32_t width, uint32_t height);
+	void buildFilterTaps();
+	void buildBlitGraph();
+
+	void generateMipsGraphics();
+	void generateMipsCompute();
+	void generateMipsSinglePass(ReductionMode reductionMode);
+	void preserveAlphaCoverage();
+
+	void blit2D(uint32_t level, uint32_t x0, uint32_t y0, uint32_t x1, uint32_t y1);
+	void boxBlit2D(uint32_t level, uint32_t x0, uint32_t y0, uint32_t x1, uint32_t y1);
+	void filterBlit2D(uint32_t level, uint32_t x0, uint32_t y0, uint32_t x1, uint32_t y1);
+	void normalBlit2D(uint32_t level, uint32_t x0, uint32_t y0, uint32_t x1, uint32_t y1);
+	void formatBlit2D(uint32_t level, uint32_t x0, uint32_t y0, uint32_t x1, uint32_t y1);
+	uint32_t perGroupProcess(uint32_t level, uint32_t gidX, uint32_t gidY);
+	uint32_t perGroupProcessPacked(uint32_t level, uint32_t gidX, uint32_t gidY);
+	uint32_t perGroupProcessFused(uint32_t level, uint32_t gidX, uint32_t gidY);
+	uint32_t perGroupProcessFusedTier(uint32_t level, uint32_t gidX, uint32_t gidY);
+	void storeGroupVals(uint32_t level, uint32_t gidX, uint32_t gidY, uint32_t fillSize, const uint32_t* pVals);
+	bool isSlowestGroup(uint32_t tier, uint32_t gidX, uint32_t gidY);
+
+	void forEachSpan(uint32_t level, const std::function<void(uint8_t*, uint32_t)>& func);
+	void alphaHistogram(uint32_t level, uint64_t* pHist);
+
+	uint8_t* getMipData(uint32_t mipLevel);
+	uint8_t* getTexel(uint8_t* pMipData, const MipLevel& mip, uint32_t x, uint32_t y) const;
+
+	std::vector<uint8_t>	m_storage;
+	std::vector<MipLevel>	m_mips;
+
+	std::vector<FilterLevel> m_filterLevels;
+	std::vector<uint32_t>	m_blitTileOffsets;
+	TaskScheduler::TaskGraph m_blitGraph;
+
+	std::unique_ptr<TaskScheduler> m_scheduler;
+	std::vector<GroupTier>	m_groupTiers;
+	StorageLayout			m_layout;
+	TexelFormat				m_format;
+	uint32_t				m_texelSize;
+	uint8_t					m_numChannels;
+	FilterType				m_filter;
+	bool					m_isSRGB;
+	bool					m_isPremultiplied;
+	NormalMapMode			m_normalMap;
+	uint32_t				m_normalFlags;
+	float					m_alphaTestRef;
+
+	MipKernels::KernelTable	m_kernels;
+};
@@ -0,0 +1,3235 @@
+//--------------------------------------------------------------------------------------
+// Copyright (c) XU, Tianchen. All rights reserved.
+//--------------------------------------------------------------------------------------
+
+#include <cassert>
+#include <cstdlib>
+#include <cstring>
+#include "MipKernels.h"
+
+#ifdef MIP_KERNELS_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+#ifdef MIP_KERNELS_NEON
+#include <arm_neon.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+// Per-function ISA, so that one binary carries every variant
+#if defined(__GNUC__) || defined(__clang__)
+#define MIP_TARGET(isa)	__attribute__((target(isa)))
+#else
+#define MIP_TARGET(isa)
+#endif
+
+// Index of the lowest set bit of a non-zero mask
+#ifdef _MSC_VER
+static inline uint32_t LowestBit(uint64_t mask)
+{
+	unsigned long index;
+#ifdef _WIN64
+	_BitScanForward64(&index, mask);
+#else
+	if (!_BitScanForward(&index, static_cast<unsigned long>(mask)))
+	{
+		_BitScanForward(&index, static_cast<unsigned long>(mask >> 32));
+		index += 32;
+	}
+#endif
+
+	return index;
+}
+#else
+static inline uint32_t LowestBit(uint64_t mask)
+{
+	return __builtin_ctzll(mask);
+}
+#endif
+
+namespace MipKernels
+{
+	//--------------------------------------------------------------------------------------
+	// Bilinear blits
+	//--------------------------------------------------------------------------------------
+	float SampleCoord(uint32_t i, uint32_t dstSize, uint32_t srcSize, uint32_t& i0, uint32_t& i1)
+	{
+		const auto coord = (i + 0.5f) / dstSize * srcSize - 0.5f;
+		const auto fCoord = floorf(coord);
+		const auto maxIdx = static_cast<int>(srcSize) - 1;
+		i0 = static_cast<uint32_t>((std::min)((std::max)(static_cast<int>(fCoord), 0), maxIdx));
+		i1 = static_cast<uint32_t>((std::min)((std::max)(static_cast<int>(fCoord) + 1, 0), maxIdx));
+
+		return coord - fCoord;
+	}
+
+	void BlendTexelsRGBA8(uint8_t* pDst, const uint8_t* p00, const uint8_t* p01,
+		const uint8_t* p10, const uint8_t* p11, float wx, float wy)
+	{
+		for (uint8_t c = 0; c < 4; ++c)
+		{
+			const auto v0 = UNORM8ToFloat(p00[c]) * (1.0f - wx) + UNORM8ToFloat(p01[c]) * wx;
+			const auto v1 = UNORM8ToFloat(p10[c]) * (1.0f - wx) + UNORM8ToFloat(p11[c]) * wx;
+			pDst[c] = FloatToUNORM8(v0 * (1.0f - wy) + v1 * wy);
+		}
+	}
+
+	void BlitRowRGBA8(uint8_t* pDst, const uint8_t* pRow0, const uint8_t* pRow1, float wy,
+		uint32_t x0, uint32_t x1, uint32_t srcWidth, uint32_t dstWidth)
+	{
+		for (auto x = x0; x < x1; ++x)
+		{
+			uint32_t sx0, sx1;
+			const auto wx = SampleCoord(x, dstWidth, srcWidth, sx0, sx1);
+			BlendTexelsRGBA8(&pDst[4 * (x - x0)], &pRow0[4 * sx0], &pRow0[4 * sx1], &pRow1[4 * sx0], &pRow1[4 * sx1], wx, wy);
+		}
+	}
+
+	//--------------------------------------------------------------------------------------
+	// Box reduction of any size
+	//--------------------------------------------------------------------------------------
+	uint32_t GetBoxTaps(uint32_t i, uint32_t srcSize, float* pWeights)
+	{
+		if (srcSize == 1)
+		{
+			pWeights[0] = 1.0f;
+
+			return 1;
+		}
+
+		if (srcSize & 1)
+		{
+			// The footprint [i, i + 1) * (2n + 1) / n covers 2 whole texels and 2 partial ones
+			const auto n = srcSize >> 1;
+			const auto scale = 1.0f / srcSize;
+			pWeights[0] = (n - i) * scale;
+			pWeights[1] = n * scale;
+			pWeights[2] = (i + 1) * scale;
+
+			return 3;
+		}
+
+		pWeights[0] = pWeights[1] = 0.5f;
+
+		return 2;
+	}
+
+	//--------------------------------------------------------------------------------------
+	// Scalar
+	//--------------------------------------------------------------------------------------
+	void DownSampleRGBA8_Scalar(uint8_t* pDst, const uint8_t* pRow0, const uint8_t* pRow1, uint32_t dstWidth)
+	{
+		for (auto i = 0u; i < 4 * dstWidth; ++i)
+		{
+			const auto j = (i & ~3u) * 2 + (i & 3);
+			pDst[i] = static_cast<uint8_t>((pRow0[j] + pRow0[j + 4] + pRow1[j] + pRow1[j + 4] + 2) >> 2);
+		}
+	}
+
+	void DownSampleQuadsRGBA8_Scalar(uint8_t* pDst, const uint8_t* pSrc, uint32_t dstCount)
+	{
+		for (auto i = 0u; i < 4 * dstCount; ++i)
+		{
+			const auto j = (i & ~3u) * 4 + (i & 3);
+			pDst[i] = static_cast<uint8_t>((pSrc[j] + pSrc[j + 4] + pSrc[j + 8] + pSrc[j + 12] + 2) >> 2);
+		}
+	}
+
+	void SumRowRGBA8_Scalar(uint16_t* pDst, const uint8_t* pRow0, const uint8_t* pRow1, uint32_t dstWidth)
+	{
+		for (auto i = 0u; i < 4 * dstWidth; ++i)
+		{
+			const auto j = (i & ~3u) * 2 + (i & 3);
+			pDst[i] = static_cast<uint16_t>(pRow0[j] + pRow0[j + 4] + pRow1[j] + pRow1[j + 4]);
+		}
+	}
+
+	void SumQuadsRGBA8_Scalar(uint16_t* pDst, const uint8_t* pSrc, uint32_t dstCount)
+	{
+		for (auto i = 0u; i < 4 * dstCount; ++i)
+		{
+			const auto j = (i & ~3u) * 4 + (i & 3);
+			pDst[i] = static_cast<uint16_t>(pSrc[j] + pSrc[j + 4] + pSrc[j + 8] + pSrc[j + 12]);
+		}
+	}
+
+	void SumQuads16_Scalar(uint16_t* pDst, const uint16_t* pSrc, uint32_t dstCount)
+	{
+		for (auto i = 0u; i < 4 * dstCount; ++i)
+		{
+			const auto j = (i & ~3u) * 4 + (i & 3);
+			pDst[i] = static_cast<uint16_t>(pSrc[j] + pSrc[j + 4] + pSrc[j + 8] + pSrc[j + 12]);
+		}
+	}
+
+	void RoundSums16_Scalar(uint8_t* pDst, const uint16_t* pSrc, uint32_t count, uint32_t shift)
+	{
+		const auto bias = 1u << (shift - 1);
+		for (auto i = 0u; i < 4 * count; ++i)
+			pDst[i] = static_cast<uint8_t>((pSrc[i] + bias) >> shift);
+	}
+
+	void BoxRowRGBA8_Scalar(uint8_t* pDst, const uint8_t* const* ppRows, const float* pRowWeights,
+		uint32_t numRows, uint32_t x0, uint32_t x1, uint32_t srcWidth)
+	{
+		for (auto x = x0; x < x1; ++x)
+		{
+			float weights[3];
+			const auto numTaps = GetBoxTaps(x, srcWidth, weights);
+			const auto offset = 8 * (x - x0);
+
+			float sum[4] = {};
+			for (auto r = 0u; r < numRows; ++r)
+				for (auto t = 0u; t < numTaps; ++t)
+				{
+					const auto w = pRowWeights[r] * weights[t];
+					const auto pTexel = &ppRows[r][offset + 4 * t];
+					for (uint8_t c = 0; c < 4; ++c) sum[c] = sum[c] + w * pTexel[c];
+				}
+
+			for (uint8_t c = 0; c < 4; ++c)
+				pDst[4 * (x - x0) + c] = static_cast<uint8_t>((std::min)(sum[c] + 0.5f, 255.0f));
+		}
+	}
+
+	//--------------------------------------------------------------------------------------
+	// Morton codes, table driven
+	//--------------------------------------------------------------------------------------
+	static const struct MortonTables
+	{
+		MortonTables()
+		{
+			for (auto i = 0u; i < 256; ++i)
+			{
+				Spread[i] = 0;
+				Compact[i] = 0;
+				for (auto b = 0u; b < 8; ++b)
+				{
+					Spread[i] |= ((i >> b) & 1) << (2 * b);
+					Compact[i] |= ((i >> b) & 1) << ((b & 1) * 4 + b / 2);
+				}
+			}
+		}
+
+		uint16_t Spread[256];	// Bits of a byte moved to the even bits
+		uint8_t Compact[256];	// Even bits to the low nibble, odd bits to the high nibble
+	} g_mortonTables;
+
+	uint32_t MortonEncode_Table(uint32_t x, uint32_t y)
+	{
+		const auto& spread = g_mortonTables.Spread;
+		const auto xBits = spread[x & 0xff] | (spread[(x >> 8) & 0xff] << 16);
+		const auto yBits = spread[y & 0xff] | (spread[(y >> 8) & 0xff] << 16);
+
+		return xBits | (yBits << 1);
+	}
+
+	void MortonDecode_Table(uint32_t code, uint32_t& x, uint32_t& y)
+	{
+		x = y = 0;
+		for (auto i = 0u; i < 4; ++i)
+		{
+			const auto bits = g_mortonTables.Compact[(code >> (8 * i)) & 0xff];
+			x |= (bits & 0xf) << (4 * i);
+			y |= (bits >> 4) << (4 * i);
+		}
+	}
+
+	//--------------------------------------------------------------------------------------
+	// Match lengths
+	//--------------------------------------------------------------------------------------
+	uint32_t MatchLength_Scalar(const uint8_t* pA, const uint8_t* pB, uint32_t maxLength)
+	{
+		// 8 bytes at a time, the first mismatch found from the XOR of little-endian words
+		auto length = 0u;
+		for (; length + 8 <= maxLength; length += 8)
+		{
+			uint64_t a, b;
+			memcpy(&a, &pA[length], sizeof(uint64_t));
+			memcpy(&b, &pB[length], sizeof(uint64_t));
+			if (a != b) return length + LowestBit(a ^ b) / 8;
+		}
+
+		while (length < maxLength && pA[length] == pB[length]) ++length;
+
+		return length;
+	}
+
+	//--------------------------------------------------------------------------------------
+	// PNG unfiltering
+	//--------------------------------------------------------------------------------------
+	static inline uint8_t PaethPredictor(int a, int b, int c)
+	{
+		// The nearest of a, b and c to a + b - c, ties broken in that order
+		const auto pa = abs(b - c);
+		const auto pb = abs(a - c);
+		const auto pc = abs(a + b - 2 * c);
+
+		return static_cast<uint8_t>(pa <= pb && pa <= pc ? a : (pb <= pc ? b : c));
+	}
+
+	void UnfilterSub_Scalar(uint8_t* pDst, const uint8_t* pSrc, const uint8_t*, uint32_t rowBytes, uint32_t bpp)
+	{
+		for (auto i = 0u; i < bpp; ++i) pDst[i] = pSrc[i];
+		for (auto i = bpp; i < rowBytes; ++i) pDst[i] = pSrc[i] + pDst[i - bpp];
+	}
+
+	void UnfilterUp_Scalar(uint8_t* pDst, const uint8_t* pSrc, const uint8_t* pPrior, uint32_t rowBytes, uint32_t)
+	{
+		for (auto i = 0u; i < rowBytes; ++i) pDst[i] = pSrc[i] + pPrior[i];
+	}
+
+	void UnfilterAverage_Scalar(uint8_t* pDst, const uint8_t* pSrc, const uint8_t* pPrior, uint32_t rowBytes, uint32_t bpp)
+	{
+		for (auto i = 0u; i < bpp; ++i) pDst[i] = pSrc[i] + (pPrior[i] >> 1);
+		for (auto i = bpp; i < rowBytes; ++i) pDst[i] = pSrc[i] + ((pDst[i - bpp] + pPrior[i]) >> 1);
+	}
+
+	void UnfilterPaeth_Scalar(uint8_t* pDst, const uint8_t* pSrc, const uint8_t* pPrior, uint32_t rowBytes, uint32_t bpp)
+	{
+		for (auto i = 0u; i < bpp; ++i) pDst[i] = pSrc[i] + pPrior[i];
+		for (auto i = bpp; i < rowBytes; ++i)
+			pDst[i] = pSrc[i] + PaethPredictor(pDst[i - bpp], pPrior[i], pPrior[i - bpp]);
+	}
+
+	//--------------------------------------------------------------------------------------
+	// sRGB conversions, table driven
+	//--------------------------------------------------------------------------------------
+	static const uint32_t g_srgbMinBits = (127 - 13) << 23;	// 2^-13, below the threshold of 1
+	static const uint32_t g_srgbMaxBits = 0x3f7fffff;		// The largest float below 1
+	static const uint32_t g_srgbBucketShift = 16;			// 128 buckets per octave
+	static const uint32_t g_srgbNumBuckets = ((g_srgbMaxBits - g_srgbMinBits) >> g_srgbBucketShift) + 1;
+
+	static const struct SRGBTables
+	{
+		SRGBTables()
+		{
+			// D3DX_SRGBTable, and UNORM8ToFloat() for alpha
+			for (auto i = 0u; i < 256; ++i)
+			{
+				const auto val = i / 255.0;
+				Decode[0][i] = static_cast<float>(val <= 0.04045 ? val / 12.92 : pow((val + 0.055) / 1.055, 2.4));
+				Decode[1][i] = UNORM8ToFloat(static_cast<uint8_t>(i));
+			}
+
+			// D3DX_FLOAT_to_SRGB(), then D3DX_FLOAT_to_UINT() with 255, from the float bits
+			const auto encode = [](uint32_t bits)
+			{
+				float val;
+				memcpy(&val, &bits, sizeof(float));
+				const auto srgb = val < 0.0031308f ? val * 12.92 : 1.055 * pow(val, 1.0 / 2.4) - 0.055;
+
+				return static_cast<uint32_t>(floor(srgb * 255 + 0.5));
+			};
+
+			// First float of each value, by bisection as the encode is monotonic. Never reached
+			// by a float below 1, value 256 stands for the last bucket threshold.
+			uint32_t thresholds[257];
+			for (auto v = 0u; v < 256; ++v)
+			{
+				uint32_t lo = 0, hi = 0x3f800000;
+				while (lo < hi)
+				{
+					const auto mid = lo + (hi - lo) / 2;
+					if (encode(mid) >= v) hi = mid;
+					else lo = mid + 1;
+				}
+				thresholds[v] = lo;
+			}
+			thresholds[256] = 0x3f800000;
+
+			// A bucket never spans more than 1 threshold at this resolution
+			for (auto i = 0u; i < g_srgbNumBuckets; ++i)
+			{
+				const auto value = encode(g_srgbMinBits + (i << g_srgbBucketShift));
+				BucketValues[i] = static_cast<int32_t>(value);
+				memcpy(&BucketThresholds[i], &thresholds[value + 1], sizeof(float));
+			}
+		}
+
+		float Decode[2][256];	// sRGB, then linear for alpha
+		int32_t BucketValues[g_srgbNumBuckets];
+		float BucketThresholds[g_srgbNumBuckets];
+	} g_srgbTables;
+
+	float SRGB8ToLinear(uint8_t val)
+	{
+		return g_srgbTables.Decode[0][val];
+	}
+
+	uint8_t LinearToSRGB8(float val)
+	{
+		// Saturated to [2^-13, 1), NaN to 0 as D3DX_Saturate_FLOAT()
+		float minVal, maxVal;
+		memcpy(&minVal, &g_srgbMinBits, sizeof(float));
+		memcpy(&maxVal, &g_srgbMaxBits, sizeof(float));
+		if (!(val > minVal)) val = minVal;
+		if (val > maxVal) val = maxVal;
+
+		uint32_t bits;
+		memcpy(&bits, &val, sizeof(float));
+		const auto bucket = (bits - g_srgbMinBits) >> g_srgbBucketShift;
+
+		return static_cast<uint8_t>(g_srgbTables.BucketValues[bucket] + (val >= g_srgbTables.BucketThresholds[bucket] ? 1 : 0));
+	}
+
+	static inline float decodeSRGBA8(const uint8_t* pTexel, uint8_t c)
+	{
+		return g_srgbTables.Decode[c == 3][pTexel[c]];
+	}
+
+	static inline void encodeSRGBA8(uint8_t* pDst, const float* pVal)
+	{
+		for (uint8_t c = 0; c < 3; ++c) pDst[c] = LinearToSRGB8(pVal[c]);
+		pDst[3] = FloatToUNORM8(pVal[3]);
+	}
+
+	void BlendTexelsSRGBA8(uint8_t* pDst, const uint8_t* p00, const uint8_t* p01,
+		const uint8_t* p10, const uint8_t* p11, float wx, float wy)
+	{
+		float val[4];
+		for (uint8_t c = 0; c < 4; ++c)
+		{
+			const auto v0 = decodeSRGBA8(p00, c) * (1.0f - wx) + decodeSRGBA8(p01, c) * wx;
+			const auto v1 = decodeSRGBA8(p10, c) * (1.0f - wx) + decodeSRGBA8(p11, c) * wx;
+			val[c] = v0 * (1.0f - wy) + v1 * wy;
+		}
+		encodeSRGBA8(pDst, val);
+	}
+
+	void BlitRowSRGBA8(uint8_t* pDst, const uint8_t* pRow0, const uint8_t* pRow1, float wy,
+		uint32_t x0, uint32_t x1, uint32_t srcWidth, uint32_t dstWidth)
+	{
+		for (auto x = x0; x < x1; ++x)
+		{
+			uint32_t sx0, sx1;
+			const auto wx = SampleCoord(x, dstWidth, srcWidth, sx0, sx1);
+			BlendTexelsSRGBA8(&pDst[4 * (x - x0)], &pRow0[4 * sx0], &pRow0[4 * sx1], &pRow1[4 * sx0], &pRow1[4 * sx1], wx, wy);
+		}
+	}
+
+	void BoxRowSRGBA8(uint8_t* pDst, const uint8_t* const* ppRows, const float* pRowWeights,
+		uint32_t numRows, uint32_t x0, uint32_t x1, uint32_t srcWidth)
+	{
+		for (auto x = x0; x < x1; ++x)
+		{
+			float weights[3];
+			const auto numTaps = GetBoxTaps(x, srcWidth, weights);
+			const auto offset = 8 * (x - x0);
+
+			float sum[4] = {};
+			for (auto r = 0u; r < numRows; ++r)
+				for (auto t = 0u; t < numTaps; ++t)
+				{
+					const auto w = pRowWeights[r] * weights[t];
+					const auto pTexel = &ppRows[r][offset + 4 * t];
+					for (uint8_t c = 0; c < 4; ++c) sum[c] = sum[c] + w * decodeSRGBA8(pTexel, c);
+				}
+			encodeSRGBA8(&pDst[4 * (x - x0)], sum);
+		}
+	}
+
+	// Columns first, ((p00 + p10) + (p01 + p11)) / 4, the order of the vector kernels
+	void DownSampleSRGBA8_Scalar(uint8_t* pDst, const uint8_t* pRow0, const uint8_t* pRow1, uint32_t dstWidth)
+	{
+		for (auto i = 0u; i < dstWidth; ++i)
+		{
+			float val[4];
+			const auto j = 8 * i;
+			for (uint8_t c = 0; c < 4; ++c)
+				val[c] = ((decodeSRGBA8(&pRow0[j], c) + decodeSRGBA8(&pRow1[j], c)) +
+					(decodeSRGBA8(&pRow0[j + 4], c) + decodeSRGBA8(&pRow1[j + 4], c))) * 0.25f;
+			encodeSRGBA8(&pDst[4 * i], val);
+		}
+	}
+
+	void DownSampleQuadsSRGBA8_Scalar(uint8_t* pDst, const uint8_t* pSrc, uint32_t dstCount)
+	{
+		for (auto i = 0u; i < dstCount; ++i)
+		{
+			float val[4];
+			const auto j = 16 * i;
+			for (uint8_t c = 0; c < 4; ++c)
+				val[c] = ((decodeSRGBA8(&pSrc[j], c) + decodeSRGBA8(&pSrc[j + 8], c)) +
+					(decodeSRGBA8(&pSrc[j + 4], c) + decodeSRGBA8(&pSrc[j + 12], c))) * 0.25f;
+			encodeSRGBA8(&pDst[4 * i], val);
+		}
+	}
+
+	//--------------------------------------------------------------------------------------
+	// Premultiplied alpha
+	//--------------------------------------------------------------------------------------
+	// Weighted sums of the premultiplied colors and alpha, and of the straight colors
+	static inline void accumulatePremulRGBA8(float* pVal, float* pStraight, const uint8_t* pTexel, float weight)
+	{
+		const auto alpha = weight * UNORM8ToFloat(pTexel[3]);
+		for (uint8_t c = 0; c < 3; ++c)
+		{
+			pVal[c] = pVal[c] + alpha * UNORM8ToFloat(pTexel[c]);
+			pStraight[c] = pStraight[c] + weight * UNORM8ToFloat(pTexel[c]);
+		}
+		pVal[3] = pVal[3] + alpha;
+	}
+
+	static inline void storePremulRGBA8(uint8_t* pDst, const float* pVal, const float* pStraight)
+	{
+		for (uint8_t c = 0; c < 3; ++c) pDst[c] = FloatToUNORM8(pVal[3] > 0.0f ? pVal[c] / pVal[3] : pStraight[c]);
+		pDst[3] = FloatToUNORM8(pVal[3]);
+	}
+
+	void BlendTexelsPremulRGBA8(uint8_t* pDst, const uint8_t* p00, const uint8_t* p01,
+		const uint8_t* p10, const uint8_t* p11, float wx, float wy)
+	{
+		float val[4] = {}, straight[3] = {};
+		accumulatePremulRGBA8(val, straight, p00, (1.0f - wx) * (1.0f - wy));
+		accumulatePremulRGBA8(val, straight, p01, wx * (1.0f - wy));
+		accumulatePremulRGBA8(val, straight, p10, (1.0f - wx) * wy);
+		accumulatePremulRGBA8(val, straight, p11, wx * wy);
+		storePremulRGBA8(pDst, val, straight);
+	}
+
+	void BlitRowPremulRGBA8(uint8_t* pDst, const uint8_t* pRow0, const uint8_t* pRow1, float wy,
+		uint32_t x0, uint32_t x1, uint32_t srcWidth, uint32_t dstWidth)
+	{
+		for (auto x = x0; x < x1; ++x)
+		{
+			uint32_t sx0, sx1;
+			const auto wx = SampleCoord(x, dstWidth, srcWidth, sx0, sx1);
+			BlendTexelsPremulRGBA8(&pDst[4 * (x - x0)], &pRow0[4 * sx0], &pRow0[4 * sx1], &pRow1[4 * sx0], &pRow1[4 * sx1], wx, wy);
+		}
+	}
+
+	void BoxRowPremulRGBA8(uint8_t* pDst, const uint8_t* const* ppRows, const float* pRowWeights,
+		uint32_t numRows, uint32_t x0, uint32_t x1, uint32_t srcWidth)
+	{
+		for (auto x = x0; x < x1; ++x)
+		{
+			float weights[3];
+			const auto numTaps = GetBoxTaps(x, srcWidth, weights);
+			const auto offset = 8 * (x - x0);
+
+			float val[4] = {}, straight[3] = {};
+			for (auto r = 0u; r < numRows; ++r)
+				for (auto t = 0u; t < numTaps; ++t)
+					accumulatePremulRGBA8(val, straight, &ppRows[r][offset + 4 * t], pRowWeights[r] * weights[t]);
+			storePremulRGBA8(&pDst[4 * (x - x0)], val, straight);
+		}
+	}
+
+	// Integer sums, divided in float: the quotient is correctly rounded, as in the vector kernels
+	static inline void downSamplePremulRGBA8(uint8_t* pDst, const uint8_t* p0, const uint8_t* p1,
+		const uint8_t* p2, const uint8_t* p3)
+	{
+		const auto sumAlpha = p0[3] + p1[3] + p2[3] + p3[3];
+		for (uint8_t c = 0; c < 3; ++c)
+		{
+			const auto weighted = p0[c] * p0[3] + p1[c] * p1[3] + p2[c] * p2[3] + p3[c] * p3[3];
+			pDst[c] = sumAlpha ? static_cast<uint8_t>(static_cast<float>(weighted) / static_cast<float>(sumAlpha) + 0.5f) :
+				static_cast<uint8_t>((p0[c] + p1[c] + p2[c] + p3[c] + 2) >> 2);
+		}
+		pDst[3] = static_cast<uint8_t>((sumAlpha + 2) >> 2);
+	}
+
+	void DownSamplePremulRGBA8_Scalar(uint8_t* pDst, const uint8_t* pRow0, const uint8_t* pRow1, uint32_t dstWidth)
+	{
+		for (auto i = 0u; i < dstWidth; ++i)
+		{
+			const auto j = 8 * i;
+			downSamplePremulRGBA8(&pDst[4 * i], &pRow0[j], &pRow0[j + 4], &pRow1[j], &pRow1[j + 4]);
+		}
+	}
+
+	void DownSampleQuadsPremulRGBA8_Scalar(uint8_t* pDst, const uint8_t* pSrc, uint32_t dstCount)
+	{
+		for (auto i = 0u; i < dstCount; ++i)
+		{
+			const auto j = 16 * i;
+			downSamplePremulRGBA8(&pDst[4 * i], &pSrc[j], &pSrc[j + 4], &pSrc[j + 8], &pSrc[j + 12]);
+		}
+	}
+
+	//--------------------------------------------------------------------------------------
+	// Normal maps
+	//--------------------------------------------------------------------------------------
+	static inline float decodeNormal(uint8_t val)
+	{
+		return val * (2.0f / 255) - 1.0f;
+	}
+
+	static inline uint8_t encodeNormal(float val)
+	{
+		return FloatToUNORM8(val * 0.5f + 0.5f);
+	}
+
+	// The order of the operations is that of the vector kernels, with no fused multiply-add
+	void FilterNormalRGBA8(uint8_t* pDst, const uint8_t* const* ppTexels, const float* pWeights,
+		uint32_t numTexels, uint32_t flags)
+	{
+		const auto isXY = (flags & NORMAL_XY) != 0;
+		const auto spareChannel = isXY ? 2 : 3;
+		float normal[3] = {}, spare = 0.0f, alpha = 0.0f;
+		for (auto i = 0u; i < numTexels; ++i)
+		{
+			const auto pTexel = ppTexels[i];
+			const auto w = pWeights[i];
+			const auto x = decodeNormal(pTexel[0]);
+			const auto y = decodeNormal(pTexel[1]);
+			const auto z = isXY ? sqrtf((std::max)(1.0f - x * x - y * y, 0.0f)) : decodeNormal(pTexel[2]);
+
+			// Never 0, since no channel decodes to 0
+			const auto invLength = 1.0f / sqrtf(x * x + y * y + z * z);
+			normal[0] = normal[0] + w * (x * invLength);
+			normal[1] = normal[1] + w * (y * invLength);
+			normal[2] = normal[2] + w * (z * invLength);
+
+			const auto s = UNORM8ToFloat(pTexel[spareChannel]);
+			spare = spare + w * (flags & NORMAL_ROUGHNESS ? s * s : s);
+			if (isXY) alpha = alpha + w * UNORM8ToFloat(pTexel[3]);
+		}
+
+		// Normals cancelling out give (0, 0, 1) and a roughness of 1
+		const auto length = sqrtf(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+		const auto invLength = 1.0f / length;
+		const auto isValid = length > 0.0f;
+		pDst[0] = encodeNormal(isValid ? normal[0] * invLength : 0.0f);
+		pDst[1] = encodeNormal(isValid ? normal[1] * invLength : 0.0f);
+		if (!isXY) pDst[2] = encodeNormal(isValid ? normal[2] * invLength : 1.0f);
+
+		if (flags & NORMAL_ROUGHNESS)
+			spare = sqrtf((std::min)((std::max)(spare + (1.0f - length) / length, 0.0f), 1.0f));
+		pDst[spareChannel] = FloatToUNORM8(spare);
+		if (isXY) pDst[3] = FloatToUNORM8(alpha);
+	}
+
+	void DownSampleNormalsRGBA8_Scalar(uint8_t* pDst, const uint8_t* pRow0, const uint8_t* pRow1,
+		uint32_t dstWidth, uint32_t flags)
+	{
+		const float weights[] = { 0.25f, 0.25f, 0.25f, 0.25f };
+		for (auto i = 0u; i < dstWidth; ++i)
+		{
+			const auto j = 8 * i;
+			const uint8_t* ppTexels[] = { &pRow0[j], &pRow0[j + 4], &pRow1[j], &pRow1[j + 4] };
+			FilterNormalRGBA8(&pDst[4 * i], ppTexels, weights, 4, flags);
+		}
+	}
+
+	void DownSampleQuadsNormalsRGBA8_Scalar(uint8_t* pDst, const uint8_t* pSrc, uint32_t dstCount, uint32_t flags)
+	{
+		const float weights[] = { 0.25f, 0.25f, 0.25f, 0.25f };
+		for (auto i = 0u; i < dstCount; ++i)
+		{
+			const auto j = 16 * i;
+			const uint8_t* ppTexels[] = { &pSrc[j], &pSrc[j + 4], &pSrc[j + 8], &pSrc[j + 12] };
+			FilterNormalRGBA8(&pDst[4 * i], ppTexels, weights, 4, flags);
+		}
+	}
+
+	//--------------------------------------------------------------------------------------
+	// Separable polyphase filters
+	//--------------------------------------------------------------------------------------
+	static const double g_pi = 3.14159265358979323846;
+
+	static double Sinc(double x)
+	{
+		return x != 0.0 ? sin(g_pi * x) / (g_pi * x) : 1.0;
+	}
+
+	// Modified Bessel function of the first kind and order 0, by its power series
+	static double BesselI0(double x)
+	{
+		auto sum = 1.0;
+		auto term = 1.0;
+		for (auto k = 1; term > 1e-12 * sum; ++k)
+		{
+			const auto t = x / (2 * k);
+			term *= t * t;
+			sum += term;
+		}
+
+		return sum;
+	}
+
+	float TentFilter(float x)
+	{
+		return (std::max)(1.0f - fabsf(x), 0.0f);
+	}
+
+	float MitchellFilter(float x)
+	{
+		const auto b = 1.0f / 3.0f;
+		const auto c = 1.0f / 3.0f;
+		x = fabsf(x);
+		if (x < 1.0f) return ((12 - 9 * b - 6 * c) * x * x * x + (-18 + 12 * b + 6 * c) * x * x + (6 - 2 * b)) / 6;
+		if (x < 2.0f) return ((-b - 6 * c) * x * x * x + (6 * b + 30 * c) * x * x + (-12 * b - 48 * c) * x + (8 * b + 24 * c)) / 6;
+
+		return 0.0f;
+	}
+
+	float Lanczos3Filter(float x)
+	{
+		return fabsf(x) < 3.0f ? static_cast<float>(Sinc(x) * Sinc(x / 3.0)) : 0.0f;
+	}
+
+	float KaiserFilter(float x)
+	{
+		const auto alpha = 4.0;
+		const auto t = x / 3.0;
+
+		return fabsf(x) < 3.0f ? static_cast<float>(Sinc(x) * BesselI0(alpha * sqrt(1.0 - t * t)) / BesselI0(alpha)) : 0.0f;
+	}
+
+	void BuildFilterTaps(FilterTaps& taps, uint32_t dstSize, uint32_t srcSize, FilterFunc filter, float radius)
+	{
+		// When minifying, the filter is stretched over the footprint of a destination texel
+		const auto scale = static_cast<double>(srcSize) / dstSize;
+		const auto stretch = (std::max)(scale, 1.0);
+		const auto support = radius * stretch;
+
+		// Clamped taps of each texel, with the zero weights at both ends trimmed
+		std::vector<std::vector<double>> weights(dstSize);
+		taps.First.resize(dstSize);
+		taps.NumTaps = 1;
+		for (auto i = 0u; i < dstSize; ++i)
+		{
+			const auto center = (i + 0.5) * scale - 0.5;
+			const auto s0 = static_cast<int>(floor(center - support)) + 1;
+			const auto s1 = static_cast<int>(ceil(center + support)) - 1;
+			const auto maxIdx = static_cast<int>(srcSize) - 1;
+			const auto lo = (std::min)((std::max)(s0, 0), maxIdx);
+			const auto hi = (std::min)((std::max)(s1, 0), maxIdx);
+
+			auto& w = weights[i];
+			w.assign(hi - lo + 1, 0.0);
+			auto total = 0.0;
+			for (auto s = s0; s <= s1; ++s)
+			{
+				const auto weight = filter(static_cast<float>((s - center) / stretch));
+				w[(std::min)((std::max)(s, lo), hi) - lo] += weight;
+				total += weight;
+			}
+			for (auto& weight : w) weight /= total;
+
+			auto first = 0u;
+			auto last = static_cast<uint32_t>(w.size()) - 1;
+			while (first < last && w[first] == 0.0) ++first;
+			while (last > first && w[last] == 0.0) --last;
+			w = std::vector<double>(w.begin() + first, w.begin() + last + 1);
+			taps.First[i] = lo + first;
+			taps.NumTaps = (std::max)(taps.NumTaps, static_cast<uint32_t>(w.size()));
+		}
+
+		// The same number of taps for every texel, keeping the windows within the source
+		assert(taps.NumTaps <= MaxFilterTaps);
+		taps.Weights.assign(static_cast<size_t>(taps.NumTaps) * dstSize, 0.0f);
+		for (auto i = 0u; i < dstSize; ++i)
+		{
+			const auto first = (std::min)(taps.First[i], srcSize - taps.NumTaps);
+			const auto offset = taps.First[i] - first;
+			for (size_t t = 0; t < weights[i].size(); ++t)
+				taps.Weights[taps.NumTaps * i + offset + t] = static_cast<float>(weights[i][t]);
+			taps.First[i] = first;
+		}
+	}
+
+	// The even and the odd taps are summed apart, then added, so that the vector kernels
+	// may take 2 taps per load
+	void FilterRowRGBA8_Scalar(float* pDst, const uint8_t* pSrc, uint32_t srcX0,
+		const uint32_t* pFirst, const float* pWeights, uint32_t numTaps, uint32_t count)
+	{
+		for (auto i = 0u; i < count; ++i)
+		{
+			const auto pTexels = &pSrc[4 * (pFirst[i] - srcX0)];
+			const auto pTexelWeights = &pWeights[numTaps * i];
+			float sums[2][4] = {};
+			for (auto t = 0u; t < numTaps; ++t)
+				for (uint8_t c = 0; c < 4; ++c) sums[t & 1][c] = sums[t & 1][c] + pTexelWeights[t] * pTexels[4 * t + c];
+			for (uint8_t c = 0; c < 4; ++c) pDst[4 * i + c] = sums[0][c] + sums[1][c];
+		}
+	}
+
+	void FilterColumnsRGBA8_Scalar(uint8_t* pDst, const float* const* ppRows, const float* pWeights,
+		uint32_t numTaps, uint32_t count)
+	{
+		for (auto i = 0u; i < 4 * count; ++i)
+		{
+			auto sum = 0.0f;
+			for (auto t = 0u; t < numTaps; ++t) sum = sum + pWeights[t] * ppRows[t][i];
+			pDst[i] = static_cast<uint8_t>((std::min)((std::max)(sum, 0.0f), 255.0f) + 0.5f);
+		}
+	}
+
+	void FilterRowSRGBA8(float* pDst, const uint8_t* pSrc, uint32_t srcX0,
+		const uint32_t* pFirst, const float* pWeights, uint32_t numTaps, uint32_t count)
+	{
+		for (auto i = 0u; i < count; ++i)
+		{
+			const auto pTexels = &pSrc[4 * (pFirst[i] - srcX0)];
+			const auto pTexelWeights = &pWeights[numTaps * i];
+			float sums[2][4] = {};
+			for (auto t = 0u; t < numTaps; ++t)
+				for (uint8_t c = 0; c < 4; ++c)
+					sums[t & 1][c] = sums[t & 1][c] + pTexelWeights[t] * decodeSRGBA8(&pTexels[4 * t], c);
+			for (uint8_t c = 0; c < 4; ++c) pDst[4 * i + c] = sums[0][c] + sums[1][c];
+		}
+	}
+
+	void FilterColumnsSRGBA8(uint8_t* pDst, const float* const* ppRows, const float* pWeights,
+		uint32_t numTaps, uint32_t count)
+	{
+		for (auto i = 0u; i < count; ++i)
+		{
+			float sum[4] = {};
+			for (auto t = 0u; t < numTaps; ++t)
+				for (uint8_t c = 0; c < 4; ++c) sum[c] = sum[c] + pWeights[t] * ppRows[t][4 * i + c];
+			encodeSRGBA8(&pDst[4 * i], sum);
+		}
+	}
+
+	//--------------------------------------------------------------------------------------
+	// Alpha coverage
+	//--------------------------------------------------------------------------------------
+	void HistogramAlphaRGBA8(uint32_t* pHist, const uint8_t* pSrc, uint32_t count)
+	{
+		auto i = 0u;
+		for (; i + 4 <= count; i += 4)
+		{
+			++pHist[pSrc[4 * i + 3]];
+			++pHist[256 + pSrc[4 * i + 7]];
+			++pHist[512 + pSrc[4 * i + 11]];
+			++pHist[768 + pSrc[4 * i + 15]];
+		}
+
+		for (; i < count; ++i) ++pHist[256 * (i & 3) + pSrc[4 * i + 3]];
+	}
+
+	void ScaleAlphaRGBA8_Scalar(uint8_t* pData, uint32_t count, uint32_t scale)
+	{
+		for (auto i = 0u; i < count; ++i)
+		{
+			const auto alpha = (pData[4 * i + 3] * scale + 0x8000) >> 16;
+			pData[4 * i + 3] = static_cast<uint8_t>((std::min)(alpha, 255u));
+		}
+	}
+
+	//--------------------------------------------------------------------------------------
+	// Levels of fewer channels, and 16-bit levels
+	//--------------------------------------------------------------------------------------
+	template<typename T, uint8_t N>
+	void DownSampleUNORM_Scalar(uint8_t* pDst, const uint8_t* pRow0, const uint8_t* pRow1, uint32_t dstWidth)
+	{
+		const auto pDstVals = reinterpret_cast<T*>(pDst);
+		const auto pVals0 = reinterpret_cast<const T*>(pRow0);
+		const auto pVals1 = reinterpret_cast<const T*>(pRow1);
+		for (auto i = 0u; i < N * dstWidth; ++i)
+		{
+			const auto x = 2 * N * (i / N) + i % N;
+			pDstVals[i] = static_cast<T>((pVals0[x] + pVals0[x + N] + pVals1[x] + pVals1[x + N] + 2u) >> 2);
+		}
+	}
+
+	template<typename T, uint8_t N>
+	void DownSampleQuadsUNORM_Scalar(uint8_t* pDst, const uint8_t* pSrc, uint32_t dstCount)
+	{
+		const auto pDstVals = reinterpret_cast<T*>(pDst);
+		const auto pVals = reinterpret_cast<const T*>(pSrc);
+		for (auto i = 0u; i < N * dstCount; ++i)
+		{
+			const auto x = 4 * N * (i / N) + i % N;
+			pDstVals[i] = static_cast<T>((pVals[x] + pVals[x + N] + pVals[x + 2 * N] + pVals[x + 3 * N] + 2u) >> 2);
+		}
+	}
+
+	template void DownSampleUNORM_Scalar<uint8_t, 1>(uint8_t*, const uint8_t*, const uint8_t*, uint32_t);
+	template void DownSampleUNORM_Scalar<uint8_t, 2>(uint8_t*, const uint8_t*, const uint8_t*, uint32_t);
+	template void DownSampleUNORM_Scalar<uint8_t, 3>(uint8_t*, const uint8_t*, const uint8_t*, uint32_t);
+	template void DownSampleUNORM_Scalar<uint16_t, 1>(uint8_t*, const uint8_t*, const uint8_t*, uint32_t);
+	template void DownSampleUNORM_Scalar<uint16_t, 2>(uint8_t*, const uint8_t*, const uint8_t*, uint32_t);
+	template void DownSampleQuadsUNORM_Scalar<uint8_t, 1>(uint8_t*, const uint8_t*, uint32_t);
+	template void DownSampleQuadsUNORM_Scalar<uint8_t, 2>(uint8_t*, const uint8_t*, uint32_t);
+	template void DownSampleQuadsUNORM_Scalar<uint8_t, 3>(uint8_t*, const uint8_t*, uint32_t);
+	template void DownSampleQuadsUNORM_Scalar<uint16_t, 1>(uint8_t*, const uint8_t*, uint32_t);
+	template void DownSampleQuadsUNORM_Scalar<uint16_t, 2>(uint8_t*, const uint8_t*, uint32_t);
+
+	void DownSampleRGBA16_Scalar(uint16_t* pDst, const uint16_t* pRow0, const uint16_t* pRow1, uint32_t dstWidth)
+	{
+		for (auto i = 0u; i < 4 * dstWidth; ++i)
+		{
+			const auto x = 8 * (i / 4) + i % 4;
+			pDst[i] = static_cast<uint16_t>((pRow0[x] + pRow0[x + 4] + pRow1[x] + pRow1[x + 4] + 2u) >> 2);
+		}
+	}
+
+	void DownSampleQuadsRGBA16_Scalar(uint16_t* pDst, const uint16_t* pSrc, uint32_t dstCount)
+	{
+		for (auto i = 0u; i < 4 * dstCount; ++i)
+		{
+			const auto x = 16 * (i / 4) + i % 4;
+			pDst[i] = static_cast<uint16_t>((pSrc[x] + pSrc[x + 4] + pSrc[x + 8] + pSrc[x + 12] + 2u) >> 2);
+		}
+	}
+
+	//--------------------------------------------------------------------------------------
+	// Floating-point levels
+	//--------------------------------------------------------------------------------------
+	uint16_t FloatToHalf(float val)
+	{
+		uint32_t bits;
+		memcpy(&bits, &val, sizeof(float));
+		const auto sign = static_cast<uint16_t>((bits >> 16) & 0x8000);
+		bits &= 0x7fffffff;
+
+		// Inf and NaN, then the overflows from 65520 on
+		if (bits >= 0x7f800000) return sign | 0x7c00 | (bits > 0x7f800000 ? 0x200 | ((bits >> 13) & 0x3ff) : 0);
+		if (bits >= 0x477ff000) return sign | 0x7c00;
+
+		// Denormals below 2^-14, rounded by the float adder when aligned onto the mantissa of 0.5
+		if (bits < 0x38800000)
+		{
+			float aligned;
+			memcpy(&aligned, &bits, sizeof(float));
+			aligned += 0.5f;
+			memcpy(&bits, &aligned, sizeof(float));
+
+			return sign | static_cast<uint16_t>(bits - 0x3f000000);
+		}
+
+		// Rebias the exponent, with the carry of round half to even into it
+		bits += 0xc8000fff + ((bits >> 13) & 1);
+
+		return sign | static_cast<uint16_t>(bits >> 13);
+	}
+
+	float HalfToFloat(uint16_t val)
+	{
+		const auto exponent = (val >> 10) & 0x1f;
+		const auto mantissa = val & 0x3ffu;
+
+		uint32_t bits;
+		if (exponent == 0x1f) bits = 0x7f800000 | (mantissa << 13) | (mantissa ? 0x400000 : 0);
+		else if (exponent > 0) bits = ((exponent + 112u) << 23) | (mantissa << 13);
+		else
+		{
+			// Denormals and zeros, exact in float
+			const auto magnitude = static_cast<float>(mantissa) / 16777216;
+			memcpy(&bits, &magnitude, sizeof(float));
+		}
+		bits |= static_cast<uint32_t>(val & 0x8000) << 16;
+
+		float result;
+		memcpy(&result, &bits, sizeof(float));
+
+		return result;
+	}
+
+	void FloatToHalf_Scalar(uint16_t* pDst, const float* pSrc, uint32_t count)
+	{
+		for (auto i = 0u; i < count; ++i) pDst[i] = FloatToHalf(pSrc[i]);
+	}
+
+	void HalfToFloat_Scalar(float* pDst, const uint16_t* pSrc, uint32_t count)
+	{
+		for (auto i = 0u; i < count; ++i) pDst[i] = HalfToFloat(pSrc[i]);
+	}
+
+	void DownSampleRGBA32F_Scalar(float* pDst, const float* pRow0, const float* pRow1, uint32_t dstWidth)
+	{
+		for (auto i = 0u; i < 4 * dstWidth; ++i)
+		{
+			const auto x = 8 * (i / 4) + i % 4;
+			pDst[i] = (pRow0[x] + pRow1[x] + (pRow0[x + 4] + pRow1[x + 4])) * 0.25f;
+		}
+	}
+
+	void DownSampleQuadsRGBA32F_Scalar(float* pDst, const float* pSrc, uint32_t dstCount)
+	{
+		for (auto i = 0u; i < 4 * dstCount; ++i)
+		{
+			const auto x = 16 * (i / 4) + i % 4;
+			pDst[i] = (pSrc[x] + pSrc[x + 8] + (pSrc[x + 4] + pSrc[x + 12])) * 0.25f;
+		}
+	}
+
+	void DownSampleRGBA16F_Scalar(uint16_t* pDst, const uint16_t* pRow0, const uint16_t* pRow1, uint32_t dstWidth)
+	{
+		for (auto i = 0u; i < 4 * dstWidth; ++i)
+		{
+			const auto x = 8 * (i / 4) + i % 4;
+			const auto sum = HalfToFloat(pRow0[x]) + HalfToFloat(pRow1[x]) + (HalfToFloat(pRow0[x + 4]) + HalfToFloat(pRow1[x + 4]));
+			pDst[i] = FloatToHalf(sum * 0.25f);
+		}
+	}
+
+	void DownSampleQuadsRGBA16F_Scalar(uint16_t* pDst, const uint16_t* pSrc, uint32_t dstCount)
+	{
+		for (auto i = 0u; i < 4 * dstCount; ++i)
+		{
+			const auto x = 16 * (i / 4) + i % 4;
+			const auto sum = HalfToFloat(pSrc[x]) + HalfToFloat(pSrc[x + 8]) + (HalfToFloat(pSrc[x + 4]) + HalfToFloat(pSrc[x + 12]));
+			pDst[i] = FloatToHalf(sum * 0.25f);
+		}
+	}
+
+#ifdef MIP_KERNELS_X86
+	//--------------------------------------------------------------------------------------
+	// SSE2, 4 destination texels per iteration
+	//--------------------------------------------------------------------------------------
+	static inline __m128i DownSample4(__m128i a0, __m128i b0, __m128i a1, __m128i b1)
+	{
+		// Split even and odd texels
+		const auto e0 = _mm_castps_si128(_mm_shuffle_ps(_mm_castsi128_ps(a0), _mm_castsi128_ps(b0), _MM_SHUFFLE(2, 0, 2, 0)));
+		const auto o0 = _mm_castps_si128(_mm_shuffle_ps(_mm_castsi128_ps(a0), _mm_castsi128_ps(b0), _MM_SHUFFLE(3, 1, 3, 1)));
+		const auto e1 = _mm_castps_si128(_mm_shuffle_ps(_mm_castsi128_ps(a1), _mm_castsi128_ps(b1), _MM_SHUFFLE(2, 0, 2, 0)));
+		const auto o1 = _mm_castps_si128(_mm_shuffle_ps(_mm_castsi128_ps(a1), _mm_castsi128_ps(b1), _MM_SHUFFLE(3, 1, 3, 1)));
+
+		// Sum the 2x2 footprints in 16-bit lanes
+		const auto zero = _mm_setzero_si128();
+		const auto bias = _mm_set1_epi16(2);
+		auto lo = _mm_add_epi16(_mm_unpacklo_epi8(e0, zero), _mm_unpacklo_epi8(o0, zero));
+		auto hi = _mm_add_epi16(_mm_unpackhi_epi8(e0, zero), _mm_unpackhi_epi8(o0, zero));
+		lo = _mm_add_epi16(lo, _mm_add_epi16(_mm_unpacklo_epi8(e1, zero), _mm_unpacklo_epi8(o1, zero)));
+		hi = _mm_add_epi16(hi, _mm_add_epi16(_mm_unpackhi_epi8(e1, zero), _mm_unpackhi_epi8(o1, zero)));
+		lo = _mm_srli_epi16(_mm_add_epi16(lo, bias), 2);
+		hi = _mm_srli_epi16(_mm_add_epi16(hi, bias), 2);
+
+		return _mm_packus_epi16(lo, hi);
+	}
+
+	void DownSampleRGBA8_SSE2(uint8_t* pDst, const uint8_t* pRow0, const uint8_t* pRow1, uint32_t dstWidth)
+	{
+		auto i = 0u;
+		for (; i + 4 <= dstWidth; i += 4)
+		{
+			const auto pSrc0 = reinterpret_cast<const __m128i*>(&pRow0[8 * i]);
+			const auto pSrc1 = reinterpret_cast<const __m128i*>(&pRow1[8 * i]);
+			const auto result = DownSample4(_mm_loadu_si128(pSrc0), _mm_loadu_si128(pSrc0 + 1),
+				_mm_loadu_si128(pSrc1), _mm_loadu_si128(pSrc1 + 1));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(&pDst[4 * i]), result);
+		}
+
+		DownSampleRGBA8_Scalar(&pDst[4 * i], &pRow0[8 * i], &pRow1[8 * i], dstWidth - i);
+	}
+
+	void DownSampleQuadsRGBA8_SSE2(uint8_t* pDst, const uint8_t* pSrc, uint32_t dstCount)
+	{
+		auto i = 0u;
+		for (; i + 4 <= dstCount; i += 4)
+		{
+			// Rearrange 4 quads as 2 rows of texel pairs
+			const auto pQuads = reinterpret_cast<const __m128i*>(&pSrc[16 * i]);
+			const auto q0 = _mm_loadu_si128(pQuads);
+			const auto q1 = _mm_loadu_si128(pQuads + 1);
+			const auto q2 = _mm_loadu_si128(pQuads + 2);
+			const auto q3 = _mm_loadu_si128(pQuads + 3);
+			const auto result = DownSample4(_mm_unpacklo_epi64(q0, q1), _mm_unpacklo_epi64(q2, q3),
+				_mm_unpackhi_epi64(q0, q1), _mm_unpackhi_epi64(q2, q3));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(&pDst[4 * i]), result);
+		}
+
+		DownSampleQuadsRGBA8_Scalar(&pDst[4 * i], &pSrc[16 * i], dstCount - i);
+	}
+
+	// Premultiplied 2x2 reduction of the same texel pairs as DownSample4(), in 32-bit lanes
+	// per channel: c * a is the madd of 16-bit lanes whose upper halves are 0.
+	static inline __m128i DownSamplePremul4(__m128i a0, __m128i b0, __m128i a1, __m128i b1)
+	{
+		__m128i texels[4];
+		texels[0] = _mm_castps_si128(_mm_shuffle_ps(_mm_castsi128_ps(a0), _mm_castsi128_ps(b0), _MM_SHUFFLE(2, 0, 2, 0)));
+		texels[1] = _mm_castps_si128(_mm_shuffle_ps(_mm_castsi128_ps(a0), _mm_castsi128_ps(b0), _MM_SHUFFLE(3, 1, 3, 1)));
+		texels[2] = _mm_castps_si128(_mm_shuffle_ps(_mm_castsi128_ps(a1), _mm_castsi128_ps(b1), _MM_SHUFFLE(2, 0, 2, 0)));
+		texels[3] = _mm_castps_si128(_mm_shuffle_ps(_mm_castsi128_ps(a1), _mm_castsi128_ps(b1), _MM_SHUFFLE(3, 1, 3, 1)));
+
+		const auto byteMask = _mm_set1_epi32(0xff);
+		const auto bias = _mm_set1_epi32(2);
+		__m128i alphas[4];
+		auto sumAlpha = _mm_setzero_si128();
+		for (auto i = 0u; i < 4; ++i)
+		{
+			alphas[i] = _mm_srli_epi32(texels[i], 24);
+			sumAlpha = _mm_add_epi32(sumAlpha, alphas[i]);
+		}
+
+		// The quotient where some alpha is, the straight average elsewhere
+		const auto isTransparent = _mm_cmpeq_epi32(sumAlpha, _mm_setzero_si128());
+		const auto divisor = _mm_max_ps(_mm_cvtepi32_ps(sumAlpha), _mm_set1_ps(1.0f));
+		auto result = _mm_slli_epi32(_mm_srli_epi32(_mm_add_epi32(sumAlpha, bias), 2), 24);
+		for (auto c = 0u; c < 3; ++c)
+		{
+			auto weighted = _mm_setzero_si128();
+			auto straight = bias;
+			for (auto i = 0u; i < 4; ++i)
+			{
+				const auto val = _mm_and_si128(_mm_srli_epi32(texels[i], 8 * c), byteMask);
+				weighted = _mm_add_epi32(weighted, _mm_madd_epi16(val, alphas[i]));
+				straight = _mm_add_epi32(straight, val);
+			}
+
+			const auto quotient = _mm_add_ps(_mm_div_ps(_mm_cvtepi32_ps(weighted), divisor), _mm_set1_ps(0.5f));
+			const auto val = _mm_or_si128(_mm_and_si128(isTransparent, _mm_srli_epi32(straight, 2)),
+				_mm_andnot_si128(isTransparent, _mm_cvttps_epi32(quotient)));
+			result = _mm_or_si128(result, _mm_slli_epi32(val, 8 * c));
+		}
+
+		return result;
+	}
+
+	void DownSamplePremulRGBA8_SSE2(uint8_t* pDst, const uint8_t* pRow0, const uint8_t* pRow1, uint32_t dstWidth)
+	{
+		auto i = 0u;
+		for (; i + 4 <= dstWidth; i += 4)
+		{
+			const auto pSrc0 = reinterpret_cast<const __m128i*>(&pRow0[8 * i]);
+			const auto pSrc1 = reinterpret_cast<const __m128i*>(&pRow1[8 * i]);
+			const auto result = DownSamplePremul4(_mm_loadu_si128(pSrc0), _mm_loadu_si128(pSrc0 + 1),
+				_mm_loadu_si128(pSrc1), _mm_loadu_si128(pSrc1 + 1));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(&pDst[4 * i]), result);
+		}
+
+		DownSamplePremulRGBA8_Scalar(&pDst[4 * i], &pRow0[8 * i], &pRow1[8 * i], dstWidth - i);
+	}
+
+	void DownSampleQuadsPremulRGBA8_SSE2(uint8_t* pDst, const uint8_t* pSrc, uint32_t dstCount)
+	{
+		auto i = 0u;
+		for (; i + 4 <= dstCount; i += 4)
+		{
+			const auto pQuads = reinterpret_cast<const __m128i*>(&pSrc[16 * i]);
+			const auto q0 = _mm_loadu_si128(pQuads);
+			const auto q1 = _mm_loadu_si128(pQuads + 1);
+			const auto q2 = _mm_loadu_si128(pQuads + 2);
+			const auto q3 = _mm_loadu_si128(pQuads + 3);
+			const auto result = DownSamplePremul4(_mm_unpacklo_epi64(q0, q1), _mm_unpacklo_epi64(q2, q3),
+				_mm_unpackhi_epi64(q0, q1), _mm_unpackhi_epi64(q2, q3));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(&pDst[4 * i]), result);
+		}
+
+		DownSampleQuadsPremulRGBA8_Scalar(&pDst[4 * i], &pSrc[16 * i], dstCount - i);
+	}
+
+	// Sums of 16-bit lanes: { a.lo + a.hi, b.lo + b.hi }
+	static inline __m128i AddHalves(__m128i a, __m128i b)
+	{
+		return _mm_add_epi16(_mm_unpacklo_epi64(a, b), _mm_unpackhi_epi64(a, b));
+	}
+
+	void SumRowRGBA8_SSE2(uint16_t* pDst, const uint8_t* pRow0, const uint8_t* pRow1, uint32_t dstWidth)
+	{
+		const auto zero = _mm_setzero_si128();
+
+		auto i = 0u;
+		for (; i + 2 <= dstWidth; i += 2)
+		{
+			// Vertical sums of 4 texels, then of the horizontal pairs
+			const auto r0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&pRow0[8 * i]));
+			const auto r1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&pRow1[8 * i]));
+			const auto lo = _mm_add_epi16(_mm_unpacklo_epi8(r0, zero), _mm_unpacklo_epi8(r1, zero));
+			const auto hi = _mm_add_epi16(_mm_unpackhi_epi8(r0, zero), _mm_unpackhi_epi8(r1, zero));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(&pDst[4 * i]), AddHalves(lo, hi));
+		}
+
+		SumRowRGBA8_Scalar(&pDst[4 * i], &pRow0[8 * i], &pRow1[8 * i], dstWidth - i);
+	}
+
+	void SumQuadsRGBA8_SSE2(uint16_t* pDst, const uint8_t* pSrc, uint32_t dstCount)
+	{
+		const auto zero = _mm_setzero_si128();
+
+		auto i = 0u;
+		for (; i + 2 <= dstCount; i += 2)
+		{
+			const auto q0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&pSrc[16 * i]));
+			const auto q1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&pSrc[16 * i + 16]));
+			const auto s0 = _mm_add_epi16(_mm_unpacklo_epi8(q0, zero), _mm_unpackhi_epi8(q0, zero));
+			const auto s1 = _mm_add_epi16(_mm_unpacklo_epi8(q1, zero), _mm_unpackhi_epi8(q1, zero));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(&pDst[4 * i]), AddHalves(s0, s1));
+		}
+
+		SumQuadsRGBA8_Scalar(&pDst[4 * i], &pSrc[16 * i], dstCount - i);
+	}
+
+	void SumQuads16_SSE2(uint16_t* pDst, const uint16_t* pSrc, uint32_t dstCount)
+	{
+		auto i = 0u;
+		for (; i + 2 <= dstCount; i += 2)
+		{
+			const auto pQuads = reinterpret_cast<const __m128i*>(&pSrc[16 * i]);
+			const auto s0 = _mm_add_epi16(_mm_loadu_si128(pQuads), _mm_loadu_si128(pQuads + 1));
+			const auto s1 = _mm_add_epi16(_mm_loadu_si128(pQuads + 2), _mm_loadu_si128(pQuads + 3));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(&pDst[4 * i]), AddHalves(s0, s1));
+		}
+
+		SumQuads16_Scalar(&pDst[4 * i], &pSrc[16 * i], dstCount - i);
+	}
+
+	void RoundSums16_SSE2(uint8_t* pDst, const uint16_t* pSrc, uint32_t count, uint32_t shift)
+	{
+		// No overflow, since a 16x16 sum plus the bias is at most 65408
+		const auto bias = _mm_set1_epi16(static_cast<short>(1 << (shift - 1)));
+		const auto count128 = _mm_cvtsi32_si128(static_cast<int>(shift));
+
+		auto i = 0u;
+		for (; i + 4 <= count; i += 4)
+		{
+			const auto pSums = reinterpret_cast<const __m128i*>(&pSrc[4 * i]);
+			const auto lo = _mm_srl_epi16(_mm_add_epi16(_mm_loadu_si128(pSums), bias), count128);
+			const auto hi = _mm_srl_epi16(_mm_add_epi16(_mm_loadu_si128(pSums + 1), bias), count128);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(&pDst[4 * i]), _mm_packus_epi16(lo, hi));
+		}
+
+		RoundSums16_Scalar(&pDst[4 * i], &pSrc[4 * i], count - i, shift);
+	}
+
+	// 4 destination texels per iteration, saturated as the scalar kernel
+	void FilterColumnsRGBA8_SSE2(uint8_t* pDst, const float* const* ppRows, const float* pWeights,
+		uint32_t numTaps, uint32_t count)
+	{
+		const auto zero = _mm_setzero_ps();
+		const auto maxVal = _mm_set1_ps(255.0f);
+		const auto half = _mm_set1_ps(0.5f);
+
+		auto i = 0u;
+		for (; i + 4 <= count; i += 4)
+		{
+			__m128i results[4];
+			for (auto j = 0u; j < 4; ++j)
+			{
+				auto sum = _mm_setzero_ps();
+				for (auto t = 0u; t < numTaps; ++t)
+					sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(pWeights[t]), _mm_loadu_ps(&ppRows[t][4 * (i + j)])));
+				results[j] = _mm_cvttps_epi32(_mm_add_ps(_mm_min_ps(_mm_max_ps(sum, zero), maxVal), half));
+			}
+
+			const auto packed = _mm_packus_epi16(_mm_packs_epi32(results[0], results[1]), _mm_packs_epi32(results[2], results[3]));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(&pDst[4 * i]), packed);
+		}
+
+		const float* ppTailRows[MaxFilterTaps];
+		for (auto t = 0u; t < numTaps; ++t) ppTailRows[t] = &ppRows[t][4 * i];
+		FilterColumnsRGBA8_Scalar(&pDst[4 * i], ppTailRows, pWeights, numTaps, count - i);
+	}
+
+	//--------------------------------------------------------------------------------------
+	// SSE4.1, the 4 channels of a texel per vector
+	//--------------------------------------------------------------------------------------
+	MIP_TARGET("sse4.1")
+	void BoxRowRGBA8_SSE41(uint8_t* pDst, const uint8_t* const* ppRows, const float* pRowWeights,
+		uint32_t numRows, uint32_t x0, uint32_t x1, uint32_t srcWidth)
+	{
+		const auto half = _mm_set1_ps(0.5f);
+		const auto maxVal = _mm_set1_ps(255.0f);
+
+		for (auto x = x0; x < x1; ++x)
+		{
+			float weights[3];
+			const auto numTaps = GetBoxTaps(x, srcWidth, weights);
+			const auto offset = 8 * (x - x0);
+
+			auto sum = _mm_setzero_ps();
+			for (auto r = 0u; r < numRows; ++r)
+				for (auto t = 0u; t < numTaps; ++t)
+				{
+					int texel;
+					memcpy(&texel, &ppRows[r][offset + 4 * t], sizeof(int));
+					const auto value = _mm_cvtepi32_ps(_mm_cvtepu8_epi32(_mm_cvtsi32_si128(texel)));
+					sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(pRowWeights[r] * weights[t]), value));
+				}
+
+			// Truncation of the non-negative sums plus 1/2
+			const auto result = _mm_cvttps_epi32(_mm_min_ps(_mm_add_ps(sum, half), maxVal));
+			const auto packed = _mm_packus_epi16(_mm_packus_epi32(result, result), _mm_setzero_si128());
+			const auto texel = _mm_cvtsi128_si32(packed);
+			memcpy(&pDst[4 * (x - x0)], &texel, sizeof(int));
+		}
+	}
+
+	MIP_TARGET("sse4.1")
+	void FilterRowRGBA8_SSE41(float* pDst, const uint8_t* pSrc, uint32_t srcX0,
+		const uint32_t* pFirst, const float* pWeights, uint32_t numTaps, uint32_t count)
+	{
+		for (auto i = 0u; i < count; ++i)
+		{
+			const auto pTexels = &pSrc[4 * (pFirst[i] - srcX0)];
+			const auto pTexelWeights = &pWeights[numTaps * i];
+			__m128 sums[2] = { _mm_setzero_ps(), _mm_setzero_ps() };
+			for (auto t = 0u; t < numTaps; ++t)
+			{
+				int texel;
+				memcpy(&texel, &pTexels[4 * t], sizeof(int));
+				const auto value = _mm_cvtepi32_ps(_mm_cvtepu8_epi32(_mm_cvtsi32_si128(texel)));
+				sums[t & 1] = _mm_add_ps(sums[t & 1], _mm_mul_ps(_mm_set1_ps(pTexelWeights[t]), value));
+			}
+			_mm_storeu_ps(&pDst[4 * i], _mm_add_ps(sums[0], sums[1]));
+		}
+	}
+
+	MIP_TARGET("sse4.1")
+	void ScaleAlphaRGBA8_SSE41(uint8_t* pData, uint32_t count, uint32_t scale)
+	{
+		const auto colorMask = _mm_set1_epi32(0x00ffffff);
+		const auto scaleVec = _mm_set1_epi32(scale);
+		const auto bias = _mm_set1_epi32(0x8000);
+		const auto maxVal = _mm_set1_epi32(255);
+
+		auto i = 0u;
+		for (; i + 4 <= count; i += 4)
+		{
+			const auto texels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&pData[4 * i]));
+			auto alpha = _mm_mullo_epi32(_mm_srli_epi32(texels, 24), scaleVec);
+			alpha = _mm_min_epu32(_mm_srli_epi32(_mm_add_epi32(alpha, bias), 16), maxVal);
+			const auto result = _mm_or_si128(_mm_and_si128(texels, colorMask), _mm_slli_epi32(alpha, 24));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(&pData[4 * i]), result);
+		}
+
+		ScaleAlphaRGBA8_Scalar(&pData[4 * i], count - i, scale);
+	}
+
+	//--------------------------------------------------------------------------------------
+	// BMI2 Morton codes
+	//--------------------------------------------------------------------------------------
+	MIP_TARGET("bmi2")
+	uint32_t MortonEncode_BMI2(uint32_t x, uint32_t y)
+	{
+		return _pdep_u32(x, 0x55555555) | _pdep_u32(y, 0xaaaaaaaa);
+	}
+
+	MIP_TARGET("bmi2")
+	void MortonDecode_BMI2(uint32_t code, uint32_t& x, uint32_t& y)
+	{
+		x = _pext_u32(code, 0x55555555);
+		y = _pext_u32(code, 0xaaaaaaaa);
+	}
+
+	//--------------------------------------------------------------------------------------
+	// SSE2 and AVX2 match lengths, 16 and 32 bytes per iteration
+	//--------------------------------------------------------------------------------------
+	MIP_TARGET("sse2")
+	uint32_t MatchLength_SSE2(const uint8_t* pA, const uint8_t* pB, uint32_t maxLength)
+	{
+		auto length = 0u;
+		for (; length + 16 <= maxLength; length += 16)
+		{
+			const auto a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&pA[length]));
+			const auto b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&pB[length]));
+			const auto mismatches = ~_mm_movemask_epi8(_mm_cmpeq_epi8(a, b)) & 0xffff;
+			if (mismatches) return length + LowestBit(mismatches);
+		}
+
+		return length + MatchLength_Scalar(&pA[length], &pB[length], maxLength - length);
+	}
+
+	MIP_TARGET("avx2")
+	uint32_t MatchLength_AVX2(const uint8_t* pA, const uint8_t* pB, uint32_t maxLength)
+	{
+		auto length = 0u;
+		for (; length + 32 <= maxLength; length += 32)
+		{
+			const auto a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&pA[length]));
+			const auto b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&pB[length]));
+			const auto mismatches = ~static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(a, b)));
+			if (mismatches) return length + LowestBit(mismatches);
+		}
+
+		return length + MatchLength_SSE2(&pA[length], &pB[length], maxLength - length);
+	}
+
+	//--------------------------------------------------------------------------------------
+	// SSE2 PNG unfiltering, a pixel per iteration in the low bytes of a vector (16 bytes for
+	// Up); the rows of 1 and 2 bytes per pixel are left to the scalar kernels
+	//--------------------------------------------------------------------------------------
+	// Pixels of 3, 4, 6 or 8 bytes through general-purpose registers, as a narrower store read
+	// back by a wider load would stall
+	template<uint32_t Bpp>
+	MIP_TARGET("sse2")
+	static inline __m128i LoadPixel(const uint8_t* pSrc)
+	{
+		if (Bpp == 8) return _mm_loadl_epi64(reinterpret_cast<const __m128i*>(pSrc));
+
+		uint32_t lo;
+		if (Bpp == 3) lo = pSrc[0] | (pSrc[1] << 8) | (pSrc[2] << 16);
+		else memcpy(&lo, pSrc, sizeof(uint32_t));
+		const auto pixel = _mm_cvtsi32_si128(static_cast<int>(lo));
+
+		return Bpp == 6 ? _mm_insert_epi16(pixel, pSrc[4] | (pSrc[5] << 8), 2) : pixel;
+	}
+
+	template<uint32_t Bpp>
+	MIP_TARGET("sse2")
+	static inline void StorePixel(uint8_t* pDst, __m128i pixel)
+	{
+		if (Bpp == 8)
+		{
+			_mm_storel_epi64(reinterpret_cast<__m128i*>(pDst), pixel);
+
+			return;
+		}
+
+		const auto lo = static_cast<uint32_t>(_mm_cvtsi128_si32(pixel));
+		if (Bpp == 3)
+		{
+			const auto bytes = static_cast<uint16_t>(lo);
+			memcpy(pDst, &bytes, sizeof(uint16_t));
+			pDst[2] = static_cast<uint8_t>(lo >> 16);
+		}
+		else memcpy(pDst, &lo, sizeof(uint32_t));
+
+		if (Bpp == 6)
+		{
+			const auto hi = static_cast<uint16_t>(_mm_extract_epi16(pixel, 2));
+			memcpy(&pDst[4], &hi, sizeof(uint16_t));
+		}
+	}
+
+	template<uint32_t Bpp>
+	MIP_TARGET("sse2")
+	static void UnfilterSubPixels_SSE2(uint8_t* pDst, const uint8_t* pSrc, uint32_t rowBytes)
+	{
+		auto a = _mm_setzero_si128();
+		for (auto i = 0u; i < rowBytes; i += Bpp)
+		{
+			a = _mm_add_epi8(LoadPixel<Bpp>(&pSrc[i]), a);
+			StorePixel<Bpp>(&pDst[i], a);
+		}
+	}
+
+	template<uint32_t Bpp>
+	MIP_TARGET("sse2")
+	static void UnfilterAveragePixels_SSE2(uint8_t* pDst, const uint8_t* pSrc, const uint8_t* pPrior, uint32_t rowBytes)
+	{
+		// (a + b) >> 1 is the rounded average, less the lost low bit
+		const auto one = _mm_set1_epi8(1);
+		auto a = _mm_setzero_si128();
+		for (auto i = 0u; i < rowBytes; i += Bpp)
+		{
+			const auto b = LoadPixel<Bpp>(&pPrior[i]);
+			const auto average = _mm_sub_epi8(_mm_avg_epu8(a, b), _mm_and_si128(_mm_xor_si128(a, b), one));
+			a = _mm_add_epi8(LoadPixel<Bpp>(&pSrc[i]), average);
+			StorePixel<Bpp>(&pDst[i], a);
+		}
+	}
+
+	template<uint32_t Bpp>
+	MIP_TARGET("sse2")
+	static void UnfilterPaethPixels_SSE2(uint8_t* pDst, const uint8_t* pSrc, const uint8_t* pPrior, uint32_t rowBytes)
+	{
+		// In 16-bit lanes: pa = |b - c|, pb = |a - c| and pc = |(b - c) + (a - c)|
+		const auto zero = _mm_setzero_si128();
+		const auto abs16 = [zero](__m128i x) { return _mm_max_epi16(x, _mm_sub_epi16(zero, x)); };
+		const auto select = [](__m128i mask, __m128i x, __m128i y)
+		{
+			return _mm_or_si128(_mm_and_si128(mask, x), _mm_andnot_si128(mask, y));
+		};
+
+		auto a = zero, c = zero;
+		for (auto i = 0u; i < rowBytes; i += Bpp)
+		{
+			const auto b = _mm_unpacklo_epi8(LoadPixel<Bpp>(&pPrior[i]), zero);
+			const auto bc = _mm_sub_epi16(b, c);
+			const auto ac = _mm_sub_epi16(a, c);
+			const auto pa = abs16(bc);
+			const auto pb = abs16(ac);
+			const auto pc = abs16(_mm_add_epi16(bc, ac));
+			const auto smallest = _mm_min_epi16(_mm_min_epi16(pa, pb), pc);
+			const auto predictor = select(_mm_cmpeq_epi16(pa, smallest), a, select(_mm_cmpeq_epi16(pb, smallest), b, c));
+
+			const auto x = _mm_add_epi8(LoadPixel<Bpp>(&pSrc[i]), _mm_packus_epi16(predictor, predictor));
+			StorePixel<Bpp>(&pDst[i], x);
+			a = _mm_unpacklo_epi8(x, zero);
+			c = b;
+		}
+	}
+
+	MIP_TARGET("sse2")
+	void UnfilterSub_SSE2(uint8_t* pDst, const uint8_t* pSrc, const uint8_t* pPrior, uint32_t rowBytes, uint32_t bpp)
+	{
+		switch (bpp)
+		{
+		case 3: UnfilterSubPixels_SSE2<3>(pDst, pSrc, rowBytes); break;
+		case 4: UnfilterSubPixels_SSE2<4>(pDst, pSrc, rowBytes); break;
+		case 6: UnfilterSubPixels_SSE2<6>(pDst, pSrc, rowBytes); break;
+		case 8: UnfilterSubPixels_SSE2<8>(pDst, pSrc, rowBytes); break;
+		default: UnfilterSub_Scalar(pDst, pSrc, pPrior, rowBytes, bpp);
+		}
+	}
+
+	MIP_TARGET("sse2")
+	void UnfilterUp_SSE2(uint8_t* pDst, const uint8_t* pSrc, const uint8_t* pPrior, uint32_t rowBytes, uint32_t bpp)
+	{
+		auto i = 0u;
+		for (; i + 16 <= rowBytes; i += 16)
+		{
+			const auto x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&pSrc[i]));
+			const auto b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&pPrior[i]));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(&pDst[i]), _mm_add_epi8(x, b));
+		}
+
+		UnfilterUp_Scalar(&pDst[i], &pSrc[i], &pPrior[i], rowBytes - i, bpp);
+	}
+
+	MIP_TARGET("sse2")
+	void UnfilterAverage_SSE2(uint8_t* pDst, const uint8_t* pSrc, const uint8_t* pPrior, uint32_t rowBytes, uint32_t bpp)
+	{
+		switch (bpp)
+		{
+		case 3: UnfilterAveragePixels_SSE2<3>(pDst, pSrc, pPrior, rowBytes); break;
+		case 4: UnfilterAveragePixels_SSE2<4>(pDst, pSrc, pPrior, rowBytes); break;
+		case 6: UnfilterAveragePixels_SSE2<6>(pDst, pSrc, pPrior, rowBytes); break;
+		case 8: UnfilterAveragePixels_SSE2<8>(pDst, pSrc, pPrior, rowBytes); break;
+		default: UnfilterAverage_Scalar(pDst, pSrc, pPrior, rowBytes, bpp);
+		}
+	}
+
+	MIP_TARGET("sse2")
+	void UnfilterPaeth_SSE2(uint8_t* pDst, const uint8_t* pSrc, const uint8_t* pPrior, uint32_t rowBytes, uint32_t bpp)
+	{
+		switch (bpp)
+		{
+		case 3: UnfilterPaethPixels_SSE2<3>(pDst, pSrc, pPrior, rowBytes); break;
+		case 4: UnfilterPaethPixels_SSE2<4>(pDst, pSrc, pPrior, rowBytes); break;
+		case 6: UnfilterPaethPixels_SSE2<6>(pDst, pSrc, pPrior, rowBytes); break;
+		case 8: UnfilterPaethPixels_SSE2<8>(pDst, pSrc, pPrior, rowBytes); break;
+		default: UnfilterPaeth_Scalar(pDst, pSrc, pPrior, rowBytes, bpp);
+		}
+	}
+
+	//--------------------------------------------------------------------------------------
+	// AVX2, 8 destination texels per iteration
+	//--------------------------------------------------------------------------------------
+	// Within each 128-bit lane, returns the averages of the 2 texel pairs of a0/a1,
+	// followed by the 2 pairs of b0/b1.
+	MIP_TARGET("avx2")
+	static inline __m256i DownSample8(__m256i a0, __m256i b0, __m256i a1, __m256i b1)
+	{
+		// Split even and odd texels within 128-bit lanes
+		const auto e0 = _mm256_castps_si256(_mm256_shuffle_ps(_mm256_castsi256_ps(a0), _mm256_castsi256_ps(b0), _MM_SHUFFLE(2, 0, 2, 0)));
+		const auto o0 = _mm256_castps_si256(_mm256_shuffle_ps(_mm256_castsi256_ps(a0), _mm256_castsi256_ps(b0), _MM_SHUFFLE(3, 1, 3, 1)));
+		const auto e1 = _mm256_castps_si256(_mm256_shuffle_ps(_mm256_castsi256_ps(a1), _mm256_castsi256_ps(b1), _MM_SHUFFLE(2, 0, 2, 0)));
+		const auto o1 = _mm256_castps_si256(_mm256_shuffle_ps(_mm256_castsi256_ps(a1), _mm256_castsi256_ps(b1), _MM_SHUFFLE(3, 1, 3, 1)));
+
+		const auto zero = _mm256_setzero_si256();
+		const auto bias = _mm256_set1_epi16(2);
+		auto lo = _mm256_add_epi16(_mm256_unpacklo_epi8(e0, zero), _mm256_unpacklo_epi8(o0, zero));
+		auto hi = _mm256_add_epi16(_mm256_unpackhi_epi8(e0, zero), _mm256_unpackhi_epi8(o0, zero));
+		lo = _mm256_add_epi16(lo, _mm256_add_epi16(_mm256_unpacklo_epi8(e1, zero), _mm256_unpacklo_epi8(o1, zero)));
+		hi = _mm256_add_epi16(hi, _mm256_add_epi16(_mm256_unpackhi_epi8(e1, zero), _mm256_unpackhi_epi8(o1, zero)));
+		lo = _mm256_srli_epi16(_mm256_add_epi16(lo, bias), 2);
+		hi = _mm256_srli_epi16(_mm256_add_epi16(hi, bias), 2);
+
+		return _mm256_packus_epi16(lo, hi);
+	}
+
+	MIP_TARGET("avx2")
+	void DownSampleRGBA8_AVX2(uint8_t* pDst, const uint8_t* pRow0, const uint8_t* pRow1, uint32_t dstWidth)
+	{
+		auto i = 0u;
+		for (; i + 8 <= dstWidth; i += 8)
+		{
+			const auto pSrc0 = reinterpret_cast<const __m256i*>(&pRow0[8 * i]);
+			const auto pSrc1 = reinterpret_cast<const __m256i*>(&pRow1[8 * i]);
+			const auto result = DownSample8(_mm256_loadu_si256(pSrc0), _mm256_loadu_si256(pSrc0 + 1),
+				_mm256_loadu_si256(pSrc1), _mm256_loadu_si256(pSrc1 + 1));
+
+			// Lanes hold texel pairs { 0, 2, 1, 3 }
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(&pDst[4 * i]),
+				_mm256_permute4x64_epi64(result, _MM_SHUFFLE(3, 1, 2, 0)));
+		}
+
+		DownSampleRGBA8_SSE2(&pDst[4 * i], &pRow0[8 * i], &pRow1[8 * i], dstWidth - i);
+	}
+
+	MIP_TARGET("avx2")
+	void DownSampleQuadsRGBA8_AVX2(uint8_t* pDst, const uint8_t* pSrc, uint32_t dstCount)
+	{
+		auto i = 0u;
+		for (; i + 8 <= dstCount; i += 8)
+		{
+			// Rearrange 8 quads as 2 rows of texel pairs, quads { 0, 2, 4, 6 } in the low lanes
+			const auto pQuads = reinterpret_cast<const __m256i*>(&pSrc[16 * i]);
+			const auto q0 = _mm256_loadu_si256(pQuads);
+			const auto q1 = _mm256_loadu_si256(pQuads + 1);
+			const auto q2 = _mm256_loadu_si256(pQuads + 2);
+			const auto q3 = _mm256_loadu_si256(pQuads + 3);
+			const auto result = DownSample8(_mm256_unpacklo_epi64(q0, q1), _mm256_unpacklo_epi64(q2, q3),
+				_mm256_unpackhi_epi64(q0, q1), _mm256_unpackhi_epi64(q2, q3));
+
+			// Lanes hold texels { 0, 2, 4, 6 } and { 1, 3, 5, 7 }
+			const auto order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(&pDst[4 * i]), _mm256_permutevar8x32_epi32(result, order));
+		}
+
+		DownSampleQuadsRGBA8_SSE2(&pDst[4 * i], &pSrc[16 * i], dstCount - i);
+	}
+
+	MIP_TARGET("avx2")
+	static inline __m256i DownSamplePremul8(__m256i a0, __m256i b0, __m256i a1, __m256i b1)
+	{
+		__m256i texels[4];
+		texels[0] = _mm256_castps_si256(_mm256_shuffle_ps(_mm256_castsi256_ps(a0), _mm256_castsi256_ps(b0), _MM_SHUFFLE(2, 0, 2, 0)));
+		texels[1] = _mm256_castps_si256(_mm256_shuffle_ps(_mm256_castsi256_ps(a0), _mm256_castsi256_ps(b0), _MM_SHUFFLE(3, 1, 3, 1)));
+		texels[2] = _mm256_castps_si256(_mm256_shuffle_ps(_mm256_castsi256_ps(a1), _mm256_castsi256_ps(b1), _MM_SHUFFLE(2, 0, 2, 0)));
+		texels[3] = _mm256_castps_si256(_mm256_shuffle_ps(_mm256_castsi256_ps(a1), _mm256_castsi256_ps(b1), _MM_SHUFFLE(3, 1, 3, 1)));
+
+		const auto byteMask = _mm256_set1_epi32(0xff);
+		const auto bias = _mm256_set1_epi32(2);
+		__m256i alphas[4];
+		auto sumAlpha = _mm256_setzero_si256();
+		for (auto i = 0u; i < 4; ++i)
+		{
+			alphas[i] = _mm256_srli_epi32(texels[i], 24);
+			sumAlpha = _mm256_add_epi32(sumAlpha, alphas[i]);
+		}
+
+		const auto isTransparent = _mm256_cmpeq_epi32(sumAlpha, _mm256_setzero_si256());
+		const auto divisor = _mm256_max_ps(_mm256_cvtepi32_ps(sumAlpha), _mm256_set1_ps(1.0f));
+		auto result = _mm256_slli_epi32(_mm256_srli_epi32(_mm256_add_epi32(sumAlpha, bias), 2), 24);
+		for (auto c = 0u; c < 3; ++c)
+		{
+			auto weighted = _mm256_setzero_si256();
+			auto straight = bias;
+			for (auto i = 0u; i < 4; ++i)
+			{
+				const auto val = _mm256_and_si256(_mm256_srli_epi32(texels[i], 8 * c), byteMask);
+				weighted = _mm256_add_epi32(weighted, _mm256_madd_epi16(val, alphas[i]));
+				straight = _mm256_add_epi32(straight, val);
+			}
+
+			const auto quotient = _mm256_add_ps(_mm256_div_ps(_mm256_cvtepi32_ps(weighted), divisor), _mm256_set1_ps(0.5f));
+			const auto val = _mm256_blendv_epi8(_mm256_cvttps_epi32(quotient), _mm256_srli_epi32(straight, 2), isTransparent);
+			result = _mm256_or_si256(result, _mm256_slli_epi32(val, 8 * c));
+		}
+
+		return result;
+	}
+
+	MIP_TARGET("avx2")
+	void DownSamplePremulRGBA8_AVX2(uint8_t* pDst, const uint8_t* pRow0, const uint8_t* pRow1, uint32_t dstWidth)
+	{
+		auto i = 0u;
+		for (; i + 8 <= dstWidth; i += 8)
+		{
+			const auto pSrc0 = reinterpret_cast<const __m256i*>(&pRow0[8 * i]);
+			const auto pSrc1 = reinterpret_cast<const __m256i*>(&pRow1[8 * i]);
+			const auto result = DownSamplePremul8(_mm256_loadu_si256(pSrc0), _mm256_loadu_si256(pSrc0 + 1),
+				_mm256_loadu_si256(pSrc1), _mm256_loadu_si256(pSrc1 + 1));
+
+			// Lanes hold texel pairs { 0, 2, 1, 3 }
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(&pDst[4 * i]),
+				_mm256_permute4x64_epi64(result, _MM_SHUFFLE(3, 1, 2, 0)));
+		}
+
+		DownSamplePremulRGBA8_SSE2(&pDst[4 * i], &pRow0[8 * i], &pRow1[8 * i], dstWidth - i);
+	}
+
+	MIP_TARGET("avx2")
+	void DownSampleQuadsPremulRGBA8_AVX2(uint8_t* pDst, const uint8_t* pSrc, uint32_t dstCount)
+	{
+		auto i = 0u;
+		for (; i + 8 <= dstCount; i += 8)
+		{
+			const auto pQuads = reinterpret_cast<const __m256i*>(&pSrc[16 * i]);
+			const auto q0 = _mm256_loadu_si256(pQuads);
+			const auto q1 = _mm256_loadu_si256(pQuads + 1);
+			const auto q2 = _mm256_loadu_si256(pQuads + 2);
+			const auto q3 = _mm256_loadu_si256(pQuads + 3);
+			const auto result = DownSamplePremul8(_mm256_unpacklo_epi64(q0, q1), _mm256_unpacklo_epi64(q2, q3),
+				_mm256_unpackhi_epi64(q0, q1), _mm256_unpackhi_epi64(q2, q3));
+
+			// Lanes hold texels { 0, 2, 4, 6 } and { 1, 3, 5, 7 }
+			const auto order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(&pDst[4 * i]), _mm256_permutevar8x32_epi32(result, order));
+		}
+
+		DownSampleQuadsPremulRGBA8_SSE2(&pDst[4 * i], &pSrc[16 * i], dstCount - i);
+	}
+
+	// Normal maps, the 2x2 footprints split as in DownSamplePremul8(), following
+	// FilterNormalRGBA8() operation for operation
+	MIP_TARGET("avx2")
+	static inline __m256 DecodeNormals8(__m256i texels, int shift)
+	{
+		const auto val = _mm256_and_si256(_mm256_srli_epi32(texels, shift), _mm256_set1_epi32(0xff));
+
+		return _mm256_sub_ps(_mm256_mul_ps(_mm256_cvtepi32_ps(val), _mm256_set1_ps(2.0f / 255)), _mm256_set1_ps(1.0f));
+	}
+
+	MIP_TARGET("avx2")
+	static inline __m256i EncodeUNORM8x8(__m256 val)
+	{
+		const auto saturated = _mm256_min_ps(_mm256_max_ps(val, _mm256_setzero_ps()), _mm256_set1_ps(1.0f));
+
+		return _mm256_cvttps_epi32(_mm256_add_ps(_mm256_mul_ps(saturated, _mm256_set1_ps(255.0f)), _mm256_set1_ps(0.5f)));
+	}
+
+	// Unit vector component to UNORM8, or the fallback one for the null vectors
+	MIP_TARGET("avx2")
+	static inline __m256i EncodeNormals8(__m256 val, __m256 invLength, __m256 isValid, __m256 fallback)
+	{
+		const auto half = _mm256_set1_ps(0.5f);
+		const auto unit = _mm256_blendv_ps(fallback, _mm256_mul_ps(val, invLength), isValid);
+
+		return EncodeUNORM8x8(_mm256_add_ps(_mm256_mul_ps(unit, half), half));
+	}
+
+	MIP_TARGET("avx2")
+	static inline __m256i DownSampleNormals8(__m256i a0, __m256i b0, __m256i a1, __m256i b1, uint32_t flags)
+	{
+		__m256i texels[4];
+		texels[0] = _mm256_castps_si256(_mm256_shuffle_ps(_mm256_castsi256_ps(a0), _mm256_castsi256_ps(b0), _MM_SHUFFLE(2, 0, 2, 0)));
+		texels[1] = _mm256_castps_si256(_mm256_shuffle_ps(_mm256_castsi256_ps(a0), _mm256_castsi256_ps(b0), _MM_SHUFFLE(3, 1, 3, 1)));
+		texels[2] = _mm256_castps_si256(_mm256_shuffle_ps(_mm256_castsi256_ps(a1), _mm256_castsi256_ps(b1), _MM_SHUFFLE(2, 0, 2, 0)));
+		texels[3] = _mm256_castps_si256(_mm256_shuffle_ps(_mm256_castsi256_ps(a1), _mm256_castsi256_ps(b1), _MM_SHUFFLE(3, 1, 3, 1)));
+
+		const auto isXY = (flags & NORMAL_XY) != 0;
+		const auto spareShift = isXY ? 16 : 24;
+		const auto zero = _mm256_setzero_ps();
+		const auto one = _mm256_set1_ps(1.0f);
+		const auto w = _mm256_set1_ps(0.25f);
+		const auto maxVal = _mm256_set1_ps(255.0f);
+		__m256 normal[3] = { zero, zero, zero };
+		auto spare = zero;
+		auto alpha = zero;
+		for (auto i = 0u; i < 4; ++i)
+		{
+			const auto x = DecodeNormals8(texels[i], 0);
+			const auto y = DecodeNormals8(texels[i], 8);
+			const auto z = isXY ? _mm256_sqrt_ps(_mm256_max_ps(_mm256_sub_ps(_mm256_sub_ps(one, _mm256_mul_ps(x, x)),
+				_mm256_mul_ps(y, y)), zero)) : DecodeNormals8(texels[i], 16);
+
+			const auto lengthSq = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(x, x), _mm256_mul_ps(y, y)), _mm256_mul_ps(z, z));
+			const auto invLength = _mm256_div_ps(one, _mm256_sqrt_ps(lengthSq));
+			normal[0] = _mm256_add_ps(normal[0], _mm256_mul_ps(w, _mm256_mul_ps(x, invLength)));
+			normal[1] = _mm256_add_ps(normal[1], _mm256_mul_ps(w, _mm256_mul_ps(y, invLength)));
+			normal[2] = _mm256_add_ps(normal[2], _mm256_mul_ps(w, _mm256_mul_ps(z, invLength)));
+
+			const auto s = _mm256_div_ps(_mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srli_epi32(texels[i], spareShift),
+				_mm256_set1_epi32(0xff))), maxVal);
+			spare = _mm256_add_ps(spare, _mm256_mul_ps(w, flags & NORMAL_ROUGHNESS ? _mm256_mul_ps(s, s) : s));
+			if (isXY) alpha = _mm256_add_ps(alpha, _mm256_mul_ps(w, _mm256_div_ps(_mm256_cvtepi32_ps(_mm256_srli_epi32(texels[i], 24)), maxVal)));
+		}
+
+		const auto length = _mm256_sqrt_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(normal[0], normal[0]),
+			_mm256_mul_ps(normal[1], normal[1])), _mm256_mul_ps(normal[2], normal[2])));
+		const auto invLength = _mm256_div_ps(one, length);
+		const auto isValid = _mm256_cmp_ps(length, zero, _CMP_GT_OQ);
+
+		if (flags & NORMAL_ROUGHNESS)
+		{
+			const auto variance = _mm256_div_ps(_mm256_sub_ps(one, length), length);
+			spare = _mm256_sqrt_ps(_mm256_min_ps(_mm256_max_ps(_mm256_add_ps(spare, variance), zero), one));
+		}
+
+		auto result = _mm256_or_si256(EncodeNormals8(normal[0], invLength, isValid, zero),
+			_mm256_slli_epi32(EncodeNormals8(normal[1], invLength, isValid, zero), 8));
+		result = _mm256_or_si256(result, _mm256_slli_epi32(EncodeUNORM8x8(spare), spareShift));
+		if (isXY) result = _mm256_or_si256(result, _mm256_slli_epi32(EncodeUNORM8x8(alpha), 24));
+		else result = _mm256_or_si256(result, _mm256_slli_epi32(EncodeNormals8(normal[2], invLength, isValid, one), 16));
+
+		return result;
+	}
+
+	MIP_TARGET("avx2")
+	void DownSampleNormalsRGBA8_AVX2(uint8_t* pDst, const uint8_t* pRow0, const uint8_t* pRow1,
+		uint32_t dstWidth, uint32_t flags)
+	{
+		auto i = 0u;
+		for (; i + 8 <= dstWidth; i += 8)
+		{
+			const auto pSrc0 = reinterpret_cast<const __m256i*>(&pRow0[8 * i]);
+			const auto pSrc1 = reinterpret_cast<const __m256i*>(&pRow1[8 * i]);
+			const auto result = DownSampleNormals8(_mm256_loadu_si256(pSrc0), _mm256_loadu_si256(pSrc0 + 1),
+				_mm256_loadu_si256(pSrc1), _mm256_loadu_si256(pSrc1 + 1), flags);
+
+			// Lanes hold texel pairs { 0, 2, 1, 3 }
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(&pDst[4 * i]),
+				_mm256_permute4x64_epi64(result, _MM_SHUFFLE(3, 1, 2, 0)));
+		}
+
+		DownSampleNormalsRGBA8_Scalar(&pDst[4 * i], &pRow0[8 * i], &pRow1[8 * i], dstWidth - i, flags);
+	}
+
+	MIP_TARGET("avx2")
+	void DownSampleQuadsNormalsRGBA8_AVX2(uint8_t* pDst, const uint8_t* pSrc, uint32_t dstCount, uint32_t flags)
+	{
+		auto i = 0u;
+		for (; i + 8 <= dstCount; i += 8)
+		{
+			const auto pQuads = reinterpret_cast<const __m256i*>(&pSrc[16 * i]);
+			const auto q0 = _mm256_loadu_si256(pQuads);
+			const auto q1 = _mm256_loadu_si256(pQuads + 1);
+			const auto q2 = _mm256_loadu_si256(pQuads + 2);
+			const auto q3 = _mm256_loadu_si256(pQuads + 3);
+			const auto result = DownSampleNormals8(_mm256_unpacklo_epi64(q0, q1), _mm256_unpacklo_epi64(q2, q3),
+				_mm256_unpackhi_epi64(q0, q1), _mm256_unpackhi_epi64(q2, q3), flags);
+
+			// Lanes hold texels { 0, 2, 4, 6 } and { 1, 3, 5, 7 }
+			const auto order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(&pDst[4 * i]), _mm256_permutevar8x32_epi32(result, order));
+		}
+
+		DownSampleQuadsNormalsRGBA8_Scalar(&pDst[4 * i], &pSrc[16 * i], dstCount - i, flags);
+	}
+
+	// 4 source texels per vector, across 2 (4 destination texels) or 4 independent sums
+	MIP_TARGET("avx2")
+	static inline __m128i SaturateRound8(__m256 sum)
+	{
+		const auto result = _mm256_cvttps_epi32(_mm256_add_ps(_mm256_min_ps(_mm256_max_ps(sum, _mm256_setzero_ps()),
+			_mm256_set1_ps(255.0f)), _mm256_set1_ps(0.5f)));
+
+		return _mm_packs_epi32(_mm256_castsi256_si128(result), _mm256_extracti128_si256(result, 1));
+	}
+
+	// 2 taps per vector, the even ones in the low lane; 2 destination texels per iteration
+	MIP_TARGET("avx2")
+	void FilterRowRGBA8_AVX2(float* pDst, const uint8_t* pSrc, uint32_t srcX0,
+		const uint32_t* pFirst, const float* pWeights, uint32_t numTaps, uint32_t count)
+	{
+		const auto pairWeights = _mm256_setr_epi32(0, 0, 0, 0, 1, 1, 1, 1);
+		const auto numPairs = numTaps / 2;
+
+		auto i = 0u;
+		for (; i + 2 <= count; i += 2)
+		{
+			const auto pTexels0 = &pSrc[4 * (pFirst[i] - srcX0)];
+			const auto pTexels1 = &pSrc[4 * (pFirst[i + 1] - srcX0)];
+			const auto pWeights0 = &pWeights[numTaps * i];
+			const auto pWeights1 = &pWeights[numTaps * (i + 1)];
+
+			auto sum0 = _mm256_setzero_ps();
+			auto sum1 = _mm256_setzero_ps();
+			for (auto p = 0u; p < numPairs; ++p)
+			{
+				const auto v0 = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(&pTexels0[8 * p]))));
+				const auto v1 = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(&pTexels1[8 * p]))));
+				const auto w0 = _mm256_permutevar8x32_ps(_mm256_castps128_ps256(_mm_castsi128_ps(
+					_mm_loadl_epi64(reinterpret_cast<const __m128i*>(&pWeights0[2 * p])))), pairWeights);
+				const auto w1 = _mm256_permutevar8x32_ps(_mm256_castps128_ps256(_mm_castsi128_ps(
+					_mm_loadl_epi64(reinterpret_cast<const __m128i*>(&pWeights1[2 * p])))), pairWeights);
+				sum0 = _mm256_add_ps(sum0, _mm256_mul_ps(w0, v0));
+				sum1 = _mm256_add_ps(sum1, _mm256_mul_ps(w1, v1));
+			}
+
+			auto even0 = _mm256_castps256_ps128(sum0);
+			auto even1 = _mm256_castps256_ps128(sum1);
+			if (numTaps & 1)
+			{
+				const auto t = numTaps - 1;
+				int texel0, texel1;
+				memcpy(&texel0, &pTexels0[4 * t], sizeof(int));
+				memcpy(&texel1, &pTexels1[4 * t], sizeof(int));
+				even0 = _mm_add_ps(even0, _mm_mul_ps(_mm_set1_ps(pWeights0[t]), _mm_cvtepi32_ps(_mm_cvtepu8_epi32(_mm_cvtsi32_si128(texel0)))));
+				even1 = _mm_add_ps(even1, _mm_mul_ps(_mm_set1_ps(pWeights1[t]), _mm_cvtepi32_ps(_mm_cvtepu8_epi32(_mm_cvtsi32_si128(texel1)))));
+			}
+			_mm_storeu_ps(&pDst[4 * i], _mm_add_ps(even0, _mm256_extractf128_ps(sum0, 1)));
+			_mm_storeu_ps(&pDst[4 * i + 4], _mm_add_ps(even1, _mm256_extractf128_ps(sum1, 1)));
+		}
+
+		FilterRowRGBA8_SSE41(&pDst[4 * i], pSrc, srcX0, &pFirst[i], &pWeights[numTaps * i], numTaps, count - i);
+	}
+
+	MIP_TARGET("avx2")
+	void FilterColumnsRGBA8_AVX2(uint8_t* pDst, const float* const* ppRows, const float* pWeights,
+		uint32_t numTaps, uint32_t count)
+	{
+		auto i = 0u;
+		for (; i + 8 <= count; i += 8)
+		{
+			__m256 sums[4] = { _mm256_setzero_ps(), _mm256_setzero_ps(), _mm256_setzero_ps(), _mm256_setzero_ps() };
+			for (auto t = 0u; t < numTaps; ++t)
+			{
+				const auto weight = _mm256_set1_ps(pWeights[t]);
+				for (auto j = 0u; j < 4; ++j)
+					sums[j] = _mm256_add_ps(sums[j], _mm256_mul_ps(weight, _mm256_loadu_ps(&ppRows[t][4 * i + 8 * j])));
+			}
+
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(&pDst[4 * i]), _mm_packus_epi16(SaturateRound8(sums[0]), SaturateRound8(sums[1])));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(&pDst[4 * i + 16]), _mm_packus_epi16(SaturateRound8(sums[2]), SaturateRound8(sums[3])));
+		}
+
+		for (; i + 4 <= count; i += 4)
+		{
+			auto sum0 = _mm256_setzero_ps();
+			auto sum1 = _mm256_setzero_ps();
+			for (auto t = 0u; t < numTaps; ++t)
+			{
+				const auto weight = _mm256_set1_ps(pWeights[t]);
+				sum0 = _mm256_add_ps(sum0, _mm256_mul_ps(weight, _mm256_loadu_ps(&ppRows[t][4 * i])));
+				sum1 = _mm256_add_ps(sum1, _mm256_mul_ps(weight, _mm256_loadu_ps(&ppRows[t][4 * i + 8])));
+			}
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(&pDst[4 * i]), _mm_packus_epi16(SaturateRound8(sum0), SaturateRound8(sum1)));
+		}
+
+		const float* ppTailRows[MaxFilterTaps];
+		for (auto t = 0u; t < numTaps; ++t) ppTailRows[t] = &ppRows[t][4 * i];
+		FilterColumnsRGBA8_Scalar(&pDst[4 * i], ppTailRows, pWeights, numTaps, count - i);
+	}
+
+	//--------------------------------------------------------------------------------------
+	// AVX2 sRGB, 2 destination texels per iteration, the tables read by gathers
+	//--------------------------------------------------------------------------------------
+	// The 2 texels at pSrc as floats, with alpha from the linear half of the decode table
+	MIP_TARGET("avx2")
+	static inline __m256 DecodeSRGBA8x2(const uint8_t* pSrc)
+	{
+		const auto alphaOffset = _mm256_setr_epi32(0, 0, 0, 256, 0, 0, 0, 256);
+		const auto texels = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(pSrc)));
+
+		return _mm256_i32gather_ps(&g_srgbTables.Decode[0][0], _mm256_add_epi32(texels, alphaOffset), 4);
+	}
+
+	MIP_TARGET("avx2")
+	static inline void EncodeSRGBA8x2(uint8_t* pDst, __m256 val)
+	{
+		const auto alphaMask = _mm256_setr_epi32(0, 0, 0, -1, 0, 0, 0, -1);
+		const auto zero = _mm256_setzero_ps();
+		const auto one = _mm256_set1_ps(1.0f);
+
+		// Color by the buckets, see LinearToSRGB8()
+		const auto clamped = _mm256_min_ps(_mm256_max_ps(val, _mm256_castsi256_ps(_mm256_set1_epi32(g_srgbMinBits))),
+			_mm256_castsi256_ps(_mm256_set1_epi32(g_srgbMaxBits)));
+		const auto bucket = _mm256_srli_epi32(_mm256_sub_epi32(_mm256_castps_si256(clamped),
+			_mm256_set1_epi32(g_srgbMinBits)), g_srgbBucketShift);
+		const auto value = _mm256_i32gather_epi32(g_srgbTables.BucketValues, bucket, 4);
+		const auto threshold = _mm256_i32gather_ps(g_srgbTables.BucketThresholds, bucket, 4);
+		const auto srgb = _mm256_sub_epi32(value, _mm256_castps_si256(_mm256_cmp_ps(clamped, threshold, _CMP_GE_OQ)));
+
+		// Alpha as FloatToUNORM8()
+		const auto alpha = _mm256_cvttps_epi32(_mm256_add_ps(_mm256_mul_ps(_mm256_min_ps(_mm256_max_ps(val, zero), one),
+			_mm256_set1_ps(255.0f)), _mm256_set1_ps(0.5f)));
+
+		const auto result = _mm256_blendv_epi8(srgb, alpha, alphaMask);
+		const auto packed = _mm256_packus_epi16(_mm256_packs_epi32(result, result), _mm256_setzero_si256());
+		_mm_storel_epi64(reinterpret_cast<__m128i*>(pDst), _mm_unpacklo_epi32(_mm256_castsi256_si128(packed),
+			_mm256_extracti128_si256(packed, 1)));
+	}
+
+	MIP_TARGET("avx2")
+	void DownSampleSRGBA8_AVX2(uint8_t* pDst, const uint8_t* pRow0, const uint8_t* pRow1, uint32_t dstWidth)
+	{
+		const auto quarter = _mm256_set1_ps(0.25f);
+
+		auto i = 0u;
+		for (; i + 2 <= dstWidth; i += 2)
+		{
+			// Column sums of source texels { 0, 1 } and { 2, 3 }
+			const auto cols0 = _mm256_add_ps(DecodeSRGBA8x2(&pRow0[8 * i]), DecodeSRGBA8x2(&pRow1[8 * i]));
+			const auto cols1 = _mm256_add_ps(DecodeSRGBA8x2(&pRow0[8 * i + 8]), DecodeSRGBA8x2(&pRow1[8 * i + 8]));
+			const auto sum = _mm256_add_ps(_mm256_permute2f128_ps(cols0, cols1, 0x20), _mm256_permute2f128_ps(cols0, cols1, 0x31));
+			EncodeSRGBA8x2(&pDst[4 * i], _mm256_mul_ps(sum, quarter));
+		}
+
+		DownSampleSRGBA8_Scalar(&pDst[4 * i], &pRow0[8 * i], &pRow1[8 * i], dstWidth - i);
+	}
+
+	MIP_TARGET("avx2")
+	void DownSampleQuadsSRGBA8_AVX2(uint8_t* pDst, const uint8_t* pSrc, uint32_t dstCount)
+	{
+		const auto quarter = _mm256_set1_ps(0.25f);
+
+		auto i = 0u;
+		for (; i + 2 <= dstCount; i += 2)
+		{
+			// Column sums of quads { 0, 1 }, texels { 0, 2 } and { 1, 3 } of each
+			const auto cols0 = _mm256_add_ps(DecodeSRGBA8x2(&pSrc[16 * i]), DecodeSRGBA8x2(&pSrc[16 * i + 8]));
+			const auto cols1 = _mm256_add_ps(DecodeSRGBA8x2(&pSrc[16 * i + 16]), DecodeSRGBA8x2(&pSrc[16 * i + 24]));
+			const auto sum = _mm256_add_ps(_mm256_permute2f128_ps(cols0, cols1, 0x20), _mm256_permute2f128_ps(cols0, cols1, 0x31));
+			EncodeSRGBA8x2(&pDst[4 * i], _mm256_mul_ps(sum, quarter));
+		}
+
+		DownSampleQuadsSRGBA8_Scalar(&pDst[4 * i], &pSrc[16 * i], dstCount - i);
+	}
+
+	//--------------------------------------------------------------------------------------
+	// SSE4.1, levels of fewer channels, 16 bytes of destination per iteration
+	//--------------------------------------------------------------------------------------
+	// Sums of the components in lanes twice as wide: 16 bits for uint8_t, 32 for uint16_t
+	template<typename T> struct UnormLanes;
+
+	template<> struct UnormLanes<uint8_t>
+	{
+		MIP_TARGET("sse4.1") static __m128i WidenLo(__m128i v) { return _mm_unpacklo_epi8(v, _mm_setzero_si128()); }
+		MIP_TARGET("sse4.1") static __m128i WidenHi(__m128i v) { return _mm_unpackhi_epi8(v, _mm_setzero_si128()); }
+		MIP_TARGET("sse4.1") static __m128i Add(__m128i a, __m128i b) { return _mm_add_epi16(a, b); }
+
+		// (sum + 2) / 4 of 2 vectors, packed back
+		MIP_TARGET("sse4.1") static __m128i Average(__m128i lo, __m128i hi)
+		{
+			const auto bias = _mm_set1_epi16(2);
+
+			return _mm_packus_epi16(_mm_srli_epi16(_mm_add_epi16(lo, bias), 2), _mm_srli_epi16(_mm_add_epi16(hi, bias), 2));
+		}
+	};
+
+	template<> struct UnormLanes<uint16_t>
+	{
+		MIP_TARGET("sse4.1") static __m128i WidenLo(__m128i v) { return _mm_unpacklo_epi16(v, _mm_setzero_si128()); }
+		MIP_TARGET("sse4.1") static __m128i WidenHi(__m128i v) { return _mm_unpackhi_epi16(v, _mm_setzero_si128()); }
+		MIP_TARGET("sse4.1") static __m128i Add(__m128i a, __m128i b) { return _mm_add_epi32(a, b); }
+
+		MIP_TARGET("sse4.1") static __m128i Average(__m128i lo, __m128i hi)
+		{
+			const auto bias = _mm_set1_epi32(2);
+
+			return _mm_packus_epi32(_mm_srli_epi32(_mm_add_epi32(lo, bias), 2), _mm_srli_epi32(_mm_add_epi32(hi, bias), 2));
+		}
+	};
+
+	// Sums of the adjacent texels of a, then of b, by the size of a texel in the wide lanes.
+	// The sums of 4 components take 10 or 18 bits, with no carry across the narrower lanes.
+	template<uint32_t TexelBytes> struct WideTexel {};
+
+	MIP_TARGET("sse4.1")
+	static inline __m128i PairSums(__m128i a, __m128i b, WideTexel<2>)
+	{
+		return _mm_hadd_epi16(a, b);
+	}
+
+	MIP_TARGET("sse4.1")
+	static inline __m128i PairSums(__m128i a, __m128i b, WideTexel<4>)
+	{
+		return _mm_hadd_epi32(a, b);
+	}
+
+	MIP_TARGET("sse4.1")
+	static inline __m128i PairSums(__m128i a, __m128i b, WideTexel<8>)
+	{
+		return _mm_add_epi32(_mm_unpacklo_epi64(a, b), _mm_unpackhi_epi64(a, b));
+	}
+
+	template<typename T, uint8_t N>
+	MIP_TARGET("sse4.1")
+	void DownSampleUNORM_SSE41(uint8_t* pDst, const uint8_t* pRow0, const uint8_t* pRow1, uint32_t dstWidth)
+	{
+		typedef UnormLanes<T> Lanes;
+		const WideTexel<2 * sizeof(T) * N> texel;
+		const auto texelBytes = static_cast<uint32_t>(sizeof(T) * N);
+		const auto texelsPerIter = 16 / texelBytes;
+
+		auto i = 0u;
+		for (; i + texelsPerIter <= dstWidth; i += texelsPerIter)
+		{
+			const auto pSrc0 = reinterpret_cast<const __m128i*>(&pRow0[2 * texelBytes * i]);
+			const auto pSrc1 = reinterpret_cast<const __m128i*>(&pRow1[2 * texelBytes * i]);
+			const auto a0 = _mm_loadu_si128(pSrc0);
+			const auto b0 = _mm_loadu_si128(pSrc0 + 1);
+			const auto a1 = _mm_loadu_si128(pSrc1);
+			const auto b1 = _mm_loadu_si128(pSrc1 + 1);
+
+			// Column sums, then the sums of the texel pairs
+			const auto lo = PairSums(Lanes::Add(Lanes::WidenLo(a0), Lanes::WidenLo(a1)),
+				Lanes::Add(Lanes::WidenHi(a0), Lanes::WidenHi(a1)), texel);
+			const auto hi = PairSums(Lanes::Add(Lanes::WidenLo(b0), Lanes::WidenLo(b1)),
+				Lanes::Add(Lanes::WidenHi(b0), Lanes::WidenHi(b1)), texel);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(&pDst[texelBytes * i]), Lanes::Average(lo, hi));
+		}
+
+		DownSampleUNORM_Scalar<T, N>(&pDst[texelBytes * i], &pRow0[2 * texelBytes * i],
+			&pRow1[2 * texelBytes * i], dstWidth - i);
+	}
+
+	template<typename T, uint8_t N>
+	MIP_TARGET("sse4.1")
+	void DownSampleQuadsUNORM_SSE41(uint8_t* pDst, const uint8_t* pSrc, uint32_t dstCount)
+	{
+		typedef UnormLanes<T> Lanes;
+		const WideTexel<2 * sizeof(T) * N> texel;
+		const auto texelBytes = static_cast<uint32_t>(sizeof(T) * N);
+		const auto texelsPerIter = 16 / texelBytes;
+
+		auto i = 0u;
+		for (; i + texelsPerIter <= dstCount; i += texelsPerIter)
+		{
+			// Sums of the texel pairs, then of the pairs of pairs
+			const auto pQuads = reinterpret_cast<const __m128i*>(&pSrc[4 * texelBytes * i]);
+			__m128i pairs[4];
+			for (auto j = 0u; j < 4; ++j)
+			{
+				const auto quads = _mm_loadu_si128(pQuads + j);
+				pairs[j] = PairSums(Lanes::WidenLo(quads), Lanes::WidenHi(quads), texel);
+			}
+
+			const auto lo = PairSums(pairs[0], pairs[1], texel);
+			const auto hi = PairSums(pairs[2], pairs[3], texel);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(&pDst[texelBytes * i]), Lanes::Average(lo, hi));
+		}
+
+		DownSampleQuadsUNORM_Scalar<T, N>(&pDst[texelBytes * i], &pSrc[4 * texelBytes * i], dstCount - i);
+	}
+
+	template void DownSampleUNORM_SSE41<uint8_t, 1>(uint8_t*, const uint8_t*, const uint8_t*, uint32_t);
+	template void DownSampleUNORM_SSE41<uint8_t, 2>(uint8_t*, const uint8_t*, const uint8_t*, uint32_t);
+	template void DownSampleUNORM_SSE41<uint16_t, 1>(uint8_t*, const uint8_t*, const uint8_t*, uint32_t);
+	template void DownSampleUNORM_SSE41<uint16_t, 2>(uint8_t*, const uint8_t*, const uint8_t*, uint32_t);
+	template void DownSampleQuadsUNORM_SSE41<uint8_t, 1>(uint8_t*, const uint8_t*, uint32_t);
+	template void DownSampleQuadsUNORM_SSE41<uint8_t, 2>(uint8_t*, const uint8_t*, uint32_t);
+	template void DownSampleQuadsUNORM_SSE41<uint16_t, 1>(uint8_t*, const uint8_t*, uint32_t);
+	template void DownSampleQuadsUNORM_SSE41<uint16_t, 2>(uint8_t*, const uint8_t*, uint32_t);
+
+	// 4 destination texels per iteration of R8G8B8 from 24 bytes of each row, or 48 bytes of
+	// quads, loaded 12 bytes at a time as the first or the last 12 bytes of a vector. The
+	// texels to sum are shuffled into adjacent bytes for _mm_maddubs_epi16(), giving 16-bit
+	// lanes of RGB0 per destination texel, then packed and compacted to 12 bytes.
+	MIP_TARGET("sse4.1")
+	static inline void StoreRGB8x4(uint8_t* pDst, __m128i lo, __m128i hi)
+	{
+		const auto bias = _mm_set1_epi16(2);
+		const auto compact = _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+		const auto packed = _mm_shuffle_epi8(_mm_packus_epi16(_mm_srli_epi16(_mm_add_epi16(lo, bias), 2),
+			_mm_srli_epi16(_mm_add_epi16(hi, bias), 2)), compact);
+		const auto last = _mm_cvtsi128_si32(_mm_srli_si128(packed, 8));
+		_mm_storel_epi64(reinterpret_cast<__m128i*>(pDst), packed);
+		memcpy(&pDst[8], &last, sizeof(int));
+	}
+
+	MIP_TARGET("sse4.1")
+	void DownSampleRGB8_SSE41(uint8_t* pDst, const uint8_t* pRow0, const uint8_t* pRow1, uint32_t dstWidth)
+	{
+		// Texel pairs of 12 bytes at offset 0, then at offset 4
+		const auto pairs0 = _mm_setr_epi8(0, 3, 1, 4, 2, 5, -1, -1, 6, 9, 7, 10, 8, 11, -1, -1);
+		const auto pairs4 = _mm_setr_epi8(4, 7, 5, 8, 6, 9, -1, -1, 10, 13, 11, 14, 12, 15, -1, -1);
+		const auto ones = _mm_set1_epi8(1);
+
+		auto i = 0u;
+		for (; i + 4 <= dstWidth; i += 4)
+		{
+			const auto pSrc0 = &pRow0[6 * i];
+			const auto pSrc1 = &pRow1[6 * i];
+			const auto lo0 = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(pSrc0)), pairs0);
+			const auto hi0 = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(pSrc0 + 8)), pairs4);
+			const auto lo1 = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(pSrc1)), pairs0);
+			const auto hi1 = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(pSrc1 + 8)), pairs4);
+
+			const auto lo = _mm_add_epi16(_mm_maddubs_epi16(lo0, ones), _mm_maddubs_epi16(lo1, ones));
+			const auto hi = _mm_add_epi16(_mm_maddubs_epi16(hi0, ones), _mm_maddubs_epi16(hi1, ones));
+			StoreRGB8x4(&pDst[3 * i], lo, hi);
+		}
+
+		DownSampleUNORM_Scalar<uint8_t, 3>(&pDst[3 * i], &pRow0[6 * i], &pRow1[6 * i], dstWidth - i);
+	}
+
+	MIP_TARGET("sse4.1")
+	void DownSampleQuadsRGB8_SSE41(uint8_t* pDst, const uint8_t* pSrc, uint32_t dstCount)
+	{
+		// Pairs (0, 1) and (2, 3) of a quad, interleaved by channel, so that the sums of the
+		// pairs are adjacent for _mm_hadd_epi16()
+		const auto quad0 = _mm_setr_epi8(0, 3, 6, 9, 1, 4, 7, 10, 2, 5, 8, 11, -1, -1, -1, -1);
+		const auto quad4 = _mm_setr_epi8(4, 7, 10, 13, 5, 8, 11, 14, 6, 9, 12, 15, -1, -1, -1, -1);
+		const auto ones = _mm_set1_epi8(1);
+
+		auto i = 0u;
+		for (; i + 4 <= dstCount; i += 4)
+		{
+			const auto pQuads = &pSrc[12 * i];
+			__m128i sums[4];
+			for (auto j = 0u; j < 4; ++j)
+			{
+				const auto quad = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&pQuads[12 * j - 4 * (j & 1)]));
+				sums[j] = _mm_maddubs_epi16(_mm_shuffle_epi8(quad, (j & 1) ? quad4 : quad0), ones);
+			}
+
+			StoreRGB8x4(&pDst[3 * i], _mm_hadd_epi16(sums[0], sums[1]), _mm_hadd_epi16(sums[2], sums[3]));
+		}
+
+		DownSampleQuadsUNORM_Scalar<uint8_t, 3>(&pDst[3 * i], &pSrc[12 * i], dstCount - i);
+	}
+
+	//--------------------------------------------------------------------------------------
+	// SSE4.1 and AVX2, 16-bit levels, 2 and 4 destination texels per iteration
+	//--------------------------------------------------------------------------------------
+	// Rounded average of the 2 texels of a and the 2 of b, in 32-bit lanes
+	MIP_TARGET("sse4.1")
+	static inline __m128i Average2x2EPU16(__m128i a, __m128i b)
+	{
+		const auto zero = _mm_setzero_si128();
+		const auto sum = _mm_add_epi32(_mm_add_epi32(_mm_unpacklo_epi16(a, zero), _mm_unpackhi_epi16(a, zero)),
+			_mm_add_epi32(_mm_unpacklo_epi16(b, zero), _mm_unpackhi_epi16(b, zero)));
+
+		return _mm_srli_epi32(_mm_add_epi32(sum, _mm_set1_epi32(2)), 2);
+	}
+
+	MIP_TARGET("sse4.1")
+	void DownSampleRGBA16_SSE41(uint16_t* pDst, const uint16_t* pRow0, const uint16_t* pRow1, uint32_t dstWidth)
+	{
+		auto i = 0u;
+		for (; i + 2 <= dstWidth; i += 2)
+		{
+			const auto pSrc0 = reinterpret_cast<const __m128i*>(&pRow0[8 * i]);
+			const auto pSrc1 = reinterpret_cast<const __m128i*>(&pRow1[8 * i]);
+			const auto d0 = Average2x2EPU16(_mm_loadu_si128(pSrc0), _mm_loadu_si128(pSrc1));
+			const auto d1 = Average2x2EPU16(_mm_loadu_si128(pSrc0 + 1), _mm_loadu_si128(pSrc1 + 1));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(&pDst[4 * i]), _mm_packus_epi32(d0, d1));
+		}
+
+		DownSampleRGBA16_Scalar(&pDst[4 * i], &pRow0[8 * i], &pRow1[8 * i], dstWidth - i);
+	}
+
+	MIP_TARGET("sse4.1")
+	void DownSampleQuadsRGBA16_SSE41(uint16_t* pDst, const uint16_t* pSrc, uint32_t dstCount)
+	{
+		auto i = 0u;
+		for (; i + 2 <= dstCount; i += 2)
+		{
+			const auto pQuads = reinterpret_cast<const __m128i*>(&pSrc[16 * i]);
+			const auto d0 = Average2x2EPU16(_mm_loadu_si128(pQuads), _mm_loadu_si128(pQuads + 1));
+			const auto d1 = Average2x2EPU16(_mm_loadu_si128(pQuads + 2), _mm_loadu_si128(pQuads + 3));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(&pDst[4 * i]), _mm_packus_epi32(d0, d1));
+		}
+
+		DownSampleQuadsRGBA16_Scalar(&pDst[4 * i], &pSrc[16 * i], dstCount - i);
+	}
+
+	// As Average2x2EPU16() within each 128-bit lane
+	MIP_TARGET("avx2")
+	static inline __m256i Average2x2EPU16x2(__m256i a, __m256i b)
+	{
+		const auto zero = _mm256_setzero_si256();
+		const auto sum = _mm256_add_epi32(_mm256_add_epi32(_mm256_unpacklo_epi16(a, zero), _mm256_unpackhi_epi16(a, zero)),
+			_mm256_add_epi32(_mm256_unpacklo_epi16(b, zero), _mm256_unpackhi_epi16(b, zero)));
+
+		return _mm256_srli_epi32(_mm256_add_epi32(sum, _mm256_set1_epi32(2)), 2);
+	}
+
+	MIP_TARGET("avx2")
+	void DownSampleRGBA16_AVX2(uint16_t* pDst, const uint16_t* pRow0, const uint16_t* pRow1, uint32_t dstWidth)
+	{
+		auto i = 0u;
+		for (; i + 4 <= dstWidth; i += 4)
+		{
+			const auto pSrc0 = reinterpret_cast<const __m256i*>(&pRow0[8 * i]);
+			const auto pSrc1 = reinterpret_cast<const __m256i*>(&pRow1[8 * i]);
+			const auto d01 = Average2x2EPU16x2(_mm256_loadu_si256(pSrc0), _mm256_loadu_si256(pSrc1));
+			const auto d23 = Average2x2EPU16x2(_mm256_loadu_si256(pSrc0 + 1), _mm256_loadu_si256(pSrc1 + 1));
+
+			// Lanes hold the texels { 0, 2, 1, 3 }
+			const auto result = _mm256_permute4x64_epi64(_mm256_packus_epi32(d01, d23), _MM_SHUFFLE(3, 1, 2, 0));
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(&pDst[4 * i]), result);
+		}
+
+		DownSampleRGBA16_SSE41(&pDst[4 * i], &pRow0[8 * i], &pRow1[8 * i], dstWidth - i);
+	}
+
+	MIP_TARGET("avx2")
+	void DownSampleQuadsRGBA16_AVX2(uint16_t* pDst, const uint16_t* pSrc, uint32_t dstCount)
+	{
+		auto i = 0u;
+		for (; i + 4 <= dstCount; i += 4)
+		{
+			// Texels 0 and 1 of 2 quads against their texels 2 and 3
+			const auto pQuads = reinterpret_cast<const __m256i*>(&pSrc[16 * i]);
+			const auto q0 = _mm256_loadu_si256(pQuads);
+			const auto q1 = _mm256_loadu_si256(pQuads + 1);
+			const auto q2 = _mm256_loadu_si256(pQuads + 2);
+			const auto q3 = _mm256_loadu_si256(pQuads + 3);
+			const auto d01 = Average2x2EPU16x2(_mm256_permute2x128_si256(q0, q1, 0x20), _mm256_permute2x128_si256(q0, q1, 0x31));
+			const auto d23 = Average2x2EPU16x2(_mm256_permute2x128_si256(q2, q3, 0x20), _mm256_permute2x128_si256(q2, q3, 0x31));
+
+			const auto result = _mm256_permute4x64_epi64(_mm256_packus_epi32(d01, d23), _MM_SHUFFLE(3, 1, 2, 0));
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(&pDst[4 * i]), result);
+		}
+
+		DownSampleQuadsRGBA16_SSE41(&pDst[4 * i], &pSrc[16 * i], dstCount - i);
+	}
+
+	//--------------------------------------------------------------------------------------
+	// AVX2 and F16C, floating-point levels, 2 destination texels per iteration
+	//--------------------------------------------------------------------------------------
+	MIP_TARGET("avx2,f16c")
+	void FloatToHalf_F16C(uint16_t* pDst, const float* pSrc, uint32_t count)
+	{
+		auto i = 0u;
+		for (; i + 8 <= count; i += 8)
+		{
+			const auto result = _mm256_cvtps_ph(_mm256_loadu_ps(&pSrc[i]), _MM_FROUND_TO_NEAREST_INT);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(&pDst[i]), result);
+		}
+
+		FloatToHalf_Scalar(&pDst[i], &pSrc[i], count - i);
+	}
+
+	MIP_TARGET("avx2,f16c")
+	void HalfToFloat_F16C(float* pDst, const uint16_t* pSrc, uint32_t count)
+	{
+		auto i = 0u;
+		for (; i + 8 <= count; i += 8)
+			_mm256_storeu_ps(&pDst[i], _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(&pSrc[i]))));
+
+		HalfToFloat_Scalar(&pDst[i], &pSrc[i], count - i);
+	}
+
+	// s0 and s1 hold the 2 halves of a footprint each, as 128-bit lanes: the sums of the
+	// columns for rows, or of the rows for quads. Returns the 2 destination texels.
+	MIP_TARGET("avx2")
+	static inline __m256 Average2x2PS(__m256 s0, __m256 s1)
+	{
+		const auto sum = _mm256_add_ps(_mm256_permute2f128_ps(s0, s1, 0x20), _mm256_permute2f128_ps(s0, s1, 0x31));
+
+		return _mm256_mul_ps(sum, _mm256_set1_ps(0.25f));
+	}
+
+	MIP_TARGET("avx2")
+	void DownSampleRGBA32F_AVX2(float* pDst, const float* pRow0, const float* pRow1, uint32_t dstWidth)
+	{
+		auto i = 0u;
+		for (; i + 2 <= dstWidth; i += 2)
+		{
+			const auto s0 = _mm256_add_ps(_mm256_loadu_ps(&pRow0[8 * i]), _mm256_loadu_ps(&pRow1[8 * i]));
+			const auto s1 = _mm256_add_ps(_mm256_loadu_ps(&pRow0[8 * i + 8]), _mm256_loadu_ps(&pRow1[8 * i + 8]));
+			_mm256_storeu_ps(&pDst[4 * i], Average2x2PS(s0, s1));
+		}
+
+		DownSampleRGBA32F_Scalar(&pDst[4 * i], &pRow0[8 * i], &pRow1[8 * i], dstWidth - i);
+	}
+
+	MIP_TARGET("avx2")
+	void DownSampleQuadsRGBA32F_AVX2(float* pDst, const float* pSrc, uint32_t dstCount)
+	{
+		auto i = 0u;
+		for (; i + 2 <= dstCount; i += 2)
+		{
+			const auto s0 = _mm256_add_ps(_mm256_loadu_ps(&pSrc[16 * i]), _mm256_loadu_ps(&pSrc[16 * i + 8]));
+			const auto s1 = _mm256_add_ps(_mm256_loadu_ps(&pSrc[16 * i + 16]), _mm256_loadu_ps(&pSrc[16 * i + 24]));
+			_mm256_storeu_ps(&pDst[4 * i], Average2x2PS(s0, s1));
+		}
+
+		DownSampleQuadsRGBA32F_Scalar(&pDst[4 * i], &pSrc[16 * i], dstCount - i);
+	}
+
+	MIP_TARGET("avx2,f16c")
+	static inline __m256 LoadHalf8(const uint16_t* pSrc)
+	{
+		return _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(pSrc)));
+	}
+
+	MIP_TARGET("avx2,f16c")
+	void DownSampleRGBA16F_F16C(uint16_t* pDst, const uint16_t* pRow0, const uint16_t* pRow1, uint32_t dstWidth)
+	{
+		auto i = 0u;
+		for (; i + 2 <= dstWidth; i += 2)
+		{
+			const auto s0 = _mm256_add_ps(LoadHalf8(&pRow0[8 * i]), LoadHalf8(&pRow1[8 * i]));
+			const auto s1 = _mm256_add_ps(LoadHalf8(&pRow0[8 * i + 8]), LoadHalf8(&pRow1[8 * i + 8]));
+			const auto result = _mm256_cvtps_ph(Average2x2PS(s0, s1), _MM_FROUND_TO_NEAREST_INT);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(&pDst[4 * i]), result);
+		}
+
+		DownSampleRGBA16F_Scalar(&pDst[4 * i], &pRow0[8 * i], &pRow1[8 * i], dstWidth - i);
+	}
+
+	MIP_TARGET("avx2,f16c")
+	void DownSampleQuadsRGBA16F_F16C(uint16_t* pDst, const uint16_t* pSrc, uint32_t dstCount)
+	{
+		auto i = 0u;
+		for (; i + 2 <= dstCount; i += 2)
+		{
+			const auto s0 = _mm256_add_ps(LoadHalf8(&pSrc[16 * i]), LoadHalf8(&pSrc[16 * i + 8]));
+			const auto s1 = _mm256_add_ps(LoadHalf8(&pSrc[16 * i + 16]), LoadHalf8(&pSrc[16 * i + 24]));
+			const auto result = _mm256_cvtps_ph(Average2x2PS(s0, s1), _MM_FROUND_TO_NEAREST_INT);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(&pDst[4 * i]), result);
+		}
+
+		DownSampleQuadsRGBA16F_Scalar(&pDst[4 * i], &pSrc[16 * i], dstCount - i);
+	}
+
+	//--------------------------------------------------------------------------------------
+	// AVX-512BW, 16 destination texels per iteration
+	//--------------------------------------------------------------------------------------
+	MIP_TARGET("avx512f,avx512bw")
+	void DownSampleRGBA8_AVX512(uint8_t* pDst, const uint8_t* pRow0, const uint8_t* pRow1, uint32_t dstWidth)
+	{
+		const auto zero = _mm512_setzero_si512();
+		const auto bias = _mm512_set1_epi16(2);
+		const auto order = _mm512_setr_epi64(0, 2, 4, 6, 1, 3, 5, 7);
+
+		auto i = 0u;
+		for (; i + 16 <= dstWidth; i += 16)
+		{
+			const auto a0 = _mm512_castsi512_ps(_mm512_loadu_si512(&pRow0[8 * i]));
+			const auto b0 = _mm512_castsi512_ps(_mm512_loadu_si512(&pRow0[8 * i + 64]));
+			const auto a1 = _mm512_castsi512_ps(_mm512_loadu_si512(&pRow1[8 * i]));
+			const auto b1 = _mm512_castsi512_ps(_mm512_loadu_si512(&pRow1[8 * i + 64]));
+
+			// Split even and odd texels within 128-bit lanes
+			const auto e0 = _mm512_castps_si512(_mm512_shuffle_ps(a0, b0, _MM_SHUFFLE(2, 0, 2, 0)));
+			const auto o0 = _mm512_castps_si512(_mm512_shuffle_ps(a0, b0, _MM_SHUFFLE(3, 1, 3, 1)));
+			const auto e1 = _mm512_castps_si512(_mm512_shuffle_ps(a1, b1, _MM_SHUFFLE(2, 0, 2, 0)));
+			const auto o1 = _mm512_castps_si512(_mm512_shuffle_ps(a1, b1, _MM_SHUFFLE(3, 1, 3, 1)));
+
+			auto lo = _mm512_add_epi16(_mm512_unpacklo_epi8(e0, zero), _mm512_unpacklo_epi8(o0, zero));
+			auto hi = _mm512_add_epi16(_mm512_unpackhi_epi8(e0, zero), _mm512_unpackhi_epi8(o0, zero));
+			lo = _mm512_add_epi16(lo, _mm512_add_epi16(_mm512_unpacklo_epi8(e1, zero), _mm512_unpacklo_epi8(o1, zero)));
+			hi = _mm512_add_epi16(hi, _mm512_add_epi16(_mm512_unpackhi_epi8(e1, zero), _mm512_unpackhi_epi8(o1, zero)));
+			lo = _mm512_srli_epi16(_mm512_add_epi16(lo, bias), 2);
+			hi = _mm512_srli_epi16(_mm512_add_epi16(hi, bias), 2);
+
+			// Lanes hold texel pairs { 0, 4, 1, 5, 2, 6, 3, 7 }
+			const auto result = _mm512_permutexvar_epi64(order, _mm512_packus_epi16(lo, hi));
+			_mm512_storeu_si512(&pDst[4 * i], result);
+		}
+
+		DownSampleRGBA8_AVX2(&pDst[4 * i], &pRow0[8 * i], &pRow1[8 * i], dstWidth - i);
+	}
+#endif
+
+#ifdef MIP_KERNELS_NEON
+	//--------------------------------------------------------------------------------------
+	// NEON, 4 destination texels per iteration
+	//--------------------------------------------------------------------------------------
+	void DownSampleRGBA8_NEON(uint8_t* pDst, const uint8_t* pRow0, const uint8_t* pRow1, uint32_t dstWidth)
+	{
+		auto i = 0u;
+		for (; i + 4 <= dstWidth; i += 4)
+		{
+			// De-interleave even and odd texels
+			const auto r0 = vld2q_u32(reinterpret_cast<const uint32_t*>(&pRow0[8 * i]));
+			const auto r1 = vld2q_u32(reinterpret_cast<const uint32_t*>(&pRow1[8 * i]));
+			const auto e0 = vreinterpretq_u8_u32(r0.val[0]);
+			const auto o0 = vreinterpretq_u8_u32(r0.val[1]);
+			const auto e1 = vreinterpretq_u8_u32(r1.val[0]);
+			const auto o1 = vreinterpretq_u8_u32(r1.val[1]);
+
+			auto lo = vaddl_u8(vget_low_u8(e0), vget_low_u8(o0));
+			auto hi = vaddl_u8(vget_high_u8(e0), vget_high_u8(o0));
+			lo = vaddq_u16(lo, vaddl_u8(vget_low_u8(e1), vget_low_u8(o1)));
+			hi = vaddq_u16(hi, vaddl_u8(vget_high_u8(e1), vget_high_u8(o1)));
+
+			// Rounding narrow, (sum + 2) >> 2
+			vst1q_u8(&pDst[4 * i], vcombine_u8(vrshrn_n_u16(lo, 2), vrshrn_n_u16(hi, 2)));
+		}
+
+		DownSampleRGBA8_Scalar(&pDst[4 * i], &pRow0[8 * i], &pRow1[8 * i], dstWidth - i);
+	}
+
+	void DownSampleQuadsRGBA8_NEON(uint8_t* pDst, const uint8_t* pSrc, uint32_t dstCount)
+	{
+		auto i = 0u;
+		for (; i + 4 <= dstCount; i += 4)
+		{
+			// De-interleave the k-th texels of 4 quads
+			const auto q = vld4q_u32(reinterpret_cast<const uint32_t*>(&pSrc[16 * i]));
+			const auto t0 = vreinterpretq_u8_u32(q.val[0]);
+			const auto t1 = vreinterpretq_u8_u32(q.val[1]);
+			const auto t2 = vreinterpretq_u8_u32(q.val[2]);
+			const auto t3 = vreinterpretq_u8_u32(q.val[3]);
+
+			auto lo = vaddl_u8(vget_low_u8(t0), vget_low_u8(t1));
+			auto hi = vaddl_u8(vget_high_u8(t0), vget_high_u8(t1));
+			lo = vaddq_u16(lo, vaddl_u8(vget_low_u8(t2), vget_low_u8(t3)));
+			hi = vaddq_u16(hi, vaddl_u8(vget_high_u8(t2), vget_high_u8(t3)));
+
+			vst1q_u8(&pDst[4 * i], vcombine_u8(vrshrn_n_u16(lo, 2), vrshrn_n_u16(hi, 2)));
+		}
+
+		DownSampleQuadsRGBA8_Scalar(&pDst[4 * i], &pSrc[16 * i], dstCount - i);
+	}
+
+	void SumRowRGBA8_NEON(uint16_t* pDst, const uint8_t* pRow0, const uint8_t* pRow1, uint32_t dstWidth)
+	{
+		auto i = 0u;
+		for (; i + 4 <= dstWidth; i += 4)
+		{
+			const auto r0 = vld2q_u32(reinterpret_cast<const uint32_t*>(&pRow0[8 * i]));
+			const auto r1 = vld2q_u32(reinterpret_cast<const uint32_t*>(&pRow1[8 * i]));
+			const auto e0 = vreinterpretq_u8_u32(r0.val[0]);
+			const auto o0 = vreinterpretq_u8_u32(r0.val[1]);
+			const auto e1 = vreinterpretq_u8_u32(r1.val[0]);
+			const auto o1 = vreinterpretq_u8_u32(r1.val[1]);
+
+			vst1q_u16(&pDst[4 * i], vaddq_u16(vaddl_u8(vget_low_u8(e0), vget_low_u8(o0)),
+				vaddl_u8(vget_low_u8(e1), vget_low_u8(o1))));
+			vst1q_u16(&pDst[4 * i + 8], vaddq_u16(vaddl_u8(vget_high_u8(e0), vget_high_u8(o0)),
+				vaddl_u8(vget_high_u8(e1), vget_high_u8(o1))));
+		}
+
+		SumRowRGBA8_Scalar(&pDst[4 * i], &pRow0[8 * i], &pRow1[8 * i], dstWidth - i);
+	}
+
+	void SumQuadsRGBA8_NEON(uint16_t* pDst, const uint8_t* pSrc, uint32_t dstCount)
+	{
+		auto i = 0u;
+		for (; i + 4 <= dstCount; i += 4)
+		{
+			const auto q = vld4q_u32(reinterpret_cast<const uint32_t*>(&pSrc[16 * i]));
+			const auto t0 = vreinterpretq_u8_u32(q.val[0]);
+			const auto t1 = vreinterpretq_u8_u32(q.val[1]);
+			const auto t2 = vreinterpretq_u8_u32(q.val[2]);
+			const auto t3 = vreinterpretq_u8_u32(q.val[3]);
+
+			vst1q_u16(&pDst[4 * i], vaddq_u16(vaddl_u8(vget_low_u8(t0), vget_low_u8(t1)),
+				vaddl_u8(vget_low_u8(t2), vget_low_u8(t3))));
+			vst1q_u16(&pDst[4 * i + 8], vaddq_u16(vaddl_u8(vget_high_u8(t0), vget_high_u8(t1)),
+				vaddl_u8(vget_high_u8(t2), vget_high_u8(t3))));
+		}
+
+		SumQuadsRGBA8_Scalar(&pDst[4 * i], &pSrc[16 * i], dstCount - i);
+	}
+
+	void SumQuads16_NEON(uint16_t* pDst, const uint16_t* pSrc, uint32_t dstCount)
+	{
+		for (auto i = 0u; i < dstCount; ++i)
+		{
+			const auto s = vaddq_u16(vld1q_u16(&pSrc[16 * i]), vld1q_u16(&pSrc[16 * i + 8]));
+			vst1_u16(&pDst[4 * i], vadd_u16(vget_low_u16(s), vget_high_u16(s)));
+		}
+	}
+
+	void RoundSums16_NEON(uint8_t* pDst, const uint16_t* pSrc, uint32_t count, uint32_t shift)
+	{
+		// Rounding shift right, without overflow
+		const auto shiftRight = vdupq_n_s16(static_cast<int16_t>(-static_cast<int>(shift)));
+
+		auto i = 0u;
+		for (; i + 4 <= count; i += 4)
+		{
+			const auto lo = vrshlq_u16(vld1q_u16(&pSrc[4 * i]), shiftRight);
+			const auto hi = vrshlq_u16(vld1q_u16(&pSrc[4 * i + 8]), shiftRight);
+			vst1q_u8(&pDst[4 * i], vcombine_u8(vmovn_u16(lo), vmovn_u16(hi)));
+		}
+
+		RoundSums16_Scalar(&pDst[4 * i], &pSrc[4 * i], count - i, shift);
+	}
+
+	void BoxRowRGBA8_NEON(uint8_t* pDst, const uint8_t* const* ppRows, const float* pRowWeights,
+		uint32_t numRows, uint32_t x0, uint32_t x1, uint32_t srcWidth)
+	{
+		const auto half = vdupq_n_f32(0.5f);
+		const auto maxVal = vdupq_n_f32(255.0f);
+
+		for (auto x = x0; x < x1; ++x)
+		{
+			float weights[3];
+			const auto numTaps = GetBoxTaps(x, srcWidth, weights);
+			const auto offset = 8 * (x - x0);
+
+			// Separate multiply and add, to match the scalar rounding
+			auto sum = vdupq_n_f32(0.0f);
+			for (auto r = 0u; r < numRows; ++r)
+				for (auto t = 0u; t < numTaps; ++t)
+				{
+					uint32_t texel;
+					memcpy(&texel, &ppRows[r][offset + 4 * t], sizeof(uint32_t));
+					const auto value = vcvtq_f32_u32(vmovl_u16(vget_low_u16(vmovl_u8(vreinterpret_u8_u32(vdup_n_u32(texel))))));
+					sum = vaddq_f32(sum, vmulq_n_f32(value, pRowWeights[r] * weights[t]));
+				}
+
+			const auto result = vmovn_u32(vcvtq_u32_f32(vminq_f32(vaddq_f32(sum, half), maxVal)));
+			const auto texel = vget_lane_u32(vreinterpret_u32_u8(vmovn_u16(vcombine_u16(result, result))), 0);
+			memcpy(&pDst[4 * (x - x0)], &texel, sizeof(uint32_t));
+		}
+	}
+
+	void FilterRowRGBA8_NEON(float* pDst, const uint8_t* pSrc, uint32_t srcX0,
+		const uint32_t* pFirst, const float* pWeights, uint32_t numTaps, uint32_t count)
+	{
+		for (auto i = 0u; i < count; ++i)
+		{
+			const auto pTexels = &pSrc[4 * (pFirst[i] - srcX0)];
+			const auto pTexelWeights = &pWeights[numTaps * i];
+			float32x4_t sums[2] = { vdupq_n_f32(0.0f), vdupq_n_f32(0.0f) };
+			for (auto t = 0u; t < numTaps; ++t)
+			{
+				uint32_t texel;
+				memcpy(&texel, &pTexels[4 * t], sizeof(uint32_t));
+				const auto value = vcvtq_f32_u32(vmovl_u16(vget_low_u16(vmovl_u8(vreinterpret_u8_u32(vdup_n_u32(texel))))));
+				sums[t & 1] = vaddq_f32(sums[t & 1], vmulq_n_f32(value, pTexelWeights[t]));
+			}
+			vst1q_f32(&pDst[4 * i], vaddq_f32(sums[0], sums[1]));
+		}
+	}
+
+	void FilterColumnsRGBA8_NEON(uint8_t* pDst, const float* const* ppRows, const float* pWeights,
+		uint32_t numTaps, uint32_t count)
+	{
+		const auto zero = vdupq_n_f32(0.0f);
+		const auto maxVal = vdupq_n_f32(255.0f);
+		const auto half = vdupq_n_f32(0.5f);
+
+		auto i = 0u;
+		for (; i + 4 <= count; i += 4)
+		{
+			uint16x4_t results[4];
+			for (auto j = 0u; j < 4; ++j)
+			{
+				auto sum = vdupq_n_f32(0.0f);
+				for (auto t = 0u; t < numTaps; ++t)
+					sum = vaddq_f32(sum, vmulq_n_f32(vld1q_f32(&ppRows[t][4 * (i + j)]), pWeights[t]));
+				results[j] = vmovn_u32(vcvtq_u32_f32(vaddq_f32(vminq_f32(vmaxq_f32(sum, zero), maxVal), half)));
+			}
+
+			const auto lo = vmovn_u16(vcombine_u16(results[0], results[1]));
+			const auto hi = vmovn_u16(vcombine_u16(results[2], results[3]));
+			vst1q_u8(&pDst[4 * i], vcombine_u8(lo, hi));
+		}
+
+		const float* ppTailRows[MaxFilterTaps];
+		for (auto t = 0u; t < numTaps; ++t) ppTailRows[t] = &ppRows[t][4 * i];
+		FilterColumnsRGBA8_Scalar(&pDst[4 * i], ppTailRows, pWeights, numTaps, count - i);
+	}
+
+	void ScaleAlphaRGBA8_NEON(uint8_t* pData, uint32_t count, uint32_t scale)
+	{
+		const auto colorMask = vdupq_n_u32(0x00ffffff);
+		const auto maxVal = vdupq_n_u32(255);
+
+		auto i = 0u;
+		for (; i + 4 <= count; i += 4)
+		{
+			const auto texels = vld1q_u32(reinterpret_cast<const uint32_t*>(&pData[4 * i]));
+			const auto alpha = vminq_u32(vrshrq_n_u32(vmulq_n_u32(vshrq_n_u32(texels, 24), scale), 16), maxVal);
+			const auto result = vorrq_u32(vandq_u32(texels, colorMask), vshlq_n_u32(alpha, 24));
+			vst1q_u32(reinterpret_cast<uint32_t*>(&pData[4 * i]), result);
+		}
+
+		ScaleAlphaRGBA8_Scalar(&pData[4 * i], count - i, scale);
+	}
+
+	//--------------------------------------------------------------------------------------
+	// NEON, levels of fewer channels, as the SSE4.1 ones
+	//--------------------------------------------------------------------------------------
+	template<typename T> struct UnormLanes;
+
+	template<> struct UnormLanes<uint8_t>
+	{
+		typedef uint8x16_t Vec;
+		typedef uint16x8_t Wide;
+
+		static Vec Load(const uint8_t* pSrc) { return vld1q_u8(pSrc); }
+		static Wide WidenLo(Vec v) { return vmovl_u8(vget_low_u8(v)); }
+		static Wide WidenHi(Vec v) { return vmovl_u8(vget_high_u8(v)); }
+		static Wide Add(Wide a, Wide b) { return vaddq_u16(a, b); }
+
+		static void StoreAverage(uint8_t* pDst, Wide lo, Wide hi)
+		{
+			vst1q_u8(pDst, vcombine_u8(vrshrn_n_u16(lo, 2), vrshrn_n_u16(hi, 2)));
+		}
+	};
+
+	template<> struct UnormLanes<uint16_t>
+	{
+		typedef uint16x8_t Vec;
+		typedef uint32x4_t Wide;
+
+		static Vec Load(const uint8_t* pSrc) { return vld1q_u16(reinterpret_cast<const uint16_t*>(pSrc)); }
+		static Wide WidenLo(Vec v) { return vmovl_u16(vget_low_u16(v)); }
+		static Wide WidenHi(Vec v) { return vmovl_u16(vget_high_u16(v)); }
+		static Wide Add(Wide a, Wide b) { return vaddq_u32(a, b); }
+
+		static void StoreAverage(uint8_t* pDst, Wide lo, Wide hi)
+		{
+			vst1q_u16(reinterpret_cast<uint16_t*>(pDst), vcombine_u16(vrshrn_n_u32(lo, 2), vrshrn_n_u32(hi, 2)));
+		}
+	};
+
+	template<uint32_t TexelBytes> struct WideTexel {};
+
+	static inline uint16x8_t PairSums(uint16x8_t a, uint16x8_t b, WideTexel<2>)
+	{
+		return vpaddq_u16(a, b);
+	}
+
+	static inline uint16x8_t PairSums(uint16x8_t a, uint16x8_t b, WideTexel<4>)
+	{
+		return vreinterpretq_u16_u32(vpaddq_u32(vreinterpretq_u32_u16(a), vreinterpretq_u32_u16(b)));
+	}
+
+	static inline uint32x4_t PairSums(uint32x4_t a, uint32x4_t b, WideTexel<4>)
+	{
+		return vpaddq_u32(a, b);
+	}
+
+	static inline uint32x4_t PairSums(uint32x4_t a, uint32x4_t b, WideTexel<8>)
+	{
+		return vreinterpretq_u32_u64(vpaddq_u64(vreinterpretq_u64_u32(a), vreinterpretq_u64_u32(b)));
+	}
+
+	template<typename T, uint8_t N>
+	void DownSampleUNORM_NEON(uint8_t* pDst, const uint8_t* pRow0, const uint8_t* pRow1, uint32_t dstWidth)
+	{
+		typedef UnormLanes<T> Lanes;
+		const WideTexel<2 * sizeof(T) * N> texel;
+		const auto texelBytes = static_cast<uint32_t>(sizeof(T) * N);
+		const auto texelsPerIter = 16 / texelBytes;
+
+		auto i = 0u;
+		for (; i + texelsPerIter <= dstWidth; i += texelsPerIter)
+		{
+			const auto pSrc0 = &pRow0[2 * texelBytes * i];
+			const auto pSrc1 = &pRow1[2 * texelBytes * i];
+			const auto a0 = Lanes::Load(pSrc0);
+			const auto b0 = Lanes::Load(pSrc0 + 16);
+			const auto a1 = Lanes::Load(pSrc1);
+			const auto b1 = Lanes::Load(pSrc1 + 16);
+
+			const auto lo = PairSums(Lanes::Add(Lanes::WidenLo(a0), Lanes::WidenLo(a1)),
+				Lanes::Add(Lanes::WidenHi(a0), Lanes::WidenHi(a1)), texel);
+			const auto hi = PairSums(Lanes::Add(Lanes::WidenLo(b0), Lanes::WidenLo(b1)),
+				Lanes::Add(Lanes::WidenHi(b0), Lanes::WidenHi(b1)), texel);
+			Lanes::StoreAverage(&pDst[texelBytes * i], lo, hi);
+		}
+
+		DownSampleUNORM_Scalar<T, N>(&pDst[texelBytes * i], &pRow0[2 * texelBytes * i],
+			&pRow1[2 * texelBytes * i], dstWidth - i);
+	}
+
+	template<typename T, uint8_t N>
+	void DownSampleQuadsUNORM_NEON(uint8_t* pDst, const uint8_t* pSrc, uint32_t dstCount)
+	{
+		typedef UnormLanes<T> Lanes;
+		const WideTexel<2 * sizeof(T) * N> texel;
+		const auto texelBytes = static_cast<uint32_t>(sizeof(T) * N);
+		const auto texelsPerIter = 16 / texelBytes;
+
+		auto i = 0u;
+		for (; i + texelsPerIter <= dstCount; i += texelsPerIter)
+		{
+			const auto pQuads = &pSrc[4 * texelBytes * i];
+			typename Lanes::Wide pairs[4];
+			for (auto j = 0u; j < 4; ++j)
+			{
+				const auto quads = Lanes::Load(pQuads + 16 * j);
+				pairs[j] = PairSums(Lanes::WidenLo(quads), Lanes::WidenHi(quads), texel);
+			}
+
+			Lanes::StoreAverage(&pDst[texelBytes * i], PairSums(pairs[0], pairs[1], texel), PairSums(pairs[2], pairs[3], texel));
+		}
+
+		DownSampleQuadsUNORM_Scalar<T, N>(&pDst[texelBytes * i], &pSrc[4 * texelBytes * i], dstCount - i);
+	}
+
+	template void DownSampleUNORM_NEON<uint8_t, 1>(uint8_t*, const uint8_t*, const uint8_t*, uint32_t);
+	template void DownSampleUNORM_NEON<uint8_t, 2>(uint8_t*, const uint8_t*, const uint8_t*, uint32_t);
+	template void DownSampleUNORM_NEON<uint16_t, 1>(uint8_t*, const uint8_t*, const uint8_t*, uint32_t);
+	template void DownSampleUNORM_NEON<uint16_t, 2>(uint8_t*, const uint8_t*, const uint8_t*, uint32_t);
+	template void DownSampleQuadsUNORM_NEON<uint8_t, 1>(uint8_t*, const uint8_t*, uint32_t);
+	template void DownSampleQuadsUNORM_NEON<uint8_t, 2>(uint8_t*, const uint8_t*, uint32_t);
+	template void DownSampleQuadsUNORM_NEON<uint16_t, 1>(uint8_t*, const uint8_t*, uint32_t);
+	template void DownSampleQuadsUNORM_NEON<uint16_t, 2>(uint8_t*, const uint8_t*, uint32_t);
+
+	// 8 destination texels per iteration of R8G8B8, deinterleaved by vld3q_u8()
+	void DownSampleRGB8_NEON(uint8_t* pDst, const uint8_t* pRow0, const uint8_t* pRow1, uint32_t dstWidth)
+	{
+		auto i = 0u;
+		for (; i + 8 <= dstWidth; i += 8)
+		{
+			const auto rgb0 = vld3q_u8(&pRow0[6 * i]);
+			const auto rgb1 = vld3q_u8(&pRow1[6 * i]);
+
+			uint8x8x3_t result;
+			for (uint8_t c = 0; c < 3; ++c)
+				result.val[c] = vrshrn_n_u16(vpadalq_u8(vpaddlq_u8(rgb0.val[c]), rgb1.val[c]), 2);
+			vst3_u8(&pDst[3 * i], result);
+		}
+
+		DownSampleUNORM_Scalar<uint8_t, 3>(&pDst[3 * i], &pRow0[6 * i], &pRow1[6 * i], dstWidth - i);
+	}
+
+	void DownSampleQuadsRGB8_NEON(uint8_t* pDst, const uint8_t* pSrc, uint32_t dstCount)
+	{
+		auto i = 0u;
+		for (; i + 8 <= dstCount; i += 8)
+		{
+			const auto quads0 = vld3q_u8(&pSrc[12 * i]);
+			const auto quads1 = vld3q_u8(&pSrc[12 * i + 48]);
+
+			uint8x8x3_t result;
+			for (uint8_t c = 0; c < 3; ++c)
+				result.val[c] = vrshrn_n_u16(vpaddq_u16(vpaddlq_u8(quads0.val[c]), vpaddlq_u8(quads1.val[c])), 2);
+			vst3_u8(&pDst[3 * i], result);
+		}
+
+		DownSampleQuadsUNORM_Scalar<uint8_t, 3>(&pDst[3 * i], &pSrc[12 * i], dstCount - i);
+	}
+
+	//--------------------------------------------------------------------------------------
+	// NEON, 16-bit levels, 2 destination texels per iteration
+	//--------------------------------------------------------------------------------------
+	void DownSampleRGBA16_NEON(uint16_t* pDst, const uint16_t* pRow0, const uint16_t* pRow1, uint32_t dstWidth)
+	{
+		auto i = 0u;
+		for (; i + 2 <= dstWidth; i += 2)
+		{
+			// Even and odd texels of each row
+			const auto r0 = vld2q_u64(reinterpret_cast<const uint64_t*>(&pRow0[8 * i]));
+			const auto r1 = vld2q_u64(reinterpret_cast<const uint64_t*>(&pRow1[8 * i]));
+			const auto e0 = vreinterpretq_u16_u64(r0.val[0]);
+			const auto o0 = vreinterpretq_u16_u64(r0.val[1]);
+			const auto e1 = vreinterpretq_u16_u64(r1.val[0]);
+			const auto o1 = vreinterpretq_u16_u64(r1.val[1]);
+
+			auto lo = vaddl_u16(vget_low_u16(e0), vget_low_u16(o0));
+			auto hi = vaddl_u16(vget_high_u16(e0), vget_high_u16(o0));
+			lo = vaddq_u32(lo, vaddl_u16(vget_low_u16(e1), vget_low_u16(o1)));
+			hi = vaddq_u32(hi, vaddl_u16(vget_high_u16(e1), vget_high_u16(o1)));
+
+			vst1q_u16(&pDst[4 * i], vcombine_u16(vrshrn_n_u32(lo, 2), vrshrn_n_u32(hi, 2)));
+		}
+
+		DownSampleRGBA16_Scalar(&pDst[4 * i], &pRow0[8 * i], &pRow1[8 * i], dstWidth - i);
+	}
+
+	void DownSampleQuadsRGBA16_NEON(uint16_t* pDst, const uint16_t* pSrc, uint32_t dstCount)
+	{
+		auto i = 0u;
+		for (; i + 2 <= dstCount; i += 2)
+		{
+			// De-interleave the k-th texels of 2 quads
+			const auto q = vld4q_u64(reinterpret_cast<const uint64_t*>(&pSrc[16 * i]));
+			const auto t0 = vreinterpretq_u16_u64(q.val[0]);
+			const auto t1 = vreinterpretq_u16_u64(q.val[1]);
+			const auto t2 = vreinterpretq_u16_u64(q.val[2]);
+			const auto t3 = vreinterpretq_u16_u64(q.val[3]);
+
+			auto lo = vaddl_u16(vget_low_u16(t0), vget_low_u16(t1));
+			auto hi = vaddl_u16(vget_high_u16(t0), vget_high_u16(t1));
+			lo = vaddq_u32(lo, vaddl_u16(vget_low_u16(t2), vget_low_u16(t3)));
+			hi = vaddq_u32(hi, vaddl_u16(vget_high_u16(t2), vget_high_u16(t3)));
+
+			vst1q_u16(&pDst[4 * i], vcombine_u16(vrshrn_n_u32(lo, 2), vrshrn_n_u32(hi, 2)));
+		}
+
+		DownSampleQuadsRGBA16_Scalar(&pDst[4 * i], &pSrc[16 * i], dstCount - i);
+	}
+
+	//--------------------------------------------------------------------------------------
+	// NEON, floating-point levels, 1 destination texel per iteration
+	//--------------------------------------------------------------------------------------
+	void FloatToHalf_NEON(uint16_t* pDst, const float* pSrc, uint32_t count)
+	{
+		auto i = 0u;
+		for (; i + 4 <= count; i += 4) vst1_u16(&pDst[i], vreinterpret_u16_f16(vcvt_f16_f32(vld1q_f32(&pSrc[i]))));
+
+		FloatToHalf_Scalar(&pDst[i], &pSrc[i], count - i);
+	}
+
+	void HalfToFloat_NEON(float* pDst, const uint16_t* pSrc, uint32_t count)
+	{
+		auto i = 0u;
+		for (; i + 4 <= count; i += 4) vst1q_f32(&pDst[i], vcvt_f32_f16(vreinterpret_f16_u16(vld1_u16(&pSrc[i]))));
+
+		HalfToFloat_Scalar(&pDst[i], &pSrc[i], count - i);
+	}
+
+	// Texels p00, p10, p01 and p11 of a footprint, in the order of the scalar sum
+	static inline float32x4_t Average2x2F32(float32x4_t p00, float32x4_t p10, float32x4_t p01, float32x4_t p11)
+	{
+		return vmulq_n_f32(vaddq_f32(vaddq_f32(p00, p10), vaddq_f32(p01, p11)), 0.25f);
+	}
+
+	static inline float32x4_t LoadHalf4(const uint16_t* pSrc)
+	{
+		return vcvt_f32_f16(vreinterpret_f16_u16(vld1_u16(pSrc)));
+	}
+
+	void DownSampleRGBA32F_NEON(float* pDst, const float* pRow0, const float* pRow1, uint32_t dstWidth)
+	{
+		for (auto i = 0u; i < dstWidth; ++i)
+			vst1q_f32(&pDst[4 * i], Average2x2F32(vld1q_f32(&pRow0[8 * i]), vld1q_f32(&pRow1[8 * i]),
+				vld1q_f32(&pRow0[8 * i + 4]), vld1q_f32(&pRow1[8 * i + 4])));
+	}
+
+	void DownSampleQuadsRGBA32F_NEON(float* pDst, const float* pSrc, uint32_t dstCount)
+	{
+		for (auto i = 0u; i < dstCount; ++i)
+			vst1q_f32(&pDst[4 * i], Average2x2F32(vld1q_f32(&pSrc[16 * i]), vld1q_f32(&pSrc[16 * i + 8]),
+				vld1q_f32(&pSrc[16 * i + 4]), vld1q_f32(&pSrc[16 * i + 12])));
+	}
+
+	void DownSampleRGBA16F_NEON(uint16_t* pDst, const uint16_t* pRow0, const uint16_t* pRow1, uint32_t dstWidth)
+	{
+		for (auto i = 0u; i < dstWidth; ++i)
+		{
+			const auto result = Average2x2F32(LoadHalf4(&pRow0[8 * i]), LoadHalf4(&pRow1[8 * i]),
+				LoadHalf4(&pRow0[8 * i + 4]), LoadHalf4(&pRow1[8 * i + 4]));
+			vst1_u16(&pDst[4 * i], vreinterpret_u16_f16(vcvt_f16_f32(result)));
+		}
+	}
+
+	void DownSampleQuadsRGBA16F_NEON(uint16_t* pDst, const uint16_t* pSrc, uint32_t dstCount)
+	{
+		for (auto i = 0u; i < dstCount; ++i)
+		{
+			const auto result = Average2x2F32(LoadHalf4(&pSrc[16 * i]), LoadHalf4(&pSrc[16 * i + 8]),
+				LoadHalf4(&pSrc[16 * i + 4]), LoadHalf4(&pSrc[16 * i + 12]));
+			vst1_u16(&pDst[4 * i], vreinterpret_u16_f16(vcvt_f16_f32(result)));
+		}
+	}
+
+	//--------------------------------------------------------------------------------------
+	// NEON match lengths, 16 bytes per iteration
+	//--------------------------------------------------------------------------------------
+	uint32_t MatchLength_NEON(const uint8_t* pA, const uint8_t* pB, uint32_t maxLength)
+	{
+		auto length = 0u;
+		for (; length + 16 <= maxLength; length += 16)
+		{
+			// A nibble per byte, set where the bytes differ
+			const auto equal = vceqq_u8(vld1q_u8(&pA[length]), vld1q_u8(&pB[length]));
+			const auto nibbles = vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(equal), 4));
+			const auto mismatches = ~vget_lane_u64(nibbles, 0);
+			if (mismatches) return length + LowestBit(mismatches) / 4;
+		}
+
+		return length + MatchLength_Scalar(&pA[length], &pB[length], maxLength - length);
+	}
+
+	//--------------------------------------------------------------------------------------
+	// NEON PNG unfiltering, as the SSE2 ones
+	//--------------------------------------------------------------------------------------
+	template<uint32_t Bpp>
+	static inline uint8x8_t LoadPixel(const uint8_t* pSrc)
+	{
+		if (Bpp == 8) return vld1_u8(pSrc);
+
+		uint32_t lo;
+		if (Bpp == 3) lo = pSrc[0] | (pSrc[1] << 8) | (pSrc[2] << 16);
+		else memcpy(&lo, pSrc, sizeof(uint32_t));
+		const auto hi = Bpp == 6 ? pSrc[4] | (pSrc[5] << 8) : 0u;
+
+		return vcreate_u8(lo | (static_cast<uint64_t>(hi) << 32));
+	}
+
+	template<uint32_t Bpp>
+	static inline void StorePixel(uint8_t* pDst, uint8x8_t pixel)
+	{
+		if (Bpp == 8) vst1_u8(pDst, pixel);
+		else if (Bpp == 4) vst1_lane_u32(reinterpret_cast<uint32_t*>(pDst), vreinterpret_u32_u8(pixel), 0);
+		else
+		{
+			const auto bytes = vget_lane_u64(vreinterpret_u64_u8(pixel), 0);
+			memcpy(pDst, &bytes, Bpp);
+		}
+	}
+
+	template<uint32_t Bpp>
+	static void UnfilterSubPixels_NEON(uint8_t* pDst, const uint8_t* pSrc, uint32_t rowBytes)
+	{
+		auto a = vdup_n_u8(0);
+		for (auto i = 0u; i < rowBytes; i += Bpp)
+		{
+			a = vadd_u8(LoadPixel<Bpp>(&pSrc[i]), a);
+			StorePixel<Bpp>(&pDst[i], a);
+		}
+	}
+
+	template<uint32_t Bpp>
+	static void UnfilterAveragePixels_NEON(uint8_t* pDst, const uint8_t* pSrc, const uint8_t* pPrior, uint32_t rowBytes)
+	{
+		auto a = vdup_n_u8(0);
+		for (auto i = 0u; i < rowBytes; i += Bpp)
+		{
+			a = vadd_u8(LoadPixel<Bpp>(&pSrc[i]), vhadd_u8(a, LoadPixel<Bpp>(&pPrior[i])));
+			StorePixel<Bpp>(&pDst[i], a);
+		}
+	}
+
+	template<uint32_t Bpp>
+	static void UnfilterPaethPixels_NEON(uint8_t* pDst, const uint8_t* pSrc, const uint8_t* pPrior, uint32_t rowBytes)
+	{
+		auto a = vdup_n_u8(0), c = vdup_n_u8(0);
+		for (auto i = 0u; i < rowBytes; i += Bpp)
+		{
+			const auto b = LoadPixel<Bpp>(&pPrior[i]);
+			const auto pa = vmovl_u8(vabd_u8(b, c));
+			const auto pb = vmovl_u8(vabd_u8(a, c));
+			const auto pc = vabdq_u16(vaddl_u8(a, b), vshll_n_u8(c, 1));
+			const auto useA = vmovn_u16(vandq_u16(vcleq_u16(pa, pb), vcleq_u16(pa, pc)));
+			const auto useB = vmovn_u16(vcleq_u16(pb, pc));
+			const auto predictor = vbsl_u8(useA, a, vbsl_u8(useB, b, c));
+
+			a = vadd_u8(LoadPixel<Bpp>(&pSrc[i]), predictor);
+			StorePixel<Bpp>(&pDst[i], a);
+			c = b;
+		}
+	}
+
+	void UnfilterSub_NEON(uint8_t* pDst, const uint8_t* pSrc, const uint8_t* pPrior, uint32_t rowBytes, uint32_t bpp)
+	{
+		switch (bpp)
+		{
+		case 3: UnfilterSubPixels_NEON<3>(pDst, pSrc, rowBytes); break;
+		case 4: UnfilterSubPixels_NEON<4>(pDst, pSrc, rowBytes); break;
+		case 6: UnfilterSubPixels_NEON<6>(pDst, pSrc, rowBytes); break;
+		case 8: UnfilterSubPixels_NEON<8>(pDst, pSrc, rowBytes); break;
+		default: UnfilterSub_Scalar(pDst, pSrc, pPrior, rowBytes, bpp);
+		}
+	}
+
+	void UnfilterUp_NEON(uint8_t* pDst, const uint8_t* pSrc, const uint8_t* pPrior, uint32_t rowBytes, uint32_t bpp)
+	{
+		auto i = 0u;
+		for (; i + 16 <= rowBytes; i += 16) vst1q_u8(&pDst[i], vaddq_u8(vld1q_u8(&pSrc[i]), vld1q_u8(&pPrior[i])));
+
+		UnfilterUp_Scalar(&pDst[i], &pSrc[i], &pPrior[i], rowBytes - i, bpp);
+	}
+
+	void UnfilterAverage_NEON(uint8_t* pDst, const uint8_t* pSrc, const uint8_t* pPrior, uint32_t rowBytes, uint32_t bpp)
+	{
+		switch (bpp)
+		{
+		case 3: UnfilterAveragePixels_NEON<3>(pDst, pSrc, pPrior, rowBytes); break;
+		case 4: UnfilterAveragePixels_NEON<4>(pDst, pSrc, pPrior, rowBytes); break;
+		case 6: UnfilterAveragePixels_NEON<6>(pDst, pSrc, pPrior, rowBytes); break;
+		case 8: UnfilterAveragePixels_NEON<8>(pDst, pSrc, pPrior, rowBytes); break;
+		default: UnfilterAverage_Scalar(pDst, pSrc, pPrior, rowBytes, bpp);
+		}
+	}
+
+	void UnfilterPaeth_NEON(uint8_t* pDst, const uint8_t* pSrc, const uint8_t* pPrior, uint32_t rowBytes, uint32_t bpp)
+	{
+		switch (bpp)
+		{
+		case 3: UnfilterPaethPixels_NEON<3>(pDst, pSrc, pPrior, rowBytes); break;
+		case 4: UnfilterPaethPixels_NEON<4>(pDst, pSrc, pPrior, rowBytes); break;
+		case 6: UnfilterPaethPixels_NEON<6>(pDst, pSrc, pPrior, rowBytes); break;
+		case 8: UnfilterPaethPixels_NEON<8>(pDst, pSrc, pPrior, rowBytes); break;
+		default: UnfilterPaeth_Scalar(pDst, pSrc, pPrior, rowBytes, bpp);
+		}
+	}
+#endif
+
+	//--------------------------------------------------------------------------------------
+	// Runtime dispatch
+	//--------------------------------------------------------------------------------------
+#ifdef MIP_KERNELS_X86
+	static void CpuId(int leaf, int subLeaf, uint32_t regs[4])
+	{
+#ifdef _MSC_VER
+		__cpuidex(reinterpret_cast<int*>(regs), leaf, subLeaf);
+#else
+		if (!__get_cpuid_count(leaf, subLeaf, &regs[0], &regs[1], &regs[2], &regs[3]))
+			regs[0] = regs[1] = regs[2] = regs[3] = 0;
+#endif
+	}
+
+	// Register states enabled by the OS in XCR0
+	static uint64_t GetXCR0()
+	{
+#ifdef _MSC_VER
+		return _xgetbv(0);
+#else
+		uint32_t lo, hi;
+		__asm__ __volatile__("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+
+		return (static_cast<uint64_t>(hi) << 32) | lo;
+#endif
+	}
+#endif
+
+	static uint32_t DetectCpuFeatures()
+	{
+		uint32_t features = 0;
+
+#if defined(MIP_KERNELS_X86)
+		uint32_t regs[4];
+		CpuId(0, 0, regs);
+		const auto maxLeaf = regs[0];
+		const auto isAMD = regs[1] == 0x68747541 && regs[3] == 0x69746e65 && regs[2] == 0x444d4163;	// "AuthenticAMD"
+
+		CpuId(1, 0, regs);
+		const auto family = ((regs[0] >> 8) & 0xf) + ((regs[0] >> 20) & 0xff);
+		const auto ecx1 = regs[2];
+		if (regs[3] & (1 << 26)) features |= CPU_SSE2;
+		if (ecx1 & (1 << 19)) features |= CPU_SSE41;
+
+		// YMM (SSE and AVX) and ZMM (opmask, ZMM_Hi256 and Hi16_ZMM) states
+		const auto osxsave = (ecx1 & (1 << 27)) != 0;
+		const auto xcr0 = osxsave ? GetXCR0() : 0;
+		const auto osAVX = (xcr0 & 0x06) == 0x06;
+		const auto osAVX512 = (xcr0 & 0xe6) == 0xe6;
+		if (osAVX && (ecx1 & (1 << 28)) && (ecx1 & (1 << 29))) features |= CPU_F16C;
+
+		if (maxLeaf >= 7)
+		{
+			CpuId(7, 0, regs);
+			const auto ebx7 = regs[1];
+			if (osAVX && (ebx7 & (1 << 5))) features |= CPU_AVX2;
+			if (osAVX512 && (ebx7 & (1 << 16)) && (ebx7 & (1u << 30))) features |= CPU_AVX512BW;
+			if (ebx7 & (1 << 8)) features |= CPU_BMI2;
+		}
+
+		// PDEP and PEXT are microcoded before Zen 3 (family 19h)
+		if (isAMD && family < 0x19) features |= CPU_SLOW_PDEP;
+#elif defined(MIP_KERNELS_NEON)
+		// Advanced SIMD is mandatory on AArch64, and a build target on ARMv7
+		features |= CPU_NEON;
+#endif
+
+		return features;
+	}
+
+	uint32_t GetCpuFeatures()
+	{
+		static const auto features = DetectCpuFeatures();
+
+		return features;
+	}
+
+	static KernelTable BindKernels(Isa maxIsa)
+	{
+		const auto features = GetCpuFeatures();
+		const auto supports = [&](Isa isa, uint32_t required) { return isa <= maxIsa && (features & required) == required; };
+
+		KernelTable kernels = { ISA_SCALAR, DownSampleRGBA8_Scalar, DownSampleQuadsRGBA8_Scalar, SumRowRGBA8_Scalar,
+			SumQuadsRGBA8_Scalar, SumQuads16_Scalar, RoundSums16_Scalar, BoxRowRGBA8_Scalar, DownSampleSRGBA8_Scalar,
+			DownSampleQuadsSRGBA8_Scalar, DownSamplePremulRGBA8_Scalar, DownSampleQuadsPremulRGBA8_Scalar,
+			DownSampleNormalsRGBA8_Scalar, DownSampleQuadsNormalsRGBA8_Scalar, FilterRowRGBA8_Scalar,
+			FilterColumnsRGBA8_Scalar, ScaleAlphaRGBA8_Scalar, DownSampleUNORM_Scalar<uint8_t, 1>,
+			DownSampleQuadsUNORM_Scalar<uint8_t, 1>, DownSampleUNORM_Scalar<uint8_t, 2>, DownSampleQuadsUNORM_Scalar<uint8_t, 2>,
+			DownSampleUNORM_Scalar<uint8_t, 3>, DownSampleQuadsUNORM_Scalar<uint8_t, 3>,
+			DownSampleUNORM_Scalar<uint16_t, 1>, DownSampleQuadsUNORM_Scalar<uint16_t, 1>, DownSampleUNORM_Scalar<uint16_t, 2>,
+			DownSampleQuadsUNORM_Scalar<uint16_t, 2>, DownSampleRGBA16_Scalar, DownSampleQuadsRGBA16_Scalar,
+			FloatToHalf_Scalar, HalfToFloat_Scalar, DownSampleRGBA32F_Scalar, DownSampleQuadsRGBA32F_Scalar, DownSampleRGBA16F_Scalar,
+			DownSampleQuadsRGBA16F_Scalar, MortonEncode_Table, MortonDecode_Table, MatchLength_Scalar,
+			UnfilterSub_Scalar, UnfilterUp_Scalar, UnfilterAverage_Scalar, UnfilterPaeth_Scalar };
+
+#if defined(MIP_KERNELS_X86)
+		// The integer kernels need no more than SSE2
+		if (supports(ISA_SSE2, CPU_SSE2))
+		{
+			kernels.SelectedIsa = ISA_SSE2;
+			kernels.DownSampleRGBA8 = DownSampleRGBA8_SSE2;
+			kernels.DownSampleQuadsRGBA8 = DownSampleQuadsRGBA8_SSE2;
+			kernels.SumRowRGBA8 = SumRowRGBA8_SSE2;
+			kernels.SumQuadsRGBA8 = SumQuadsRGBA8_SSE2;
+			kernels.SumQuads16 = SumQuads16_SSE2;
+			kernels.RoundSums16 = RoundSums16_SSE2;
+			kernels.DownSamplePremulRGBA8 = DownSamplePremulRGBA8_SSE2;
+			kernels.DownSampleQuadsPremulRGBA8 = DownSampleQuadsPremulRGBA8_SSE2;
+			kernels.FilterColumnsRGBA8 = FilterColumnsRGBA8_SSE2;
+			kernels.MatchLength = MatchLength_SSE2;
+			kernels.UnfilterSub = UnfilterSub_SSE2;
+			kernels.UnfilterUp = UnfilterUp_SSE2;
+			kernels.UnfilterAverage = UnfilterAverage_SSE2;
+			kernels.UnfilterPaeth = UnfilterPaeth_SSE2;
+		}
+
+		if (supports(ISA_SSE41, CPU_SSE2 | CPU_SSE41))
+		{
+			kernels.SelectedIsa = ISA_SSE41;
+			kernels.BoxRowRGBA8 = BoxRowRGBA8_SSE41;
+			kernels.FilterRowRGBA8 = FilterRowRGBA8_SSE41;
+			kernels.ScaleAlphaRGBA8 = ScaleAlphaRGBA8_SSE41;
+			kernels.DownSampleR8 = DownSampleUNORM_SSE41<uint8_t, 1>;
+			kernels.DownSampleQuadsR8 = DownSampleQuadsUNORM_SSE41<uint8_t, 1>;
+			kernels.DownSampleRG8 = DownSampleUNORM_SSE41<uint8_t, 2>;
+			kernels.DownSampleQuadsRG8 = DownSampleQuadsUNORM_SSE41<uint8_t, 2>;
+			kernels.DownSampleRGB8 = DownSampleRGB8_SSE41;
+			kernels.DownSampleQuadsRGB8 = DownSampleQuadsRGB8_SSE41;
+			kernels.DownSampleR16 = DownSampleUNORM_SSE41<uint16_t, 1>;
+			kernels.DownSampleQuadsR16 = DownSampleQuadsUNORM_SSE41<uint16_t, 1>;
+			kernels.DownSampleRG16 = DownSampleUNORM_SSE41<uint16_t, 2>;
+			kernels.DownSampleQuadsRG16 = DownSampleQuadsUNORM_SSE41<uint16_t, 2>;
+			kernels.DownSampleRGBA16 = DownSampleRGBA16_SSE41;
+			kernels.DownSampleQuadsRGBA16 = DownSampleQuadsRGBA16_SSE41;
+		}
+
+		if (supports(ISA_AVX2, CPU_SSE2 | CPU_SSE41 | CPU_AVX2))
+		{
+			kernels.SelectedIsa = ISA_AVX2;
+			kernels.DownSampleRGBA8 = DownSampleRGBA8_AVX2;
+			kernels.DownSampleQuadsRGBA8 = DownSampleQuadsRGBA8_AVX2;
+			kernels.DownSampleSRGBA8 = DownSampleSRGBA8_AVX2;
+			kernels.DownSampleQuadsSRGBA8 = DownSampleQuadsSRGBA8_AVX2;
+			kernels.DownSamplePremulRGBA8 = DownSamplePremulRGBA8_AVX2;
+			kernels.DownSampleQuadsPremulRGBA8 = DownSampleQuadsPremulRGBA8_AVX2;
+			kernels.DownSampleNormalsRGBA8 = DownSampleNormalsRGBA8_AVX2;
+			kernels.DownSampleQuadsNormalsRGBA8 = DownSampleQuadsNormalsRGBA8_AVX2;
+			kernels.FilterRowRGBA8 = FilterRowRGBA8_AVX2;
+			kernels.FilterColumnsRGBA8 = FilterColumnsRGBA8_AVX2;
+			kernels.DownSampleRGBA16 = DownSampleRGBA16_AVX2;
+			kernels.DownSampleQuadsRGBA16 = DownSampleQuadsRGBA16_AVX2;
+			kernels.DownSampleRGBA32F = DownSampleRGBA32F_AVX2;
+			kernels.DownSampleQuadsRGBA32F = DownSampleQuadsRGBA32F_AVX2;
+			kernels.MatchLength = MatchLength_AVX2;
+
+			if (features & CPU_F16C)
+			{
+				kernels.FloatToHalf = FloatToHalf_F16C;
+				kernels.HalfToFloat = HalfToFloat_F16C;
+				kernels.DownSampleRGBA16F = DownSampleRGBA16F_F16C;
+				kernels.DownSampleQuadsRGBA16F = DownSampleQuadsRGBA16F_F16C;
+			}
+
+			if ((features & CPU_BMI2) && !(features & CPU_SLOW_PDEP))
+			{
+				kernels.MortonEncode = MortonEncode_BMI2;
+				kernels.MortonDecode = MortonDecode_BMI2;
+			}
+		}
+
+		if (supports(ISA_AVX512BW, CPU_SSE2 | CPU_SSE41 | CPU_AVX2 | CPU_AVX512BW))
+		{
+			kernels.SelectedIsa = ISA_AVX512BW;
+			kernels.DownSampleRGBA8 = DownSampleRGBA8_AVX512;
+		}
+#elif defined(MIP_KERNELS_NEON)
+		if (supports(ISA_NEON, CPU_NEON))
+		{
+			kernels.SelectedIsa = ISA_NEON;
+			kernels.DownSampleRGBA8 = DownSampleRGBA8_NEON;
+			kernels.DownSampleQuadsRGBA8 = DownSampleQuadsRGBA8_NEON;
+			kernels.SumRowRGBA8 = SumRowRGBA8_NEON;
+			kernels.SumQuadsRGBA8 = SumQuadsRGBA8_NEON;
+			kernels.SumQuads16 = SumQuads16_NEON;
+			kernels.RoundSums16 = RoundSums16_NEON;
+			kernels.BoxRowRGBA8 = BoxRowRGBA8_NEON;
+			kernels.FilterRowRGBA8 = FilterRowRGBA8_NEON;
+			kernels.FilterColumnsRGBA8 = FilterColumnsRGBA8_NEON;
+			kernels.ScaleAlphaRGBA8 = ScaleAlphaRGBA8_NEON;
+			kernels.DownSampleR8 = DownSampleUNORM_NEON<uint8_t, 1>;
+			kernels.DownSampleQuadsR8 = DownSampleQuadsUNORM_NEON<uint8_t, 1>;
+			kernels.DownSampleRG8 = DownSampleUNORM_NEON<uint8_t, 2>;
+			kernels.DownSampleQuadsRG8 = DownSampleQuadsUNORM_NEON<uint8_t, 2>;
+			kernels.DownSampleRGB8 = DownSampleRGB8_NEON;
+			kernels.DownSampleQuadsRGB8 = DownSampleQuadsRGB8_NEON;
+			kernels.DownSampleR16 = DownSampleUNORM_NEON<uint16_t, 1>;
+			kernels.DownSampleQuadsR16 = DownSampleQuadsUNORM_NEON<uint16_t, 1>;
+			kernels.DownSampleRG16 = DownSampleUNORM_NEON<uint16_t, 2>;
+			kernels.DownSampleQuadsRG16 = DownSampleQuadsUNORM_NEON<uint16_t, 2>;
+			kernels.DownSampleRGBA16 = DownSampleRGBA16_NEON;
+			kernels.DownSampleQuadsRGBA16 = DownSampleQuadsRGBA16_NEON;
+			kernels.FloatToHalf = FloatToHalf_NEON;
+			kernels.HalfToFloat = HalfToFloat_NEON;
+			kernels.DownSampleRGBA32F = DownSampleRGBA32F_NEON;
+			kernels.DownSampleQuadsRGBA32F = DownSampleQuadsRGBA32F_NEON;
+			kernels.DownSampleRGBA16F = DownSampleRGBA16F_NEON;
+			kernels.DownSampleQuadsRGBA16F = DownSampleQuadsRGBA16F_NEON;
+			kernels.MatchLength = MatchLength_NEON;
+			kernels.UnfilterSub = UnfilterSub_NEON;
+			kernels.UnfilterUp = UnfilterUp_NEON;
+			kernels.UnfilterAverage = UnfilterAverage_NEON;
+			kernels.UnfilterPaeth = UnfilterPaeth_NEON;
+		}
+#endif
+
+		return kernels;
+	}
+
+	static KernelTable& GetKernelTable()
+	{
+		static auto kernels = BindKernels(NUM_ISA);
+
+		return kernels;
+	}
+
+	const KernelTable& GetKernels()
+	{
+		return GetKernelTable();
+	}
+
+	void SelectKernels(Isa maxIsa)
+	{
+		GetKernelTable() = BindKernels(maxIsa);
+	}
+
+	const char* GetIsaName(Isa isa)
+	{
+		static const char* const names[] = { "Scalar", "SSE2", "SSE4.1", "AVX2", "AVX-512BW", "NEON" };
+		static_assert(sizeof(names) / sizeof(names[0]) == NUM_ISA, "Missing ISA names");
+
+		return isa < NUM_ISA ? names[isa] : "Unknown";
+	}
+}
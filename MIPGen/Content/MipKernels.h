@@ -0,0 +1,506 @@
+//--------------------------------------------------------------------------------------
+// Copyright (c) XU, Tianchen. All rights reserved.
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+#include <vector>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define MIP_KERNELS_X86
+#elif defined(_M_ARM64) || defined(__aarch64__) || defined(__ARM_NEON)
+#define MIP_KERNELS_NEON
+#endif
+
+//--------------------------------------------------------------------------------------
+// CPU kernels of the MIP-map generation
+//--------------------------------------------------------------------------------------
+namespace MipKernels
+{
+	inline float UNORM8ToFloat(uint8_t val)
+	{
+		return static_cast<float>(val) / 255;
+	}
+
+	inline uint8_t FloatToUNORM8(float val)
+	{
+		return static_cast<uint8_t>(floorf((std::min)((std::max)(val, 0.0f), 1.0f) * 255 + 0.5f));
+	}
+
+	// Bilinear footprint with clamp of the destination texel center i, as Blit2D() in
+	// Blit2D.hlsli samples: returns the weight of i1.
+	float SampleCoord(uint32_t i, uint32_t dstSize, uint32_t srcSize, uint32_t& i0, uint32_t& i1);
+
+	// Bilinear blend of the R8G8B8A8_UNORM texels p00, p01 (along x), p10 and p11 (along y)
+	void BlendTexelsRGBA8(uint8_t* pDst, const uint8_t* p00, const uint8_t* p01,
+		const uint8_t* p10, const uint8_t* p11, float wx, float wy);
+
+	// Texels [x0, x1) of a destination row of the bilinear blit, from the source rows
+	// pRow0 and pRow1 (starting at texel 0) weighted by wy. pDst points to texel x0.
+	void BlitRowRGBA8(uint8_t* pDst, const uint8_t* pRow0, const uint8_t* pRow1, float wy,
+		uint32_t x0, uint32_t x1, uint32_t srcWidth, uint32_t dstWidth);
+
+	// 2x2 box reduction of R8G8B8A8_UNORM, DownSample() in CSGenerateMips.hlsl.
+	// Turns the source rows pRow0 and pRow1 (2 * dstWidth texels each) into one
+	// destination row, with the average rounded to nearest: (a + b + c + d + 2) / 4.
+	typedef void (*DownSampleRowFunc)(uint8_t* pDst, const uint8_t* pRow0, const uint8_t* pRow1, uint32_t dstWidth);
+
+	void DownSampleRGBA8_Scalar(uint8_t* pDst, const uint8_t* pRow0, const uint8_t* pRow1, uint32_t dstWidth);
+#ifdef MIP_KERNELS_X86
+	void DownSampleRGBA8_SSE2(uint8_t* pDst, const uint8_t* pRow0, const uint8_t* pRow1, uint32_t dstWidth);
+	void DownSampleRGBA8_AVX2(uint8_t* pDst, const uint8_t* pRow0, const uint8_t* pRow1, uint32_t dstWidth);
+	void DownSampleRGBA8_AVX512(uint8_t* pDst, const uint8_t* pRow0, const uint8_t* pRow1, uint32_t dstWidth);
+#endif
+#ifdef MIP_KERNELS_NEON
+	void DownSampleRGBA8_NEON(uint8_t* pDst, const uint8_t* pRow0, const uint8_t* pRow1, uint32_t dstWidth);
+#endif
+
+	// 2x2 box reduction of R8G8B8A8_UNORM in Z-order, where each 2x2 footprint
+	// is 4 consecutive texels: pDst[i] is the average of pSrc[4 * i, 4 * i + 3].
+	typedef void (*DownSampleQuadsFunc)(uint8_t* pDst, const uint8_t* pSrc, uint32_t dstCount);
+
+	void DownSampleQuadsRGBA8_Scalar(uint8_t* pDst, const uint8_t* pSrc, uint32_t dstCount);
+#ifdef MIP_KERNELS_X86
+	void DownSampleQuadsRGBA8_SSE2(uint8_t* pDst, const uint8_t* pSrc, uint32_t dstCount);
+	void DownSampleQuadsRGBA8_AVX2(uint8_t* pDst, const uint8_t* pSrc, uint32_t dstCount);
+#endif
+#ifdef MIP_KERNELS_NEON
+	void DownSampleQuadsRGBA8_NEON(uint8_t* pDst, const uint8_t* pSrc, uint32_t dstCount);
+#endif
+
+	// Sums of the 2x2 footprints of R8G8B8A8_UNORM in 16-bit lanes, 4 per destination
+	// texel, for the exact multi-level reduction. The row variant takes 2 source rows,
+	// the quad variant consecutive footprints in Z-order.
+	typedef void (*SumRowRGBA8Func)(uint16_t* pDst, const uint8_t* pRow0, const uint8_t* pRow1, uint32_t dstWidth);
+	typedef void (*SumQuadsRGBA8Func)(uint16_t* pDst, const uint8_t* pSrc, uint32_t dstCount);
+
+	// Sums of 4 consecutive texels of 16-bit sums in Z-order, which must not overflow:
+	// a 16x16 footprint of 8-bit texels is the most that fits.
+	typedef void (*SumQuads16Func)(uint16_t* pDst, const uint16_t* pSrc, uint32_t dstCount);
+
+	// 16-bit sums to R8G8B8A8_UNORM, rounded to nearest: (sum + 2^(shift - 1)) >> shift,
+	// with the shift in [2, 8] (2x2 to 16x16 footprints).
+	typedef void (*RoundSums16Func)(uint8_t* pDst, const uint16_t* pSrc, uint32_t count, uint32_t shift);
+
+	void SumRowRGBA8_Scalar(uint16_t* pDst, const uint8_t* pRow0, const uint8_t* pRow1, uint32_t dstWidth);
+	void SumQuadsRGBA8_Scalar(uint16_t* pDst, const uint8_t* pSrc, uint32_t dstCount);
+	void SumQuads16_Scalar(uint16_t* pDst, const uint16_t* pSrc, uint32_t dstCount);
+	void RoundSums16_Scalar(uint8_t* pDst, const uint16_t* pSrc, uint32_t count, uint32_t shift);
+#ifdef MIP_KERNELS_X86
+	void SumRowRGBA8_SSE2(uint16_t* pDst, const uint8_t* pRow0, const uint8_t* pRow1, uint32_t dstWidth);
+	void SumQuadsRGBA8_SSE2(uint16_t* pDst, const uint8_t* pSrc, uint32_t dstCount);
+	void SumQuads16_SSE2(uint16_t* pDst, const uint16_t* pSrc, uint32_t dstCount);
+	void RoundSums16_SSE2(uint8_t* pDst, const uint16_t* pSrc, uint32_t count, uint32_t shift);
+#endif
+#ifdef MIP_KERNELS_NEON
+	void SumRowRGBA8_NEON(uint16_t* pDst, const uint8_t* pRow0, const uint8_t* pRow1, uint32_t dstWidth);
+	void SumQuadsRGBA8_NEON(uint16_t* pDst, const uint8_t* pSrc, uint32_t dstCount);
+	void SumQuads16_NEON(uint16_t* pDst, const uint16_t* pSrc, uint32_t dstCount);
+	void RoundSums16_NEON(uint8_t* pDst, const uint16_t* pSrc, uint32_t count, uint32_t shift);
+#endif
+
+	// Box reduction of any size in one pass: the footprint of destination texel i along a
+	// dimension starts at source texel 2i, with 2 taps of 1/2 if the source size is even,
+	// and 3 polyphase taps of (n - i, n, i + 1) / (2n + 1) if it is 2n + 1. Returns the
+	// number of taps (1 for a source size of 1).
+	uint32_t GetBoxTaps(uint32_t i, uint32_t srcSize, float* pWeights);
+
+	// Texels [x0, x1) of a destination row of the box reduction, from numRows (1 to 3)
+	// source rows weighted by pRowWeights. pDst points to texel x0, and each source row
+	// to texel 2 * x0.
+	typedef void (*BoxRowFunc)(uint8_t* pDst, const uint8_t* const* ppRows, const float* pRowWeights,
+		uint32_t numRows, uint32_t x0, uint32_t x1, uint32_t srcWidth);
+
+	void BoxRowRGBA8_Scalar(uint8_t* pDst, const uint8_t* const* ppRows, const float* pRowWeights,
+		uint32_t numRows, uint32_t x0, uint32_t x1, uint32_t srcWidth);
+#ifdef MIP_KERNELS_X86
+	void BoxRowRGBA8_SSE41(uint8_t* pDst, const uint8_t* const* ppRows, const float* pRowWeights,
+		uint32_t numRows, uint32_t x0, uint32_t x1, uint32_t srcWidth);
+#endif
+#ifdef MIP_KERNELS_NEON
+	void BoxRowRGBA8_NEON(uint8_t* pDst, const uint8_t* const* ppRows, const float* pRowWeights,
+		uint32_t numRows, uint32_t x0, uint32_t x1, uint32_t srcWidth);
+#endif
+
+	// R8G8B8A8_UNORM_SRGB, with sRGB color channels and a linear alpha. The decode is a
+	// 256-entry table. The encode splits [2^-13, 1) into 128 buckets per octave of the float
+	// bits; each bucket holds its first value and the threshold of the next one, which
+	// gives the exact D3DX_FLOAT_to_SRGB() of D3DX_DXGIFormatConvert.inl with 1 compare.
+	float SRGB8ToLinear(uint8_t val);
+	uint8_t LinearToSRGB8(float val);
+
+	// Linear-light counterparts of the R8G8B8A8_UNORM blits, each texel rounded once
+	void BlendTexelsSRGBA8(uint8_t* pDst, const uint8_t* p00, const uint8_t* p01,
+		const uint8_t* p10, const uint8_t* p11, float wx, float wy);
+	void BlitRowSRGBA8(uint8_t* pDst, const uint8_t* pRow0, const uint8_t* pRow1, float wy,
+		uint32_t x0, uint32_t x1, uint32_t srcWidth, uint32_t dstWidth);
+	void BoxRowSRGBA8(uint8_t* pDst, const uint8_t* const* ppRows, const float* pRowWeights,
+		uint32_t numRows, uint32_t x0, uint32_t x1, uint32_t srcWidth);
+
+	// Linear-light 2x2 box reductions of R8G8B8A8_UNORM_SRGB, in rows and in Z-order
+	void DownSampleSRGBA8_Scalar(uint8_t* pDst, const uint8_t* pRow0, const uint8_t* pRow1, uint32_t dstWidth);
+	void DownSampleQuadsSRGBA8_Scalar(uint8_t* pDst, const uint8_t* pSrc, uint32_t dstCount);
+#ifdef MIP_KERNELS_X86
+	void DownSampleSRGBA8_AVX2(uint8_t* pDst, const uint8_t* pRow0, const uint8_t* pRow1, uint32_t dstWidth);
+	void DownSampleQuadsSRGBA8_AVX2(uint8_t* pDst, const uint8_t* pSrc, uint32_t dstCount);
+#endif
+
+	// Premultiplied-alpha counterparts of the R8G8B8A8_UNORM reductions: the colors are
+	// weighted by alpha as they are read, averaged, and divided by the filtered alpha as
+	// they are stored, so that invisible texels do not bleed into halos. A footprint with
+	// no alpha keeps the straight average. The 2x2 ones are exact: round(sum(c * a) / sum(a))
+	// for the colors and (sum(a) + 2) / 4 for alpha.
+	void BlendTexelsPremulRGBA8(uint8_t* pDst, const uint8_t* p00, const uint8_t* p01,
+		const uint8_t* p10, const uint8_t* p11, float wx, float wy);
+	void BlitRowPremulRGBA8(uint8_t* pDst, const uint8_t* pRow0, const uint8_t* pRow1, float wy,
+		uint32_t x0, uint32_t x1, uint32_t srcWidth, uint32_t dstWidth);
+	void BoxRowPremulRGBA8(uint8_t* pDst, const uint8_t* const* ppRows, const float* pRowWeights,
+		uint32_t numRows, uint32_t x0, uint32_t x1, uint32_t srcWidth);
+
+	void DownSamplePremulRGBA8_Scalar(uint8_t* pDst, const uint8_t* pRow0, const uint8_t* pRow1, uint32_t dstWidth);
+	void DownSampleQuadsPremulRGBA8_Scalar(uint8_t* pDst, const uint8_t* pSrc, uint32_t dstCount);
+#ifdef MIP_KERNELS_X86
+	void DownSamplePremulRGBA8_SSE2(uint8_t* pDst, const uint8_t* pRow0, const uint8_t* pRow1, uint32_t dstWidth);
+	void DownSampleQuadsPremulRGBA8_SSE2(uint8_t* pDst, const uint8_t* pSrc, uint32_t dstCount);
+	void DownSamplePremulRGBA8_AVX2(uint8_t* pDst, const uint8_t* pRow0, const uint8_t* pRow1, uint32_t dstWidth);
+	void DownSampleQuadsPremulRGBA8_AVX2(uint8_t* pDst, const uint8_t* pSrc, uint32_t dstCount);
+#endif
+
+	// Tangent-space normal maps, stored as (n + 1) / 2: the normals of a footprint are decoded,
+	// normalized, weighted, and the sum renormalized. With NORMAL_ROUGHNESS, the spare channel
+	// holds a roughness r, folded Toksvig-style with the spread of the normals, whose sum
+	// shortens to a length l: sqrt(sum(w * r^2) + (1 - l) / l), saturated. Otherwise, the
+	// spare channel is averaged like the remaining one.
+	enum NormalMapFlag : uint32_t
+	{
+		NORMAL_XY			= (1 << 0),	// X and Y in RG, Z reconstructed as for BC5, blue spare; else XYZ in RGB, alpha spare
+		NORMAL_ROUGHNESS	= (1 << 1)
+	};
+
+	// numTexels texels at ppTexels weighted by pWeights, which sum to 1
+	void FilterNormalRGBA8(uint8_t* pDst, const uint8_t* const* ppTexels, const float* pWeights,
+		uint32_t numTexels, uint32_t flags);
+
+	// 2x2 reductions of normal maps, as DownSampleRowFunc and DownSampleQuadsFunc
+	typedef void (*DownSampleNormalsFunc)(uint8_t* pDst, const uint8_t* pRow0, const uint8_t* pRow1,
+		uint32_t dstWidth, uint32_t flags);
+	typedef void (*DownSampleQuadsNormalsFunc)(uint8_t* pDst, const uint8_t* pSrc, uint32_t dstCount, uint32_t flags);
+
+	void DownSampleNormalsRGBA8_Scalar(uint8_t* pDst, const uint8_t* pRow0, const uint8_t* pRow1,
+		uint32_t dstWidth, uint32_t flags);
+	void DownSampleQuadsNormalsRGBA8_Scalar(uint8_t* pDst, const uint8_t* pSrc, uint32_t dstCount, uint32_t flags);
+#ifdef MIP_KERNELS_X86
+	void DownSampleNormalsRGBA8_AVX2(uint8_t* pDst, const uint8_t* pRow0, const uint8_t* pRow1,
+		uint32_t dstWidth, uint32_t flags);
+	void DownSampleQuadsNormalsRGBA8_AVX2(uint8_t* pDst, const uint8_t* pSrc, uint32_t dstCount, uint32_t flags);
+#endif
+
+	// Separable resampling filters over distances in destination texels, each one zero
+	// beyond its radius: tent (1), Mitchell-Netravali with B = C = 1/3 (2), Lanczos (3),
+	// and a sinc under a Kaiser window of alpha 4 (3).
+	typedef float (*FilterFunc)(float x);
+
+	float TentFilter(float x);
+	float MitchellFilter(float x);
+	float Lanczos3Filter(float x);
+	float KaiserFilter(float x);
+
+	// Polyphase weights along a dimension, generated once per level size. Destination
+	// texel i is the sum of source texels [First[i], First[i] + NumTaps) weighted by
+	// Weights[NumTaps * i, NumTaps * (i + 1)), with the taps beyond the edges clamped
+	// onto the edge texels, as sampling with clamp does. The radii above, stretched over
+	// footprints of at most 3 source texels, need no more than MaxFilterTaps.
+	const uint32_t MaxFilterTaps = 32;
+
+	struct FilterTaps
+	{
+		uint32_t NumTaps;
+		std::vector<uint32_t> First;
+		std::vector<float> Weights;
+	};
+
+	void BuildFilterTaps(FilterTaps& taps, uint32_t dstSize, uint32_t srcSize, FilterFunc filter, float radius);
+
+	// Horizontal pass: count destination texels as float RGBA, with the taps of the first one
+	// at pFirst and pWeights, from a source row whose texel srcX0 is at pSrc. The values are
+	// in [0, 255] for R8G8B8A8_UNORM, and in linear light in [0, 1] for sRGB.
+	typedef void (*FilterRowFunc)(float* pDst, const uint8_t* pSrc, uint32_t srcX0,
+		const uint32_t* pFirst, const float* pWeights, uint32_t numTaps, uint32_t count);
+
+	// Vertical pass: count texels of R8G8B8A8_UNORM from numTaps horizontally filtered rows,
+	// rounded to nearest after saturation
+	typedef void (*FilterColumnsFunc)(uint8_t* pDst, const float* const* ppRows, const float* pWeights,
+		uint32_t numTaps, uint32_t count);
+
+	void FilterRowRGBA8_Scalar(float* pDst, const uint8_t* pSrc, uint32_t srcX0,
+		const uint32_t* pFirst, const float* pWeights, uint32_t numTaps, uint32_t count);
+	void FilterColumnsRGBA8_Scalar(uint8_t* pDst, const float* const* ppRows, const float* pWeights,
+		uint32_t numTaps, uint32_t count);
+	void FilterRowSRGBA8(float* pDst, const uint8_t* pSrc, uint32_t srcX0,
+		const uint32_t* pFirst, const float* pWeights, uint32_t numTaps, uint32_t count);
+	void FilterColumnsSRGBA8(uint8_t* pDst, const float* const* ppRows, const float* pWeights,
+		uint32_t numTaps, uint32_t count);
+#ifdef MIP_KERNELS_X86
+	void FilterRowRGBA8_SSE41(float* pDst, const uint8_t* pSrc, uint32_t srcX0,
+		const uint32_t* pFirst, const float* pWeights, uint32_t numTaps, uint32_t count);
+	void FilterColumnsRGBA8_SSE2(uint8_t* pDst, const float* const* ppRows, const float* pWeights,
+		uint32_t numTaps, uint32_t count);
+	void FilterRowRGBA8_AVX2(float* pDst, const uint8_t* pSrc, uint32_t srcX0,
+		const uint32_t* pFirst, const float* pWeights, uint32_t numTaps, uint32_t count);
+	void FilterColumnsRGBA8_AVX2(uint8_t* pDst, const float* const* ppRows, const float* pWeights,
+		uint32_t numTaps, uint32_t count);
+#endif
+#ifdef MIP_KERNELS_NEON
+	void FilterRowRGBA8_NEON(float* pDst, const uint8_t* pSrc, uint32_t srcX0,
+		const uint32_t* pFirst, const float* pWeights, uint32_t numTaps, uint32_t count);
+	void FilterColumnsRGBA8_NEON(uint8_t* pDst, const float* const* ppRows, const float* pWeights,
+		uint32_t numTaps, uint32_t count);
+#endif
+
+	// Alpha coverage: adds the alpha of count texels of R8G8B8A8_UNORM into 4 interleaved
+	// histograms of 256 bins at pHist, texel i into histogram i % 4, so that runs of equal
+	// alpha do not wait on one counter. The caller sums the 4 histograms.
+	void HistogramAlphaRGBA8(uint32_t* pHist, const uint8_t* pSrc, uint32_t count);
+
+	// Scales the alpha of count texels in place by scale / 2^16, rounded to nearest and
+	// saturated: min((a * scale + 2^15) >> 16, 255), with scale below 2^24.
+	typedef void (*ScaleAlphaFunc)(uint8_t* pData, uint32_t count, uint32_t scale);
+
+	void ScaleAlphaRGBA8_Scalar(uint8_t* pData, uint32_t count, uint32_t scale);
+#ifdef MIP_KERNELS_X86
+	void ScaleAlphaRGBA8_SSE41(uint8_t* pData, uint32_t count, uint32_t scale);
+#endif
+#ifdef MIP_KERNELS_NEON
+	void ScaleAlphaRGBA8_NEON(uint8_t* pData, uint32_t count, uint32_t scale);
+#endif
+
+	// 2x2 box reductions of the UNORM formats of N channels of T (uint8_t or uint16_t), as
+	// DownSampleRowFunc and DownSampleQuadsFunc over bytes: (a + b + c + d + 2) / 4. Every
+	// format is specialized at compile time, so that R8, R8G8, R16 and R16G16 levels move
+	// their own bytes only. Instantiated for these 4, and for R8G8B8 in scalar.
+	template<typename T, uint8_t N>
+	void DownSampleUNORM_Scalar(uint8_t* pDst, const uint8_t* pRow0, const uint8_t* pRow1, uint32_t dstWidth);
+	template<typename T, uint8_t N>
+	void DownSampleQuadsUNORM_Scalar(uint8_t* pDst, const uint8_t* pSrc, uint32_t dstCount);
+#ifdef MIP_KERNELS_X86
+	template<typename T, uint8_t N>
+	void DownSampleUNORM_SSE41(uint8_t* pDst, const uint8_t* pRow0, const uint8_t* pRow1, uint32_t dstWidth);
+	template<typename T, uint8_t N>
+	void DownSampleQuadsUNORM_SSE41(uint8_t* pDst, const uint8_t* pSrc, uint32_t dstCount);
+#endif
+#ifdef MIP_KERNELS_NEON
+	template<typename T, uint8_t N>
+	void DownSampleUNORM_NEON(uint8_t* pDst, const uint8_t* pRow0, const uint8_t* pRow1, uint32_t dstWidth);
+	template<typename T, uint8_t N>
+	void DownSampleQuadsUNORM_NEON(uint8_t* pDst, const uint8_t* pSrc, uint32_t dstCount);
+#endif
+
+	// The same for R8G8B8 of 3 bytes per texel, which no power-of-2 vector divides: SSE4.1
+	// shuffles the texel pairs together for multiply-adds, NEON deinterleaves the channels
+#ifdef MIP_KERNELS_X86
+	void DownSampleRGB8_SSE41(uint8_t* pDst, const uint8_t* pRow0, const uint8_t* pRow1, uint32_t dstWidth);
+	void DownSampleQuadsRGB8_SSE41(uint8_t* pDst, const uint8_t* pSrc, uint32_t dstCount);
+#endif
+#ifdef MIP_KERNELS_NEON
+	void DownSampleRGB8_NEON(uint8_t* pDst, const uint8_t* pRow0, const uint8_t* pRow1, uint32_t dstWidth);
+	void DownSampleQuadsRGB8_NEON(uint8_t* pDst, const uint8_t* pSrc, uint32_t dstCount);
+#endif
+
+	// 2x2 box reductions of R16G16B16A16_UNORM, as DownSampleRowFunc and DownSampleQuadsFunc:
+	// (a + b + c + d + 2) / 4 in 32-bit lanes
+	typedef void (*DownSampleRowRGBA16Func)(uint16_t* pDst, const uint16_t* pRow0, const uint16_t* pRow1, uint32_t dstWidth);
+	typedef void (*DownSampleQuadsRGBA16Func)(uint16_t* pDst, const uint16_t* pSrc, uint32_t dstCount);
+
+	void DownSampleRGBA16_Scalar(uint16_t* pDst, const uint16_t* pRow0, const uint16_t* pRow1, uint32_t dstWidth);
+	void DownSampleQuadsRGBA16_Scalar(uint16_t* pDst, const uint16_t* pSrc, uint32_t dstCount);
+#ifdef MIP_KERNELS_X86
+	void DownSampleRGBA16_SSE41(uint16_t* pDst, const uint16_t* pRow0, const uint16_t* pRow1, uint32_t dstWidth);
+	void DownSampleQuadsRGBA16_SSE41(uint16_t* pDst, const uint16_t* pSrc, uint32_t dstCount);
+	void DownSampleRGBA16_AVX2(uint16_t* pDst, const uint16_t* pRow0, const uint16_t* pRow1, uint32_t dstWidth);
+	void DownSampleQuadsRGBA16_AVX2(uint16_t* pDst, const uint16_t* pSrc, uint32_t dstCount);
+#endif
+#ifdef MIP_KERNELS_NEON
+	void DownSampleRGBA16_NEON(uint16_t* pDst, const uint16_t* pRow0, const uint16_t* pRow1, uint32_t dstWidth);
+	void DownSampleQuadsRGBA16_NEON(uint16_t* pDst, const uint16_t* pSrc, uint32_t dstCount);
+#endif
+
+	// Floating-point levels: IEEE half conversions rounded to nearest even, with the NaNs
+	// kept and quieted, as F16C and the NEON conversions do
+	uint16_t FloatToHalf(float val);
+	float HalfToFloat(uint16_t val);
+
+	typedef void (*FloatToHalfFunc)(uint16_t* pDst, const float* pSrc, uint32_t count);
+	typedef void (*HalfToFloatFunc)(float* pDst, const uint16_t* pSrc, uint32_t count);
+
+	void FloatToHalf_Scalar(uint16_t* pDst, const float* pSrc, uint32_t count);
+	void HalfToFloat_Scalar(float* pDst, const uint16_t* pSrc, uint32_t count);
+#ifdef MIP_KERNELS_X86
+	void FloatToHalf_F16C(uint16_t* pDst, const float* pSrc, uint32_t count);
+	void HalfToFloat_F16C(float* pDst, const uint16_t* pSrc, uint32_t count);
+#endif
+#ifdef MIP_KERNELS_NEON
+	void FloatToHalf_NEON(uint16_t* pDst, const float* pSrc, uint32_t count);
+	void HalfToFloat_NEON(float* pDst, const uint16_t* pSrc, uint32_t count);
+#endif
+
+	// 2x2 box reductions of R32G32B32A32_FLOAT and R16G16B16A16_FLOAT, as DownSampleRowFunc
+	// and DownSampleQuadsFunc: (p00 + p10 + (p01 + p11)) / 4 in float, so that every
+	// variant gives the same bits
+	typedef void (*DownSampleRowRGBA32FFunc)(float* pDst, const float* pRow0, const float* pRow1, uint32_t dstWidth);
+	typedef void (*DownSampleQuadsRGBA32FFunc)(float* pDst, const float* pSrc, uint32_t dstCount);
+	typedef void (*DownSampleRowRGBA16FFunc)(uint16_t* pDst, const uint16_t* pRow0, const uint16_t* pRow1, uint32_t dstWidth);
+	typedef void (*DownSampleQuadsRGBA16FFunc)(uint16_t* pDst, const uint16_t* pSrc, uint32_t dstCount);
+
+	void DownSampleRGBA32F_Scalar(float* pDst, const float* pRow0, const float* pRow1, uint32_t dstWidth);
+	void DownSampleQuadsRGBA32F_Scalar(float* pDst, const float* pSrc, uint32_t dstCount);
+	void DownSampleRGBA16F_Scalar(uint16_t* pDst, const uint16_t* pRow0, const uint16_t* pRow1, uint32_t dstWidth);
+	void DownSampleQuadsRGBA16F_Scalar(uint16_t* pDst, const uint16_t* pSrc, uint32_t dstCount);
+#ifdef MIP_KERNELS_X86
+	void DownSampleRGBA32F_AVX2(float* pDst, const float* pRow0, const float* pRow1, uint32_t dstWidth);
+	void DownSampleQuadsRGBA32F_AVX2(float* pDst, const float* pSrc, uint32_t dstCount);
+	void DownSampleRGBA16F_F16C(uint16_t* pDst, const uint16_t* pRow0, const uint16_t* pRow1, uint32_t dstWidth);
+	void DownSampleQuadsRGBA16F_F16C(uint16_t* pDst, const uint16_t* pSrc, uint32_t dstCount);
+#endif
+#ifdef MIP_KERNELS_NEON
+	void DownSampleRGBA32F_NEON(float* pDst, const float* pRow0, const float* pRow1, uint32_t dstWidth);
+	void DownSampleQuadsRGBA32F_NEON(float* pDst, const float* pSrc, uint32_t dstCount);
+	void DownSampleRGBA16F_NEON(uint16_t* pDst, const uint16_t* pRow0, const uint16_t* pRow1, uint32_t dstWidth);
+	void DownSampleQuadsRGBA16F_NEON(uint16_t* pDst, const uint16_t* pSrc, uint32_t dstCount);
+#endif
+
+	// Z-order (Morton) code of 16-bit coordinates, the inverse of MortonDecode()
+	// in CSGenerateMips.hlsl: x in the even bits, y in the odd bits.
+	typedef uint32_t (*MortonEncodeFunc)(uint32_t x, uint32_t y);
+	typedef void (*MortonDecodeFunc)(uint32_t code, uint32_t& x, uint32_t& y);
+
+	uint32_t MortonEncode_Table(uint32_t x, uint32_t y);
+	void MortonDecode_Table(uint32_t code, uint32_t& x, uint32_t& y);
+#ifdef MIP_KERNELS_X86
+	uint32_t MortonEncode_BMI2(uint32_t x, uint32_t y);
+	void MortonDecode_BMI2(uint32_t code, uint32_t& x, uint32_t& y);
+#endif
+
+	// Length of the common prefix of pA and pB, up to maxLength, for the match finder of
+	// ParallelDeflate; both are readable up to maxLength
+	typedef uint32_t (*MatchLengthFunc)(const uint8_t* pA, const uint8_t* pB, uint32_t maxLength);
+
+	uint32_t MatchLength_Scalar(const uint8_t* pA, const uint8_t* pB, uint32_t maxLength);
+#ifdef MIP_KERNELS_X86
+	uint32_t MatchLength_SSE2(const uint8_t* pA, const uint8_t* pB, uint32_t maxLength);
+	uint32_t MatchLength_AVX2(const uint8_t* pA, const uint8_t* pB, uint32_t maxLength);
+#endif
+#ifdef MIP_KERNELS_NEON
+	uint32_t MatchLength_NEON(const uint8_t* pA, const uint8_t* pB, uint32_t maxLength);
+#endif
+
+	// Reconstruction of a PNG row of filter type Sub, Up, Average or Paeth, for PngDecoder:
+	// pSrc holds the filtered bytes, pPrior the reconstructed row above (zeros for the first
+	// row), and bpp the bytes per pixel, 1 to 8, that divide rowBytes.
+	typedef void (*UnfilterRowFunc)(uint8_t* pDst, const uint8_t* pSrc, const uint8_t* pPrior,
+		uint32_t rowBytes, uint32_t bpp);
+
+	void UnfilterSub_Scalar(uint8_t* pDst, const uint8_t* pSrc, const uint8_t* pPrior, uint32_t rowBytes, uint32_t bpp);
+	void UnfilterUp_Scalar(uint8_t* pDst, const uint8_t* pSrc, const uint8_t* pPrior, uint32_t rowBytes, uint32_t bpp);
+	void UnfilterAverage_Scalar(uint8_t* pDst, const uint8_t* pSrc, const uint8_t* pPrior, uint32_t rowBytes, uint32_t bpp);
+	void UnfilterPaeth_Scalar(uint8_t* pDst, const uint8_t* pSrc, const uint8_t* pPrior, uint32_t rowBytes, uint32_t bpp);
+#ifdef MIP_KERNELS_X86
+	void UnfilterSub_SSE2(uint8_t* pDst, const uint8_t* pSrc, const uint8_t* pPrior, uint32_t rowBytes, uint32_t bpp);
+	void UnfilterUp_SSE2(uint8_t* pDst, const uint8_t* pSrc, const uint8_t* pPrior, uint32_t rowBytes, uint32_t bpp);
+	void UnfilterAverage_SSE2(uint8_t* pDst, const uint8_t* pSrc, const uint8_t* pPrior, uint32_t rowBytes, uint32_t bpp);
+	void UnfilterPaeth_SSE2(uint8_t* pDst, const uint8_t* pSrc, const uint8_t* pPrior, uint32_t rowBytes, uint32_t bpp);
+#endif
+#ifdef MIP_KERNELS_NEON
+	void UnfilterSub_NEON(uint8_t* pDst, const uint8_t* pSrc, const uint8_t* pPrior, uint32_t rowBytes, uint32_t bpp);
+	void UnfilterUp_NEON(uint8_t* pDst, const uint8_t* pSrc, const uint8_t* pPrior, uint32_t rowBytes, uint32_t bpp);
+	void UnfilterAverage_NEON(uint8_t* pDst, const uint8_t* pSrc, const uint8_t* pPrior, uint32_t rowBytes, uint32_t bpp);
+	void UnfilterPaeth_NEON(uint8_t* pDst, const uint8_t* pSrc, const uint8_t* pPrior, uint32_t rowBytes, uint32_t bpp);
+#endif
+
+	//--------------------------------------------------------------------------------------
+	// Runtime dispatch
+	//--------------------------------------------------------------------------------------
+	enum CpuFeature : uint32_t
+	{
+		CPU_SSE2		= (1 << 0),
+		CPU_SSE41		= (1 << 1),
+		CPU_AVX2		= (1 << 2),	// Including the OS support of the YMM state
+		CPU_AVX512BW	= (1 << 3),	// Including the OS support of the ZMM state
+		CPU_BMI2		= (1 << 4),
+		CPU_F16C		= (1 << 5),
+		CPU_NEON		= (1 << 6),
+		CPU_SLOW_PDEP	= (1 << 7)	// Microcoded PDEP/PEXT (AMD before Zen 3)
+	};
+
+	enum Isa : uint8_t
+	{
+		ISA_SCALAR,
+		ISA_SSE2,
+		ISA_SSE41,
+		ISA_AVX2,
+		ISA_AVX512BW,
+		ISA_NEON,
+
+		NUM_ISA
+	};
+
+	struct KernelTable
+	{
+		Isa SelectedIsa;
+		DownSampleRowFunc DownSampleRGBA8;
+		DownSampleQuadsFunc DownSampleQuadsRGBA8;
+		SumRowRGBA8Func SumRowRGBA8;
+		SumQuadsRGBA8Func SumQuadsRGBA8;
+		SumQuads16Func SumQuads16;
+		RoundSums16Func RoundSums16;
+		BoxRowFunc BoxRowRGBA8;
+		DownSampleRowFunc DownSampleSRGBA8;
+		DownSampleQuadsFunc DownSampleQuadsSRGBA8;
+		DownSampleRowFunc DownSamplePremulRGBA8;
+		DownSampleQuadsFunc DownSampleQuadsPremulRGBA8;
+		DownSampleNormalsFunc DownSampleNormalsRGBA8;
+		DownSampleQuadsNormalsFunc DownSampleQuadsNormalsRGBA8;
+		FilterRowFunc FilterRowRGBA8;
+		FilterColumnsFunc FilterColumnsRGBA8;
+		ScaleAlphaFunc ScaleAlphaRGBA8;
+		DownSampleRowFunc DownSampleR8;
+		DownSampleQuadsFunc DownSampleQuadsR8;
+		DownSampleRowFunc DownSampleRG8;
+		DownSampleQuadsFunc DownSampleQuadsRG8;
+		DownSampleRowFunc DownSampleRGB8;
+		DownSampleQuadsFunc DownSampleQuadsRGB8;
+		DownSampleRowFunc DownSampleR16;
+		DownSampleQuadsFunc DownSampleQuadsR16;
+		DownSampleRowFunc DownSampleRG16;
+		DownSampleQuadsFunc DownSampleQuadsRG16;
+		DownSampleRowRGBA16Func DownSampleRGBA16;
+		DownSampleQuadsRGBA16Func DownSampleQuadsRGBA16;
+		FloatToHalfFunc FloatToHalf;
+		HalfToFloatFunc HalfToFloat;
+		DownSampleRowRGBA32FFunc DownSampleRGBA32F;
+		DownSampleQuadsRGBA32FFunc DownSampleQuadsRGBA32F;
+		DownSampleRowRGBA16FFunc DownSampleRGBA16F;
+		DownSampleQuadsRGBA16FFunc DownSampleQuadsRGBA16F;
+		MortonEncodeFunc MortonEncode;
+		MortonDecodeFunc MortonDecode;
+		MatchLengthFunc MatchLength;
+		UnfilterRowFunc UnfilterSub;
+		UnfilterRowFunc UnfilterUp;
+		UnfilterRowFunc UnfilterAverage;
+		UnfilterRowFunc UnfilterPaeth;
+	};
+
+	// CPUID (x86) or the target (ARM) probed once, combination of CpuFeature
+	uint32_t GetCpuFeatures();
+
+	// Best kernels the running CPU supports, bound on the first call
+	const KernelTable& GetKernels();
+
+	// Rebinds the kernels up to maxIsa, e.g. to benchmark the lower tiers.
+	// Kernels are copied by the generators at construction, so call it before.
+	void SelectKernels(Isa maxIsa = NUM_ISA);
+
+	const char* GetIsaName(Isa isa);
+}
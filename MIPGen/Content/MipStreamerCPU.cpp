@@ -0,0 +1,263 @@
+//--------------------------------------------------------------------------------------
+// Copyright (c) XU, Tianchen. All rights reserved.
+//--------------------------------------------------------------------------------------
+
+#include <cassert>
+#include <cstring>
+#include <algorithm>
+#include "MipStreamerCPU.h"
+
+#define DIV_UP(x, n)	(((x) + (n) - 1) / (n))
+
+using namespace std;
+using namespace MipKernels;
+
+static const uint32_t g_minTexelsPerTask = 16384;	// Rows of the small levels are batched
+
+MipStreamerCPU::MipStreamerCPU() :
+	m_channels(4),
+	m_filter(MipGeneratorCPU::BILINEAR),
+	m_isSRGB(false),
+	m_isPremultiplied(false),
+	m_kernels(GetKernels())
+{
+}
+
+MipStreamerCPU::~MipStreamerCPU()
+{
+}
+
+bool MipStreamerCPU::Init(uint32_t width, uint32_t height, uint8_t channels, const BandFunc& onBand, uint32_t numThreads)
+{
+	if (!width || !height || !channels || channels > 4 || !onBand) return false;
+
+	if (!m_scheduler || (numThreads && numThreads != m_scheduler->GetThreadCount()))
+		m_scheduler = make_unique<TaskScheduler>(numThreads);
+	m_channels = channels;
+	m_onBand = onBand;
+
+	// Full chain, as RenderTarget::Create() with 0 MIP levels
+	auto numMips = 1u;
+	for (auto size = (max)(width, height); size > 1; size >>= 1) ++numMips;
+
+	m_levels.resize(numMips);
+	for (auto i = 0u; i < numMips; ++i)
+	{
+		auto& mip = m_levels[i];
+		mip.Width = (max)(width >> i, 1u);
+		mip.Height = (max)(height >> i, 1u);
+		mip.NumRows = 0;
+		mip.Carry.resize(2 * sizeof(uint32_t) * mip.Width);
+		mip.Band.clear();
+	}
+	buildFilterTaps();
+
+	return true;
+}
+
+void MipStreamerCPU::SetFilter(MipGeneratorCPU::FilterType filter)
+{
+	m_filter = filter;
+	buildFilterTaps();
+}
+
+void MipStreamerCPU::SetSRGB(bool isSRGB)
+{
+	m_isSRGB = isSRGB;
+}
+
+void MipStreamerCPU::SetPremultipliedAlpha(bool isPremultiplied)
+{
+	m_isPremultiplied = isPremultiplied;
+}
+
+void MipStreamerCPU::PushRows(const void* pRows, uint32_t numRows, size_t rowPitch)
+{
+	const auto& mip = m_levels[0];
+	numRows = (min)(numRows, mip.Height - mip.NumRows);
+	if (!pRows || numRows == 0) return;
+
+	// Expand the band with the default SRV component mapping
+	auto pBand = static_cast<const uint8_t*>(pRows);
+	if (m_channels != 4)
+	{
+		const auto bandPitch = sizeof(uint32_t) * mip.Width;
+		m_sourceBand.resize(bandPitch * numRows);
+		m_scheduler->ParallelFor(numRows, [&](uint32_t y)
+		{
+			const uint8_t defaults[] = { 0, 0, 0, 0xff };
+			const auto pSrcRow = &pBand[rowPitch * y];
+			const auto pDstRow = &m_sourceBand[bandPitch * y];
+			for (auto x = 0u; x < mip.Width; ++x)
+				for (uint8_t c = 0; c < 4; ++c)
+					pDstRow[4 * x + c] = c < m_channels ? pSrcRow[m_channels * x + c] : defaults[c];
+		});
+		pBand = m_sourceBand.data();
+		rowPitch = bandPitch;
+	}
+
+	pushBand(0, pBand, numRows, rowPitch);
+}
+
+bool MipStreamerCPU::IsComplete() const
+{
+	return !m_levels.empty() && m_levels.back().NumRows == m_levels.back().Height;
+}
+
+uint32_t MipStreamerCPU::GetMipLevelCount() const
+{
+	return static_cast<uint32_t>(m_levels.size());
+}
+
+uint32_t MipStreamerCPU::GetThreadCount() const
+{
+	return m_scheduler ? m_scheduler->GetThreadCount() : 0;
+}
+
+void MipStreamerCPU::GetMipSize(uint32_t mipLevel, uint32_t& width, uint32_t& height) const
+{
+	assert(mipLevel < GetMipLevelCount());
+	width = m_levels[mipLevel].Width;
+	height = m_levels[mipLevel].Height;
+}
+
+void MipStreamerCPU::buildFilterTaps()
+{
+	for (auto i = 1u; i < GetMipLevelCount(); ++i)
+	{
+		const auto& src = m_levels[i - 1];
+		auto& dst = m_levels[i];
+		if (!MipGeneratorCPU::BuildFilterTaps(m_filter, dst.Width, src.Width, dst.TapsX) ||
+			!MipGeneratorCPU::BuildFilterTaps(m_filter, dst.Height, src.Height, dst.TapsY))
+		{
+			dst.TapsX = FilterTaps();
+			dst.TapsY = FilterTaps();
+		}
+		dst.Filtered.clear();
+		dst.FilteredFirst = 0;
+	}
+}
+
+void MipStreamerCPU::pushBand(uint32_t mipLevel, const uint8_t* pRows, uint32_t numRows, size_t rowPitch)
+{
+	auto& src = m_levels[mipLevel];
+	const auto firstRow = src.NumRows;
+	m_onBand(mipLevel, firstRow, numRows, pRows, rowPitch);
+	src.NumRows += numRows;
+
+	if (mipLevel + 1 < GetMipLevelCount())
+	{
+		auto& dst = m_levels[mipLevel + 1];
+		if (!dst.TapsY.First.empty())
+		{
+			const auto numDstRows = filterBand(mipLevel, pRows, numRows, rowPitch);
+			if (numDstRows > 0) pushBand(mipLevel + 1, dst.Band.data(), numDstRows, sizeof(uint32_t) * dst.Width);
+
+			return;
+		}
+
+		// Rows of the parent band, or the last 2 of the previous bands
+		const auto carryPitch = src.Carry.size() / 2;
+		const auto getRow = [&](uint32_t y)
+		{
+			assert(y + 2 >= firstRow && y < src.NumRows);
+			return y < firstRow ? &src.Carry[carryPitch * (y & 1)] : &pRows[rowPitch * (y - firstRow)];
+		};
+
+		// The next rows whose footprints have arrived. Footprints only move down, and they
+		// span up to 3 rows, so that the previous bands are needed for their last 2 rows only.
+		const auto isBox = m_filter == MipGeneratorCPU::BOX;
+		auto dstRow = dst.NumRows;
+		for (; dstRow < dst.Height; ++dstRow)
+		{
+			uint32_t sy0, sy1;
+			if (isBox)
+			{
+				float weights[3];
+				sy1 = 2 * dstRow + GetBoxTaps(dstRow, src.Height, weights) - 1;
+			}
+			else SampleCoord(dstRow, dst.Height, src.Height, sy0, sy1);
+			if (sy1 >= src.NumRows) break;
+		}
+
+		const auto numDstRows = dstRow - dst.NumRows;
+		if (numDstRows > 0)
+		{
+			const auto dstPitch = sizeof(uint32_t) * dst.Width;
+			const auto isExactHalf = src.Width == 2 * dst.Width && src.Height == 2 * dst.Height;
+			const auto downSampleRow = m_isSRGB ? m_kernels.DownSampleSRGBA8 :
+				(m_isPremultiplied ? m_kernels.DownSamplePremulRGBA8 : m_kernels.DownSampleRGBA8);
+			const auto boxRow = m_isSRGB ? BoxRowSRGBA8 : (m_isPremultiplied ? BoxRowPremulRGBA8 : m_kernels.BoxRowRGBA8);
+			const auto blitRow = m_isSRGB ? BlitRowSRGBA8 : (m_isPremultiplied ? BlitRowPremulRGBA8 : BlitRowRGBA8);
+			dst.Band.resize(dstPitch * numDstRows);
+			m_scheduler->ParallelFor(numDstRows, [&](uint32_t i)
+			{
+				uint32_t sy0, sy1;
+				const auto y = dst.NumRows + i;
+				const auto wy = SampleCoord(y, dst.Height, src.Height, sy0, sy1);
+				const auto pDstRow = &dst.Band[dstPitch * i];
+				if (isExactHalf) downSampleRow(pDstRow, getRow(2 * y), getRow(2 * y + 1), dst.Width);
+				else if (isBox)
+				{
+					float weights[3];
+					const uint8_t* ppRows[3];
+					const auto numRows = GetBoxTaps(y, src.Height, weights);
+					for (auto r = 0u; r < numRows; ++r) ppRows[r] = getRow(2 * y + r);
+					boxRow(pDstRow, ppRows, weights, numRows, 0, dst.Width, src.Width);
+				}
+				else blitRow(pDstRow, getRow(sy0), getRow(sy1), wy, 0, dst.Width, src.Width, dst.Width);
+			}, DIV_UP(g_minTexelsPerTask, dst.Width));
+		}
+
+		// Keep the last 2 rows for the next band
+		for (auto y = src.NumRows - (min)(numRows, 2u); y < src.NumRows; ++y)
+			memcpy(&src.Carry[carryPitch * (y & 1)], &pRows[rowPitch * (y - firstRow)], carryPitch);
+
+		if (numDstRows > 0) pushBand(mipLevel + 1, dst.Band.data(), numDstRows, sizeof(uint32_t) * dst.Width);
+	}
+}
+
+uint32_t MipStreamerCPU::filterBand(uint32_t mipLevel, const uint8_t* pRows, uint32_t numRows, size_t rowPitch)
+{
+	// Rows of the band filtered horizontally after the parent rows still needed, then the
+	// vertical pass of the rows whose taps have all arrived
+	const auto& src = m_levels[mipLevel];
+	auto& dst = m_levels[mipLevel + 1];
+	const auto& tapsX = dst.TapsX;
+	const auto& tapsY = dst.TapsY;
+	const auto firstRow = src.NumRows - numRows;
+	const auto filterRow = m_isSRGB ? FilterRowSRGBA8 : m_kernels.FilterRowRGBA8;
+	const auto filterColumns = m_isSRGB ? FilterColumnsSRGBA8 : m_kernels.FilterColumnsRGBA8;
+	const auto rowSize = 4 * dst.Width;
+	const auto grainSize = DIV_UP(g_minTexelsPerTask, dst.Width);
+
+	dst.Filtered.resize(static_cast<size_t>(rowSize) * (src.NumRows - dst.FilteredFirst));
+	m_scheduler->ParallelFor(numRows, [&](uint32_t i)
+	{
+		filterRow(&dst.Filtered[static_cast<size_t>(rowSize) * (firstRow + i - dst.FilteredFirst)], &pRows[rowPitch * i],
+			0, tapsX.First.data(), tapsX.Weights.data(), tapsX.NumTaps, dst.Width);
+	}, grainSize);
+
+	auto dstRow = dst.NumRows;
+	while (dstRow < dst.Height && tapsY.First[dstRow] + tapsY.NumTaps <= src.NumRows) ++dstRow;
+
+	const auto numDstRows = dstRow - dst.NumRows;
+	const auto dstPitch = sizeof(uint32_t) * dst.Width;
+	dst.Band.resize(dstPitch * numDstRows);
+	m_scheduler->ParallelFor(numDstRows, [&](uint32_t i)
+	{
+		const auto y = dst.NumRows + i;
+		const float* ppRows[MaxFilterTaps];
+		for (auto t = 0u; t < tapsY.NumTaps; ++t)
+			ppRows[t] = &dst.Filtered[static_cast<size_t>(rowSize) * (tapsY.First[y] + t - dst.FilteredFirst)];
+		filterColumns(&dst.Band[dstPitch * i], ppRows, &tapsY.Weights[tapsY.NumTaps * y], tapsY.NumTaps, dst.Width);
+	}, grainSize);
+
+	// Drop the rows before the taps of the next pending row
+	const auto keepFirst = dstRow < dst.Height ? (min)(tapsY.First[dstRow], src.NumRows) : src.NumRows;
+	const auto numDropped = static_cast<size_t>(rowSize) * (keepFirst - dst.FilteredFirst);
+	dst.Filtered.erase(dst.Filtered.begin(), dst.Filtered.begin() + numDropped);
+	dst.FilteredFirst = keepFirst;
+
+	return numDstRows;
+}
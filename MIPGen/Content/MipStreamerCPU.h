@@ -0,0 +1,76 @@
+//--------------------------------------------------------------------------------------
+// Copyright (c) XU, Tianchen. All rights reserved.
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <memory>
+#include <functional>
+#include "MipGeneratorCPU.h"
+
+//--------------------------------------------------------------------------------------
+// Out-of-core MIP-map generation: the source is pushed in bands of rows, top down, and
+// every level is emitted in bands as soon as its rows are final. A level only keeps the
+// last 2 rows of the parent band (or the filtered rows under the taps of a polyphase
+// filter), which the next band may still need, so that the memory is bounded by the band
+// size instead of the image size. The chain is the same as
+// MipGeneratorCPU::Process(GRAPHICS) with the same filter, color space and alpha mode.
+//--------------------------------------------------------------------------------------
+class MipStreamerCPU
+{
+public:
+	// Rows [firstRow, firstRow + numRows) of a level as R8G8B8A8_UNORM, valid for the call
+	typedef std::function<void(uint32_t mipLevel, uint32_t firstRow, uint32_t numRows,
+		const uint8_t* pRows, size_t rowPitch)> BandFunc;
+
+	MipStreamerCPU();
+	virtual ~MipStreamerCPU();
+
+	bool Init(uint32_t width, uint32_t height, uint8_t channels, const BandFunc& onBand, uint32_t numThreads = 0);
+	void SetFilter(MipGeneratorCPU::FilterType filter);	// Before the first rows
+	void SetSRGB(bool isSRGB);
+	void SetPremultipliedAlpha(bool isPremultiplied);
+
+	// Level 0 is emitted too, with the default SRV component mapping of MipGeneratorCPU
+	void PushRows(const void* pRows, uint32_t numRows, size_t rowPitch);
+
+	bool IsComplete() const;
+	uint32_t GetMipLevelCount() const;
+	uint32_t GetThreadCount() const;
+	void GetMipSize(uint32_t mipLevel, uint32_t& width, uint32_t& height) const;
+
+protected:
+	struct Level
+	{
+		uint32_t Width;
+		uint32_t Height;
+		uint32_t NumRows;				// Rows emitted so far
+		std::vector<uint8_t> Carry;		// Last 2 rows of the previous parent bands, by row parity
+		std::vector<uint8_t> Band;		// Rows produced from the current parent band
+
+		// Polyphase filters only: taps from the parent, and the parent rows from FilteredFirst
+		// on, filtered horizontally, that the pending rows of the level still need
+		MipKernels::FilterTaps TapsX;
+		MipKernels::FilterTaps TapsY;
+		std::vector<float> Filtered;
+		uint32_t FilteredFirst;
+	};
+
+	void buildFilterTaps();
+	void pushBand(uint32_t mipLevel, const uint8_t* pRows, uint32_t numRows, size_t rowPitch);
+	uint32_t filterBand(uint32_t mipLevel, const uint8_t* pRows, uint32_t numRows, size_t rowPitch);
+
+	std::vector<Level>		m_levels;
+	std::vector<uint8_t>	m_sourceBand;
+	uint8_t					m_channels;
+	MipGeneratorCPU::FilterType m_filter;
+	bool					m_isSRGB;
+	bool					m_isPremultiplied;
+	BandFunc				m_onBand;
+
+	std::unique_ptr<TaskScheduler> m_scheduler;
+	MipKernels::KernelTable	m_kernels;
+};
@@ -0,0 +1,523 @@
+//--------------------------------------------------------------------------------------
+// Copyright (c) XU, Tianchen. All rights reserved.
+//--------------------------------------------------------------------------------------
+
+#include <cassert>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <vector>
+#include "ParallelDeflate.h"
+#include "MipKernels.h"
+#include "TaskScheduler.h"
+
+#define DIV_UP(x, n)	(((x) + (n) - 1) / (n))
+
+using namespace std;
+
+namespace ParallelDeflate
+{
+	static const uint32_t WindowSize = 1 << 15;
+	static const uint32_t MinMatch = 4;			// Matches are hashed on 4 bytes
+	static const uint32_t MaxMatch = 258;
+	static const uint32_t HashBits = 15;
+	static const uint32_t MaxBlockTokens = 1 << 16;
+	static const uint32_t NumLitLenCodes = 286;
+	static const uint32_t NumDistCodes = 30;
+	static const uint32_t NumCodeLenCodes = 19;
+
+	static const uint16_t g_lengthBases[] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+		35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+	static const uint8_t g_lengthExtraBits[] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+		3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+	static const uint16_t g_distBases[] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+		257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+	static const uint8_t g_distExtraBits[] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+		7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+	static const uint8_t g_codeLenOrder[] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+
+	// Codes of the match lengths and distances, less their extra bits
+	static const struct SymbolTables
+	{
+		SymbolTables()
+		{
+			const auto numLengthCodes = static_cast<uint8_t>(size(g_lengthBases));
+			for (uint8_t i = 0; i < numLengthCodes; ++i)
+			{
+				const auto end = i + 1 < numLengthCodes ? g_lengthBases[i + 1] : MaxMatch + 1;
+				for (auto length = g_lengthBases[i]; length < end; ++length) LengthCodes[length] = i;
+			}
+
+			const auto numDistCodes = static_cast<uint8_t>(size(g_distBases));
+			for (uint8_t i = 0; i < numDistCodes; ++i)
+			{
+				const auto end = i + 1 < numDistCodes ? g_distBases[i + 1] : WindowSize + 1;
+				for (uint32_t distance = g_distBases[i]; distance < end; ++distance) DistCodes[distance] = i;
+			}
+		}
+
+		uint8_t LengthCodes[MaxMatch + 1];
+		uint8_t DistCodes[WindowSize + 1];
+	} g_symbolTables;
+
+	// LSB-first bits appended to a byte stream
+	struct BitWriter
+	{
+		BitWriter(vector<uint8_t>& stream) : Stream(stream), Bits(0), NumBits(0) {}
+
+		void Write(uint32_t bits, uint32_t numBits)
+		{
+			Bits |= static_cast<uint64_t>(bits) << NumBits;
+			for (NumBits += numBits; NumBits >= 8; NumBits -= 8)
+			{
+				Stream.push_back(static_cast<uint8_t>(Bits));
+				Bits >>= 8;
+			}
+		}
+
+		void AlignToByte()
+		{
+			if (NumBits > 0) Write(0, 8 - NumBits);
+		}
+
+		vector<uint8_t>& Stream;
+		uint64_t Bits;
+		uint32_t NumBits;
+	};
+
+	uint32_t Adler32(const uint8_t* pData, size_t size)
+	{
+		// 5552 bytes at most between the reductions, as zlib
+		const auto base = 65521u;
+		auto a = 1u, b = 0u;
+		while (size > 0)
+		{
+			const auto n = static_cast<uint32_t>((min)(size, static_cast<size_t>(5552)));
+			for (auto i = 0u; i < n; ++i)
+			{
+				a += pData[i];
+				b += a;
+			}
+			a %= base;
+			b %= base;
+			pData += n;
+			size -= n;
+		}
+
+		return (b << 16) | a;
+	}
+
+	// Adler-32 of 2 concatenated spans from theirs, as adler32_combine() of zlib
+	static uint32_t CombineAdler32(uint32_t adler1, uint32_t adler2, uint32_t size2)
+	{
+		const auto base = 65521u;
+		const auto rem = size2 % base;
+		auto sum1 = adler1 & 0xffff;
+		auto sum2 = static_cast<uint32_t>((static_cast<uint64_t>(rem) * sum1) % base);
+		sum1 += (adler2 & 0xffff) + base - 1;
+		sum2 += (adler1 >> 16) + (adler2 >> 16) + base - rem;
+		if (sum1 >= base) sum1 -= base;
+		if (sum1 >= base) sum1 -= base;
+		if (sum2 >= (base << 1)) sum2 -= (base << 1);
+		if (sum2 >= base) sum2 -= base;
+
+		return sum1 | (sum2 << 16);
+	}
+
+	// Lengths of a Huffman code over the frequencies, limited to maxLength bits by halving the
+	// frequencies until the tree is shallow enough
+	static void BuildCodeLengths(const uint32_t* pFreqs, uint32_t numSymbols, uint32_t maxLength, uint8_t* pLengths)
+	{
+		vector<uint32_t> freqs(pFreqs, pFreqs + numSymbols);
+		vector<uint32_t> symbols;
+		vector<uint64_t> weights;
+		vector<uint32_t> parents;
+		vector<uint32_t> depths;
+		memset(pLengths, 0, numSymbols);
+
+		while (true)
+		{
+			symbols.clear();
+			for (auto i = 0u; i < numSymbols; ++i) if (freqs[i]) symbols.push_back(i);
+			stable_sort(symbols.begin(), symbols.end(), [&freqs](uint32_t a, uint32_t b) { return freqs[a] < freqs[b]; });
+
+			const auto numLeaves = static_cast<uint32_t>(symbols.size());
+			if (numLeaves == 0) return;
+			if (numLeaves == 1)
+			{
+				pLengths[symbols[0]] = 1;
+
+				return;
+			}
+
+			// Two queues: the sorted leaves, and the internal nodes in the order they are made
+			const auto numNodes = 2 * numLeaves - 1;
+			weights.resize(numNodes);
+			parents.resize(numNodes);
+			for (auto i = 0u; i < numLeaves; ++i) weights[i] = freqs[symbols[i]];
+
+			auto leaf = 0u, node = numLeaves;
+			for (auto next = numLeaves; next < numNodes; ++next)
+			{
+				uint32_t children[2];
+				for (auto& child : children)
+					child = leaf < numLeaves && (node == next || weights[leaf] <= weights[node]) ? leaf++ : node++;
+				weights[next] = weights[children[0]] + weights[children[1]];
+				parents[children[0]] = parents[children[1]] = next;
+			}
+
+			// Parents come after their children
+			depths.assign(numNodes, 0);
+			auto maxDepth = 0u;
+			for (auto i = numNodes - 1; i-- > 0;)
+			{
+				depths[i] = depths[parents[i]] + 1;
+				maxDepth = (max)(maxDepth, depths[i]);
+			}
+
+			if (maxDepth <= maxLength)
+			{
+				for (auto i = 0u; i < numLeaves; ++i) pLengths[symbols[i]] = static_cast<uint8_t>(depths[i]);
+
+				return;
+			}
+
+			for (auto& freq : freqs) freq = (freq + 1) >> 1;
+		}
+	}
+
+	// Canonical codes of the lengths, bit-reversed for LSB-first writing
+	static void BuildCodes(const uint8_t* pLengths, uint32_t numSymbols, uint16_t* pCodes)
+	{
+		uint32_t counts[16] = {};
+		for (auto i = 0u; i < numSymbols; ++i) ++counts[pLengths[i]];
+		counts[0] = 0;
+
+		uint32_t nextCodes[16] = {};
+		auto code = 0u;
+		for (auto bits = 1u; bits < 16; ++bits)
+		{
+			code = (code + counts[bits - 1]) << 1;
+			nextCodes[bits] = code;
+		}
+
+		for (auto i = 0u; i < numSymbols; ++i)
+		{
+			const auto length = pLengths[i];
+			if (length == 0) continue;
+
+			const auto code = nextCodes[length]++;
+			auto reversed = 0u;
+			for (uint8_t b = 0; b < length; ++b) reversed |= ((code >> b) & 1) << (length - 1 - b);
+			pCodes[i] = static_cast<uint16_t>(reversed);
+		}
+	}
+
+	static void WriteStoredBlocks(BitWriter& writer, const uint8_t* pData, uint32_t size, bool isFinal)
+	{
+		do
+		{
+			const auto n = (min)(size, 65535u);
+			size -= n;
+			writer.Write(isFinal && size == 0 ? 1 : 0, 3);
+			writer.AlignToByte();
+			writer.Write(n, 16);
+			writer.Write(~n & 0xffff, 16);
+			writer.Stream.insert(writer.Stream.end(), pData, pData + n);
+			pData += n;
+		} while (size > 0);
+	}
+
+	// One block of the tokens of [pData, pData + size): a literal byte below 256, else a match
+	// as distance << 9 | length. Takes dynamic Huffman codes, or stored blocks if smaller.
+	static void WriteBlock(BitWriter& writer, const uint32_t* pTokens, uint32_t numTokens,
+		const uint8_t* pData, uint32_t size, bool isFinal)
+	{
+		const auto& lengthSymbols = g_symbolTables.LengthCodes;
+		const auto& distSymbols = g_symbolTables.DistCodes;
+
+		uint32_t litFreqs[NumLitLenCodes] = {};
+		uint32_t distFreqs[NumDistCodes] = {};
+		for (auto i = 0u; i < numTokens; ++i)
+		{
+			const auto token = pTokens[i];
+			if (token < 256) ++litFreqs[token];
+			else
+			{
+				++litFreqs[257 + lengthSymbols[token & 0x1ff]];
+				++distFreqs[distSymbols[token >> 9]];
+			}
+		}
+		litFreqs[256] = 1;
+
+		// 2 codes at least in each alphabet, which every inflater takes as a complete code
+		if (count_if(litFreqs, litFreqs + NumLitLenCodes, [](uint32_t f) { return f > 0; }) < 2) litFreqs[0] = 1;
+		if (count_if(distFreqs, distFreqs + NumDistCodes, [](uint32_t f) { return f > 0; }) < 2)
+			distFreqs[0] = distFreqs[1] = 1;
+
+		uint8_t litLengths[NumLitLenCodes], distLengths[NumDistCodes];
+		BuildCodeLengths(litFreqs, NumLitLenCodes, 15, litLengths);
+		BuildCodeLengths(distFreqs, NumDistCodes, 15, distLengths);
+
+		auto numLitCodes = NumLitLenCodes;
+		while (numLitCodes > 257 && litLengths[numLitCodes - 1] == 0) --numLitCodes;
+		auto numDistCodes = NumDistCodes;
+		while (numDistCodes > 1 && distLengths[numDistCodes - 1] == 0) --numDistCodes;
+
+		// Run-length coded lengths of both codes: 16 repeats the previous length 3 to 6 times,
+		// 17 and 18 give 3 to 10 and 11 to 138 zeros, with their extra bits from bit 5 on
+		uint8_t lengths[NumLitLenCodes + NumDistCodes];
+		memcpy(lengths, litLengths, numLitCodes);
+		memcpy(&lengths[numLitCodes], distLengths, numDistCodes);
+		const auto numLengths = numLitCodes + numDistCodes;
+
+		uint16_t runs[NumLitLenCodes + NumDistCodes];
+		auto numRuns = 0u;
+		for (auto i = 0u; i < numLengths;)
+		{
+			const auto length = lengths[i];
+			auto run = 1u;
+			while (i + run < numLengths && lengths[i + run] == length) ++run;
+
+			if (length == 0 && run >= 3)
+			{
+				run = (min)(run, 138u);
+				runs[numRuns++] = static_cast<uint16_t>(run >= 11 ? 18 | ((run - 11) << 5) : 17 | ((run - 3) << 5));
+			}
+			else if (length > 0 && run >= 4)
+			{
+				run = (min)(run, 7u);
+				runs[numRuns++] = length;
+				runs[numRuns++] = static_cast<uint16_t>(16 | ((run - 4) << 5));
+			}
+			else
+			{
+				run = 1;
+				runs[numRuns++] = length;
+			}
+			i += run;
+		}
+
+		uint32_t codeLenFreqs[NumCodeLenCodes] = {};
+		for (auto i = 0u; i < numRuns; ++i) ++codeLenFreqs[runs[i] & 0x1f];
+
+		uint8_t codeLenLengths[NumCodeLenCodes];
+		BuildCodeLengths(codeLenFreqs, NumCodeLenCodes, 7, codeLenLengths);
+		auto numCodeLenCodes = NumCodeLenCodes;
+		while (numCodeLenCodes > 4 && codeLenLengths[g_codeLenOrder[numCodeLenCodes - 1]] == 0) --numCodeLenCodes;
+
+		// Bits of the dynamic block against the stored ones
+		const uint8_t runExtraBits[] = { 2, 3, 7 };
+		uint64_t numBits = 3 + 5 + 5 + 4 + 3 * numCodeLenCodes;
+		for (auto i = 0u; i < numRuns; ++i)
+		{
+			const auto symbol = runs[i] & 0x1f;
+			numBits += codeLenLengths[symbol] + (symbol >= 16 ? runExtraBits[symbol - 16] : 0);
+		}
+		for (auto i = 0u; i < NumLitLenCodes; ++i)
+			numBits += static_cast<uint64_t>(litFreqs[i]) * (litLengths[i] + (i > 256 ? g_lengthExtraBits[i - 257] : 0));
+		for (auto i = 0u; i < NumDistCodes; ++i)
+			numBits += static_cast<uint64_t>(distFreqs[i]) * (distLengths[i] + g_distExtraBits[i]);
+
+		const auto numStoredBits = 8ull * (5 * (size / 65535 + 1) + size);
+		if (numBits >= numStoredBits)
+		{
+			WriteStoredBlocks(writer, pData, size, isFinal);
+
+			return;
+		}
+
+		uint16_t litCodes[NumLitLenCodes], distCodes[NumDistCodes], codeLenCodes[NumCodeLenCodes];
+		BuildCodes(litLengths, NumLitLenCodes, litCodes);
+		BuildCodes(distLengths, NumDistCodes, distCodes);
+		BuildCodes(codeLenLengths, NumCodeLenCodes, codeLenCodes);
+
+		writer.Write(isFinal ? 1 : 0, 1);
+		writer.Write(2, 2);
+		writer.Write(numLitCodes - 257, 5);
+		writer.Write(numDistCodes - 1, 5);
+		writer.Write(numCodeLenCodes - 4, 4);
+		for (auto i = 0u; i < numCodeLenCodes; ++i) writer.Write(codeLenLengths[g_codeLenOrder[i]], 3);
+		for (auto i = 0u; i < numRuns; ++i)
+		{
+			const auto symbol = runs[i] & 0x1f;
+			writer.Write(codeLenCodes[symbol], codeLenLengths[symbol]);
+			if (symbol >= 16) writer.Write(runs[i] >> 5, runExtraBits[symbol - 16]);
+		}
+
+		for (auto i = 0u; i < numTokens; ++i)
+		{
+			const auto token = pTokens[i];
+			if (token < 256) writer.Write(litCodes[token], litLengths[token]);
+			else
+			{
+				const auto length = token & 0x1ff;
+				const auto distance = token >> 9;
+				const auto lengthCode = lengthSymbols[length];
+				const auto distCode = distSymbols[distance];
+				writer.Write(litCodes[257 + lengthCode], litLengths[257 + lengthCode]);
+				writer.Write(length - g_lengthBases[lengthCode], g_lengthExtraBits[lengthCode]);
+				writer.Write(distCodes[distCode], distLengths[distCode]);
+				writer.Write(distance - g_distBases[distCode], g_distExtraBits[distCode]);
+			}
+		}
+		writer.Write(litCodes[256], litLengths[256]);
+	}
+
+	// Raw deflate of [pChunk, pChunk + size), the dictSize bytes before it as the window. The
+	// chunks before the last one end with an empty stored block, on a byte boundary.
+	static void DeflateChunk(const uint8_t* pChunk, uint32_t dictSize, uint32_t size, bool isLast,
+		int quality, vector<uint8_t>& stream)
+	{
+		const auto& kernels = MipKernels::GetKernels();
+		const auto pBase = pChunk - dictSize;
+		const auto end = dictSize + size;
+		const auto level = static_cast<uint32_t>((min)((max)(quality, 1), 10));
+		const auto maxChain = 1u << level;
+		const auto niceLength = (min)(8u << level, MaxMatch);
+		const auto isLazy = level >= 4;
+
+		// Hash chains of the positions from the window start, reused by the worker
+		thread_local vector<int32_t> heads;
+		thread_local vector<int32_t> prevs;
+		thread_local vector<uint32_t> tokens;
+		heads.assign(1 << HashBits, -1);
+		prevs.resize(end);
+		tokens.clear();
+
+		const auto hash = [pBase](uint32_t i)
+		{
+			uint32_t bytes;
+			memcpy(&bytes, &pBase[i], sizeof(uint32_t));
+
+			return (bytes * 2654435761u) >> (32 - HashBits);
+		};
+
+		auto numInserted = 0u;
+		const auto insertUpTo = [&](uint32_t i)
+		{
+			for (i = (min)(i, end >= MinMatch ? end - MinMatch + 1 : 0); numInserted < i; ++numInserted)
+			{
+				const auto h = hash(numInserted);
+				prevs[numInserted] = heads[h];
+				heads[h] = static_cast<int32_t>(numInserted);
+			}
+		};
+
+		// Longest match at i among the positions before it, within the window
+		const auto findMatch = [&](uint32_t i, uint32_t& distance)
+		{
+			const auto maxLength = (min)(MaxMatch, end - i);
+			if (maxLength < MinMatch) return 0u;
+
+			auto bestLength = MinMatch - 1;
+			auto chain = maxChain;
+			for (auto candidate = heads[hash(i)]; candidate >= 0 && i - candidate <= WindowSize && chain-- > 0;
+				candidate = prevs[candidate])
+			{
+				if (pBase[candidate + bestLength] != pBase[i + bestLength]) continue;
+
+				const auto length = kernels.MatchLength(&pBase[candidate], &pBase[i], maxLength);
+				if (length > bestLength)
+				{
+					bestLength = length;
+					distance = i - candidate;
+					if (length >= niceLength || length == maxLength) break;
+				}
+			}
+
+			return bestLength >= MinMatch ? bestLength : 0u;
+		};
+
+		for (auto i = dictSize; i < end;)
+		{
+			insertUpTo(i);
+			auto distance = 0u;
+			auto length = findMatch(i, distance);
+
+			// Lazy evaluation: a longer match from the next byte turns this one into a literal
+			if (length > 0 && isLazy && length < niceLength)
+			{
+				insertUpTo(i + 1);
+				auto nextDistance = 0u;
+				const auto nextLength = findMatch(i + 1, nextDistance);
+				if (nextLength > length)
+				{
+					tokens.push_back(pBase[i++]);
+					length = nextLength;
+					distance = nextDistance;
+				}
+			}
+
+			if (length > 0)
+			{
+				tokens.push_back((distance << 9) | length);
+				i += length;
+			}
+			else tokens.push_back(pBase[i++]);
+		}
+
+		BitWriter writer(stream);
+		const auto numTokens = static_cast<uint32_t>(tokens.size());
+		auto offset = dictSize;
+		for (auto i = 0u; i < numTokens; i += MaxBlockTokens)
+		{
+			const auto count = (min)(numTokens - i, MaxBlockTokens);
+			auto blockSize = 0u;
+			for (auto t = i; t < i + count; ++t) blockSize += tokens[t] < 256 ? 1 : (tokens[t] & 0x1ff);
+			WriteBlock(writer, &tokens[i], count, &pBase[offset], blockSize, isLast && i + count == numTokens);
+			offset += blockSize;
+		}
+		assert(offset == end);
+
+		if (!isLast || numTokens == 0) WriteStoredBlocks(writer, pChunk, 0, isLast);
+		writer.AlignToByte();
+	}
+
+	unsigned char* Compress(unsigned char* pData, int dataLen, int* pOutLen, int quality)
+	{
+		const auto size = static_cast<uint32_t>((max)(dataLen, 0));
+		const auto numChunks = (max)(DIV_UP(size, ChunkSize), 1u);
+
+		vector<vector<uint8_t>> streams(numChunks);
+		vector<uint32_t> adlers(numChunks);
+		const auto deflateChunk = [&](uint32_t i)
+		{
+			const auto offset = ChunkSize * i;
+			const auto chunkSize = (min)(ChunkSize, size - offset);
+			DeflateChunk(&pData[offset], (min)(offset, WindowSize), chunkSize, i + 1 == numChunks, quality, streams[i]);
+			adlers[i] = Adler32(&pData[offset], chunkSize);
+		};
+
+		// On the scheduler of the calling task, if any
+		const auto pScheduler = TaskScheduler::GetCurrent();
+		if (pScheduler) pScheduler->ParallelFor(numChunks, deflateChunk);
+		else for (auto i = 0u; i < numChunks; ++i) deflateChunk(i);
+
+		// zlib header, the chunks, and the Adler-32 of the input
+		auto adler = adlers[0];
+		size_t streamSize = 2 + 4;
+		for (auto i = 0u; i < numChunks; ++i)
+		{
+			if (i > 0) adler = CombineAdler32(adler, adlers[i], (min)(ChunkSize, size - ChunkSize * i));
+			streamSize += streams[i].size();
+		}
+
+		const auto pStream = static_cast<unsigned char*>(malloc(streamSize));
+		if (!pStream) return nullptr;
+
+		auto pOut = pStream;
+		*pOut++ = 0x78;
+		*pOut++ = 0x9c;
+		for (const auto& stream : streams)
+		{
+			memcpy(pOut, stream.data(), stream.size());
+			pOut += stream.size();
+		}
+		for (auto i = 0u; i < 4; ++i) *pOut++ = static_cast<unsigned char>(adler >> (24 - 8 * i));
+
+		*pOutLen = static_cast<int>(streamSize);
+
+		return pStream;
+	}
+}
@@ -0,0 +1,31 @@
+//--------------------------------------------------------------------------------------
+// Copyright (c) XU, Tianchen. All rights reserved.
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+//--------------------------------------------------------------------------------------
+// Multi-threaded zlib compressor, pigz-style: the input is cut into chunks deflated as
+// independent tasks, each one primed with the last 32 KB of the previous chunk as its
+// window, and ended with an empty stored block so that the chunks concatenate on byte
+// boundaries. Blocks take dynamic Huffman codes, with a stored fallback for incompressible
+// data; the matches are found over hash chains, extended by MipKernels::MatchLength.
+// The chunks run on the TaskScheduler of the calling task (TaskScheduler::GetCurrent()), so
+// that levels written in parallel share its threads; called from elsewhere, they run in turn.
+//--------------------------------------------------------------------------------------
+namespace ParallelDeflate
+{
+	static const uint32_t ChunkSize = 1 << 18;	// Input bytes per task
+
+	// The STBIW_ZLIB_COMPRESS hook of stb_image_write: quality is the compression level of
+	// stbi_write_png_compression_level, clamped to [1, 10], each level doubling the hash
+	// chains searched; and the stream is allocated with malloc(). Safe to call from several
+	// threads at once.
+	unsigned char* Compress(unsigned char* pData, int dataLen, int* pOutLen, int quality);
+
+	// Adler-32 checksum of zlib streams, also checked by PngDecoder
+	uint32_t Adler32(const uint8_t* pData, size_t size);
+}
@@ -0,0 +1,647 @@
+//--------------------------------------------------------------------------------------
+// Copyright (c) XU, Tianchen. All rights reserved.
+//--------------------------------------------------------------------------------------
+
+#include <cassert>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <fstream>
+#include <memory>
+#include <vector>
+#include "PngDecoder.h"
+#include "MipKernels.h"
+#include "ParallelDeflate.h"
+
+using namespace std;
+
+namespace PngDecoder
+{
+	static const uint32_t LitLenBits = 11;		// Bits of the primary tables
+	static const uint32_t DistBits = 8;
+	static const uint32_t CodeLenBits = 7;
+	static const uint32_t MaxCodeLength = 15;
+	static const uint32_t MaxDimension = 1 << 24;	// As stb_image
+	static const uint32_t CopySlack = 16;		// Bytes past the output that the match copies may write
+
+	static const uint16_t g_lengthBases[] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+		35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+	static const uint8_t g_lengthExtraBits[] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+		3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+	static const uint16_t g_distBases[] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+		257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+	static const uint8_t g_distExtraBits[] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+		7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+	static const uint8_t g_codeLenOrder[] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+
+	// Decoding table entries: the bits to consume in bits 0-4, the kind in bits 5-7, the extra
+	// bits (or those indexing the subtable) in bits 8-11, and the payload from bit 12: the
+	// literals, the base of the length or the distance, or the offset of the subtable.
+	enum EntryKind : uint32_t
+	{
+		ENTRY_INVALID,
+		ENTRY_LITERAL,
+		ENTRY_LITERAL_PAIR,
+		ENTRY_LENGTH,
+		ENTRY_DISTANCE,
+		ENTRY_END,
+		ENTRY_SUBTABLE
+	};
+
+	static inline uint32_t MakeEntry(uint32_t numBits, EntryKind kind, uint32_t extraBits, uint32_t payload)
+	{
+		return numBits | (kind << 5) | (extraBits << 8) | (payload << 12);
+	}
+
+	static inline uint32_t GetNumBits(uint32_t entry) { return entry & 0x1f; }
+	static inline EntryKind GetKind(uint32_t entry) { return static_cast<EntryKind>((entry >> 5) & 0x7); }
+	static inline uint32_t GetExtraBits(uint32_t entry) { return (entry >> 8) & 0xf; }
+	static inline uint32_t GetPayload(uint32_t entry) { return entry >> 12; }
+
+	// Entries of each symbol of the 3 alphabets, less their code lengths; the unused length
+	// and distance symbols are invalid
+	static const struct SymbolEntries
+	{
+		SymbolEntries()
+		{
+			for (auto i = 0u; i < 256; ++i) LitLen[i] = MakeEntry(0, ENTRY_LITERAL, 0, i);
+			LitLen[256] = MakeEntry(0, ENTRY_END, 0, 0);
+			for (auto i = 0u; i < 29; ++i) LitLen[257 + i] = MakeEntry(0, ENTRY_LENGTH, g_lengthExtraBits[i], g_lengthBases[i]);
+			for (auto i = 0u; i < 30; ++i) Dist[i] = MakeEntry(0, ENTRY_DISTANCE, g_distExtraBits[i], g_distBases[i]);
+			for (auto i = 0u; i < 19; ++i) CodeLen[i] = MakeEntry(0, ENTRY_LITERAL, 0, i);
+		}
+
+		uint32_t LitLen[288] = {};
+		uint32_t Dist[32] = {};
+		uint32_t CodeLen[19] = {};
+	} g_symbolEntries;
+
+	// LSB-first bits of a byte stream, refilled a little-endian word at a time. Past the end,
+	// zeros are shifted in and counted, so that a truncated stream is caught once they get used.
+	struct BitReader
+	{
+		void Refill()
+		{
+			if (pEnd - pNext >= 8)
+			{
+				uint64_t word;
+				memcpy(&word, pNext, sizeof(uint64_t));
+				Bits |= word << NumBits;
+				pNext += (63 - NumBits) >> 3;
+				NumBits |= 56;
+			}
+			else for (; NumBits <= 56; NumBits += 8)
+			{
+				if (pNext < pEnd) Bits |= static_cast<uint64_t>(*pNext++) << NumBits;
+				else ++NumPadBytes;
+			}
+		}
+
+		uint32_t Peek(uint32_t numBits) const { return static_cast<uint32_t>(Bits) & ((1u << numBits) - 1); }
+		void Consume(uint32_t numBits) { Bits >>= numBits; NumBits -= numBits; }
+
+		uint32_t Read(uint32_t numBits)
+		{
+			const auto bits = Peek(numBits);
+			Consume(numBits);
+
+			return bits;
+		}
+
+		bool IsOverrun() const { return NumBits < 8 * NumPadBytes; }
+
+		const uint8_t* pNext;
+		const uint8_t* pEnd;
+		uint64_t Bits;
+		uint32_t NumBits;
+		uint32_t NumPadBytes;
+	};
+
+	// Canonical Huffman decoding table: 2^primaryBits entries indexed by the next bits, then the
+	// subtables of the longer codes, sized by the longest code of their prefix. False for the
+	// oversubscribed codes; the entries left by incomplete ones are invalid.
+	static bool BuildTable(const uint8_t* pLengths, uint32_t numSymbols, const uint32_t* pSymbolEntries,
+		uint32_t primaryBits, vector<uint32_t>& table)
+	{
+		uint32_t counts[MaxCodeLength + 1] = {};
+		for (auto i = 0u; i < numSymbols; ++i) ++counts[pLengths[i]];
+		counts[0] = 0;
+
+		auto left = 1;
+		for (auto bits = 1u; bits <= MaxCodeLength; ++bits)
+		{
+			left = (left << 1) - static_cast<int>(counts[bits]);
+			if (left < 0) return false;
+		}
+
+		uint32_t nextCodes[MaxCodeLength + 1] = {};
+		auto code = 0u;
+		for (auto bits = 1u; bits <= MaxCodeLength; ++bits)
+		{
+			code = (code + counts[bits - 1]) << 1;
+			nextCodes[bits] = code;
+		}
+
+		// Bit-reversed codes, and the longest code of each prefix of the longer codes
+		assert(primaryBits <= LitLenBits);
+		const auto primarySize = 1u << primaryBits;
+		uint16_t codes[288];
+		uint8_t maxLengths[1 << LitLenBits] = {};
+		for (auto i = 0u; i < numSymbols; ++i)
+		{
+			const auto length = pLengths[i];
+			if (length == 0) continue;
+
+			const auto code = nextCodes[length]++;
+			auto reversed = 0u;
+			for (uint8_t b = 0; b < length; ++b) reversed |= ((code >> b) & 1) << (length - 1 - b);
+			codes[i] = static_cast<uint16_t>(reversed);
+
+			auto& maxLength = maxLengths[reversed & (primarySize - 1)];
+			if (length > primaryBits) maxLength = (max)(maxLength, length);
+		}
+
+		table.assign(primarySize, 0);
+		for (auto i = 0u; i < primarySize; ++i)
+		{
+			if (maxLengths[i] == 0) continue;
+
+			const auto subBits = maxLengths[i] - primaryBits;
+			table[i] = MakeEntry(primaryBits, ENTRY_SUBTABLE, subBits, static_cast<uint32_t>(table.size()));
+			table.resize(table.size() + (1ull << subBits), 0);
+		}
+
+		for (auto i = 0u; i < numSymbols; ++i)
+		{
+			const auto length = pLengths[i];
+			if (length == 0) continue;
+
+			const auto reversed = codes[i];
+			if (length <= primaryBits)
+			{
+				const auto entry = pSymbolEntries[i] | length;
+				for (uint32_t j = reversed; j < primarySize; j += 1 << length) table[j] = entry;
+			}
+			else
+			{
+				const auto subtable = table[reversed & (primarySize - 1)];
+				const auto subBits = length - primaryBits;
+				const auto entry = pSymbolEntries[i] | subBits;
+				const auto pSubtable = &table[GetPayload(subtable)];
+				for (uint32_t j = reversed >> primaryBits; j < 1u << GetExtraBits(subtable); j += 1 << subBits) pSubtable[j] = entry;
+			}
+		}
+
+		return true;
+	}
+
+	// Primary literal entries followed by another literal within the primary bits are turned
+	// into pairs, resolving both in one lookup
+	static void PairLiterals(vector<uint32_t>& table)
+	{
+		const auto primarySize = 1u << LitLenBits;
+		uint32_t singles[1 << LitLenBits];
+		memcpy(singles, table.data(), sizeof(singles));
+
+		for (auto i = 0u; i < primarySize; ++i)
+		{
+			const auto first = singles[i];
+			const auto firstBits = GetNumBits(first);
+			if (GetKind(first) != ENTRY_LITERAL || firstBits >= LitLenBits) continue;
+
+			// The rest of the index holds the low bits of the next code
+			const auto second = singles[i >> firstBits];
+			const auto numBits = firstBits + GetNumBits(second);
+			if (GetKind(second) == ENTRY_LITERAL && numBits <= LitLenBits)
+				table[i] = MakeEntry(numBits, ENTRY_LITERAL_PAIR, 0, GetPayload(first) | (GetPayload(second) << 8));
+		}
+	}
+
+	struct FixedTables
+	{
+		FixedTables()
+		{
+			uint8_t lengths[288];
+			memset(lengths, 8, 144);
+			memset(&lengths[144], 9, 112);
+			memset(&lengths[256], 7, 24);
+			memset(&lengths[280], 8, 8);
+			BuildTable(lengths, 288, g_symbolEntries.LitLen, LitLenBits, LitLen);
+			PairLiterals(LitLen);
+
+			memset(lengths, 5, 32);
+			BuildTable(lengths, 32, g_symbolEntries.Dist, DistBits, Dist);
+		}
+
+		vector<uint32_t> LitLen;
+		vector<uint32_t> Dist;
+	};
+
+	static const FixedTables& GetFixedTables()
+	{
+		static const FixedTables tables;
+
+		return tables;
+	}
+
+	static bool ReadDynamicTables(BitReader& reader, vector<uint32_t>& litLenTable, vector<uint32_t>& distTable)
+	{
+		reader.Refill();
+		const auto numLitLenCodes = reader.Read(5) + 257;
+		const auto numDistCodes = reader.Read(5) + 1;
+		const auto numCodeLenCodes = reader.Read(4) + 4;
+		if (numLitLenCodes > 286 || numDistCodes > 30) return false;
+
+		uint8_t codeLenLengths[19] = {};
+		for (auto i = 0u; i < numCodeLenCodes; ++i)
+		{
+			reader.Refill();
+			codeLenLengths[g_codeLenOrder[i]] = static_cast<uint8_t>(reader.Read(3));
+		}
+
+		// The code lengths take 7 bits at most, with no subtables
+		uint32_t codeLenTable[1 << CodeLenBits];
+		{
+			vector<uint32_t> table;
+			if (!BuildTable(codeLenLengths, 19, g_symbolEntries.CodeLen, CodeLenBits, table)) return false;
+			memcpy(codeLenTable, table.data(), sizeof(codeLenTable));
+		}
+
+		// Run-length coded lengths of both codes, the runs may cross from one to the other
+		uint8_t lengths[286 + 30];
+		const auto numLengths = numLitLenCodes + numDistCodes;
+		for (auto i = 0u; i < numLengths;)
+		{
+			reader.Refill();
+			const auto entry = codeLenTable[reader.Peek(CodeLenBits)];
+			if (GetKind(entry) != ENTRY_LITERAL) return false;
+			reader.Consume(GetNumBits(entry));
+
+			const auto symbol = GetPayload(entry);
+			if (symbol < 16)
+			{
+				lengths[i++] = static_cast<uint8_t>(symbol);
+				continue;
+			}
+
+			uint8_t length = 0;
+			uint32_t run;
+			switch (symbol)
+			{
+			case 16:
+				if (i == 0) return false;
+				length = lengths[i - 1];
+				run = 3 + reader.Read(2);
+				break;
+			case 17:
+				run = 3 + reader.Read(3);
+				break;
+			default:
+				run = 11 + reader.Read(7);
+			}
+			if (run > numLengths - i) return false;
+			memset(&lengths[i], length, run);
+			i += run;
+		}
+		if (lengths[256] == 0) return false;
+
+		if (!BuildTable(lengths, numLitLenCodes, g_symbolEntries.LitLen, LitLenBits, litLenTable)) return false;
+		PairLiterals(litLenTable);
+
+		return BuildTable(&lengths[numLitLenCodes], numDistCodes, g_symbolEntries.Dist, DistBits, distTable);
+	}
+
+	static inline uint32_t DecodeSymbol(BitReader& reader, const uint32_t* pTable, uint32_t primaryBits)
+	{
+		auto entry = pTable[reader.Peek(primaryBits)];
+		if (GetKind(entry) == ENTRY_SUBTABLE)
+		{
+			reader.Consume(primaryBits);
+			entry = pTable[GetPayload(entry) + reader.Peek(GetExtraBits(entry))];
+		}
+		reader.Consume(GetNumBits(entry));
+
+		return entry;
+	}
+
+	// Symbols of a Huffman block up to its end. A refill holds 56 bits: 3 literal codes of 15
+	// bits at most, or a code before a match, whose length and distance take 48 bits at most.
+	static bool InflateBlock(BitReader& reader, const uint32_t* pLitLenTable, const uint32_t* pDistTable,
+		const uint8_t* pStart, uint8_t*& pOut, const uint8_t* pEnd, const uint8_t* pLimit)
+	{
+		while (true)
+		{
+			reader.Refill();
+			auto entry = DecodeSymbol(reader, pLitLenTable, LitLenBits);
+
+			// The kind of the literal entries is their count; both bytes are written, the
+			// second one into the slack past the output if need be
+			auto numCodes = 0u;
+			while (GetKind(entry) == ENTRY_LITERAL || GetKind(entry) == ENTRY_LITERAL_PAIR)
+			{
+				const auto count = GetKind(entry);
+				if (static_cast<size_t>(pEnd - pOut) < count) return false;
+				pOut[0] = static_cast<uint8_t>(GetPayload(entry));
+				pOut[1] = static_cast<uint8_t>(GetPayload(entry) >> 8);
+				pOut += count;
+
+				if (++numCodes == 3) break;
+				entry = DecodeSymbol(reader, pLitLenTable, LitLenBits);
+			}
+			if (numCodes == 3) continue;
+			if (numCodes > 0) reader.Refill();
+
+			switch (GetKind(entry))
+			{
+			case ENTRY_LENGTH:
+			{
+				const auto length = GetPayload(entry) + reader.Read(GetExtraBits(entry));
+				const auto distEntry = DecodeSymbol(reader, pDistTable, DistBits);
+				if (GetKind(distEntry) != ENTRY_DISTANCE) return false;
+
+				const auto distance = GetPayload(distEntry) + reader.Read(GetExtraBits(distEntry));
+				if (distance > static_cast<size_t>(pOut - pStart) || length > static_cast<size_t>(pEnd - pOut)) return false;
+
+				// Whole words, overrunning the match into what the next symbols overwrite: 16 or
+				// 8 bytes at a time when the copies do not overlap within a word, else 8 bytes of
+				// the repeated pattern every multiple of its period up to 8
+				const auto pMatch = pOut - distance;
+				if (static_cast<size_t>(pLimit - pOut) < length + CopySlack)
+					for (auto i = 0u; i < length; ++i) pOut[i] = pMatch[i];
+				else if (distance >= 16)
+					for (auto i = 0u; i < length; i += 16) memcpy(&pOut[i], &pMatch[i], 16);
+				else if (distance >= 8)
+					for (auto i = 0u; i < length; i += 8) memcpy(&pOut[i], &pMatch[i], 8);
+				else
+				{
+					static const uint8_t periods[] = { 0, 8, 8, 6, 8, 5, 6, 7 };
+					uint8_t pattern[8];
+					for (auto i = 0u; i < 8; ++i) pattern[i] = i < distance ? pMatch[i] : pattern[i - distance];
+					for (auto i = 0u; i < length; i += periods[distance]) memcpy(&pOut[i], pattern, 8);
+				}
+				pOut += length;
+				break;
+			}
+			case ENTRY_END:
+				return !reader.IsOverrun();
+			default:
+				return false;
+			}
+		}
+	}
+
+	// zlib stream of exactly size bytes, to pOut followed by CopySlack writable bytes
+	static bool Inflate(const uint8_t* pData, size_t dataSize, uint8_t* pOut, size_t size)
+	{
+		// Deflate with no preset dictionary
+		if (dataSize < 2 || (pData[0] & 0xf) != 8 || ((pData[0] << 8) | pData[1]) % 31 != 0 || (pData[1] & 0x20))
+			return false;
+
+		BitReader reader = { pData + 2, pData + dataSize, 0, 0, 0 };
+		const auto pStart = pOut;
+		const auto pEnd = pOut + size;
+		const auto pLimit = pEnd + CopySlack;
+
+		thread_local vector<uint32_t> litLenTable;
+		thread_local vector<uint32_t> distTable;
+		auto isFinal = false;
+		while (!isFinal)
+		{
+			reader.Refill();
+			isFinal = reader.Read(1) != 0;
+			switch (reader.Read(2))
+			{
+			case 0:
+			{
+				// Stored: the bytes left in the bit buffer first, then straight from the stream
+				reader.Consume(reader.NumBits & 7);
+				const auto length = reader.Read(16);
+				if ((reader.Read(16) ^ length) != 0xffff) return false;
+
+				auto remaining = length;
+				for (; remaining > 0 && reader.NumBits >= 8; --remaining)
+				{
+					if (pOut == pEnd) return false;
+					*pOut++ = static_cast<uint8_t>(reader.Read(8));
+				}
+
+				if (remaining > 0)
+				{
+					if (reader.IsOverrun() || static_cast<uint32_t>(reader.pEnd - reader.pNext) < remaining ||
+						static_cast<size_t>(pEnd - pOut) < remaining) return false;
+					memcpy(pOut, reader.pNext, remaining);
+					reader.pNext += remaining;
+					reader.Bits = 0;	// Bytes past NumBits that Refill() loaded ahead, now skipped
+					pOut += remaining;
+				}
+				if (reader.IsOverrun()) return false;
+				break;
+			}
+			case 1:
+			{
+				const auto& tables = GetFixedTables();
+				if (!InflateBlock(reader, tables.LitLen.data(), tables.Dist.data(), pStart, pOut, pEnd, pLimit)) return false;
+				break;
+			}
+			case 2:
+				if (!ReadDynamicTables(reader, litLenTable, distTable)) return false;
+				if (!InflateBlock(reader, litLenTable.data(), distTable.data(), pStart, pOut, pEnd, pLimit)) return false;
+				break;
+			default:
+				return false;
+			}
+		}
+
+		// Adler-32 trailer, big-endian from the byte boundary
+		reader.Consume(reader.NumBits & 7);
+		reader.Refill();
+		auto adler = 0u;
+		for (auto i = 0; i < 4; ++i) adler = (adler << 8) | reader.Read(8);
+
+		return pOut == pEnd && !reader.IsOverrun() && adler == ParallelDeflate::Adler32(pStart, size);
+	}
+
+	static inline uint32_t ReadBigEndian32(const uint8_t* pData)
+	{
+		return (pData[0] << 24) | (pData[1] << 16) | (pData[2] << 8) | pData[3];
+	}
+
+	// Channels of the file in big-endian order, to those of the result
+	template<typename T>
+	static inline T LoadChannel(const uint8_t* pSrc);
+
+	template<>
+	inline uint8_t LoadChannel<uint8_t>(const uint8_t* pSrc)
+	{
+		return pSrc[0];
+	}
+
+	template<>
+	inline uint16_t LoadChannel<uint16_t>(const uint8_t* pSrc)
+	{
+		return static_cast<uint16_t>((pSrc[0] << 8) | pSrc[1]);
+	}
+
+	// Gray replicated to RGB, and opaque alpha added, as stbi__convert_format()
+	template<typename T, uint32_t Channels, uint32_t OutChannels>
+	static void ExpandRow(T* pDst, const uint8_t* pSrc, uint32_t width)
+	{
+		const auto opaque = static_cast<T>(~0u);
+		for (auto x = 0u; x < width; ++x)
+		{
+			const auto pTexel = &pSrc[sizeof(T) * Channels * x];
+			const auto pOut = &pDst[OutChannels * x];
+			const auto r = LoadChannel<T>(pTexel);
+			const auto g = Channels >= 3 ? LoadChannel<T>(&pTexel[sizeof(T)]) : r;
+			const auto b = Channels >= 3 ? LoadChannel<T>(&pTexel[2 * sizeof(T)]) : r;
+			const auto a = Channels == 2 ? LoadChannel<T>(&pTexel[sizeof(T)]) : opaque;
+			pOut[0] = r;
+			if (OutChannels == 2) pOut[1] = a;
+			else
+			{
+				pOut[1] = g;
+				pOut[2] = b;
+				if (OutChannels == 4) pOut[3] = a;
+			}
+		}
+	}
+
+	template<typename T>
+	static void ExpandRow(T* pDst, const uint8_t* pSrc, uint32_t width, uint32_t channels, uint32_t outChannels)
+	{
+		switch (channels * 4 + outChannels)
+		{
+		case 1 * 4 + 2: ExpandRow<T, 1, 2>(pDst, pSrc, width); break;
+		case 1 * 4 + 3: ExpandRow<T, 1, 3>(pDst, pSrc, width); break;
+		case 1 * 4 + 4: ExpandRow<T, 1, 4>(pDst, pSrc, width); break;
+		case 2 * 4 + 4: ExpandRow<T, 2, 4>(pDst, pSrc, width); break;
+		case 3 * 4 + 4: ExpandRow<T, 3, 4>(pDst, pSrc, width); break;
+		default: assert(!"Unsupported channel expansion");
+		}
+	}
+
+	static void SwapBytes16(uint8_t* pRow, size_t rowBytes)
+	{
+		for (size_t i = 0; i < rowBytes; i += 2) swap(pRow[i], pRow[i + 1]);
+	}
+
+	// Rows of a file of the bit depth, the channels expanded to reqChannels
+	template<typename T>
+	static T* Decode(const char* fileName, int* pWidth, int* pHeight, int* pChannels, int reqChannels)
+	{
+		static const uint8_t signature[] = { 137, 80, 78, 71, 13, 10, 26, 10 };
+
+		ifstream file(fileName, ios::binary | ios::ate);
+		if (!file) return nullptr;
+		const auto fileSize = static_cast<size_t>(file.tellg());
+		if (fileSize < sizeof(signature)) return nullptr;
+
+		vector<uint8_t> fileData(sizeof(signature));
+		file.seekg(0);
+		if (!file.read(reinterpret_cast<char*>(fileData.data()), sizeof(signature))) return nullptr;
+		if (memcmp(fileData.data(), signature, sizeof(signature)) != 0) return nullptr;
+
+		fileData.resize(fileSize);
+		if (!file.read(reinterpret_cast<char*>(&fileData[sizeof(signature)]), fileSize - sizeof(signature))) return nullptr;
+
+		// IHDR first, the IDAT data packed in place behind the signature; tRNS and the unknown
+		// critical chunks are left to stb_image, as is CgBI that comes before IHDR
+		uint32_t width = 0, height = 0, channels = 0;
+		size_t idatSize = 0;
+		for (auto pos = sizeof(signature); fileSize - pos >= 12;)
+		{
+			const auto length = ReadBigEndian32(&fileData[pos]);
+			const auto pType = reinterpret_cast<const char*>(&fileData[pos + 4]);
+			const auto pChunk = &fileData[pos + 8];
+			if (length > fileSize - pos - 12) return nullptr;
+
+			if (memcmp(pType, "IHDR", 4) == 0)
+			{
+				if (channels || length != 13) return nullptr;
+
+				static const uint8_t channelCounts[] = { 1, 0, 3, 0, 2, 0, 4 };
+				const auto colorType = pChunk[9];
+				width = ReadBigEndian32(pChunk);
+				height = ReadBigEndian32(&pChunk[4]);
+				channels = colorType < sizeof(channelCounts) ? channelCounts[colorType] : 0;
+				if (pChunk[8] != 8 * sizeof(T) || pChunk[10] || pChunk[11] || pChunk[12] || !channels) return nullptr;
+				if (!width || !height || width > MaxDimension || height > MaxDimension) return nullptr;
+			}
+			else if (!channels) return nullptr;
+			else if (memcmp(pType, "IDAT", 4) == 0)
+			{
+				memmove(&fileData[sizeof(signature) + idatSize], pChunk, length);
+				idatSize += length;
+			}
+			else if (memcmp(pType, "IEND", 4) == 0) break;
+			else if (memcmp(pType, "tRNS", 4) == 0) return nullptr;
+			else if (pType[0] >= 'A' && pType[0] <= 'Z' && memcmp(pType, "PLTE", 4) != 0) return nullptr;
+
+			pos += length + 12;
+		}
+		if (!channels || !idatSize) return nullptr;
+
+		const auto outChannels = reqChannels ? static_cast<uint32_t>(reqChannels) : channels;
+		if (outChannels < channels || outChannels > 4 || (channels == 2 && outChannels == 3)) return nullptr;
+
+		const auto bpp = static_cast<uint32_t>(sizeof(T)) * channels;
+		const auto rowBytes = static_cast<size_t>(width) * bpp;
+		const auto outRowBytes = sizeof(T) * outChannels * width;
+		if (outRowBytes + 1 > SIZE_MAX / height) return nullptr;
+
+		// A filter type byte before each row
+		const auto rawRowBytes = rowBytes + 1;
+		unique_ptr<uint8_t[]> raw(new uint8_t[rawRowBytes * height + CopySlack]);
+		if (!Inflate(&fileData[sizeof(signature)], idatSize, raw.get(), rawRowBytes * height)) return nullptr;
+		fileData = vector<uint8_t>();
+
+		const auto pImage = static_cast<uint8_t*>(malloc(outRowBytes * height));
+		if (!pImage) return nullptr;
+
+		// Rows reconstructed in place if the channels are kept, else in 2 rows expanded after
+		const auto& kernels = MipKernels::GetKernels();
+		const MipKernels::UnfilterRowFunc unfilters[] =
+		{ nullptr, kernels.UnfilterSub, kernels.UnfilterUp, kernels.UnfilterAverage, kernels.UnfilterPaeth };
+		const auto isInPlace = outChannels == channels;
+		const vector<uint8_t> zeros(rowBytes);
+		vector<uint8_t> rows(isInPlace ? 0 : 2 * rowBytes);
+		const uint8_t* pPrior = zeros.data();
+		for (auto y = 0u; y < height; ++y)
+		{
+			const auto pRaw = &raw[rawRowBytes * y];
+			const auto pRow = isInPlace ? &pImage[outRowBytes * y] : &rows[rowBytes * (y & 1)];
+			const auto filter = pRaw[0];
+			if (filter > 4)
+			{
+				free(pImage);
+
+				return nullptr;
+			}
+
+			if (filter) unfilters[filter](pRow, &pRaw[1], pPrior, static_cast<uint32_t>(rowBytes), bpp);
+			else memcpy(pRow, &pRaw[1], rowBytes);
+
+			// 16-bit rows in place to native order once the next row is reconstructed
+			if (!isInPlace) ExpandRow(reinterpret_cast<T*>(&pImage[outRowBytes * y]), pRow, width, channels, outChannels);
+			else if (sizeof(T) > 1 && y > 0) SwapBytes16(&pImage[outRowBytes * (y - 1)], rowBytes);
+			pPrior = pRow;
+		}
+		if (isInPlace && sizeof(T) > 1) SwapBytes16(&pImage[outRowBytes * (height - 1)], rowBytes);
+
+		*pWidth = static_cast<int>(width);
+		*pHeight = static_cast<int>(height);
+		*pChannels = static_cast<int>(channels);
+
+		return reinterpret_cast<T*>(pImage);
+	}
+
+	uint8_t* Load(const char* fileName, int* pWidth, int* pHeight, int* pChannels, int reqChannels)
+	{
+		return Decode<uint8_t>(fileName, pWidth, pHeight, pChannels, reqChannels);
+	}
+
+	uint16_t* Load16(const char* fileName, int* pWidth, int* pHeight, int* pChannels, int reqChannels)
+	{
+		return Decode<uint16_t>(fileName, pWidth, pHeight, pChannels, reqChannels);
+	}
+}
@@ -0,0 +1,25 @@
+//--------------------------------------------------------------------------------------
+// Copyright (c) XU, Tianchen. All rights reserved.
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <cstdint>
+
+//--------------------------------------------------------------------------------------
+// PNG decoder for the common files, in front of stb_image: the IDAT stream is inflated
+// through Huffman tables that resolve up to 2 literals per lookup, with a 64-bit bit buffer
+// refilled by whole words, and the rows are reconstructed by MipKernels' Unfilter kernels.
+// It takes the non-interlaced 8- and 16-bit grayscale, gray-alpha, RGB and RGBA files
+// without tRNS; the others are left to stb_image.
+//--------------------------------------------------------------------------------------
+namespace PngDecoder
+{
+	// As stbi_load() and stbi_load_16() of 8- and 16-bit files respectively: *pChannels is
+	// that of the file, and the result has reqChannels (0 for that of the file) channels,
+	// allocated with malloc() so that stbi_image_free() releases it. Returns nullptr for the
+	// files it does not take, including those asking to drop channels, and on any error,
+	// for the callers to fall back to stb_image.
+	uint8_t* Load(const char* fileName, int* pWidth, int* pHeight, int* pChannels, int reqChannels);
+	uint16_t* Load16(const char* fileName, int* pWidth, int* pHeight, int* pChannels, int reqChannels);
+}
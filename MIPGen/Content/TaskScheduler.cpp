@@ -0,0 +1,238 @@
+//--------------------------------------------------------------------------------------
+// Copyright (c) XU, Tianchen. All rights reserved.
+//--------------------------------------------------------------------------------------
+
+#include <cassert>
+#include <algorithm>
+#include <memory>
+#include "TaskScheduler.h"
+
+using namespace std;
+
+// Slot of the current thread, external threads use slot 0
+static thread_local const TaskScheduler* g_pScheduler = nullptr;
+static thread_local uint32_t g_threadIdx = 0;
+
+// Scheduler the current thread works for, set by its workers and for the span of its runs
+static thread_local TaskScheduler* g_pCurrent = nullptr;
+
+// Rounds of failed popping and stealing before an idle thread parks
+static const uint32_t MaxSpins = 256;
+
+TaskScheduler::TaskScheduler(uint32_t numThreads) :
+	m_queues(numThreads ? numThreads : (max)(thread::hardware_concurrency(), 1u)),
+	m_numQueuedJobs(0),
+	m_numSleeping(0),
+	m_quit(false)
+{
+	numThreads = GetThreadCount();
+	m_threads.reserve(numThreads - 1);
+	for (auto i = 1u; i < numThreads; ++i)
+		m_threads.emplace_back(&TaskScheduler::workerLoop, this, i);
+}
+
+TaskScheduler::~TaskScheduler()
+{
+	{
+		lock_guard<mutex> lock(m_mutex);
+		m_quit = true;
+	}
+	m_wakeUp.notify_all();
+
+	for (auto& t : m_threads) t.join();
+}
+
+void TaskScheduler::ParallelFor(uint32_t count, const TaskFunc& func, uint32_t grainSize)
+{
+	if (count == 0) return;
+
+	Batch batch;
+	batch.pFunc = &func;
+	batch.pGraph = nullptr;
+	batch.pPending = nullptr;
+	batch.NumRemaining = count;
+	batch.GrainSize = (max)(grainSize, 1u);
+
+	const auto pPrevious = g_pCurrent;
+	g_pCurrent = this;
+	push(GetThreadIndex(), { &batch, 0, count });
+	wait(batch);
+	g_pCurrent = pPrevious;
+}
+
+void TaskScheduler::Run(const TaskGraph& graph, const TaskFunc& func)
+{
+	const auto numTasks = static_cast<uint32_t>(graph.NumDependencies.size());
+	assert(graph.Successors.size() == numTasks);
+	if (numTasks == 0) return;
+
+	unique_ptr<atomic<uint32_t>[]> pending(new atomic<uint32_t>[numTasks]);
+	for (auto i = 0u; i < numTasks; ++i) pending[i] = graph.NumDependencies[i];
+
+	Batch batch;
+	batch.pFunc = &func;
+	batch.pGraph = &graph;
+	batch.pPending = pending.get();
+	batch.NumRemaining = numTasks;
+	batch.GrainSize = 1;
+
+	// Seed with the tasks without dependencies
+	const auto pPrevious = g_pCurrent;
+	g_pCurrent = this;
+	const auto threadIdx = GetThreadIndex();
+	for (auto i = numTasks; i-- > 0;)
+		if (graph.NumDependencies[i] == 0) push(threadIdx, { &batch, i, i + 1 });
+	wait(batch);
+	g_pCurrent = pPrevious;
+}
+
+uint32_t TaskScheduler::GetThreadCount() const
+{
+	return static_cast<uint32_t>(m_queues.size());
+}
+
+uint32_t TaskScheduler::GetThreadIndex() const
+{
+	return g_pScheduler == this ? g_threadIdx : 0;
+}
+
+TaskScheduler* TaskScheduler::GetCurrent()
+{
+	return g_pCurrent;
+}
+
+void TaskScheduler::workerLoop(uint32_t threadIdx)
+{
+	g_pScheduler = this;
+	g_pCurrent = this;
+	g_threadIdx = threadIdx;
+
+	Job job;
+	auto numSpins = 0u;
+	while (true)
+	{
+		if (pop(threadIdx, job) || steal(threadIdx, job))
+		{
+			execute(threadIdx, job);
+			numSpins = 0;
+		}
+		else if (++numSpins < MaxSpins) this_thread::yield();
+		else
+		{
+			// Park until a job is queued
+			unique_lock<mutex> lock(m_mutex);
+			++m_numSleeping;
+			m_wakeUp.wait(lock, [this]() { return m_quit || m_numQueuedJobs > 0; });
+			--m_numSleeping;
+			if (m_quit) return;
+			numSpins = 0;
+		}
+	}
+}
+
+void TaskScheduler::push(uint32_t threadIdx, const Job& job)
+{
+	{
+		auto& queue = m_queues[threadIdx];
+		lock_guard<mutex> lock(queue.Mutex);
+		queue.Jobs.push_back(job);
+		++m_numQueuedJobs;
+	}
+
+	// A sleeper counted before the job was seen holds m_mutex until it waits
+	if (m_numSleeping > 0)
+	{
+		{ lock_guard<mutex> lock(m_mutex); }
+		m_wakeUp.notify_one();
+	}
+}
+
+void TaskScheduler::execute(uint32_t threadIdx, Job job)
+{
+	auto& batch = *job.pBatch;
+
+	// Split off the upper halves for the thieves
+	while (job.End - job.Begin > batch.GrainSize)
+	{
+		const auto mid = job.Begin + (job.End - job.Begin) / 2;
+		push(threadIdx, { &batch, mid, job.End });
+		job.End = mid;
+	}
+
+	for (auto i = job.Begin; i < job.End; ++i)
+	{
+		(*batch.pFunc)(i);
+
+		// Release the successors whose dependencies are all finished
+		if (batch.pGraph)
+			for (const auto& successor : batch.pGraph->Successors[i])
+				if (batch.pPending[successor].fetch_sub(1, memory_order_acq_rel) == 1)
+					push(threadIdx, { &batch, successor, successor + 1 });
+	}
+
+	// Wake the thread parked in wait() on the last tasks; the batch may be gone once they are counted
+	const auto numTasks = job.End - job.Begin;
+	if (batch.NumRemaining.fetch_sub(numTasks) == numTasks && m_numSleeping > 0)
+	{
+		{ lock_guard<mutex> lock(m_mutex); }
+		m_wakeUp.notify_all();
+	}
+}
+
+void TaskScheduler::wait(Batch& batch)
+{
+	const auto threadIdx = GetThreadIndex();
+
+	// Help until every task of the batch has finished, parking while the last ones run elsewhere
+	Job job;
+	auto numSpins = 0u;
+	while (batch.NumRemaining > 0)
+	{
+		if (pop(threadIdx, job) || steal(threadIdx, job))
+		{
+			execute(threadIdx, job);
+			numSpins = 0;
+		}
+		else if (++numSpins < MaxSpins) this_thread::yield();
+		else
+		{
+			unique_lock<mutex> lock(m_mutex);
+			++m_numSleeping;
+			m_wakeUp.wait(lock, [&batch, this]() { return batch.NumRemaining == 0 || m_numQueuedJobs > 0; });
+			--m_numSleeping;
+			numSpins = 0;
+		}
+	}
+}
+
+bool TaskScheduler::pop(uint32_t threadIdx, Job& job)
+{
+	auto& queue = m_queues[threadIdx];
+	lock_guard<mutex> lock(queue.Mutex);
+	if (queue.Jobs.empty()) return false;
+
+	job = queue.Jobs.back();
+	queue.Jobs.pop_back();
+	--m_numQueuedJobs;
+
+	return true;
+}
+
+bool TaskScheduler::steal(uint32_t threadIdx, Job& job)
+{
+	const auto numQueues = GetThreadCount();
+	for (auto i = 1u; i < numQueues; ++i)
+	{
+		auto& queue = m_queues[(threadIdx + i) % numQueues];
+		unique_lock<mutex> lock(queue.Mutex, try_to_lock);
+		if (!lock.owns_lock() || queue.Jobs.empty()) continue;
+
+		job = queue.Jobs.front();
+		queue.Jobs.pop_front();
+		--m_numQueuedJobs;
+
+		return true;
+	}
+
+	return false;
+}
@@ -0,0 +1,89 @@
+//--------------------------------------------------------------------------------------
+// Copyright (c) XU, Tianchen. All rights reserved.
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <deque>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <functional>
+
+//--------------------------------------------------------------------------------------
+// Work-stealing task scheduler
+// Every thread owns a deque of jobs: it pops from the back (depth first, cache warm),
+// while idle threads steal from the front of others. A job is a range of task indices
+// that gets split in halves until it reaches the grain size, so that big ranges
+// are spread without static partitioning. The calling thread participates.
+// Idle threads keep stealing for a bounded number of rounds, then park until a job
+// is pushed.
+//--------------------------------------------------------------------------------------
+class TaskScheduler
+{
+public:
+	typedef std::function<void(uint32_t)> TaskFunc;
+
+	// Dependencies between tasks of one run: task i starts once all the tasks
+	// listing it as a successor have finished.
+	struct TaskGraph
+	{
+		std::vector<uint32_t> NumDependencies;
+		std::vector<std::vector<uint32_t>> Successors;
+	};
+
+	TaskScheduler(uint32_t numThreads = 0);
+	virtual ~TaskScheduler();
+
+	void ParallelFor(uint32_t count, const TaskFunc& func, uint32_t grainSize = 1);
+	void Run(const TaskGraph& graph, const TaskFunc& func);
+
+	uint32_t GetThreadCount() const;
+	uint32_t GetThreadIndex() const;
+
+	// Scheduler the calling thread works for: the one owning it, or the one whose
+	// ParallelFor() or Run() it is in; nullptr elsewhere. Nested parallel loops run there.
+	static TaskScheduler* GetCurrent();
+
+protected:
+	struct Batch
+	{
+		const TaskFunc* pFunc;
+		const TaskGraph* pGraph;
+		std::atomic<uint32_t>* pPending;
+		std::atomic<uint32_t> NumRemaining;
+		uint32_t GrainSize;
+	};
+
+	struct Job
+	{
+		Batch* pBatch;
+		uint32_t Begin;
+		uint32_t End;
+	};
+
+	struct WorkQueue
+	{
+		std::mutex Mutex;
+		std::deque<Job> Jobs;
+	};
+
+	void workerLoop(uint32_t threadIdx);
+	void push(uint32_t threadIdx, const Job& job);
+	void execute(uint32_t threadIdx, Job job);
+	void wait(Batch& batch);
+	bool pop(uint32_t threadIdx, Job& job);
+	bool steal(uint32_t threadIdx, Job& job);
+
+	std::vector<std::thread>	m_threads;
+	std::vector<WorkQueue>		m_queues;
+
+	std::mutex					m_mutex;
+	std::condition_variable		m_wakeUp;
+	std::atomic<uint32_t>		m_numQueuedJobs;
+	std::atomic<uint32_t>		m_numSleeping;
+	bool						m_quit;
+};
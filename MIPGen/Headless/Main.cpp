@@ -0,0 +1,152 @@
+//--------------------------------------------------------------------------------------
+// Copyright (c) XU, Tianchen. All rights reserved.
+//--------------------------------------------------------------------------------------
+
+#include <cstdio>
+#include <cstdlib>
+#include <cctype>
+#include <string>
+#include <algorithm>
+#include "MipGeneratorCPU.h"
+
+using namespace std;
+
+//--------------------------------------------------------------------------------------
+// Headless driver of MipGeneratorCPU, for bake machines without a GPU: loads an image,
+// generates its chain with the pipeline of MipGenerator of the same name, and writes it
+// into one DDS file (an output ending with .dds) or into a file per level.
+//--------------------------------------------------------------------------------------
+static const char* const g_pipelineNames[] = { "graphics", "compute", "singlepass" };
+static const char* const g_reductionNames[] = { "floatcarry", "packed", "fusedinteger" };
+static const char* const g_filterNames[] = { "bilinear", "box", "tent", "mitchell", "lanczos3", "kaiser" };
+
+static void PrintUsage(const char* appName)
+{
+	printf("Usage: %s -i <image> -o <output> [options]\n"
+		"  -p <graphics|compute|singlepass>         Pipeline, compute by default\n"
+		"  -r <floatcarry|packed|fusedinteger>      Reduction mode of singlepass\n"
+		"  -f <bilinear|box|tent|mitchell|lanczos3|kaiser>  Filter of graphics and compute\n"
+		"  -srgb                                    Filters in linear light\n"
+		"  -premultiplied                           Filters as premultiplied alpha\n"
+		"  -normalxyz, -normalxy [-roughness]       Normal maps, optionally folding roughness\n"
+		"  -alpharef <ref>                          Preserves the alpha-test coverage\n"
+		"  -native                                  Keeps 1- to 3-channel sources native\n"
+		"  -tiled                                   Morton-tiled storage\n"
+		"  -threads <count>                         Threads, 0 for one per core\n"
+		"An output ending with .dds gets the whole chain, any other one a file per level.\n",
+		appName);
+}
+
+template<size_t N>
+static bool FindName(const char* const (&names)[N], const string& name, uint8_t& index)
+{
+	const auto it = find(names, names + N, name);
+	if (it == names + N) return false;
+	index = static_cast<uint8_t>(it - names);
+
+	return true;
+}
+
+int main(int argc, char* argv[])
+{
+	const auto str_tolower = [](string s)
+	{
+		transform(s.begin(), s.end(), s.begin(), [](char c) { return static_cast<char>(tolower(c)); });
+
+		return s;
+	};
+
+	const auto isArgMatched = [&argv, &str_tolower](int i, const char* paramName)
+	{
+		const auto& arg = argv[i];
+
+		return (arg[0] == '-' || arg[0] == '/') && str_tolower(&arg[1]) == paramName;
+	};
+
+	const auto hasNextArgValue = [&argv, &argc](int i)
+	{
+		return i + 1 < argc && argv[i + 1][0] != '-';
+	};
+
+	string fileName, outFileName;
+	uint8_t pipeline = MipGeneratorCPU::COMPUTE;
+	uint8_t reduction = MipGeneratorCPU::FLOAT_CARRY;
+	uint8_t filter = MipGeneratorCPU::BILINEAR;
+	auto normalMap = MipGeneratorCPU::COLOR_MAP;
+	auto layout = MipGeneratorCPU::ROW_MAJOR;
+	auto isSRGB = false, isPremultiplied = false, foldRoughness = false, isNative = false;
+	auto alphaRef = 0.0f;
+	auto numThreads = 0u;
+
+	for (auto i = 1; i < argc; ++i)
+	{
+		auto isValid = true;
+		if (isArgMatched(i, "i") && hasNextArgValue(i)) fileName = argv[++i];
+		else if (isArgMatched(i, "o") && hasNextArgValue(i)) outFileName = argv[++i];
+		else if (isArgMatched(i, "p") && hasNextArgValue(i)) isValid = FindName(g_pipelineNames, str_tolower(argv[++i]), pipeline);
+		else if (isArgMatched(i, "r") && hasNextArgValue(i)) isValid = FindName(g_reductionNames, str_tolower(argv[++i]), reduction);
+		else if (isArgMatched(i, "f") && hasNextArgValue(i)) isValid = FindName(g_filterNames, str_tolower(argv[++i]), filter);
+		else if (isArgMatched(i, "srgb")) isSRGB = true;
+		else if (isArgMatched(i, "premultiplied")) isPremultiplied = true;
+		else if (isArgMatched(i, "normalxyz")) normalMap = MipGeneratorCPU::NORMAL_MAP_XYZ;
+		else if (isArgMatched(i, "normalxy")) normalMap = MipGeneratorCPU::NORMAL_MAP_XY;
+		else if (isArgMatched(i, "roughness")) foldRoughness = true;
+		else if (isArgMatched(i, "alpharef") && hasNextArgValue(i)) alphaRef = static_cast<float>(atof(argv[++i]));
+		else if (isArgMatched(i, "native")) isNative = true;
+		else if (isArgMatched(i, "tiled")) layout = MipGeneratorCPU::MORTON_TILED;
+		else if (isArgMatched(i, "threads") && hasNextArgValue(i)) numThreads = static_cast<uint32_t>(atoi(argv[++i]));
+		else isValid = false;
+
+		if (!isValid)
+		{
+			fprintf(stderr, "Invalid argument: %s\n", argv[i]);
+			PrintUsage(argv[0]);
+
+			return EXIT_FAILURE;
+		}
+	}
+
+	if (fileName.empty() || outFileName.empty())
+	{
+		PrintUsage(argv[0]);
+
+		return EXIT_FAILURE;
+	}
+
+	MipGeneratorCPU mipGenerator;
+	const auto isLoaded = isNative ? mipGenerator.InitNative(fileName.c_str(), numThreads, layout) :
+		mipGenerator.Init(fileName.c_str(), numThreads, layout);
+	if (!isLoaded)
+	{
+		fprintf(stderr, "Failed to load %s\n", fileName.c_str());
+
+		return EXIT_FAILURE;
+	}
+
+	mipGenerator.SetFilter(static_cast<MipGeneratorCPU::FilterType>(filter));
+	mipGenerator.SetSRGB(isSRGB);
+	mipGenerator.SetPremultipliedAlpha(isPremultiplied);
+	mipGenerator.SetNormalMap(normalMap, foldRoughness);
+	mipGenerator.SetAlphaTestRef(alphaRef);
+	mipGenerator.Process(static_cast<MipGeneratorCPU::PipelineType>(pipeline),
+		static_cast<MipGeneratorCPU::ReductionMode>(reduction));
+
+	const auto numMips = mipGenerator.GetMipLevelCount();
+	const auto isDDS = outFileName.size() >= 4 && str_tolower(outFileName.substr(outFileName.size() - 4)) == ".dds";
+	const auto numSaved = isDDS ? (mipGenerator.SaveDDS(outFileName.c_str()) ? numMips : 0) :
+		mipGenerator.SaveMipLevels(outFileName.c_str());
+	if (numSaved < numMips)
+	{
+		fprintf(stderr, "Failed to write %s: %u of %u levels written\n", outFileName.c_str(), numSaved, numMips);
+
+		return EXIT_FAILURE;
+	}
+
+	uint32_t width, height;
+	mipGenerator.GetImageSize(width, height);
+	printf("%s: %ux%u, %u levels with %s on %u threads (%s) to %s\n", fileName.c_str(), width, height, numMips,
+		g_pipelineNames[pipeline], mipGenerator.GetThreadCount(), MipKernels::GetIsaName(mipGenerator.GetKernelIsa()),
+		outFileName.c_str());
+
+	return EXIT_SUCCESS;
+}
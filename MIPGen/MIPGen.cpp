@@ -26,7 +26,8 @@ MIPGen::MIPGen(uint32_t width, uint32_t height, wstring name) :
 	m_pipelineType(MipGenerator::SINGLE_PASS),
 	m_showFPS(true),
 	m_fileName("Assets/Sashimi.png"),
-	m_screenShot(0)
+	m_screenShot(0),
+	m_ddsExport(0)
 {
 #if defined (_DEBUG)
 	_CrtSetDbgFlag(_CRTDBG_ALLOC_MEM_DF | _CRTDBG_LEAK_CHECK_DF);
@@ -284,6 +285,9 @@ void MIPGen::OnKeyUp(uint8_t key)
 	case VK_F11:
 		m_screenShot = 1;
 		break;
+	case 'D':
+		m_ddsExport = 1;
+		break;
 	case 'P':
 		m_pipelineType = static_cast<MipGenerator::PipelineType>((m_pipelineType + 1) % MipGenerator::NUM_PIPE_TYPE);
 		break;
@@ -374,6 +378,14 @@ void MIPGen::PopulateCommandList()
 		m_screenShot = 2;
 	}
 
+	// DDS export helper: the whole chain, as generated by the current pipeline
+	if (m_ddsExport == 1)
+	{
+		m_mipGenerator->ReadBack(pCommandList, ResourceState::PIXEL_SHADER_RESOURCE |
+			ResourceState::NON_PIXEL_SHADER_RESOURCE);
+		m_ddsExport = 2;
+	}
+
 	XUSG_N_RETURN(pCommandList->Close(), ThrowIfFailed(E_FAIL));
 }
 
@@ -425,6 +437,21 @@ void MIPGen::MoveToNextFrame()
 		}
 		else ++m_screenShot;
 	}
+
+	// DDS export helper
+	if (m_ddsExport)
+	{
+		if (m_ddsExport > FrameCount)
+		{
+			char timeStr[15];
+			tm dateTime;
+			const auto now = time(nullptr);
+			if (!localtime_s(&dateTime, &now) && strftime(timeStr, sizeof(timeStr), "%Y%m%d%H%M%S", &dateTime))
+				m_mipGenerator->SaveDDS((string("MIPGen_") + timeStr + ".dds").c_str());
+			m_ddsExport = 0;
+		}
+		else ++m_ddsExport;
+	}
 }
 
 void MIPGen::SaveImage(char const* fileName, Buffer* pImageBuffer, uint32_t w, uint32_t h, uint32_t rowPitch, uint8_t comp)
@@ -433,18 +460,22 @@ void MIPGen::SaveImage(char const* fileName, Buffer* pImageBuffer, uint32_t w, u
 	const auto pData = static_cast<const uint8_t*>(pImageBuffer->Map(nullptr));
 
 	//stbi_write_png_compression_level = 1024;
-	vector<uint8_t> imageData(comp * w * h);
-	const auto sw = rowPitch / 4; // Byte to pixel
-	for (auto i = 0u; i < h; ++i)
-		for (auto j = 0u; j < w; ++j)
+	if (comp == 4) stbi_write_png(fileName, w, h, comp, pData, rowPitch);	// Straight from the pitched rows
+	else
+	{
+		// Alpha dropped
+		vector<uint8_t> imageData(comp * w * h);
+		for (auto i = 0u; i < h; ++i)
 		{
-			const auto s = sw * i + j;
-			const auto d = w * i + j;
-			for (uint8_t k = 0; k < comp; ++k)
-				imageData[comp * d + k] = pData[4 * s + k];
+			const auto pSrcRow = &pData[rowPitch * i];
+			const auto pDstRow = &imageData[comp * w * i];
+			for (auto j = 0u; j < w; ++j)
+				for (uint8_t k = 0; k < comp; ++k)
+					pDstRow[comp * j + k] = pSrcRow[4 * j + k];
 		}
 
-	stbi_write_png(fileName, w, h, comp, imageData.data(), 0);
+		stbi_write_png(fileName, w, h, comp, imageData.data(), comp * w);
+	}
 
 	pImageBuffer->Unmap();
 }
@@ -485,7 +516,7 @@ double MIPGen::CalculateFrameStats(float* pTimeStep)
 		}
 
 		windowText << L"    [\x2191][\x2193] MIP-level: " << m_mipLevel;
-		windowText << L"    [F11] screen shot";
+		windowText << L"    [F11] screen shot    [D] DDS export";
 
 		SetCustomWindowText(windowText.str().c_str());
 	}
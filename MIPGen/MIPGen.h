@@ -81,10 +81,11 @@ private:
 	// User external settings
 	std::string m_fileName;
 
-	// Screen-shot helpers and state
+	// Screen-shot and DDS export helpers and state
 	XUSG::Buffer::uptr	m_readBuffer;
 	uint32_t			m_rowPitch;
 	uint8_t				m_screenShot;
+	uint8_t				m_ddsExport;
 
 	void LoadPipeline(std::vector<XUSG::Resource::uptr>& uploaders);
 	void LoadAssets();
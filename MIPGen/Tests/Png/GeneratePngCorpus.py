@@ -0,0 +1,135 @@
+#--------------------------------------------------------------------------------------
+# Generates the PNG corpus of TestPngDecoder: every color type and bit depth PngDecoder
+# takes, over each kind of deflate block zlib writes, the rows cycling through the 5
+# filters and the IDAT data split into chunks of various sizes; then files it leaves to
+# stb_image and files it must reject. Run from this directory; the output is deterministic
+# for a given zlib.
+#--------------------------------------------------------------------------------------
+import random
+import struct
+import zlib
+
+# Channels of the color types
+CHANNELS = { 0: 1, 2: 3, 4: 2, 6: 4 }
+COLOR_NAMES = { 0: 'gray', 2: 'rgb', 4: 'ga', 6: 'rgba' }
+
+# zlib level and strategy of each block kind
+BLOCKS = {
+	'stored': (0, zlib.Z_DEFAULT_STRATEGY),
+	'fixed': (9, zlib.Z_FIXED),
+	'dynamic': (9, zlib.Z_DEFAULT_STRATEGY),
+	'rle': (9, zlib.Z_RLE),
+	'huffman': (9, zlib.Z_HUFFMAN_ONLY)
+}
+
+def chunk(chunkType, data):
+	return struct.pack('>I', len(data)) + chunkType + data + struct.pack('>I', zlib.crc32(chunkType + data) & 0xffffffff)
+
+def paeth(a, b, c):
+	p = a + b - c
+	pa, pb, pc = abs(p - a), abs(p - b), abs(p - c)
+	return a if pa <= pb and pa <= pc else (b if pb <= pc else c)
+
+# Gradients with noise, which every filter predicts differently; noise only is incompressible
+def image(rng, width, height, numChannels, depth, noise):
+	rowBytes = width * numChannels * depth // 8
+	rows = []
+	for y in range(height):
+		row = bytearray(rowBytes)
+		for i in range(rowBytes):
+			x = i // (numChannels * depth // 8)
+			row[i] = rng.randrange(256) if noise or (depth == 16 and i % 2) else (3 * x * (i % numChannels + 1) + 5 * y + rng.randrange(7)) & 0xff
+		rows.append(row)
+	return rows
+
+# The filter of row y is y % 5, unless given
+def filterRows(rows, bpp, filterType=None):
+	raw = bytearray()
+	prior = bytearray(len(rows[0]))
+	for y, row in enumerate(rows):
+		f = y % 5 if filterType is None else filterType
+		raw.append(f)
+		for i in range(len(row)):
+			a = row[i - bpp] if i >= bpp else 0
+			b = prior[i]
+			c = prior[i - bpp] if i >= bpp else 0
+			raw.append((row[i] - [0, a, b, (a + b) // 2, paeth(a, b, c)][f]) & 0xff)
+		prior = row
+	return bytes(raw)
+
+def compress(rng, raw, level, strategy, flushEvery=0, memLevel=9):
+	compressor = zlib.compressobj(level, zlib.DEFLATED, 15, memLevel, strategy)
+	if not flushEvery:
+		return compressor.compress(raw) + compressor.flush()
+
+	# Sync and full flushes end the blocks mid-row with empty stored blocks
+	stream = b''
+	for i in range(0, len(raw), flushEvery):
+		stream += compressor.compress(raw[i:i + flushEvery])
+		stream += compressor.flush(rng.choice([zlib.Z_SYNC_FLUSH, zlib.Z_FULL_FLUSH, zlib.Z_NO_FLUSH]))
+	return stream + compressor.flush()
+
+def write(fileName, width, height, colorType, depth, stream, idatSize, extraChunks=b''):
+	data = b'\x89PNG\r\n\x1a\n' + chunk(b'IHDR', struct.pack('>IIBBBBB', width, height, depth, colorType, 0, 0, 0))
+	data += extraChunks
+	for i in range(0, len(stream), idatSize):
+		data += chunk(b'IDAT', stream[i:i + idatSize])
+	data += chunk(b'IEND', b'')
+	with open(fileName, 'wb') as f:
+		f.write(data)
+
+def main():
+	rng = random.Random(23)
+
+	# Each color type, depth and block kind, split into 7-byte to whole IDATs
+	for colorType, numChannels in CHANNELS.items():
+		for depth in (8, 16):
+			for blockName, (level, strategy) in BLOCKS.items():
+				width, height = rng.choice([(33, 20), (17, 11), (40, 25)])
+				rows = image(rng, width, height, numChannels, depth, False)
+				raw = filterRows(rows, numChannels * depth // 8)
+				stream = compress(rng, raw, level, strategy)
+				fileName = '%s%d_%s.png' % (COLOR_NAMES[colorType], depth, blockName)
+				write(fileName, width, height, colorType, depth, stream, rng.choice([7, 100, 1 << 20]))
+
+	# Streams flushed mid-row, a single pixel, many small blocks around noise, and 1-byte IDATs
+	for colorType, depth in ((6, 8), (2, 16), (0, 8)):
+		numChannels = CHANNELS[colorType]
+		rows = image(rng, 61, 40, numChannels, depth, False)
+		stream = compress(rng, filterRows(rows, numChannels * depth // 8), 6, zlib.Z_DEFAULT_STRATEGY, 33)
+		write('%s%d_flush.png' % (COLOR_NAMES[colorType], depth), 61, 40, colorType, depth, stream, 64)
+
+	for colorType, numChannels in CHANNELS.items():
+		rows = image(rng, 1, 1, numChannels, 8, False)
+		stream = compress(rng, filterRows(rows, numChannels, 4), 9, zlib.Z_DEFAULT_STRATEGY)
+		write('%s8_1x1.png' % COLOR_NAMES[colorType], 1, 1, colorType, 8, stream, 1 << 20)
+
+	rows = image(rng, 64, 40, 4, 8, False)
+	rows[15:25] = image(rng, 64, 10, 4, 8, True)
+	stream = compress(rng, filterRows(rows, 4), 6, zlib.Z_DEFAULT_STRATEGY, memLevel=1)
+	write('rgba8_blocks.png', 64, 40, 6, 8, stream, 8192)
+
+	rows = image(rng, 17, 11, 1, 8, False)
+	write('gray8_split.png', 17, 11, 0, 8, compress(rng, filterRows(rows, 1), 9, 0), 1)
+
+	# Left to stb_image: palette, tRNS, and 4-bit gray
+	rows = [bytearray(rng.randrange(4) for x in range(19)) for y in range(9)]
+	palette = bytes(rng.randrange(256) for i in range(12))
+	write('palette8.png', 19, 9, 3, 8, compress(rng, filterRows(rows, 1), 9, 0), 1 << 20, chunk(b'PLTE', palette))
+
+	rows = image(rng, 19, 9, 3, 8, False)
+	write('rgb8_trns.png', 19, 9, 2, 8, compress(rng, filterRows(rows, 3), 9, 0), 1 << 20, chunk(b'tRNS', b'\0\1\0\2\0\3'))
+
+	rows = [bytearray(rng.randrange(256) for x in range(10)) for y in range(9)]
+	write('gray4.png', 19, 9, 0, 4, compress(rng, filterRows(rows, 1), 9, 0), 1 << 20)
+
+	# Rejected for a wrong Adler-32, in a compressed and a stored stream
+	for blockName in ('dynamic', 'stored'):
+		level, strategy = BLOCKS[blockName]
+		rows = image(rng, 33, 20, 3, 8, False)
+		stream = compress(rng, filterRows(rows, 3), level, strategy)
+		stream = stream[:-1] + bytes([stream[-1] ^ 1])
+		write('bad_adler_%s.png' % blockName, 33, 20, 2, 8, stream, 1 << 20)
+
+if __name__ == '__main__':
+	main()
@@ -0,0 +1,73 @@
+//--------------------------------------------------------------------------------------
+// Copyright (c) XU, Tianchen. All rights reserved.
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+//--------------------------------------------------------------------------------------
+// Checks of the portable tests: each test is an executable run by CTest, which reports
+// every failed check and returns the number of failures.
+//--------------------------------------------------------------------------------------
+namespace TestCommon
+{
+	inline uint32_t& NumFailures()
+	{
+		static auto numFailures = 0u;
+
+		return numFailures;
+	}
+
+	// Returns the condition, so that a test can stop at the first failure of a loop
+	inline bool Check(bool condition, const char* pExpression, const char* pFile, int line)
+	{
+		if (!condition)
+		{
+			fprintf(stderr, "%s(%d): check failed: %s\n", pFile, line, pExpression);
+			++NumFailures();
+		}
+
+		return condition;
+	}
+
+	inline int Report(const char* pTestName)
+	{
+		printf("%s: %u failure(s)\n", pTestName, NumFailures());
+
+		return NumFailures() > 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+	}
+
+	// xorshift64*, reproducible across platforms unlike rand()
+	class Random
+	{
+	public:
+		Random(uint64_t seed = 0x9e3779b97f4a7c15ull) : m_state(seed ? seed : 1) {}
+
+		uint32_t operator()()
+		{
+			m_state ^= m_state >> 12;
+			m_state ^= m_state << 25;
+			m_state ^= m_state >> 27;
+
+			return static_cast<uint32_t>((m_state * 0x2545f4914f6cdd1dull) >> 32);
+		}
+
+		// In [0, n)
+		uint32_t operator()(uint32_t n) { return static_cast<uint32_t>((static_cast<uint64_t>((*this)()) * n) >> 32); }
+
+		template<typename T>
+		void Fill(std::vector<T>& values, uint32_t n)
+		{
+			for (auto& value : values) value = static_cast<T>((*this)(n));
+		}
+
+	protected:
+		uint64_t m_state;
+	};
+}
+
+#define TEST_CHECK(condition) TestCommon::Check((condition), #condition, __FILE__, __LINE__)
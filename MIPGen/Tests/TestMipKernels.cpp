@@ -0,0 +1,512 @@
+//--------------------------------------------------------------------------------------
+// Copyright (c) XU, Tianchen. All rights reserved.
+//--------------------------------------------------------------------------------------
+
+#include <cstring>
+#include <cmath>
+#include <functional>
+#include "MipGeneratorCPU.h"
+#include "TestCommon.h"
+
+using namespace std;
+using namespace MipKernels;
+using namespace TestCommon;
+
+//--------------------------------------------------------------------------------------
+// Every kernel of every ISA the CPU runs against its scalar reference, bit for bit, on
+// random rows of odd sizes around the vector widths; then the CPU generator against
+// exact references: FUSED_INTEGER against 64-bit box sums past 4096, and COMPUTE and
+// SINGLE_PASS against GRAPHICS where every level is an exact half.
+//--------------------------------------------------------------------------------------
+static const uint32_t g_sizes[] = { 1, 3, 5, 7, 9, 15, 17, 31, 33, 63, 65, 127, 129, 333 };
+static const char* g_pIsaName = "";
+
+static bool CheckKernel(bool isEqual, const char* pKernel, uint32_t size)
+{
+	if (!isEqual) fprintf(stderr, "%s of %s differs from the scalar one at size %u\n", pKernel, g_pIsaName, size);
+
+	return TEST_CHECK(isEqual);
+}
+
+template<typename T>
+static bool IsEqual(const vector<T>& a, const vector<T>& b)
+{
+	return a.size() == b.size() && memcmp(a.data(), b.data(), sizeof(T) * a.size()) == 0;
+}
+
+static float RandomFloat(Random& rng, float minVal, float maxVal)
+{
+	return minVal + (maxVal - minVal) * static_cast<float>(rng(1 << 24)) / (1 << 24);
+}
+
+//--------------------------------------------------------------------------------------
+// 2x2 reductions: rows of 2 * width texels of the given element count, and quads
+//--------------------------------------------------------------------------------------
+template<typename TDst, typename TSrc>
+static void TestRows(const char* pKernel, void (*func)(TDst*, const TSrc*, const TSrc*, uint32_t),
+	void (*ref)(TDst*, const TSrc*, const TSrc*, uint32_t), uint32_t numElements,
+	const function<TSrc(Random&)>& random, Random& rng)
+{
+	if (func == ref) return;
+
+	for (const auto width : g_sizes)
+	{
+		vector<TSrc> row0(2 * width * numElements), row1(row0.size());
+		for (auto& value : row0) value = random(rng);
+		for (auto& value : row1) value = random(rng);
+
+		vector<TDst> result(width * numElements), expected(result.size());
+		func(result.data(), row0.data(), row1.data(), width);
+		ref(expected.data(), row0.data(), row1.data(), width);
+		if (!CheckKernel(IsEqual(result, expected), pKernel, width)) return;
+	}
+}
+
+template<typename TDst, typename TSrc>
+static void TestQuads(const char* pKernel, void (*func)(TDst*, const TSrc*, uint32_t),
+	void (*ref)(TDst*, const TSrc*, uint32_t), uint32_t numElements,
+	const function<TSrc(Random&)>& random, Random& rng)
+{
+	if (func == ref) return;
+
+	for (const auto count : g_sizes)
+	{
+		vector<TSrc> src(4 * count * numElements);
+		for (auto& value : src) value = random(rng);
+
+		vector<TDst> result(count * numElements), expected(result.size());
+		func(result.data(), src.data(), count);
+		ref(expected.data(), src.data(), count);
+		if (!CheckKernel(IsEqual(result, expected), pKernel, count)) return;
+	}
+}
+
+static void TestNormals(const KernelTable& kernels, const KernelTable& ref, Random& rng)
+{
+	for (auto flags = 0u; flags <= (NORMAL_XY | NORMAL_ROUGHNESS); ++flags)
+		for (const auto width : g_sizes)
+		{
+			vector<uint8_t> row0(8 * width), row1(8 * width);
+			rng.Fill(row0, 256);
+			rng.Fill(row1, 256);
+
+			vector<uint8_t> result(4 * width), expected(4 * width);
+			if (kernels.DownSampleNormalsRGBA8 != ref.DownSampleNormalsRGBA8)
+			{
+				kernels.DownSampleNormalsRGBA8(result.data(), row0.data(), row1.data(), width, flags);
+				ref.DownSampleNormalsRGBA8(expected.data(), row0.data(), row1.data(), width, flags);
+				if (!CheckKernel(IsEqual(result, expected), "DownSampleNormalsRGBA8", width)) return;
+			}
+
+			if (kernels.DownSampleQuadsNormalsRGBA8 != ref.DownSampleQuadsNormalsRGBA8)
+			{
+				kernels.DownSampleQuadsNormalsRGBA8(result.data(), row0.data(), width / 2, flags);
+				ref.DownSampleQuadsNormalsRGBA8(expected.data(), row0.data(), width / 2, flags);
+				if (!CheckKernel(IsEqual(result, expected), "DownSampleQuadsNormalsRGBA8", width / 2)) return;
+			}
+		}
+}
+
+//--------------------------------------------------------------------------------------
+// Sums of the exact reduction, box rows and polyphase passes
+//--------------------------------------------------------------------------------------
+static void TestRoundSums(const KernelTable& kernels, const KernelTable& ref, Random& rng)
+{
+	if (kernels.RoundSums16 == ref.RoundSums16) return;
+
+	for (auto shift = 2u; shift <= 8; ++shift)
+		for (const auto count : g_sizes)
+		{
+			vector<uint16_t> sums(4 * count);
+			rng.Fill(sums, (255u << shift) + 1);
+
+			vector<uint8_t> result(4 * count), expected(4 * count);
+			kernels.RoundSums16(result.data(), sums.data(), count, shift);
+			ref.RoundSums16(expected.data(), sums.data(), count, shift);
+			if (!CheckKernel(IsEqual(result, expected), "RoundSums16", count)) return;
+		}
+}
+
+static void TestBoxRows(const KernelTable& kernels, const KernelTable& ref, Random& rng)
+{
+	if (kernels.BoxRowRGBA8 == ref.BoxRowRGBA8) return;
+
+	for (const auto dstWidth : g_sizes)
+		for (auto srcWidth = 2 * dstWidth; srcWidth <= 2 * dstWidth + 1; ++srcWidth)
+			for (auto numRows = 1u; numRows <= 3; ++numRows)
+			{
+				// Rows of 2 or 3 taps of a box, and a single row of weight 1
+				float rowWeights[3] = { 1.0f };
+				if (numRows > 1) GetBoxTaps(rng(4), numRows == 2 ? 8 : 9, rowWeights);
+
+				vector<vector<uint8_t>> rows(numRows, vector<uint8_t>(4 * srcWidth));
+				for (auto& row : rows) rng.Fill(row, 256);
+
+				const auto x0 = rng(dstWidth);
+				const uint8_t* ppRows[3];
+				for (auto r = 0u; r < numRows; ++r) ppRows[r] = &rows[r][8 * x0];
+
+				vector<uint8_t> result(4 * (dstWidth - x0)), expected(result.size());
+				kernels.BoxRowRGBA8(result.data(), ppRows, rowWeights, numRows, x0, dstWidth, srcWidth);
+				ref.BoxRowRGBA8(expected.data(), ppRows, rowWeights, numRows, x0, dstWidth, srcWidth);
+				if (!CheckKernel(IsEqual(result, expected), "BoxRowRGBA8", srcWidth)) return;
+			}
+}
+
+static void TestFilters(const KernelTable& kernels, const KernelTable& ref, Random& rng)
+{
+	for (auto filter = MipGeneratorCPU::TENT; filter <= MipGeneratorCPU::KAISER;
+		filter = static_cast<MipGeneratorCPU::FilterType>(filter + 1))
+		for (const auto dstSize : g_sizes)
+			for (auto srcSize = 2 * dstSize; srcSize <= 2 * dstSize + 1; ++srcSize)
+			{
+				FilterTaps taps;
+				MipGeneratorCPU::BuildFilterTaps(filter, dstSize, srcSize, taps);
+
+				// Horizontal pass over a whole row
+				vector<uint8_t> src(4 * srcSize);
+				rng.Fill(src, 256);
+
+				vector<float> result(4 * dstSize), expected(result.size());
+				if (kernels.FilterRowRGBA8 != ref.FilterRowRGBA8)
+				{
+					kernels.FilterRowRGBA8(result.data(), src.data(), 0, taps.First.data(), taps.Weights.data(), taps.NumTaps, dstSize);
+					ref.FilterRowRGBA8(expected.data(), src.data(), 0, taps.First.data(), taps.Weights.data(), taps.NumTaps, dstSize);
+					if (!CheckKernel(IsEqual(result, expected), "FilterRowRGBA8", srcSize)) return;
+				}
+
+				// Vertical pass over rows with the negative lobes and overshoots to saturate
+				if (kernels.FilterColumnsRGBA8 != ref.FilterColumnsRGBA8)
+				{
+					vector<vector<float>> rows(taps.NumTaps, vector<float>(4 * dstSize));
+					vector<const float*> ppRows(taps.NumTaps);
+					for (auto t = 0u; t < taps.NumTaps; ++t)
+					{
+						for (auto& value : rows[t]) value = RandomFloat(rng, -32.0f, 287.0f);
+						ppRows[t] = rows[t].data();
+					}
+
+					const auto pWeights = &taps.Weights[taps.NumTaps * rng(dstSize)];
+					vector<uint8_t> texels(4 * dstSize), expectedTexels(texels.size());
+					kernels.FilterColumnsRGBA8(texels.data(), ppRows.data(), pWeights, taps.NumTaps, dstSize);
+					ref.FilterColumnsRGBA8(expectedTexels.data(), ppRows.data(), pWeights, taps.NumTaps, dstSize);
+					if (!CheckKernel(IsEqual(texels, expectedTexels), "FilterColumnsRGBA8", dstSize)) return;
+				}
+			}
+}
+
+static void TestScaleAlpha(const KernelTable& kernels, const KernelTable& ref, Random& rng)
+{
+	if (kernels.ScaleAlphaRGBA8 == ref.ScaleAlphaRGBA8) return;
+
+	for (const auto count : g_sizes)
+	{
+		vector<uint8_t> result(4 * count);
+		rng.Fill(result, 256);
+		auto expected = result;
+
+		// Down to 0 and up to saturation
+		const auto scale = rng(1 << 18);
+		kernels.ScaleAlphaRGBA8(result.data(), count, scale);
+		ref.ScaleAlphaRGBA8(expected.data(), count, scale);
+		if (!CheckKernel(IsEqual(result, expected), "ScaleAlphaRGBA8", count)) return;
+	}
+}
+
+//--------------------------------------------------------------------------------------
+// Half conversions, exhaustive from halves and over the float classes to halves
+//--------------------------------------------------------------------------------------
+static void TestHalves(const KernelTable& kernels, const KernelTable& ref, Random& rng)
+{
+	if (kernels.HalfToFloat != ref.HalfToFloat)
+	{
+		vector<uint16_t> halves(0x10000);
+		for (auto i = 0u; i < 0x10000; ++i) halves[i] = static_cast<uint16_t>(i);
+
+		vector<float> result(halves.size()), expected(halves.size());
+		kernels.HalfToFloat(result.data(), halves.data(), static_cast<uint32_t>(halves.size()));
+		ref.HalfToFloat(expected.data(), halves.data(), static_cast<uint32_t>(halves.size()));
+		CheckKernel(IsEqual(result, expected), "HalfToFloat", static_cast<uint32_t>(halves.size()));
+	}
+
+	if (kernels.FloatToHalf != ref.FloatToHalf)
+	{
+		// Random bit patterns cover NaNs, infinities, overflows and denormals; the ties to
+		// even and the edges of the half range are added
+		vector<float> floats(1 << 16);
+		for (auto& value : floats)
+		{
+			const auto bits = rng();
+			memcpy(&value, &bits, sizeof(float));
+		}
+		const float edges[] = { 0.0f, -0.0f, 65504.0f, 65519.99f, 65520.0f, 6.1035156e-05f, 5.9604645e-08f,
+			2.9802322e-08f, 1.0f + 1.0f / 2048, 1.0f + 3.0f / 2048, INFINITY, -INFINITY, NAN };
+		memcpy(floats.data(), edges, sizeof(edges));
+
+		for (const auto count : g_sizes)
+		{
+			vector<uint16_t> result(count), expected(count);
+			const auto pSrc = &floats[rng(static_cast<uint32_t>(floats.size()) - count)];
+			kernels.FloatToHalf(result.data(), count == 1 ? floats.data() : pSrc, count);
+			ref.FloatToHalf(expected.data(), count == 1 ? floats.data() : pSrc, count);
+			if (!CheckKernel(IsEqual(result, expected), "FloatToHalf", count)) return;
+		}
+
+		vector<uint16_t> result(floats.size()), expected(floats.size());
+		kernels.FloatToHalf(result.data(), floats.data(), static_cast<uint32_t>(floats.size()));
+		ref.FloatToHalf(expected.data(), floats.data(), static_cast<uint32_t>(floats.size()));
+		CheckKernel(IsEqual(result, expected), "FloatToHalf", static_cast<uint32_t>(floats.size()));
+	}
+}
+
+//--------------------------------------------------------------------------------------
+// Morton codes, match lengths and PNG unfiltering
+//--------------------------------------------------------------------------------------
+static void TestMorton(const KernelTable& kernels, const KernelTable& ref, Random& rng)
+{
+	if (kernels.MortonEncode == ref.MortonEncode && kernels.MortonDecode == ref.MortonDecode) return;
+
+	for (auto i = 0u; i < 100000; ++i)
+	{
+		const auto x = rng(0x10000), y = rng(0x10000), code = rng();
+		uint32_t x0, y0, x1, y1;
+		kernels.MortonDecode(code, x0, y0);
+		ref.MortonDecode(code, x1, y1);
+		if (!CheckKernel(kernels.MortonEncode(x, y) == ref.MortonEncode(x, y) && x0 == x1 && y0 == y1, "Morton", i)) return;
+	}
+}
+
+static void TestMatchLength(const KernelTable& kernels, const KernelTable& ref, Random& rng)
+{
+	if (kernels.MatchLength == ref.MatchLength) return;
+
+	for (auto maxLength = 0u; maxLength <= 300; ++maxLength)
+	{
+		vector<uint8_t> a(maxLength), b(maxLength);
+		rng.Fill(a, 256);
+		b = a;
+		if (maxLength > 0 && rng(4)) b[rng(maxLength)] ^= static_cast<uint8_t>(1 + rng(255));
+
+		if (!CheckKernel(kernels.MatchLength(a.data(), b.data(), maxLength) ==
+			ref.MatchLength(a.data(), b.data(), maxLength), "MatchLength", maxLength)) return;
+	}
+}
+
+static void TestUnfilter(const char* pKernel, UnfilterRowFunc func, UnfilterRowFunc ref, Random& rng)
+{
+	if (func == ref) return;
+
+	for (auto bpp = 1u; bpp <= 8; ++bpp)
+		for (const auto width : g_sizes)
+		{
+			const auto rowBytes = bpp * width;
+			vector<uint8_t> src(rowBytes), prior(rowBytes);
+			rng.Fill(src, 256);
+			rng.Fill(prior, 256);
+
+			vector<uint8_t> result(rowBytes), expected(rowBytes);
+			func(result.data(), src.data(), prior.data(), rowBytes, bpp);
+			ref(expected.data(), src.data(), prior.data(), rowBytes, bpp);
+			if (!CheckKernel(IsEqual(result, expected), pKernel, rowBytes)) return;
+		}
+}
+
+static void TestKernels(const KernelTable& kernels, const KernelTable& ref)
+{
+	Random rng(kernels.SelectedIsa + 1);
+	const function<uint8_t(Random&)> random8 = [](Random& rng) { return static_cast<uint8_t>(rng(256)); };
+	const function<uint16_t(Random&)> random16 = [](Random& rng) { return static_cast<uint16_t>(rng(0x10000)); };
+	const function<uint16_t(Random&)> randomSums = [](Random& rng) { return static_cast<uint16_t>(rng(255 * 64 + 1)); };
+	const function<float(Random&)> randomFloat = [](Random& rng) { return RandomFloat(rng, -4.0f, 12.0f); };
+	const function<uint16_t(Random&)> randomHalf = [](Random& rng) { return FloatToHalf(RandomFloat(rng, -4.0f, 12.0f)); };
+
+	// Bytes per texel: RGBA8 4, R8 1, RG8 2, RGB8 3, R16 2, RG16 4
+	TestRows("DownSampleRGBA8", kernels.DownSampleRGBA8, ref.DownSampleRGBA8, 4, random8, rng);
+	TestQuads("DownSampleQuadsRGBA8", kernels.DownSampleQuadsRGBA8, ref.DownSampleQuadsRGBA8, 4, random8, rng);
+	TestRows("SumRowRGBA8", kernels.SumRowRGBA8, ref.SumRowRGBA8, 4, random8, rng);
+	TestQuads("SumQuadsRGBA8", kernels.SumQuadsRGBA8, ref.SumQuadsRGBA8, 4, random8, rng);
+	TestQuads("SumQuads16", kernels.SumQuads16, ref.SumQuads16, 4, randomSums, rng);
+	TestRoundSums(kernels, ref, rng);
+	TestBoxRows(kernels, ref, rng);
+	TestRows("DownSampleSRGBA8", kernels.DownSampleSRGBA8, ref.DownSampleSRGBA8, 4, random8, rng);
+	TestQuads("DownSampleQuadsSRGBA8", kernels.DownSampleQuadsSRGBA8, ref.DownSampleQuadsSRGBA8, 4, random8, rng);
+	TestRows("DownSamplePremulRGBA8", kernels.DownSamplePremulRGBA8, ref.DownSamplePremulRGBA8, 4, random8, rng);
+	TestQuads("DownSampleQuadsPremulRGBA8", kernels.DownSampleQuadsPremulRGBA8, ref.DownSampleQuadsPremulRGBA8, 4, random8, rng);
+	TestNormals(kernels, ref, rng);
+	TestFilters(kernels, ref, rng);
+	TestScaleAlpha(kernels, ref, rng);
+	TestRows("DownSampleR8", kernels.DownSampleR8, ref.DownSampleR8, 1, random8, rng);
+	TestQuads("DownSampleQuadsR8", kernels.DownSampleQuadsR8, ref.DownSampleQuadsR8, 1, random8, rng);
+	TestRows("DownSampleRG8", kernels.DownSampleRG8, ref.DownSampleRG8, 2, random8, rng);
+	TestQuads("DownSampleQuadsRG8", kernels.DownSampleQuadsRG8, ref.DownSampleQuadsRG8, 2, random8, rng);
+	TestRows("DownSampleRGB8", kernels.DownSampleRGB8, ref.DownSampleRGB8, 3, random8, rng);
+	TestQuads("DownSampleQuadsRGB8", kernels.DownSampleQuadsRGB8, ref.DownSampleQuadsRGB8, 3, random8, rng);
+	TestRows("DownSampleR16", kernels.DownSampleR16, ref.DownSampleR16, 2, random8, rng);
+	TestQuads("DownSampleQuadsR16", kernels.DownSampleQuadsR16, ref.DownSampleQuadsR16, 2, random8, rng);
+	TestRows("DownSampleRG16", kernels.DownSampleRG16, ref.DownSampleRG16, 4, random8, rng);
+	TestQuads("DownSampleQuadsRG16", kernels.DownSampleQuadsRG16, ref.DownSampleQuadsRG16, 4, random8, rng);
+	TestRows("DownSampleRGBA16", kernels.DownSampleRGBA16, ref.DownSampleRGBA16, 4, random16, rng);
+	TestQuads("DownSampleQuadsRGBA16", kernels.DownSampleQuadsRGBA16, ref.DownSampleQuadsRGBA16, 4, random16, rng);
+	TestHalves(kernels, ref, rng);
+	TestRows("DownSampleRGBA32F", kernels.DownSampleRGBA32F, ref.DownSampleRGBA32F, 4, randomFloat, rng);
+	TestQuads("DownSampleQuadsRGBA32F", kernels.DownSampleQuadsRGBA32F, ref.DownSampleQuadsRGBA32F, 4, randomFloat, rng);
+	TestRows("DownSampleRGBA16F", kernels.DownSampleRGBA16F, ref.DownSampleRGBA16F, 4, randomHalf, rng);
+	TestQuads("DownSampleQuadsRGBA16F", kernels.DownSampleQuadsRGBA16F, ref.DownSampleQuadsRGBA16F, 4, randomHalf, rng);
+	TestMorton(kernels, ref, rng);
+	TestMatchLength(kernels, ref, rng);
+	TestUnfilter("UnfilterSub", kernels.UnfilterSub, ref.UnfilterSub, rng);
+	TestUnfilter("UnfilterUp", kernels.UnfilterUp, ref.UnfilterUp, rng);
+	TestUnfilter("UnfilterAverage", kernels.UnfilterAverage, ref.UnfilterAverage, rng);
+	TestUnfilter("UnfilterPaeth", kernels.UnfilterPaeth, ref.UnfilterPaeth, rng);
+}
+
+//--------------------------------------------------------------------------------------
+// Generator checks, on the best kernels
+//--------------------------------------------------------------------------------------
+static vector<uint32_t> ReadMip(const MipGeneratorCPU& mipGenerator, uint32_t level)
+{
+	uint32_t width, height;
+	mipGenerator.GetMipSize(level, width, height);
+	vector<uint32_t> texels(static_cast<size_t>(width) * height);
+	mipGenerator.ReadMipData(level, texels.data(), 4 * width);
+
+	return texels;
+}
+
+// Level n of FUSED_INTEGER is round(sum / 4^n) of the 2^n x 2^n base texels of each texel,
+// those past the image counting as 0 once a dimension is down to 1, as in the shader. The
+// sums of the last levels past 4096x4096 overflow 32 bits.
+static void TestFusedInteger(uint32_t width, uint32_t height, Random& rng)
+{
+	vector<uint32_t> image(static_cast<size_t>(width) * height);
+	for (auto& texel : image) texel = rng();
+
+	// Channel sums of each block, with the partial blocks of the odd sizes
+	auto sumWidth = width, sumHeight = height;
+	vector<uint64_t> sums(4 * image.size());
+	for (size_t i = 0; i < image.size(); ++i)
+		for (uint8_t c = 0; c < 4; ++c) sums[4 * i + c] = (image[i] >> (8 * c)) & 0xff;
+
+	for (uint8_t layout = MipGeneratorCPU::ROW_MAJOR; layout <= MipGeneratorCPU::MORTON_TILED; ++layout)
+	{
+		MipGeneratorCPU mipGenerator;
+		mipGenerator.Init(image.data(), width, height, 4, 4, static_cast<MipGeneratorCPU::StorageLayout>(layout));
+		mipGenerator.Process(MipGeneratorCPU::SINGLE_PASS, MipGeneratorCPU::FUSED_INTEGER);
+
+		auto levelSums = sums;
+		sumWidth = width;
+		sumHeight = height;
+		for (auto level = 1u; level < mipGenerator.GetMipLevelCount(); ++level)
+		{
+			const auto srcWidth = sumWidth, srcHeight = sumHeight;
+			sumWidth = (srcWidth + 1) / 2;
+			sumHeight = (srcHeight + 1) / 2;
+			vector<uint64_t> next(4 * static_cast<size_t>(sumWidth) * sumHeight);
+			for (auto y = 0u; y < srcHeight; ++y)
+				for (auto x = 0u; x < srcWidth; ++x)
+					for (uint8_t c = 0; c < 4; ++c)
+						next[4 * (static_cast<size_t>(sumWidth) * (y / 2) + x / 2) + c] +=
+						levelSums[4 * (static_cast<size_t>(srcWidth) * y + x) + c];
+			levelSums.swap(next);
+
+			uint32_t mipWidth, mipHeight;
+			mipGenerator.GetMipSize(level, mipWidth, mipHeight);
+			vector<uint32_t> expected(static_cast<size_t>(mipWidth) * mipHeight);
+			const auto shift = 2 * level;
+			for (auto y = 0u; y < mipHeight; ++y)
+				for (auto x = 0u; x < mipWidth; ++x)
+					for (uint8_t c = 0; c < 4; ++c)
+					{
+						const auto sum = levelSums[4 * (static_cast<size_t>(sumWidth) * y + x) + c];
+						expected[static_cast<size_t>(mipWidth) * y + x] |=
+							static_cast<uint32_t>((sum + (1ull << (shift - 1))) >> shift) << (8 * c);
+					}
+
+			if (!TEST_CHECK(ReadMip(mipGenerator, level) == expected))
+			{
+				fprintf(stderr, "FUSED_INTEGER of %ux%u, layout %u, differs at level %u\n", width, height, layout, level);
+				break;
+			}
+		}
+	}
+}
+
+// On square sizes of powers of 2, each texel is the mean of its 2x2 parent texels (levels
+// past a dimension down to 1 are not, and SINGLE_PASS pads them with 0): COMPUTE and
+// PACKED, which round at each level, match GRAPHICS; FLOAT_CARRY and FUSED_INTEGER, which
+// round once per group, stay within 2.
+static void TestExactHalves(uint32_t width, uint32_t height, Random& rng)
+{
+	vector<uint32_t> image(static_cast<size_t>(width) * height);
+	for (auto& texel : image) texel = rng();
+
+	MipGeneratorCPU graphics;
+	graphics.Init(image.data(), width, height, 4, 4);
+	graphics.Process(MipGeneratorCPU::GRAPHICS);
+
+	static const struct
+	{
+		MipGeneratorCPU::PipelineType Pipeline;
+		MipGeneratorCPU::ReductionMode Mode;
+		int Tolerance;
+		const char* Name;
+	} cases[] =
+	{
+		{ MipGeneratorCPU::COMPUTE, MipGeneratorCPU::FLOAT_CARRY, 0, "COMPUTE" },
+		{ MipGeneratorCPU::SINGLE_PASS, MipGeneratorCPU::PACKED, 0, "SINGLE_PASS PACKED" },
+		{ MipGeneratorCPU::SINGLE_PASS, MipGeneratorCPU::FLOAT_CARRY, 2, "SINGLE_PASS FLOAT_CARRY" },
+		{ MipGeneratorCPU::SINGLE_PASS, MipGeneratorCPU::FUSED_INTEGER, 2, "SINGLE_PASS FUSED_INTEGER" }
+	};
+
+	for (const auto& c : cases)
+		for (uint8_t layout = MipGeneratorCPU::ROW_MAJOR; layout <= MipGeneratorCPU::MORTON_TILED; ++layout)
+		{
+			MipGeneratorCPU mipGenerator;
+			mipGenerator.Init(image.data(), width, height, 4, 4, static_cast<MipGeneratorCPU::StorageLayout>(layout));
+			mipGenerator.Process(c.Pipeline, c.Mode);
+
+			for (auto level = 1u; level < mipGenerator.GetMipLevelCount(); ++level)
+			{
+				const auto result = ReadMip(mipGenerator, level);
+				const auto expected = ReadMip(graphics, level);
+				auto maxDiff = 0;
+				for (size_t i = 0; i < 4 * result.size(); ++i)
+					maxDiff = (max)(maxDiff, abs(reinterpret_cast<const uint8_t*>(result.data())[i] -
+						reinterpret_cast<const uint8_t*>(expected.data())[i]));
+
+				if (!TEST_CHECK(maxDiff <= c.Tolerance))
+				{
+					fprintf(stderr, "%s of %ux%u, layout %u, differs from GRAPHICS by %d at level %u\n",
+						c.Name, width, height, layout, maxDiff, level);
+					break;
+				}
+			}
+		}
+}
+
+int main()
+{
+	// Scalar references, then each ISA the CPU supports
+	SelectKernels(ISA_SCALAR);
+	const auto ref = GetKernels();
+	for (auto isa = ISA_SSE2; isa < NUM_ISA; isa = static_cast<Isa>(isa + 1))
+	{
+		SelectKernels(isa);
+		const auto& kernels = GetKernels();
+		if (kernels.SelectedIsa != isa) continue;
+
+		g_pIsaName = GetIsaName(isa);
+		const auto numFailures = NumFailures();
+		TestKernels(kernels, ref);
+		printf("%s kernels: %s\n", g_pIsaName, NumFailures() == numFailures ? "passed" : "FAILED");
+	}
+	SelectKernels();
+
+	Random rng;
+	TestFusedInteger(5000, 256, rng);
+	TestFusedInteger(8192, 64, rng);
+	TestExactHalves(256, 256, rng);
+	TestExactHalves(1024, 1024, rng);
+
+	return Report("TestMipKernels");
+}
@@ -0,0 +1,118 @@
+//--------------------------------------------------------------------------------------
+// Copyright (c) XU, Tianchen. All rights reserved.
+//--------------------------------------------------------------------------------------
+
+#include <cstring>
+#include "stb_image.h"
+#include "ParallelDeflate.h"
+#include "TaskScheduler.h"
+#include "TestCommon.h"
+
+using namespace std;
+using namespace TestCommon;
+
+//--------------------------------------------------------------------------------------
+// Round trips of ParallelDeflate::Compress() through the zlib decoder of stb_image, over
+// the sizes around the chunks and the window, on data from incompressible to all zeros,
+// and on the calling thread as on the scheduler of a task.
+//--------------------------------------------------------------------------------------
+enum DataType : uint8_t
+{
+	RANDOM_DATA,
+	ZERO_DATA,
+	RUN_DATA,		// Runs of random lengths and bytes
+	TEXT_DATA,		// Few symbols with repeats at all distances, as in filtered images
+
+	NUM_DATA_TYPE
+};
+
+static const char* const g_dataNames[] = { "random", "zero", "run-length", "text" };
+
+static vector<uint8_t> GenerateData(DataType type, uint32_t size, Random& rng)
+{
+	vector<uint8_t> data(size);
+	switch (type)
+	{
+	case RANDOM_DATA:
+		rng.Fill(data, 256);
+		break;
+	case RUN_DATA:
+		for (auto i = 0u; i < size;)
+		{
+			const auto length = (min)(1 + rng(300), size - i);
+			memset(&data[i], static_cast<int>(rng(256)), length);
+			i += length;
+		}
+		break;
+	case TEXT_DATA:
+		for (auto i = 0u; i < size;)
+		{
+			// Copies of earlier spans, up to past the window, between runs of 16 symbols
+			const auto length = (min)(3 + rng(64), size - i);
+			if (i > 0 && rng(2))
+			{
+				const auto distance = 1 + rng((min)(i, 40000u));
+				for (auto j = 0u; j < length; ++j, ++i) data[i] = data[i - distance];
+			}
+			else for (auto j = 0u; j < length; ++j) data[i++] = static_cast<uint8_t>('a' + rng(16));
+		}
+		break;
+	default:
+		break;
+	}
+
+	return data;
+}
+
+static bool TestRoundTrip(const vector<uint8_t>& data, int quality, const char* pDataName)
+{
+	auto streamSize = 0;
+	const auto pStream = ParallelDeflate::Compress(const_cast<uint8_t*>(data.data()),
+		static_cast<int>(data.size()), &streamSize, quality);
+	if (!TEST_CHECK(pStream != nullptr)) return false;
+
+	// A byte to spare, so that a longer output is caught
+	vector<uint8_t> decoded(data.size() + 1);
+	const auto decodedSize = stbi_zlib_decode_buffer(reinterpret_cast<char*>(decoded.data()), static_cast<int>(decoded.size()),
+		reinterpret_cast<const char*>(pStream), streamSize);
+	free(pStream);
+
+	const auto isEqual = decodedSize == static_cast<int>(data.size()) && memcmp(decoded.data(), data.data(), data.size()) == 0;
+	if (!isEqual) fprintf(stderr, "%zu bytes of %s data at level %d: decoded %d bytes\n", data.size(), pDataName, quality, decodedSize);
+
+	return TEST_CHECK(isEqual);
+}
+
+int main()
+{
+	const auto chunkSize = ParallelDeflate::ChunkSize;
+	const auto windowSize = 1u << 15;
+	const uint32_t sizes[] = { 0, 1, 2, 3, 4, 5, 258, 259, windowSize - 1, windowSize, windowSize + 1,
+		chunkSize - 1, chunkSize, chunkSize + 1, chunkSize + windowSize, 2 * chunkSize - 1,
+		2 * chunkSize, 2 * chunkSize + 3, 3 << 20 };
+	const int qualities[] = { 1, 5, 8, 10 };
+
+	Random rng;
+	TaskScheduler scheduler(4);
+	for (uint8_t type = 0; type < NUM_DATA_TYPE; ++type)
+		for (const auto size : sizes)
+		{
+			const auto data = GenerateData(static_cast<DataType>(type), size, rng);
+			const auto pDataName = g_dataNames[type];
+
+			// On the calling thread, then in parallel from a task of the scheduler
+			for (const auto quality : qualities) TestRoundTrip(data, quality, pDataName);
+			scheduler.ParallelFor(static_cast<uint32_t>(std::size(qualities)), [&](uint32_t i)
+			{
+				TestRoundTrip(data, qualities[i], pDataName);
+			});
+		}
+
+	// Levels out of range are clamped
+	const auto data = GenerateData(TEXT_DATA, 100000, rng);
+	TestRoundTrip(data, -1, g_dataNames[TEXT_DATA]);
+	TestRoundTrip(data, 0, g_dataNames[TEXT_DATA]);
+	TestRoundTrip(data, 11, g_dataNames[TEXT_DATA]);
+
+	return Report("TestParallelDeflate");
+}
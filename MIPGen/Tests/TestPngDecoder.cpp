@@ -0,0 +1,160 @@
+//--------------------------------------------------------------------------------------
+// Copyright (c) XU, Tianchen. All rights reserved.
+//--------------------------------------------------------------------------------------
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include "stb_image.h"
+#include "PngDecoder.h"
+#include "TestCommon.h"
+
+using namespace std;
+using namespace TestCommon;
+
+//--------------------------------------------------------------------------------------
+// PngDecoder against stb_image over the corpus of Png/GeneratePngCorpus.py, for each
+// requested channel count; then truncated and corrupted copies of some of its files,
+// which must either fail or decode as the intact file, never differently.
+//--------------------------------------------------------------------------------------
+static const char* const g_fallbackFiles[] = { "palette8.png", "rgb8_trns.png", "gray4.png" };
+static const char* const g_fuzzedFiles[] = { "rgb8_stored.png", "rgba8_dynamic.png", "gray16_fixed.png",
+	"ga8_rle.png", "gray8_flush.png", "gray8_split.png", "bad_adler_stored.png" };
+static const char* const g_tempFileName = "TestPngDecoder.tmp.png";
+
+struct Image
+{
+	Image() : pData(nullptr), Width(0), Height(0), Channels(0), Size(0) {}
+	~Image() { free(pData); }
+
+	void* pData;
+	int Width;
+	int Height;
+	int Channels;
+	size_t Size;
+};
+
+static void Load(const char* fileName, bool is16Bit, int reqChannels, Image& image)
+{
+	image.pData = is16Bit ?
+		static_cast<void*>(PngDecoder::Load16(fileName, &image.Width, &image.Height, &image.Channels, reqChannels)) :
+		static_cast<void*>(PngDecoder::Load(fileName, &image.Width, &image.Height, &image.Channels, reqChannels));
+	image.Size = static_cast<size_t>(image.Width) * image.Height * (reqChannels ? reqChannels : image.Channels) * (is16Bit ? 2 : 1);
+}
+
+static bool IsEqual(const Image& a, const Image& b)
+{
+	return a.Width == b.Width && a.Height == b.Height && a.Channels == b.Channels &&
+		a.Size == b.Size && memcmp(a.pData, b.pData, a.Size) == 0;
+}
+
+static void TestFile(const string& fileName, const string& name)
+{
+	const auto isBadAdler = name.compare(0, 9, "bad_adler") == 0;
+	auto mayFallBack = false;
+	for (const auto pName : g_fallbackFiles) mayFallBack = mayFallBack || name == pName;
+
+	int width, height, channels;
+	if (!TEST_CHECK(stbi_info(fileName.c_str(), &width, &height, &channels))) return;
+	const auto is16Bit = stbi_is_16_bit(fileName.c_str()) != 0;
+
+	for (auto reqChannels = 0; reqChannels <= 4; ++reqChannels)
+	{
+		Image image, image16;
+		Load(fileName.c_str(), is16Bit, reqChannels, image);
+
+		// Never at the other depth
+		Load(fileName.c_str(), !is16Bit, reqChannels, image16);
+		TEST_CHECK(image16.pData == nullptr);
+
+		// Channels are only added, and gray-alpha does not expand to RGB
+		const auto isTaken = !isBadAdler && !mayFallBack && (reqChannels == 0 ||
+			(reqChannels >= channels && !(channels == 2 && reqChannels == 3)));
+		if (!TEST_CHECK(isTaken ? image.pData != nullptr : (image.pData == nullptr || mayFallBack)))
+		{
+			fprintf(stderr, "%s with %d channels %s\n", name.c_str(), reqChannels, isTaken ? "is not decoded" : "is decoded");
+			continue;
+		}
+		if (!image.pData) continue;
+
+		Image reference;
+		reference.pData = is16Bit ?
+			static_cast<void*>(stbi_load_16(fileName.c_str(), &reference.Width, &reference.Height, &reference.Channels, reqChannels)) :
+			static_cast<void*>(stbi_load(fileName.c_str(), &reference.Width, &reference.Height, &reference.Channels, reqChannels));
+		reference.Size = image.Size;
+		if (!TEST_CHECK(reference.pData && IsEqual(image, reference)))
+			fprintf(stderr, "%s with %d channels differs from stb_image\n", name.c_str(), reqChannels);
+	}
+}
+
+static bool WriteFile(const vector<char>& data, size_t size)
+{
+	ofstream file(g_tempFileName, ios::binary | ios::trunc);
+
+	return file.write(data.data(), size).good();
+}
+
+static void TestDamagedFile(const string& fileName, const string& name, Random& rng)
+{
+	ifstream file(fileName, ios::binary);
+	const vector<char> data((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
+	if (!TEST_CHECK(!data.empty())) return;
+
+	const auto is16Bit = stbi_is_16_bit(fileName.c_str()) != 0;
+	Image intact;
+	Load(fileName.c_str(), is16Bit, 0, intact);
+
+	const auto check = [&](const char* pDamage, size_t pos)
+	{
+		Image image;
+		Load(g_tempFileName, is16Bit, 0, image);
+		const auto isValid = image.pData == nullptr || (intact.pData && IsEqual(image, intact));
+		if (!isValid) fprintf(stderr, "%s %s at %zu decodes differently\n", name.c_str(), pDamage, pos);
+
+		return TEST_CHECK(isValid);
+	};
+
+	// Every prefix
+	for (size_t size = 0; size < data.size(); ++size)
+		if (!TEST_CHECK(WriteFile(data, size)) || !check("truncated", size)) break;
+
+	// Bytes past the signature flipped or overwritten
+	auto damaged = data;
+	for (auto i = 0u; i < 2000; ++i)
+	{
+		const auto pos = 8 + rng(static_cast<uint32_t>(data.size()) - 8);
+		damaged[pos] = static_cast<char>(rng(2) ? data[pos] ^ (1 << rng(8)) : rng(256));
+		const auto isWritten = TEST_CHECK(WriteFile(damaged, damaged.size()));
+		damaged[pos] = data[pos];
+		if (!isWritten || !check("corrupted", pos)) break;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	if (argc < 2)
+	{
+		fprintf(stderr, "Usage: %s <corpus directory>\n", argv[0]);
+
+		return EXIT_FAILURE;
+	}
+
+	const filesystem::path corpusDir(argv[1]);
+	auto numFiles = 0u;
+	for (const auto& entry : filesystem::directory_iterator(corpusDir))
+		if (entry.path().extension() == ".png")
+		{
+			TestFile(entry.path().string(), entry.path().filename().string());
+			++numFiles;
+		}
+	TEST_CHECK(numFiles > 0);
+
+	Random rng;
+	for (const auto pName : g_fuzzedFiles) TestDamagedFile((corpusDir / pName).string(), pName, rng);
+	filesystem::remove(g_tempFileName);
+
+	printf("%u files of %s\n", numFiles, argv[1]);
+
+	return Report("TestPngDecoder");
+}
@@ -11,6 +11,8 @@
 
 #ifdef _ENABLE_STB_IMAGE_LOADER_
 #include "stb_image.h"
+#include "PngDecoder.h"
+#include "JpegDecoder.h"
 
 namespace XUSG
 {
@@ -28,23 +30,79 @@ namespace XUSG
 		const auto infoStat = LoadImageInfoFromFile(fileName, width, height, channels, reqChannels);
 		assert(infoStat);
 
-		return stbi_load(fileName, &width, &height, &channels, reqChannels);
+		// PNG files through the SIMD decoder, the others and those it leaves through stb_image
+		const auto pImageData = PngDecoder::Load(fileName, &width, &height, &channels, reqChannels);
+
+		return pImageData ? pImageData : stbi_load(fileName, &width, &height, &channels, reqChannels);
 	}
 
-	inline Format GetImageFormat(int reqChannels)
+	// For the callers needing only the levels from mipLevel down: JPEG files are decoded
+	// straight at that level, of 1/2, 1/4 or 1/8 of the size (mipLevel is capped at 3), from
+	// the low frequencies of their blocks. mipLevel returns the level of the loaded image,
+	// 0 for the other files, loaded in full.
+	inline stbi_uc* LoadImageFromFile(const char* fileName, int& width, int& height, int& reqChannels, uint8_t& mipLevel)
 	{
-		switch (reqChannels)
+		int channels;
+		const auto infoStat = LoadImageInfoFromFile(fileName, width, height, channels, reqChannels);
+		assert(infoStat);
+
+		if (mipLevel > JpegDecoder::MaxScaleShift) mipLevel = JpegDecoder::MaxScaleShift;
+		if (mipLevel > 0)
 		{
-		case 1:
-			return Format::R8_UNORM;
-		case 2:
-			return Format::R8G8_UNORM;
-		case 4:
-			return Format::R8G8B8A8_UNORM;
-		default:
-			assert(!"Wrong channels, unknown format!");
+			const auto pImageData = JpegDecoder::Load(fileName, mipLevel, &width, &height, &channels, reqChannels);
+			if (pImageData) return pImageData;
+			mipLevel = 0;
+		}
+
+		return LoadImageFromFile(fileName, width, height, reqChannels);
+	}
+
+	// Radiance HDR files, as 32-bit float channels
+	inline float* LoadImageFromFileHDR(const char* fileName, int& width, int& height, int& reqChannels)
+	{
+		int channels;
+		const auto infoStat = LoadImageInfoFromFile(fileName, width, height, channels, reqChannels);
+		assert(infoStat);
+
+		return stbi_loadf(fileName, &width, &height, &channels, reqChannels);
+	}
+
+	// 16-bit PNG, PSD and PNM files, with full precision
+	inline stbi_us* LoadImageFromFile16(const char* fileName, int& width, int& height, int& reqChannels)
+	{
+		int channels;
+		const auto infoStat = LoadImageInfoFromFile(fileName, width, height, channels, reqChannels);
+		assert(infoStat);
+
+		const auto pImageData = PngDecoder::Load16(fileName, &width, &height, &channels, reqChannels);
+
+		return pImageData ? pImageData : stbi_load_16(fileName, &width, &height, &channels, reqChannels);
+	}
+
+	// Bits per channel of the loaded image: 32 (float) for HDR files, 16 or 8
+	inline int GetImageBitsPerChannel(const char* fileName)
+	{
+		return stbi_is_hdr(fileName) ? 32 : (stbi_is_16_bit(fileName) ? 16 : 8);
+	}
+
+	inline Format GetImageFormat(int reqChannels, int bitsPerChannel = 8)
+	{
+		static const Format formats[][3] =
+		{
+			{ Format::R8_UNORM, Format::R16_UNORM, Format::R32_FLOAT },
+			{ Format::R8G8_UNORM, Format::R16G16_UNORM, Format::R32G32_FLOAT },
+			{ Format::UNKNOWN, Format::UNKNOWN, Format::UNKNOWN },
+			{ Format::R8G8B8A8_UNORM, Format::R16G16B16A16_UNORM, Format::R32G32B32A32_FLOAT }
+		};
+
+		if (reqChannels < 1 || reqChannels > 4 || reqChannels == 3 ||
+			(bitsPerChannel != 8 && bitsPerChannel != 16 && bitsPerChannel != 32))
+		{
+			assert(!"Wrong channels or bits, unknown format!");
 			return Format::UNKNOWN;
 		}
+
+		return formats[reqChannels - 1][bitsPerChannel / 16];
 	}
 
 	inline bool CreateTextureFromFile(CommandList* pCommandList, const char* fileName,
@@ -52,13 +110,26 @@ namespace XUSG
 		MemoryFlag memoryFlags = MemoryFlag::NONE, const wchar_t* name = nullptr)
 	{
 		int width, height, reqChannels;
-		const auto pTexData = LoadImageFromFile(fileName, width, height, reqChannels);
+		void* pTexData;
+		const auto bitsPerChannel = GetImageBitsPerChannel(fileName);
+		switch (bitsPerChannel)
+		{
+		case 32:
+			pTexData = LoadImageFromFileHDR(fileName, width, height, reqChannels);
+			break;
+		case 16:
+			pTexData = LoadImageFromFile16(fileName, width, height, reqChannels);
+			break;
+		default:
+			pTexData = LoadImageFromFile(fileName, width, height, reqChannels);
+		}
+		const auto byteStride = static_cast<uint8_t>(reqChannels * bitsPerChannel / 8);
 
 		XUSG_N_RETURN(pTexture->Create(pCommandList->GetDevice(), width, height,
-			GetImageFormat(reqChannels), 1, ResourceFlag::NONE, 1, 1, false,
+			GetImageFormat(reqChannels, bitsPerChannel), 1, ResourceFlag::NONE, 1, 1, false,
 			memoryFlags, name), false);
 
-		XUSG_N_RETURN(pTexture->Upload(pCommandList, pUploader, pTexData, reqChannels, state), false);
+		XUSG_N_RETURN(pTexture->Upload(pCommandList, pUploader, pTexData, byteStride, state), false);
 		free(pTexData);
 
 		return true;